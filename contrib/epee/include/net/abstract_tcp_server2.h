@@ -57,6 +57,8 @@
 
 
 #define ABSTRACT_SERVER_SEND_QUE_MAX_COUNT 1000
+#define ABSTRACT_SERVER_SEND_QUE_FULL_TIMEOUT 5 // seconds the send queue may stay over ABSTRACT_SERVER_SEND_QUE_MAX_COUNT
+#define ABSTRACT_SERVER_SEND_GATHER_COUNT 16	 // max queued chunks written by one async_write
 
 namespace epee
 {
@@ -113,7 +115,8 @@ class connection
   private:
 	//----------------- i_service_endpoint ---------------------
 	virtual bool do_send(const void *ptr, size_t cb);		///< (see do_send from i_service_endpoint)
-	virtual bool do_send_chunk(const void *ptr, size_t cb); ///< will send (or queue) a part of data
+	virtual bool do_send_buffer(const shared_send_buffer &buf); ///< queues buf without copying it, split in chunks for P2P
+	bool do_send_chunk(const shared_send_buffer &buf, size_t offset, size_t cb); ///< will send (or queue) a part of data
 	virtual bool close();
 	virtual bool call_run_once_service_io();
 	virtual bool request_callback();
@@ -130,6 +133,13 @@ class connection
 	/// Handle completion of a write operation.
 	void handle_write(const boost::system::error_code &e, size_t cb);
 
+	/// Issue the next read, or defer it on a timer while the in speed limit is exceeded.
+	void start_read(size_t bytes_transferred);
+
+	/// Write the front of the send queue, or defer it on a timer while the out speed limit is exceeded.
+	/// Must be called with m_send_que_lock held and no write in flight.
+	void start_write();
+
 	/// reset connection timeout timer and callback
 	void reset_timer(boost::posix_time::milliseconds ms, bool add);
 	boost::posix_time::milliseconds get_default_time() const;
@@ -159,6 +169,10 @@ class connection
 	boost::mutex m_throttle_speed_out_mutex;
 
 	boost::asio::deadline_timer m_timer;
+	// deferral timers used instead of sleeping in the io_service threads when the speed limit is hit
+	boost::asio::deadline_timer m_throttle_read_timer;
+	boost::asio::deadline_timer m_throttle_write_timer;
+	time_t m_send_que_full_since; ///< when the send queue first went over ABSTRACT_SERVER_SEND_QUE_MAX_COUNT, 0 if it is not
 	bool m_local;
 
   public:
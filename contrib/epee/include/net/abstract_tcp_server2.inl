@@ -41,6 +41,7 @@
 #include <boost/foreach.hpp>
 #include <boost/lambda/bind.hpp>
 #include <boost/lambda/lambda.hpp>
+#include <boost/make_shared.hpp>
 #include <boost/thread/condition_variable.hpp> // TODO
 #include <boost/thread/thread.hpp>			   // TODO
 #include <boost/utility/value_init.hpp>
@@ -83,6 +84,9 @@ connection<t_protocol_handler>::connection(boost::asio::io_service &io_service,
 	  m_throttle_speed_in("speed_in", "throttle_speed_in"),
 	  m_throttle_speed_out("speed_out", "throttle_speed_out"),
 	  m_timer(io_service),
+	  m_throttle_read_timer(io_service),
+	  m_throttle_write_timer(io_service),
+	  m_send_que_full_since(0),
 	  m_local(false)
 {
 	GULPSF_LOG_L1("test, connection constructor set m_connection_type={}", m_connection_type);
@@ -294,27 +298,6 @@ void connection<t_protocol_handler>::handle_read(const boost::system::error_code
 			epee::net_utils::network_throttle_manager::network_throttle_manager::get_global_throttle_in().handle_trafic_exact(bytes_transferred);
 		}
 
-		double delay = 0; // will be calculated - how much we should sleep to obey speed limit etc
-
-		if(speed_limit_is_enabled())
-		{
-			do // keep sleeping if we should sleep
-			{
-				{ //_scopeGULPSF_LOG_L1("CRITICAL_REGION_LOCAL");
-					CRITICAL_REGION_LOCAL(epee::net_utils::network_throttle_manager::m_lock_get_global_throttle_in);
-					delay = epee::net_utils::network_throttle_manager::get_global_throttle_in().get_sleep_time_after_tick(bytes_transferred);
-				}
-
-				delay *= 0.5;
-				if(delay > 0)
-				{
-					long int ms = (long int)(delay * 100);
-					reset_timer(boost::posix_time::milliseconds(ms + 1), true);
-					boost::this_thread::sleep_for(boost::chrono::milliseconds(ms));
-				}
-			} while(delay > 0);
-		} // any form of sleeping
-
 		//GULPS_INFO("[sock " << socket_.native_handle() << "] RECV " << bytes_transferred);
 		logger_handle_net_read(bytes_transferred);
 		context.m_last_recv = time(NULL);
@@ -336,13 +319,8 @@ void connection<t_protocol_handler>::handle_read(const boost::system::error_code
 		}
 		else
 		{
-			reset_timer(get_timeout_from_bytes_read(bytes_transferred), false);
-			socket_.async_read_some(boost::asio::buffer(buffer_),
-									strand_.wrap(
-										boost::bind(&connection<t_protocol_handler>::handle_read, connection<t_protocol_handler>::shared_from_this(),
-													boost::asio::placeholders::error,
-													boost::asio::placeholders::bytes_transferred)));
-			//GULPS_INFO("[sock " << socket_.native_handle() << "]Async read requested.");
+			// the in speed limit is obeyed by deferring the next read, the data we already have is handled right away
+			start_read(bytes_transferred);
 		}
 	}
 	else
@@ -362,6 +340,44 @@ void connection<t_protocol_handler>::handle_read(const boost::system::error_code
 }
 //---------------------------------------------------------------------------------
 template <class t_protocol_handler>
+void connection<t_protocol_handler>::start_read(size_t bytes_transferred)
+{
+	double delay = 0; // how long we should wait to obey the speed limit
+
+	if(speed_limit_is_enabled())
+	{
+		CRITICAL_REGION_LOCAL(epee::net_utils::network_throttle_manager::m_lock_get_global_throttle_in);
+		delay = epee::net_utils::network_throttle_manager::get_global_throttle_in().get_sleep_time_after_tick(bytes_transferred);
+	}
+
+	delay *= 0.5;
+	if(delay > 0)
+	{
+		// Never sleep in an io_service thread, other connections are served by it too.
+		// Not reading lets the kernel socket buffer fill up, which backs off the peer through TCP flow control.
+		long int ms = (long int)(delay * 1000);
+		GULPS_LOG_L2("[sock ", socket_.native_handle(), "] deferring read for ", ms, " ms");
+		reset_timer(boost::posix_time::milliseconds(ms + 1), true);
+		auto self = connection<t_protocol_handler>::shared_from_this();
+		m_throttle_read_timer.expires_from_now(boost::posix_time::milliseconds(ms + 1));
+		m_throttle_read_timer.async_wait(strand_.wrap([this, self, bytes_transferred](const boost::system::error_code &ec) {
+			if(ec == boost::asio::error::operation_aborted || m_was_shutdown)
+				return;
+			start_read(bytes_transferred);
+		}));
+		return;
+	}
+
+	reset_timer(get_timeout_from_bytes_read(bytes_transferred), false);
+	socket_.async_read_some(boost::asio::buffer(buffer_),
+							strand_.wrap(
+								boost::bind(&connection<t_protocol_handler>::handle_read, connection<t_protocol_handler>::shared_from_this(),
+											boost::asio::placeholders::error,
+											boost::asio::placeholders::bytes_transferred)));
+	//GULPS_INFO("[sock " << socket_.native_handle() << "]Async read requested.");
+}
+//---------------------------------------------------------------------------------
+template <class t_protocol_handler>
 bool connection<t_protocol_handler>::call_run_once_service_io()
 {
 	GULPS_TRY_ENTRY();
@@ -390,6 +406,19 @@ bool connection<t_protocol_handler>::call_run_once_service_io()
 //---------------------------------------------------------------------------------
 template <class t_protocol_handler>
 bool connection<t_protocol_handler>::do_send(const void *ptr, size_t cb)
+{
+	GULPS_TRY_ENTRY();
+	if(m_was_shutdown)
+		return false;
+
+	// the only copy of the data, the queued chunks are slices of this buffer
+	return do_send_buffer(boost::make_shared<const std::string>(static_cast<const char *>(ptr), cb));
+
+	GULPS_CATCH_ENTRY_L0("connection<t_protocol_handler>::do_send", false);
+}
+//---------------------------------------------------------------------------------
+template <class t_protocol_handler>
+bool connection<t_protocol_handler>::do_send_buffer(const shared_send_buffer &buf)
 {
 	GULPS_TRY_ENTRY();
 
@@ -399,7 +428,9 @@ bool connection<t_protocol_handler>::do_send(const void *ptr, size_t cb)
 		return false;
 	if(m_was_shutdown)
 		return false;
-	// TODO avoid copy
+
+	const void *ptr = buf->data();
+	const size_t cb = buf->size();
 
 	const double factor = 32;			 // TODO config
 	typedef long long signed int t_safe; // my t_size to avoid any overunderflow in arithmetic
@@ -439,14 +470,9 @@ bool connection<t_protocol_handler>::do_send(const void *ptr, size_t cb)
 				GULPS_CHECK_AND_ASSERT_MES(len > 0, false, "len not strictly positive");										// (redundant)
 				GULPS_CHECK_AND_ASSERT_MES(len_unsigned < std::numeric_limits<size_t>::max(), false, "Invalid len_unsigned"); // yeap we want strong < then max size, to be sure
 
-				void *chunk_start = ((char *)ptr) + pos;
-				GULPSF_LOG_L1("chunk_start={} ptr={} pos={}", chunk_start , ptr , pos);
-				GULPS_CHECK_AND_ASSERT_MES(chunk_start >= ptr, false, "Pointer wraparound"); // not wrapped around address?
-				//std::memcpy( (void*)buf, chunk_start, len);
-
 				GULPSF_LOG_L1("part of {}: pos={} len={}", lenall , pos , len);
 
-				bool ok = do_send_chunk(chunk_start, len); // <====== ***
+				bool ok = do_send_chunk(buf, pos, len); // <====== *** no copy, the chunk shares buf
 
 				all_ok = all_ok && ok;
 				if(!all_ok)
@@ -470,15 +496,15 @@ bool connection<t_protocol_handler>::do_send(const void *ptr, size_t cb)
 	}					   // a big block (to be chunked) - all chunks
 	else
 	{								   // small block
-		return do_send_chunk(ptr, cb); // just send as 1 big chunk
+		return do_send_chunk(buf, 0, cb); // just send as 1 big chunk
 	}
 
-	GULPS_CATCH_ENTRY_L0("connection<t_protocol_handler>::do_send", false);
-} // do_send()
+	GULPS_CATCH_ENTRY_L0("connection<t_protocol_handler>::do_send_buffer", false);
+} // do_send_buffer()
 
 //---------------------------------------------------------------------------------
 template <class t_protocol_handler>
-bool connection<t_protocol_handler>::do_send_chunk(const void *ptr, size_t cb)
+bool connection<t_protocol_handler>::do_send_chunk(const shared_send_buffer &buf, size_t offset, size_t cb)
 {
 	GULPS_TRY_ENTRY();
 	// Use safe_shared_from_this, because of this is public method and it can be called on the object being deleted
@@ -499,39 +525,28 @@ bool connection<t_protocol_handler>::do_send_chunk(const void *ptr, size_t cb)
 	//some data should be wrote to stream
 	//request complete
 
-	// No sleeping here; sleeping is done once and for all in "handle_write"
+	// No waiting here; the out speed limit is obeyed by deferring writes in "start_write"
 
 	m_send_que_lock.lock(); // *** critical ***
 	epee::misc_utils::auto_scope_leave_caller scope_exit_handler = epee::misc_utils::create_scope_leave_handler([&]() { m_send_que_lock.unlock(); });
 
-	long int retry = 0;
-	const long int retry_limit = 5 * 4;
-	while(m_send_que.size() > ABSTRACT_SERVER_SEND_QUE_MAX_COUNT)
+	if(m_send_que.size() > ABSTRACT_SERVER_SEND_QUE_MAX_COUNT)
 	{
-		retry++;
-
-		/* if ( ::cryptonote::core::get_is_stopping() ) { // TODO re-add fast stop
-            GULPS_LOG_L1("ABORT queue wait due to stopping");
-            return false; // aborted
-        }*/
-
-		long int ms = 250 + (rand() % 50);
-		GULPSF_LOG_L1("Sleeping because QUEUE is FULL, in {} for {} ms before packet_size={}", __FUNCTION__ , ms , cb); // XXX debug sleep
-		m_send_que_lock.unlock();
-		boost::this_thread::sleep(boost::posix_time::milliseconds(ms));
-		m_send_que_lock.lock();
-		GULPSF_LOG_L1("sleep for queue: {}", ms);
-
-		if(retry > retry_limit)
+		// We do not wait for the queue to drain, the caller may be an io_service thread.
+		// A peer that does not read for ABSTRACT_SERVER_SEND_QUE_FULL_TIMEOUT seconds, or lets twice the limit pile up, is dropped.
+		const time_t now = time(NULL);
+		if(!m_send_que_full_since)
+			m_send_que_full_since = now;
+		if(now - m_send_que_full_since > ABSTRACT_SERVER_SEND_QUE_FULL_TIMEOUT || m_send_que.size() > 2 * ABSTRACT_SERVER_SEND_QUE_MAX_COUNT)
 		{
 			GULPSF_WARN("send que size is more than ABSTRACT_SERVER_SEND_QUE_MAX_COUNT({}), shutting down connection", ABSTRACT_SERVER_SEND_QUE_MAX_COUNT );
 			shutdown();
 			return false;
 		}
+		GULPSF_LOG_L1("QUEUE is FULL in {}, queue-size={} before packet_size={}", __FUNCTION__, m_send_que.size(), cb);
 	}
 
-	m_send_que.resize(m_send_que.size() + 1);
-	m_send_que.back().assign((const char *)ptr, cb);
+	m_send_que.push_back(send_que_chunk{buf, offset, cb});
 
 	if(m_send_que.size() > 1)
 	{ // active operation should be in progress, nothing to do, just wait last operation callback
@@ -539,7 +554,7 @@ bool connection<t_protocol_handler>::do_send_chunk(const void *ptr, size_t cb)
 		GULPSF_LOG_L1("do_send() NOW just queues: packet={} B, is added to queue-size={}", size_now , m_send_que.size());
 		//do_send_handler_delayed( ptr , size_now ); // (((H))) // empty function
 
-		GULPS_LOG_L2(context, "[sock ", socket_.native_handle(), "] Async send requested ", m_send_que.front().size());
+		GULPS_LOG_L2(context, "[sock ", socket_.native_handle(), "] Async send requested ", m_send_que.front().size);
 	}
 	else
 	{ // no active operation
@@ -550,21 +565,8 @@ bool connection<t_protocol_handler>::do_send_chunk(const void *ptr, size_t cb)
 			return false;
 		}
 
-		auto size_now = m_send_que.front().size();
-		GULPSF_LOG_L1("do_send() NOW SENSD: packet={} B", size_now );
-		if(speed_limit_is_enabled())
-			do_send_handler_write(ptr, size_now); // (((H)))
-
-		GULPS_CHECK_AND_ASSERT_MES(size_now == m_send_que.front().size(), false, "Unexpected queue size");
-		reset_timer(get_default_time(), false);
-		boost::asio::async_write(socket_, boost::asio::buffer(m_send_que.front().data(), size_now),
-								 //strand_.wrap(
-								 boost::bind(&connection<t_protocol_handler>::handle_write, self, _1, _2)
-								 //)
-								 );
-		//GULPSF_LOG_L2("(chunk): {}", size_now);
-		//logger_handle_net_write(size_now);
-		//GULPS_INFO("[sock " << socket_.native_handle() << "] Async send requested " << m_send_que.front().size());
+		GULPSF_LOG_L1("do_send() NOW SENSD: packet={} B", m_send_que.front().size);
+		start_write();
 	}
 
 	//do_send_handler_stop( ptr , cb ); // empty function
@@ -575,6 +577,53 @@ bool connection<t_protocol_handler>::do_send_chunk(const void *ptr, size_t cb)
 } // do_send_chunk
 //---------------------------------------------------------------------------------
 template <class t_protocol_handler>
+void connection<t_protocol_handler>::start_write()
+{
+	auto size_now = m_send_que.front().size;
+
+	double delay = 0;
+	if(speed_limit_is_enabled())
+		delay = get_send_delay(size_now);
+
+	if(delay > 0)
+	{
+		// the front stays queued, anything sent meanwhile is appended behind it
+		long int ms = (long int)(delay * 1000);
+		GULPS_LOG_L2("[sock ", socket_.native_handle(), "] deferring write of ", size_now, " B for ", ms, " ms");
+		auto self = connection<t_protocol_handler>::shared_from_this();
+		m_throttle_write_timer.expires_from_now(boost::posix_time::milliseconds(ms + 1));
+		m_throttle_write_timer.async_wait([this, self](const boost::system::error_code &ec) {
+			if(ec == boost::asio::error::operation_aborted || m_was_shutdown)
+				return;
+			CRITICAL_REGION_LOCAL(m_send_que_lock);
+			if(!m_send_que.empty())
+				start_write();
+		});
+		return;
+	}
+
+	if(speed_limit_is_enabled())
+		do_send_handler_write(m_send_que.front().data(), size_now); // (((H)))
+
+	// Rate limited connections write one chunk at a time so the limit keeps its granularity,
+	// the others gather several queued chunks into a single write
+	const size_t gather_max = speed_limit_is_enabled() ? 1 : ABSTRACT_SERVER_SEND_GATHER_COUNT;
+	std::vector<boost::asio::const_buffer> buffers;
+	buffers.reserve((std::min)(gather_max, m_send_que.size()));
+	for(auto it = m_send_que.begin(); it != m_send_que.end() && buffers.size() < gather_max; ++it)
+		buffers.emplace_back(it->data(), it->size);
+	m_send_que_in_flight = buffers.size();
+
+	reset_timer(get_default_time(), false);
+	boost::asio::async_write(socket_, buffers,
+							 //strand_.wrap(
+							 boost::bind(&connection<t_protocol_handler>::handle_write, connection<t_protocol_handler>::shared_from_this(), _1, _2)
+							 //)
+							 );
+	//GULPS_INFO("[sock " << socket_.native_handle() << "] Async send requested " << size_now);
+}
+//---------------------------------------------------------------------------------
+template <class t_protocol_handler>
 boost::posix_time::milliseconds connection<t_protocol_handler>::get_default_time() const
 {
 	if(m_local)
@@ -621,6 +670,8 @@ bool connection<t_protocol_handler>::shutdown()
 {
 	// Initiate graceful connection closure.
 	m_timer.cancel();
+	m_throttle_read_timer.cancel();
+	m_throttle_write_timer.cancel();
 	boost::system::error_code ignored_ec;
 	socket_.shutdown(boost::asio::ip::tcp::socket::shutdown_both, ignored_ec);
 	m_was_shutdown = true;
@@ -668,11 +719,9 @@ void connection<t_protocol_handler>::handle_write(const boost::system::error_cod
 	}
 	logger_handle_net_write(cb);
 
-	// The single sleeping that is needed for correctly handling "out" speed throttling
+	// account the packet for "out" speed throttling, the next write is deferred in start_write if needed
 	if(speed_limit_is_enabled())
-	{
-		sleep_before_packet(cb, 1, 1);
-	}
+		handle_sent_packet(cb);
 
 	bool do_shutdown = false;
 	CRITICAL_REGION_BEGIN(m_send_que_lock);
@@ -682,7 +731,12 @@ void connection<t_protocol_handler>::handle_write(const boost::system::error_cod
 		return;
 	}
 
-	m_send_que.pop_front();
+	// the buffers are only released here, after the write that referenced them completed
+	for(size_t i = 0; i < m_send_que_in_flight && !m_send_que.empty(); ++i)
+		m_send_que.pop_front();
+	m_send_que_in_flight = 0;
+	if(m_send_que.size() <= ABSTRACT_SERVER_SEND_QUE_MAX_COUNT)
+		m_send_que_full_since = 0;
 	if(m_send_que.empty())
 	{
 		if(boost::interprocess::ipcdetail::atomic_read32(&m_want_close_connection))
@@ -693,18 +747,8 @@ void connection<t_protocol_handler>::handle_write(const boost::system::error_cod
 	else
 	{
 		//have more data to send
-		reset_timer(get_default_time(), false);
-		auto size_now = m_send_que.front().size();
-		GULPS_LOG_L1("handle_write NOW SENDS: packet=", size_now, " B, from  queue size=", m_send_que.size());
-		if(speed_limit_is_enabled())
-			do_send_handler_write_from_queue(e, m_send_que.front().size(), m_send_que.size()); // (((H)))
-		GULPS_CHECK_AND_ASSERT_MES(size_now == m_send_que.front().size(), void(), "Unexpected queue size");
-		boost::asio::async_write(socket_, boost::asio::buffer(m_send_que.front().data(), size_now),
-								 // strand_.wrap(
-								 boost::bind(&connection<t_protocol_handler>::handle_write, connection<t_protocol_handler>::shared_from_this(), _1, _2)
-								 // )
-								 );
-		//GULPSF_LOG_L2("(normal){}", size_now);
+		GULPS_LOG_L1("handle_write NOW SENDS: packet=", m_send_que.front().size, " B, from  queue size=", m_send_que.size());
+		start_write();
 	}
 	CRITICAL_REGION_END();
 
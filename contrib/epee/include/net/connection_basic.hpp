@@ -82,6 +82,16 @@ enum t_connection_type
 
 std::string to_string(t_connection_type type);
 
+/// A slice of a shared send buffer, the buffer is kept alive until the slice is written
+struct send_que_chunk
+{
+	shared_send_buffer buffer;
+	size_t offset;
+	size_t size;
+
+	const char *data() const { return buffer->data() + offset; }
+};
+
 class connection_basic
 {
 	GULPS_CAT_MAJOR("epee_conn_basics");
@@ -93,7 +103,8 @@ class connection_basic
 	volatile uint32_t m_want_close_connection;
 	std::atomic<bool> m_was_shutdown;
 	critical_section m_send_que_lock;
-	std::list<std::string> m_send_que;
+	std::list<send_que_chunk> m_send_que;
+	size_t m_send_que_in_flight; // number of m_send_que entries handed to the current async_write
 	volatile bool m_is_multithreaded;
 	double m_start_time;
 	/// Strand to ensure the connection's handlers are not called concurrently.
@@ -128,8 +139,9 @@ class connection_basic
 	static void set_tos_flag(int tos); // ToS / QoS flag
 	static int get_tos_flag();
 
-	// handlers and sleep
-	void sleep_before_packet(size_t packet_size, int phase, int q_len); // execute a sleep ; phase is not really used now(?)
+	// handlers for the out rate limit; callers defer the next write on a timer instead of sleeping
+	double get_send_delay(size_t packet_size); // seconds to wait before the next packet may go out, 0 if it can go now
+	void handle_sent_packet(size_t packet_size); // account a written packet in the global out throttle
 	static void save_limit_to_file(int limit);							///< for dr-monero
 	static double get_sleep_time(size_t cb);
 };
@@ -54,6 +54,25 @@ namespace epee
 namespace levin
 {
 
+/// Builds a complete levin notification (header and body) that can be queued on any number of connections
+inline net_utils::shared_send_buffer make_notify_buffer(int command, const std::string &in_buff)
+{
+	bucket_head2 head = {0};
+	head.m_signature = LEVIN_SIGNATURE;
+	head.m_have_to_return_data = false;
+	head.m_cb = in_buff.size();
+
+	head.m_command = command;
+	head.m_protocol_version = LEVIN_PROTOCOL_VER_1;
+	head.m_flags = LEVIN_PACKET_REQUEST;
+
+	auto buff = boost::make_shared<std::string>();
+	buff->reserve(sizeof(head) + in_buff.size());
+	buff->append(reinterpret_cast<const char *>(&head), sizeof(head));
+	buff->append(in_buff);
+	return buff;
+}
+
 /************************************************************************/
 /*                                                                      */
 /************************************************************************/
@@ -91,6 +110,7 @@ class async_protocol_handler_config
 	int invoke_async(int command, const std::string &in_buff, boost::uuids::uuid connection_id, const callback_t &cb, size_t timeout = LEVIN_DEFAULT_TIMEOUT_PRECONFIGURED);
 
 	int notify(int command, const std::string &in_buff, boost::uuids::uuid connection_id);
+	int send(const net_utils::shared_send_buffer &packet, boost::uuids::uuid connection_id); ///< queue a packet from make_notify_buffer, shared with other connections
 	bool close(boost::uuids::uuid connection_id);
 	bool update_connection_context(const t_connection_context &contxt);
 	bool request_callback(boost::uuids::uuid connection_id);
@@ -466,10 +486,10 @@ class async_protocol_handler
 							m_current_head.m_have_to_return_data = false;
 							m_current_head.m_protocol_version = LEVIN_PROTOCOL_VER_1;
 							m_current_head.m_flags = LEVIN_PACKET_RESPONSE;
-							std::string send_buff((const char *)&m_current_head, sizeof(m_current_head));
-							send_buff += return_buff;
+							auto send_buff = boost::make_shared<std::string>((const char *)&m_current_head, sizeof(m_current_head));
+							*send_buff += return_buff;
 							CRITICAL_REGION_BEGIN(m_send_lock);
-							if(!m_pservice_endpoint->do_send(send_buff.data(), send_buff.size()))
+							if(!m_pservice_endpoint->do_send_buffer(send_buff))
 								return false;
 							CRITICAL_REGION_END();
 							GULPS_LOG_L1(m_connection_context , "LEVIN_PACKET_SENT. [len=" , m_current_head.m_cb
@@ -682,6 +702,11 @@ class async_protocol_handler
 	}
 
 	int notify(int command, const std::string &in_buff)
+	{
+		return send(make_notify_buffer(command, in_buff));
+	}
+
+	int send(const net_utils::shared_send_buffer &packet)
 	{
 		misc_utils::auto_scope_leave_caller scope_exit_handler = misc_utils::create_scope_leave_handler(
 			boost::bind(&async_protocol_handler::finish_outer_call, this));
@@ -694,27 +719,16 @@ class async_protocol_handler
 		if(m_deletion_initiated)
 			return LEVIN_ERROR_CONNECTION_DESTROYED;
 
-		bucket_head2 head = {0};
-		head.m_signature = LEVIN_SIGNATURE;
-		head.m_have_to_return_data = false;
-		head.m_cb = in_buff.size();
-
-		head.m_command = command;
-		head.m_protocol_version = LEVIN_PROTOCOL_VER_1;
-		head.m_flags = LEVIN_PACKET_REQUEST;
 		CRITICAL_REGION_BEGIN(m_send_lock);
-		if(!m_pservice_endpoint->do_send(&head, sizeof(head)))
-		{
-			GULPS_LOG_ERROR(m_connection_context, "Failed to do_send()");
-			return -1;
-		}
-
-		if(!m_pservice_endpoint->do_send(in_buff.data(), (int)in_buff.size()))
+		if(!m_pservice_endpoint->do_send_buffer(packet))
 		{
 			GULPS_LOG_ERROR(m_connection_context, "Failed to do_send()");
 			return -1;
 		}
 		CRITICAL_REGION_END();
+
+		bucket_head2 head;
+		memcpy(&head, packet->data(), sizeof(head));
 		GULPS_LOG_L1(m_connection_context , "LEVIN_PACKET_SENT. [len=" , head.m_cb , ", f=" , head.m_flags , ", r?=" , head.m_have_to_return_data , ", cmd = " , head.m_command , ", ver=" , head.m_protocol_version);
 
 		return 1;
@@ -878,6 +892,14 @@ int async_protocol_handler_config<t_connection_context>::notify(int command, con
 }
 //------------------------------------------------------------------------------------------
 template <class t_connection_context>
+int async_protocol_handler_config<t_connection_context>::send(const net_utils::shared_send_buffer &packet, boost::uuids::uuid connection_id)
+{
+	async_protocol_handler<t_connection_context> *aph;
+	int r = find_and_lock_connection(connection_id, aph);
+	return LEVIN_OK == r ? aph->send(packet) : r;
+}
+//------------------------------------------------------------------------------------------
+template <class t_connection_context>
 bool async_protocol_handler_config<t_connection_context>::close(boost::uuids::uuid connection_id)
 {
 	CRITICAL_REGION_LOCAL(m_connects_lock);
@@ -29,6 +29,7 @@
 
 #include "serialization/keyvalue_serialization.h"
 #include <boost/asio/io_service.hpp>
+#include <boost/shared_ptr.hpp>
 #include <boost/uuid/uuid.hpp>
 #include <type_traits>
 #include <typeinfo>
@@ -311,12 +312,17 @@ struct connection_context_base
 	}
 };
 
+/// Immutable, reference counted payload. Connections keep a reference in their send queue
+/// instead of a copy, so one serialized packet can be sent to any number of peers.
+typedef boost::shared_ptr<const std::string> shared_send_buffer;
+
 /************************************************************************/
 /*                                                                      */
 /************************************************************************/
 struct i_service_endpoint
 {
 	virtual bool do_send(const void *ptr, size_t cb) = 0;
+	virtual bool do_send_buffer(const shared_send_buffer &buf) { return do_send(buf->data(), buf->size()); }
 	virtual bool close() = 0;
 	virtual bool call_run_once_service_io() = 0;
 	virtual bool request_callback() = 0;
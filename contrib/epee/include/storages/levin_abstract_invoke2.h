@@ -44,10 +44,9 @@ bool invoke_remote_command2(int command, const t_arg &out_struct, t_result &resu
 	if(!transport.is_connected())
 		return false;
 
-	serialization::portable_storage stg;
-	out_struct.store(stg);
 	std::string buff_to_send, buff_to_recv;
-	stg.store_to_binary(buff_to_send);
+	if(!serialization::store_t_to_binary(out_struct, buff_to_send))
+		return false;
 
 	int res = transport.invoke(command, buff_to_send, buff_to_recv);
 	GULPS_CAT_MAJOR("epee_lev_abs_inv2");
@@ -56,13 +55,12 @@ bool invoke_remote_command2(int command, const t_arg &out_struct, t_result &resu
 		GULPSF_LOG_ERROR("Failed to invoke command {} return code {}", command , res);
 		return false;
 	}
-	serialization::portable_storage stg_ret;
-	if(!stg_ret.load_from_binary(buff_to_recv))
+	if(!serialization::load_t_from_binary(result_struct, buff_to_recv))
 	{
 		GULPSF_LOG_ERROR("Failed to load_from_binary on command {}", command);
 		return false;
 	}
-	return result_struct.load(stg_ret);
+	return true;
 }
 
 template <class t_arg, class t_transport>
@@ -71,10 +69,9 @@ bool notify_remote_command2(int command, const t_arg &out_struct, t_transport &t
 	if(!transport.is_connected())
 		return false;
 
-	serialization::portable_storage stg;
-	out_struct.store(&stg);
 	std::string buff_to_send;
-	stg.store_to_binary(buff_to_send);
+	if(!serialization::store_t_to_binary(out_struct, buff_to_send))
+		return false;
 
 	int res = transport.notify(command, buff_to_send);
 	if(res <= 0)
@@ -90,10 +87,9 @@ template <class t_arg, class t_result, class t_transport>
 bool invoke_remote_command2(boost::uuids::uuid conn_id, int command, const t_arg &out_struct, t_result &result_struct, t_transport &transport)
 {
 	GULPS_CAT_MAJOR("epee_lev_abs_inv2");
-	typename serialization::portable_storage stg;
-	out_struct.store(stg);
 	std::string buff_to_send, buff_to_recv;
-	stg.store_to_binary(buff_to_send);
+	if(!serialization::store_t_to_binary(out_struct, buff_to_send))
+		return false;
 
 	int res = transport.invoke(command, buff_to_send, buff_to_recv, conn_id);
 	if(res <= 0)
@@ -101,23 +97,21 @@ bool invoke_remote_command2(boost::uuids::uuid conn_id, int command, const t_arg
 		GULPSF_LOG_L1("Failed to invoke command {} return code {}", command , res);
 		return false;
 	}
-	typename serialization::portable_storage stg_ret;
-	if(!stg_ret.load_from_binary(buff_to_recv))
+	if(!serialization::load_t_from_binary(result_struct, buff_to_recv))
 	{
 		GULPSF_LOG_ERROR("Failed to load_from_binary on command {}", command);
 		return false;
 	}
-	return result_struct.load(stg_ret);
+	return true;
 }
 
 template <class t_result, class t_arg, class callback_t, class t_transport>
 bool async_invoke_remote_command2(boost::uuids::uuid conn_id, int command, const t_arg &out_struct, t_transport &transport, const callback_t &cb, size_t inv_timeout = LEVIN_DEFAULT_TIMEOUT_PRECONFIGURED)
 {
 	GULPS_CAT_MAJOR("epee_lev_abs_inv2");
-	typename serialization::portable_storage stg;
-	const_cast<t_arg &>(out_struct).store(stg); //TODO: add true const support to searilzation
 	std::string buff_to_send;
-	stg.store_to_binary(buff_to_send);
+	if(!serialization::store_t_to_binary(out_struct, buff_to_send))
+		return false;
 	int res = transport.invoke_async(command, buff_to_send, conn_id, [cb, command](int code, const std::string &buff, typename t_transport::connection_context &context) -> bool {
 		t_result result_struct = AUTO_VAL_INIT(result_struct);
 		if(code <= 0)
@@ -126,14 +120,7 @@ bool async_invoke_remote_command2(boost::uuids::uuid conn_id, int command, const
 			cb(code, result_struct, context);
 			return false;
 		}
-		serialization::portable_storage stg_ret;
-		if(!stg_ret.load_from_binary(buff))
-		{
-			GULPSF_LOG_ERROR("Failed to load_from_binary on command {}", command);
-			cb(LEVIN_ERROR_FORMAT, result_struct, context);
-			return false;
-		}
-		if(!result_struct.load(stg_ret))
+		if(!serialization::load_t_from_binary(result_struct, buff))
 		{
 			GULPSF_LOG_ERROR("Failed to load result struct on command {}", command);
 			cb(LEVIN_ERROR_FORMAT, result_struct, context);
@@ -155,10 +142,9 @@ template <class t_arg, class t_transport>
 bool notify_remote_command2(boost::uuids::uuid conn_id, int command, const t_arg &out_struct, t_transport &transport)
 {
 
-	serialization::portable_storage stg;
-	out_struct.store(stg);
 	std::string buff_to_send;
-	stg.store_to_binary(buff_to_send);
+	if(!serialization::store_t_to_binary(out_struct, buff_to_send))
+		return false;
 
 	int res = transport.notify(command, buff_to_send, conn_id);
 	if(res <= 0)
@@ -175,25 +161,17 @@ template <class t_owner, class t_in_type, class t_out_type, class t_context, cla
 int buff_to_t_adapter(int command, const std::string &in_buff, std::string &buff_out, callback_t cb, t_context &context)
 {
 	GULPS_CAT_MAJOR("epee_lev_abs_inv2");
-	serialization::portable_storage strg;
-	if(!strg.load_from_binary(in_buff))
-	{
-		GULPSF_LOG_ERROR("Failed to load_from_binary in command {}", command);
-		return -1;
-	}
 	boost::value_initialized<t_in_type> in_struct;
 	boost::value_initialized<t_out_type> out_struct;
 
-	if(!static_cast<t_in_type &>(in_struct).load(strg))
+	if(!serialization::load_t_from_binary(static_cast<t_in_type &>(in_struct), in_buff))
 	{
 		GULPSF_LOG_ERROR("Failed to load in_struct in command {}", command);
 		return -1;
 	}
 	int res = cb(command, static_cast<t_in_type &>(in_struct), static_cast<t_out_type &>(out_struct), context);
-	serialization::portable_storage strg_out;
-	static_cast<t_out_type &>(out_struct).store(strg_out);
 
-	if(!strg_out.store_to_binary(buff_out))
+	if(!serialization::store_t_to_binary(static_cast<t_out_type &>(out_struct), buff_out))
 	{
 		GULPSF_LOG_ERROR("Failed to store_to_binary in command{}", command);
 		return -1;
@@ -206,14 +184,8 @@ template <class t_owner, class t_in_type, class t_context, class callback_t>
 int buff_to_t_adapter(t_owner *powner, int command, const std::string &in_buff, callback_t cb, t_context &context)
 {
 	GULPS_CAT_MAJOR("epee_lev_abs_inv2");
-	serialization::portable_storage strg;
-	if(!strg.load_from_binary(in_buff))
-	{
-		GULPSF_LOG_ERROR("Failed to load_from_binary in notify {}", command);
-		return -1;
-	}
 	boost::value_initialized<t_in_type> in_struct;
-	if(!static_cast<t_in_type &>(in_struct).load(strg))
+	if(!serialization::load_t_from_binary(static_cast<t_in_type &>(in_struct), in_buff))
 	{
 		GULPSF_LOG_ERROR("Failed to load in_struct in notify {}", command);
 		return -1;
@@ -0,0 +1,738 @@
+// Copyright (c) 2020, pasta Currency Project
+//
+// Portions of this file are available under BSD-3 license. Please see ORIGINAL-LICENSE for details
+// All rights reserved.
+//
+// Authors and copyright holders give permission for following:
+//
+// 1. Redistribution and use in source and binary forms WITHOUT modification.
+//
+// 2. Modification of the source form for your own personal use.
+//
+// As long as the following conditions are met:
+//
+// 3. You must not distribute modified copies of the work to third parties. This includes
+//    posting the work online, or hosting copies of the modified work for download.
+//
+// 4. Any derivative version of this work is also covered by this license, including point 8.
+//
+// 5. Neither the name of the copyright holders nor the names of the authors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+//
+// 6. You agree that this licence is governed by and shall be construed in accordance
+//    with the laws of England and Wales.
+//
+// 7. You agree to submit all disputes arising out of or in connection with this licence
+//    to the exclusive jurisdiction of the Courts of England and Wales.
+//
+// Authors and copyright holders agree that:
+//
+// 8. This licence expires and the work covered by it is released into the
+//    public domain on 1st of February 2021
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#pragma once
+
+#include <cstring>
+#include <deque>
+#include <string>
+#include <vector>
+
+#include "misc_language.h"
+#include "portable_storage_base.h"
+#include "portable_storage_from_bin.h"
+#include "portable_storage_to_bin.h"
+#include "portable_storage_val_converters.h"
+
+#include "common/gulps.hpp"
+
+namespace epee
+{
+namespace serialization
+{
+/************************************************************************/
+/* Streaming codec for the portable_storage binary format.             */
+/* Both classes expose the storage API used by the KV_SERIALIZE maps,  */
+/* so any map can be stored / loaded through them without building a   */
+/* section DOM first.                                                  */
+/************************************************************************/
+
+template <class t_value>
+struct bin_type_code;
+template <>
+struct bin_type_code<int64_t> { static constexpr uint8_t value = SERIALIZE_TYPE_INT64; };
+template <>
+struct bin_type_code<int32_t> { static constexpr uint8_t value = SERIALIZE_TYPE_INT32; };
+template <>
+struct bin_type_code<int16_t> { static constexpr uint8_t value = SERIALIZE_TYPE_INT16; };
+template <>
+struct bin_type_code<int8_t> { static constexpr uint8_t value = SERIALIZE_TYPE_INT8; };
+template <>
+struct bin_type_code<uint64_t> { static constexpr uint8_t value = SERIALIZE_TYPE_UINT64; };
+template <>
+struct bin_type_code<uint32_t> { static constexpr uint8_t value = SERIALIZE_TYPE_UINT32; };
+template <>
+struct bin_type_code<uint16_t> { static constexpr uint8_t value = SERIALIZE_TYPE_UINT16; };
+template <>
+struct bin_type_code<uint8_t> { static constexpr uint8_t value = SERIALIZE_TYPE_UINT8; };
+template <>
+struct bin_type_code<double> { static constexpr uint8_t value = SERIALIZE_TYPE_DUOBLE; };
+template <>
+struct bin_type_code<bool> { static constexpr uint8_t value = SERIALIZE_TYPE_BOOL; };
+template <>
+struct bin_type_code<std::string> { static constexpr uint8_t value = SERIALIZE_TYPE_STRING; };
+
+/*! Writes straight into the target buffer. Section and array sizes are not
+ *  known up front, so a one byte count is reserved and widened in place when
+ *  the section or array is closed. Entries come out in KV map order instead
+ *  of the alphabetical order of portable_storage, which every reader accepts.
+ */
+class portable_storage_bin_writer
+{
+	GULPS_CAT_MAJOR("epee_prt_strg");
+
+  public:
+	struct frame
+	{
+		size_t count_pos;
+		size_t count;
+		size_t depth;
+	};
+
+	typedef frame *hsection;
+	typedef frame *harray;
+	typedef storage_entry meta_entry;
+
+	explicit portable_storage_bin_writer(binarybuffer &target);
+
+	hsection open_section(const std::string &section_name, hsection hparent_section, bool create_if_notexist = false);
+	template <class t_value>
+	bool set_value(const std::string &value_name, const t_value &target, hsection hparent_section);
+	//! only scalar meta entries (ids of json rpc requests) can be streamed
+	bool set_value(const std::string &value_name, const storage_entry &target, hsection hparent_section);
+
+	template <class t_value>
+	harray insert_first_value(const std::string &value_name, const t_value &target, hsection hparent_section);
+	template <class t_value>
+	bool insert_next_value(harray hval_array, const t_value &target);
+	harray insert_first_section(const std::string &pSectionName, hsection &hinserted_childsection, hsection hparent_section);
+	bool insert_next_section(harray hSecArray, hsection &hinserted_childsection);
+
+	//! closes every open section, the buffer is complete afterwards
+	bool finish();
+
+  private:
+	struct meta_setter : public boost::static_visitor<bool>
+	{
+		portable_storage_bin_writer &m_w;
+		const std::string &m_name;
+		hsection m_parent;
+		meta_setter(portable_storage_bin_writer &w, const std::string &name, hsection parent) : m_w(w), m_name(name), m_parent(parent) {}
+
+		template <class t_value>
+		bool operator()(const t_value &v) const { return m_w.set_value(m_name, v, m_parent); }
+		bool operator()(const section &) const { GULPS_ASSERT_MES_AND_THROW("portable_storage_bin_writer: section meta entries are not supported"); }
+		bool operator()(const array_entry &) const { GULPS_ASSERT_MES_AND_THROW("portable_storage_bin_writer: array meta entries are not supported"); }
+	};
+
+	struct varint_buff
+	{
+		char data[sizeof(uint64_t)];
+		size_t size = 0;
+		void write(const char *p, size_t n)
+		{
+			memcpy(data + size, p, n);
+			size += n;
+		}
+	};
+
+	frame *enter(frame *f);
+	frame *push_frame();
+	void close_frame();
+	void put_entry_header(const std::string &name, uint8_t type);
+
+	template <class t_value>
+	void put_value(const t_value &v)
+	{
+		static_assert(std::is_arithmetic<t_value>::value, "unexpected value type");
+		m_buff.append((const char *)&v, sizeof(v));
+	}
+	void put_value(const std::string &v)
+	{
+		pack_varint(*this, v.size());
+		m_buff.append(v);
+	}
+
+  public:
+	//! raw append, lets pack_varint() write here
+	void write(const char *p, size_t n) { m_buff.append(p, n); }
+
+  private:
+	binarybuffer &m_buff;
+	std::deque<frame> m_frames;
+};
+
+inline portable_storage_bin_writer::portable_storage_bin_writer(binarybuffer &target) : m_buff(target)
+{
+	m_buff.clear();
+	uint32_t sig_a = PORTABLE_STORAGE_SIGNATUREA;
+	uint32_t sig_b = PORTABLE_STORAGE_SIGNATUREB;
+	uint8_t ver = PORTABLE_STORAGE_FORMAT_VER;
+	write((const char *)&sig_a, sizeof(sig_a));
+	write((const char *)&sig_b, sizeof(sig_b));
+	write((const char *)&ver, sizeof(ver));
+	push_frame();
+}
+//---------------------------------------------------------------------------------------------------------------
+inline portable_storage_bin_writer::frame *portable_storage_bin_writer::push_frame()
+{
+	m_frames.push_back(frame{m_buff.size(), 0, m_frames.size()});
+	m_buff.push_back(0);
+	return &m_frames.back();
+}
+//---------------------------------------------------------------------------------------------------------------
+inline void portable_storage_bin_writer::close_frame()
+{
+	const frame &f = m_frames.back();
+	varint_buff vb;
+	pack_varint(vb, f.count);
+	if(vb.size > 1)
+		m_buff.insert(f.count_pos + 1, vb.size - 1, '\0');
+	memcpy(&m_buff[f.count_pos], vb.data, vb.size);
+	m_frames.pop_back();
+}
+//---------------------------------------------------------------------------------------------------------------
+inline portable_storage_bin_writer::frame *portable_storage_bin_writer::enter(frame *f)
+{
+	if(!f)
+		f = &m_frames.front();
+	GULPS_CHECK_AND_ASSERT_THROW_MES(f->depth < m_frames.size() && &m_frames[f->depth] == f, "portable_storage_bin_writer: section is already closed");
+	while(&m_frames.back() != f)
+		close_frame();
+	return f;
+}
+//---------------------------------------------------------------------------------------------------------------
+inline void portable_storage_bin_writer::put_entry_header(const std::string &name, uint8_t type)
+{
+	GULPS_CHECK_AND_ASSERT_THROW_MES(name.size() < std::numeric_limits<uint8_t>::max(), "storage_entry_name is too long: ", name.size(), ", val: ", name);
+	uint8_t len = static_cast<uint8_t>(name.size());
+	write((const char *)&len, sizeof(len));
+	write(name.data(), len);
+	write((const char *)&type, sizeof(type));
+}
+//---------------------------------------------------------------------------------------------------------------
+inline portable_storage_bin_writer::hsection portable_storage_bin_writer::open_section(const std::string &section_name, hsection hparent_section, bool create_if_notexist)
+{
+	if(!create_if_notexist)
+		return nullptr;
+	enter(hparent_section)->count++;
+	put_entry_header(section_name, SERIALIZE_TYPE_OBJECT);
+	return push_frame();
+}
+//---------------------------------------------------------------------------------------------------------------
+template <class t_value>
+bool portable_storage_bin_writer::set_value(const std::string &value_name, const t_value &v, hsection hparent_section)
+{
+	enter(hparent_section)->count++;
+	put_entry_header(value_name, bin_type_code<t_value>::value);
+	put_value(v);
+	return true;
+}
+//---------------------------------------------------------------------------------------------------------------
+inline bool portable_storage_bin_writer::set_value(const std::string &value_name, const storage_entry &v, hsection hparent_section)
+{
+	return boost::apply_visitor(meta_setter(*this, value_name, hparent_section), v);
+}
+//---------------------------------------------------------------------------------------------------------------
+template <class t_value>
+portable_storage_bin_writer::harray portable_storage_bin_writer::insert_first_value(const std::string &value_name, const t_value &target, hsection hparent_section)
+{
+	enter(hparent_section)->count++;
+	put_entry_header(value_name, bin_type_code<t_value>::value | SERIALIZE_FLAG_ARRAY);
+	frame *arr = push_frame();
+	put_value(target);
+	arr->count = 1;
+	return arr;
+}
+//---------------------------------------------------------------------------------------------------------------
+template <class t_value>
+bool portable_storage_bin_writer::insert_next_value(harray hval_array, const t_value &target)
+{
+	enter(hval_array)->count++;
+	put_value(target);
+	return true;
+}
+//---------------------------------------------------------------------------------------------------------------
+inline portable_storage_bin_writer::harray portable_storage_bin_writer::insert_first_section(const std::string &sec_name, hsection &hinserted_childsection, hsection hparent_section)
+{
+	enter(hparent_section)->count++;
+	put_entry_header(sec_name, SERIALIZE_TYPE_OBJECT | SERIALIZE_FLAG_ARRAY);
+	frame *arr = push_frame();
+	arr->count = 1;
+	hinserted_childsection = push_frame();
+	return arr;
+}
+//---------------------------------------------------------------------------------------------------------------
+inline bool portable_storage_bin_writer::insert_next_section(harray hsec_array, hsection &hinserted_childsection)
+{
+	enter(hsec_array)->count++;
+	hinserted_childsection = push_frame();
+	return true;
+}
+//---------------------------------------------------------------------------------------------------------------
+inline bool portable_storage_bin_writer::finish()
+{
+	while(!m_frames.empty())
+		close_frame();
+	return true;
+}
+
+/*! Reads the KV map targets straight out of the source buffer. A section is
+ *  indexed (name, type and value position of each entry, pointing into the
+ *  buffer) only when it is opened, values are decoded on access.
+ */
+class portable_storage_bin_reader
+{
+	GULPS_CAT_MAJOR("epee_prt_strg");
+
+  public:
+	struct entry
+	{
+		const char *name;
+		uint8_t name_len;
+		uint8_t type;
+		const uint8_t *value;
+	};
+
+	struct section_view
+	{
+		size_t first;
+		size_t count;
+	};
+
+	struct array_cursor
+	{
+		uint8_t type;
+		size_t remaining;
+		const uint8_t *next;
+	};
+
+	typedef section_view *hsection;
+	typedef array_cursor *harray;
+	typedef storage_entry meta_entry;
+
+	portable_storage_bin_reader() : m_end(nullptr), m_depth(0) {}
+
+	//! the source buffer has to outlive the reader
+	bool load_from_binary(const binarybuffer &source);
+
+	hsection open_section(const std::string &section_name, hsection hparent_section, bool create_if_notexist = false);
+	template <class t_value>
+	bool get_value(const std::string &value_name, t_value &val, hsection hparent_section);
+
+	template <class t_value>
+	harray get_first_value(const std::string &value_name, t_value &target, hsection hparent_section);
+	template <class t_value>
+	bool get_next_value(harray hval_array, t_value &target);
+	harray get_first_section(const std::string &pSectionName, hsection &h_child_section, hsection hparent_section);
+	bool get_next_section(harray hSecArray, hsection &h_child_section);
+
+  private:
+	struct depth_guard
+	{
+		size_t &m_depth;
+		depth_guard(size_t &depth) : m_depth(depth)
+		{
+			GULPS_CHECK_AND_ASSERT_THROW_MES(++m_depth < EPEE_PORTABLE_STORAGE_RECURSION_LIMIT_INTERNAL, "Wrong blob data in portable storage: recursion limitation (", EPEE_PORTABLE_STORAGE_RECURSION_LIMIT_INTERNAL, ") exceeded");
+		}
+		~depth_guard() { --m_depth; }
+	};
+
+	void need(const uint8_t *p, size_t n) const
+	{
+		GULPS_CHECK_AND_ASSERT_THROW_MES(p <= m_end && size_t(m_end - p) >= n, "attempt to read ", n, " bytes past the end of the buffer");
+	}
+	template <class t_pod_type>
+	t_pod_type read_pod(const uint8_t *&p) const
+	{
+		t_pod_type v;
+		need(p, sizeof(v));
+		memcpy(&v, p, sizeof(v));
+		p += sizeof(v);
+		return v;
+	}
+	size_t read_varint(const uint8_t *&p) const;
+	size_t read_string_size(const uint8_t *&p) const;
+
+	const entry *find(const std::string &name, hsection hparent_section);
+	hsection index_section(const uint8_t *&p);
+	void skip_value(uint8_t type, const uint8_t *&p);
+	void skip_section(const uint8_t *&p);
+	bool start_array(const entry &e, array_cursor &c);
+
+	template <class t_value>
+	void read_value(uint8_t type, const uint8_t *&p, t_value &val);
+	void read_value(uint8_t type, const uint8_t *&p, std::string &val);
+	void read_value(uint8_t type, const uint8_t *&p, storage_entry &val);
+
+	const uint8_t *m_end;
+	size_t m_depth;
+	std::vector<entry> m_entries;
+	std::deque<section_view> m_sections;
+	std::deque<array_cursor> m_arrays;
+};
+
+inline bool portable_storage_bin_reader::load_from_binary(const binarybuffer &source)
+{
+	m_entries.clear();
+	m_sections.clear();
+	m_arrays.clear();
+	m_depth = 0;
+	const size_t header_size = sizeof(uint32_t) * 2 + sizeof(uint8_t);
+	if(source.size() < header_size)
+	{
+		GULPSF_ERROR("portable_storage: wrong binary format, packet size = {} less than expected header size {}", source.size(), header_size);
+		return false;
+	}
+	const uint8_t *p = (const uint8_t *)source.data();
+	m_end = p + source.size();
+	if(read_pod<uint32_t>(p) != PORTABLE_STORAGE_SIGNATUREA || read_pod<uint32_t>(p) != PORTABLE_STORAGE_SIGNATUREB)
+	{
+		GULPS_ERROR("portable_storage: wrong binary format - signature mismatch");
+		return false;
+	}
+	uint8_t ver = read_pod<uint8_t>(p);
+	if(ver != PORTABLE_STORAGE_FORMAT_VER)
+	{
+		GULPSF_ERROR("portable_storage: wrong binary format - unknown format ver = {}", ver);
+		return false;
+	}
+	GULPS_TRY_ENTRY();
+	GULPS_CHECK_AND_ASSERT_THROW_MES(p < m_end, "empty buff, expected place for varint");
+	index_section(p);
+	return true;
+	GULPS_CATCH_ENTRY("portable_storage_bin_reader::load_from_binary", false);
+}
+//---------------------------------------------------------------------------------------------------------------
+inline size_t portable_storage_bin_reader::read_varint(const uint8_t *&p) const
+{
+	need(p, 1);
+	size_t v = 0;
+	switch(*p & PORTABLE_RAW_SIZE_MARK_MASK)
+	{
+	case PORTABLE_RAW_SIZE_MARK_BYTE:
+		v = read_pod<uint8_t>(p);
+		break;
+	case PORTABLE_RAW_SIZE_MARK_WORD:
+		v = read_pod<uint16_t>(p);
+		break;
+	case PORTABLE_RAW_SIZE_MARK_DWORD:
+		v = read_pod<uint32_t>(p);
+		break;
+	default:
+		v = read_pod<uint64_t>(p);
+		break;
+	}
+	return v >> 2;
+}
+//---------------------------------------------------------------------------------------------------------------
+inline size_t portable_storage_bin_reader::read_string_size(const uint8_t *&p) const
+{
+	size_t len = read_varint(p);
+	GULPS_CHECK_AND_ASSERT_THROW_MES(len < MAX_STRING_LEN_POSSIBLE, "to big string len value in storage: ", len);
+	need(p, len);
+	return len;
+}
+//---------------------------------------------------------------------------------------------------------------
+inline portable_storage_bin_reader::hsection portable_storage_bin_reader::index_section(const uint8_t *&p)
+{
+	depth_guard dg(m_depth);
+	size_t count = read_varint(p);
+	// every entry takes at least 3 bytes, do not trust the count any further than that
+	GULPS_CHECK_AND_ASSERT_THROW_MES(count <= size_t(m_end - p) / 3, "section entry count ", count, " goes out of remain storage len ", m_end - p);
+	section_view sv{m_entries.size(), count};
+	for(size_t i = 0; i < count; i++)
+	{
+		entry e;
+		e.name_len = read_pod<uint8_t>(p);
+		need(p, e.name_len);
+		e.name = (const char *)p;
+		p += e.name_len;
+		e.type = read_pod<uint8_t>(p);
+		e.value = p;
+		skip_value(e.type, p);
+		m_entries.push_back(e);
+	}
+	m_sections.push_back(sv);
+	return &m_sections.back();
+}
+//---------------------------------------------------------------------------------------------------------------
+inline void portable_storage_bin_reader::skip_section(const uint8_t *&p)
+{
+	depth_guard dg(m_depth);
+	size_t count = read_varint(p);
+	while(count--)
+	{
+		size_t name_len = read_pod<uint8_t>(p);
+		need(p, name_len);
+		p += name_len;
+		skip_value(read_pod<uint8_t>(p), p);
+	}
+}
+//---------------------------------------------------------------------------------------------------------------
+inline void portable_storage_bin_reader::skip_value(uint8_t type, const uint8_t *&p)
+{
+	depth_guard dg(m_depth);
+	size_t pod_size = 0;
+	switch(type & ~SERIALIZE_FLAG_ARRAY)
+	{
+	case SERIALIZE_TYPE_INT64:
+	case SERIALIZE_TYPE_UINT64:
+	case SERIALIZE_TYPE_DUOBLE:
+		pod_size = 8;
+		break;
+	case SERIALIZE_TYPE_INT32:
+	case SERIALIZE_TYPE_UINT32:
+		pod_size = 4;
+		break;
+	case SERIALIZE_TYPE_INT16:
+	case SERIALIZE_TYPE_UINT16:
+		pod_size = 2;
+		break;
+	case SERIALIZE_TYPE_INT8:
+	case SERIALIZE_TYPE_UINT8:
+	case SERIALIZE_TYPE_BOOL:
+		pod_size = 1;
+		break;
+	case SERIALIZE_TYPE_STRING:
+	case SERIALIZE_TYPE_OBJECT:
+		break;
+	case SERIALIZE_TYPE_ARRAY:
+		GULPS_CHECK_AND_ASSERT_THROW_MES(!(type & SERIALIZE_FLAG_ARRAY), "Reading array entry is not supported");
+		type = read_pod<uint8_t>(p);
+		GULPS_CHECK_AND_ASSERT_THROW_MES(type & SERIALIZE_FLAG_ARRAY, "wrong type sequenses");
+		skip_value(type, p);
+		return;
+	default:
+		GULPS_CHECK_AND_ASSERT_THROW_MES(false, "unknown entry_type code = ", type);
+	}
+
+	size_t count = 1;
+	if(type & SERIALIZE_FLAG_ARRAY)
+		count = read_varint(p);
+
+	if(pod_size)
+	{
+		GULPS_CHECK_AND_ASSERT_THROW_MES(count <= size_t(m_end - p) / pod_size, "array of ", count, " elements goes out of remain storage len ", m_end - p);
+		p += count * pod_size;
+	}
+	else if((type & ~SERIALIZE_FLAG_ARRAY) == SERIALIZE_TYPE_STRING)
+	{
+		while(count--)
+			p += read_string_size(p);
+	}
+	else
+	{
+		while(count--)
+			skip_section(p);
+	}
+}
+//---------------------------------------------------------------------------------------------------------------
+inline const portable_storage_bin_reader::entry *portable_storage_bin_reader::find(const std::string &name, hsection hparent_section)
+{
+	if(!hparent_section)
+	{
+		GULPS_CHECK_AND_ASSERT_THROW_MES(!m_sections.empty(), "portable_storage_bin_reader: nothing loaded");
+		hparent_section = &m_sections.front();
+	}
+	for(size_t i = hparent_section->first; i < hparent_section->first + hparent_section->count; i++)
+	{
+		const entry &e = m_entries[i];
+		if(e.name_len == name.size() && memcmp(e.name, name.data(), e.name_len) == 0)
+			return &e;
+	}
+	return nullptr;
+}
+//---------------------------------------------------------------------------------------------------------------
+template <class t_value>
+void portable_storage_bin_reader::read_value(uint8_t type, const uint8_t *&p, t_value &val)
+{
+	switch(type)
+	{
+	case SERIALIZE_TYPE_INT64:
+		return convert_t(read_pod<int64_t>(p), val);
+	case SERIALIZE_TYPE_INT32:
+		return convert_t(read_pod<int32_t>(p), val);
+	case SERIALIZE_TYPE_INT16:
+		return convert_t(read_pod<int16_t>(p), val);
+	case SERIALIZE_TYPE_INT8:
+		return convert_t(read_pod<int8_t>(p), val);
+	case SERIALIZE_TYPE_UINT64:
+		return convert_t(read_pod<uint64_t>(p), val);
+	case SERIALIZE_TYPE_UINT32:
+		return convert_t(read_pod<uint32_t>(p), val);
+	case SERIALIZE_TYPE_UINT16:
+		return convert_t(read_pod<uint16_t>(p), val);
+	case SERIALIZE_TYPE_UINT8:
+		return convert_t(read_pod<uint8_t>(p), val);
+	case SERIALIZE_TYPE_DUOBLE:
+		return convert_t(read_pod<double>(p), val);
+	case SERIALIZE_TYPE_BOOL:
+		return convert_t(read_pod<bool>(p), val);
+	case SERIALIZE_TYPE_STRING:
+	{
+		size_t len = read_string_size(p);
+		std::string str((const char *)p, len);
+		p += len;
+		return convert_t(str, val);
+	}
+	default:
+		GULPS_ASSERT_MES_AND_THROW("WRONG DATA CONVERSION: from entry type=", (unsigned)type, " to type ", typeid(t_value).name());
+	}
+}
+//---------------------------------------------------------------------------------------------------------------
+inline void portable_storage_bin_reader::read_value(uint8_t type, const uint8_t *&p, std::string &val)
+{
+	GULPS_CHECK_AND_ASSERT_THROW_MES(type == SERIALIZE_TYPE_STRING, "WRONG DATA CONVERSION: from entry type=", (unsigned)type, " to type std::string");
+	size_t len = read_string_size(p);
+	val.assign((const char *)p, len);
+	p += len;
+}
+//---------------------------------------------------------------------------------------------------------------
+inline void portable_storage_bin_reader::read_value(uint8_t type, const uint8_t *&p, storage_entry &val)
+{
+	switch(type)
+	{
+	case SERIALIZE_TYPE_INT64:
+		val = read_pod<int64_t>(p);
+		break;
+	case SERIALIZE_TYPE_INT32:
+		val = read_pod<int32_t>(p);
+		break;
+	case SERIALIZE_TYPE_INT16:
+		val = read_pod<int16_t>(p);
+		break;
+	case SERIALIZE_TYPE_INT8:
+		val = read_pod<int8_t>(p);
+		break;
+	case SERIALIZE_TYPE_UINT64:
+		val = read_pod<uint64_t>(p);
+		break;
+	case SERIALIZE_TYPE_UINT32:
+		val = read_pod<uint32_t>(p);
+		break;
+	case SERIALIZE_TYPE_UINT16:
+		val = read_pod<uint16_t>(p);
+		break;
+	case SERIALIZE_TYPE_UINT8:
+		val = read_pod<uint8_t>(p);
+		break;
+	case SERIALIZE_TYPE_DUOBLE:
+		val = read_pod<double>(p);
+		break;
+	case SERIALIZE_TYPE_BOOL:
+		val = read_pod<bool>(p);
+		break;
+	case SERIALIZE_TYPE_STRING:
+	{
+		std::string str;
+		read_value(type, p, str);
+		val = std::move(str);
+		break;
+	}
+	default:
+		GULPS_ASSERT_MES_AND_THROW("portable_storage_bin_reader: only scalar meta entries are supported, entry type=", (unsigned)type);
+	}
+}
+//---------------------------------------------------------------------------------------------------------------
+inline portable_storage_bin_reader::hsection portable_storage_bin_reader::open_section(const std::string &section_name, hsection hparent_section, bool create_if_notexist)
+{
+	const entry *e = find(section_name, hparent_section);
+	if(!e || e->type != SERIALIZE_TYPE_OBJECT)
+		return nullptr;
+	const uint8_t *p = e->value;
+	return index_section(p);
+}
+//---------------------------------------------------------------------------------------------------------------
+template <class t_value>
+bool portable_storage_bin_reader::get_value(const std::string &value_name, t_value &val, hsection hparent_section)
+{
+	const entry *e = find(value_name, hparent_section);
+	if(!e)
+		return false;
+	const uint8_t *p = e->value;
+	read_value(e->type, p, val);
+	return true;
+}
+//---------------------------------------------------------------------------------------------------------------
+inline bool portable_storage_bin_reader::start_array(const entry &e, array_cursor &c)
+{
+	const uint8_t *p = e.value;
+	uint8_t type = e.type;
+	if(type == SERIALIZE_TYPE_ARRAY)
+		type = read_pod<uint8_t>(p);
+	if(!(type & SERIALIZE_FLAG_ARRAY))
+		return false;
+	c.type = type & ~SERIALIZE_FLAG_ARRAY;
+	c.remaining = read_varint(p);
+	c.next = p;
+	return c.remaining != 0;
+}
+//---------------------------------------------------------------------------------------------------------------
+template <class t_value>
+portable_storage_bin_reader::harray portable_storage_bin_reader::get_first_value(const std::string &value_name, t_value &target, hsection hparent_section)
+{
+	const entry *e = find(value_name, hparent_section);
+	array_cursor c;
+	if(!e || !start_array(*e, c))
+		return nullptr;
+	m_arrays.push_back(c);
+	harray arr = &m_arrays.back();
+	get_next_value(arr, target);
+	return arr;
+}
+//---------------------------------------------------------------------------------------------------------------
+template <class t_value>
+bool portable_storage_bin_reader::get_next_value(harray hval_array, t_value &target)
+{
+	GULPS_CHECK_AND_ASSERT(hval_array, false);
+	if(!hval_array->remaining)
+		return false;
+	read_value(hval_array->type, hval_array->next, target);
+	hval_array->remaining--;
+	return true;
+}
+//---------------------------------------------------------------------------------------------------------------
+inline portable_storage_bin_reader::harray portable_storage_bin_reader::get_first_section(const std::string &sec_name, hsection &h_child_section, hsection hparent_section)
+{
+	const entry *e = find(sec_name, hparent_section);
+	array_cursor c;
+	if(!e || !start_array(*e, c) || c.type != SERIALIZE_TYPE_OBJECT)
+		return nullptr;
+	m_arrays.push_back(c);
+	harray arr = &m_arrays.back();
+	get_next_section(arr, h_child_section);
+	return arr;
+}
+//---------------------------------------------------------------------------------------------------------------
+inline bool portable_storage_bin_reader::get_next_section(harray hsec_array, hsection &h_child_section)
+{
+	GULPS_CHECK_AND_ASSERT(hsec_array, false);
+	if(hsec_array->type != SERIALIZE_TYPE_OBJECT || !hsec_array->remaining)
+		return false;
+	h_child_section = index_section(hsec_array->next);
+	hsec_array->remaining--;
+	return true;
+}
+}
+}
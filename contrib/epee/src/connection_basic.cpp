@@ -150,6 +150,7 @@ connection_basic::connection_basic(boost::asio::io_service &io_service, std::ato
 	  socket_(io_service),
 	  m_want_close_connection(false),
 	  m_was_shutdown(false),
+	  m_send_que_in_flight(0),
 	  m_ref_sock_count(ref_sock_count)
 {
 	++ref_sock_count;							  // increase the global counter
@@ -240,37 +241,29 @@ int connection_basic::get_tos_flag()
 	return connection_basic_pimpl::m_default_tos;
 }
 
-void connection_basic::sleep_before_packet(size_t packet_size, int phase, int q_len)
+double connection_basic::get_send_delay(size_t packet_size)
 {
-	double delay = 0; // will be calculated
-	do
-	{ // rate limiting
-		if(m_was_shutdown)
-		{
-			GULPS_LOG_L1("m_was_shutdown - so abort sleep");
-			return;
-		}
-
-		{
-			CRITICAL_REGION_LOCAL(network_throttle_manager::m_lock_get_global_throttle_out);
-			delay = network_throttle_manager::get_global_throttle_out().get_sleep_time_after_tick(packet_size);
-		}
-
-		delay *= 0.50;
-		if(delay > 0)
-		{
-			long int ms = (long int)(delay * 1000);
-			GULPSF_LOG_L2("Sleeping in {} for {}  ms before packet_size={}", __FUNCTION__, ms, packet_size); // debug sleep
-			boost::this_thread::sleep(boost::posix_time::milliseconds(ms));
-		}
-	} while(delay > 0);
-
-	// XXX LATER XXX
+	if(m_was_shutdown)
+		return 0;
+
+	double delay;
 	{
 		CRITICAL_REGION_LOCAL(network_throttle_manager::m_lock_get_global_throttle_out);
-		network_throttle_manager::get_global_throttle_out().handle_trafic_exact(packet_size); // increase counter - global
+		delay = network_throttle_manager::get_global_throttle_out().get_sleep_time_after_tick(packet_size);
 	}
+
+	delay *= 0.50;
+	if(delay > 0)
+		GULPSF_LOG_L2("Deferring in {} for {} ms before packet_size={}", __FUNCTION__, (long int)(delay * 1000), packet_size);
+	return delay > 0 ? delay : 0;
 }
+
+void connection_basic::handle_sent_packet(size_t packet_size)
+{
+	CRITICAL_REGION_LOCAL(network_throttle_manager::m_lock_get_global_throttle_out);
+	network_throttle_manager::get_global_throttle_out().handle_trafic_exact(packet_size); // increase counter - global
+}
+
 void connection_basic::set_start_time()
 {
 	CRITICAL_REGION_LOCAL(network_throttle_manager::m_lock_get_global_throttle_out);
@@ -279,15 +272,15 @@ void connection_basic::set_start_time()
 
 void connection_basic::do_send_handler_write(const void *ptr, size_t cb)
 {
-	// No sleeping here; sleeping is done once and for all in connection<t_protocol_handler>::handle_write
+	// No waiting here; the out limit is obeyed by connection<t_protocol_handler>::start_write
 	GULPSF_LOG_L2("handler_write (direct) - before ASIO write, for packet={}" , cb);
 	set_start_time();
 }
 
 void connection_basic::do_send_handler_write_from_queue(const boost::system::error_code &e, size_t cb, int q_len)
 {
-	// No sleeping here; sleeping is done once and for all in connection<t_protocol_handler>::handle_write
-	GULPSF_LOG_L2("handler_write (after write, from queue={}) - before ASIO write, for packet={} B (after sleep)", q_len, cb);
+	// No waiting here; the out limit is obeyed by connection<t_protocol_handler>::start_write
+	GULPSF_LOG_L2("handler_write (after write, from queue={}) - before ASIO write, for packet={} B (after deferral)", q_len, cb);
 
 	set_start_time();
 }
@@ -218,7 +218,8 @@ int main(int argc, char *argv[])
 
 	// We won't replace the custom output writer here, so just direct **our** errors to console
 	std::unique_ptr<gulps::gulps_output> out(new gulps::gulps_print_output(gulps::COLOR_WHITE, gulps::TIMESTAMP_ONLY));
-	out->add_filter([](const gulps::message& msg, bool printed, bool logged) -> bool { return msg.cat_major == "addr_val" && msg.lvl == gulps::LEVEL_ERROR; });
+	out->add_filter([](const gulps::message& msg, bool printed, bool logged) -> bool { return msg.cat_major == "addr_val" && msg.lvl == gulps::LEVEL_ERROR; },
+		[](gulps::output out, gulps::level lvl) -> bool { return lvl == gulps::LEVEL_ERROR; });
 	gulps::inst().add_output(std::move(out));
 
 	using namespace cryptonote;
@@ -240,7 +240,7 @@ struct Dbt_safe : public Dbt
 namespace cryptonote
 {
 
-void BlockchainBDB::add_block(const block &blk, const size_t &block_size, const difficulty_type &cumulative_difficulty, const uint64_t &coins_generated, const crypto::hash &blk_hash)
+void BlockchainBDB::add_block(const block &blk, const size_t &block_size, const difficulty_type &cumulative_difficulty, const uint64_t &coins_generated, const uint64_t &block_fees, const crypto::hash &blk_hash)
 {
 	LOG_PRINT_L3("BlockchainBDB::" << __func__);
 	check_open();
@@ -1434,6 +1434,14 @@ uint64_t BlockchainBDB::get_block_already_generated_coins(const uint64_t &height
 	return result;
 }
 
+void BlockchainBDB::get_block_cumulative_totals(const uint64_t &height, uint64_t &emission, uint64_t &fees) const
+{
+	LOG_PRINT_L3("BlockchainBDB::" << __func__);
+	check_open();
+
+	throw1(DB_ERROR("Not implemented."));
+}
+
 crypto::hash BlockchainBDB::get_block_hash_from_height(const uint64_t &height) const
 {
 	LOG_PRINT_L3("BlockchainBDB::" << __func__);
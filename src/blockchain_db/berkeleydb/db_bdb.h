@@ -290,6 +290,8 @@ class BlockchainBDB : public BlockchainDB
 
 	virtual uint64_t get_block_already_generated_coins(const uint64_t &height) const;
 
+	virtual void get_block_cumulative_totals(const uint64_t &height, uint64_t &emission, uint64_t &fees) const;
+
 	virtual crypto::hash get_block_hash_from_height(const uint64_t &height) const;
 
 	virtual std::vector<block> get_blocks_range(const uint64_t &h1, const uint64_t &h2) const;
@@ -370,7 +372,7 @@ class BlockchainBDB : public BlockchainDB
 	std::map<uint64_t, uint64_t> get_output_histogram(const std::vector<uint64_t> &amounts) const;
 
   private:
-	virtual void add_block(const block &blk, const size_t &block_size, const difficulty_type &cumulative_difficulty, const uint64_t &coins_generated, const crypto::hash &block_hash);
+	virtual void add_block(const block &blk, const size_t &block_size, const difficulty_type &cumulative_difficulty, const uint64_t &coins_generated, const uint64_t &block_fees, const crypto::hash &block_hash);
 
 	virtual void remove_block();
 
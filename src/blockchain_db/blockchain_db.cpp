@@ -230,11 +230,13 @@ uint64_t BlockchainDB::add_block(const block &blk, const size_t &block_size, con
 	time1 = epee::misc_utils::get_tick_count();
 	add_transaction(blk_hash, blk.miner_tx);
 	int tx_i = 0;
+	uint64_t block_fees = 0;
 	crypto::hash tx_hash = crypto::null_hash;
 	for(const transaction &tx : txs)
 	{
 		tx_hash = blk.tx_hashes[tx_i];
 		add_transaction(blk_hash, tx, &tx_hash);
+		block_fees += get_tx_fee(tx);
 		++tx_i;
 	}
 	TIME_MEASURE_FINISH(time1);
@@ -242,7 +244,7 @@ uint64_t BlockchainDB::add_block(const block &blk, const size_t &block_size, con
 
 	// call out to subclass implementation to add the block & metadata
 	time1 = epee::misc_utils::get_tick_count();
-	add_block(blk, block_size, cumulative_difficulty, coins_generated, blk_hash);
+	add_block(blk, block_size, cumulative_difficulty, coins_generated, block_fees, blk_hash);
 	TIME_MEASURE_FINISH(time1);
 	time_add_block1 += time1;
 
@@ -377,16 +377,17 @@ class BlockchainDB
    * @param block_size the size of the block (transactions and all)
    * @param cumulative_difficulty the accumulated difficulty after this block
    * @param coins_generated the number of coins generated total after this block
+   * @param block_fees the sum of the fees paid by the block's transactions
    * @param blk_hash the hash of the block
    */
-	virtual void add_block(const block &blk, const size_t &block_size, const difficulty_type &cumulative_difficulty, const uint64_t &coins_generated, const crypto::hash &blk_hash) = 0;
+	virtual void add_block(const block &blk, const size_t &block_size, const difficulty_type &cumulative_difficulty, const uint64_t &coins_generated, const uint64_t &block_fees, const crypto::hash &blk_hash) = 0;
 
 	/**
    * @brief remove data about the top block
    *
    * The subclass implementing this will remove the block data from the top
    * block in the chain.  The data to be removed is that which was added in
-   * BlockchainDB::add_block(const block& blk, const size_t& block_size, const difficulty_type& cumulative_difficulty, const uint64_t& coins_generated, const crypto::hash& blk_hash)
+   * BlockchainDB::add_block(const block& blk, const size_t& block_size, const difficulty_type& cumulative_difficulty, const uint64_t& coins_generated, const uint64_t& block_fees, const crypto::hash& blk_hash)
    *
    * If any of this cannot be done, the subclass should throw the corresponding
    * subclass of DB_EXCEPTION
@@ -955,6 +956,22 @@ class BlockchainDB
    */
 	virtual uint64_t get_block_already_generated_coins(const uint64_t &height) const = 0;
 
+	/**
+   * @brief fetch the running emission and fee totals as of a block
+   *
+   * The subclass should return the sum of the miner tx outputs less fees
+   * (the emission) and the sum of the fees paid, over all blocks up to and
+   * including the one with the given height. The totals over a range of
+   * blocks are the difference of the values at its two ends.
+   *
+   * If the block does not exist, the subclass should throw BLOCK_DNE
+   *
+   * @param height the height requested
+   * @param emission return-by-reference the cumulative emission
+   * @param fees return-by-reference the cumulative fees
+   */
+	virtual void get_block_cumulative_totals(const uint64_t &height, uint64_t &emission, uint64_t &fees) const = 0;
+
 	/**
    * @brief fetch a block's hash
    *
@@ -1118,7 +1135,33 @@ class BlockchainDB
    * @return true iff the transaction was found
    */
 	virtual bool get_tx_blob(const crypto::hash &h, cryptonote::blobdata &tx) const = 0;
-	virtual bool get_tx_blob_indexed(const crypto::hash& h, cryptonote::blobdata& bd, std::vector<uint64_t>& o_idx) const = 0;
+
+	/**
+   * @brief fetches the pruned transaction blob with the given hash
+   *
+   * The pruned blob is the transaction prefix and the ringct base, as
+   * produced by transaction::serialize_base, without the prunable
+   * signature data.
+   *
+   * If the transaction does not exist, the subclass should return false.
+   *
+   * @param h the hash to look for
+   * @param bd return-by-reference the pruned blob
+   *
+   * @return true iff the transaction was found
+   */
+	virtual bool get_pruned_tx_blob(const crypto::hash &h, cryptonote::blobdata &bd) const = 0;
+
+	/**
+   * @brief fetches the pruned transaction blob and its output indices
+   *
+   * @param h the hash to look for
+   * @param bd return-by-reference the pruned blob
+   * @param o_idx return-by-reference the amount output indices
+   *
+   * @return true iff the transaction was found
+   */
+	virtual bool get_pruned_tx_blob_indexed(const crypto::hash& h, cryptonote::blobdata& bd, std::vector<uint64_t>& o_idx) const = 0;
 
 	/**
    * @brief fetches the total number of transactions ever
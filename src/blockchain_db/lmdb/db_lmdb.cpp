@@ -66,7 +66,7 @@ using namespace crypto;
 
 // Increase when the DB changes in a non backward compatible way, and there
 // is no automatic conversion, so that a full resync is needed.
-#define VERSION 1
+#define VERSION 4
 
 namespace
 {
@@ -175,14 +175,16 @@ int compare_string(const MDB_val *a, const MDB_val *b)
  * -----            ---          ----
  * blocks           block ID     block blob
  * block_heights    block hash   block height
- * block_info       block ID     {block metadata}
+ * block_info       block ID     {block metadata, cumulative emission and fees}
  *
- * txs              txn ID       txn blob
+ * txs_pruned       txn ID       pruned txn blob (prefix and ringct base)
+ * txs_prunable     txn ID       prunable txn blob (the rest)
  * tx_indices       txn hash     {txn ID, metadata}
  * tx_outputs       txn ID       [txn amount output indices]
  *
  * output_txs       output ID    {txn hash, local index}
  * output_amounts   amount       [{amount output index, metadata}...]
+ * rct_distribution block ID     cumulative RCT output count
  *
  * spent_keys       input hash   -
  *
@@ -201,12 +203,14 @@ const char *const LMDB_BLOCKS = "blocks";
 const char *const LMDB_BLOCK_HEIGHTS = "block_heights";
 const char *const LMDB_BLOCK_INFO = "block_info";
 
-const char *const LMDB_TXS = "txs";
+const char *const LMDB_TXS_PRUNED = "txs_pruned";
+const char *const LMDB_TXS_PRUNABLE = "txs_prunable";
 const char *const LMDB_TX_INDICES = "tx_indices";
 const char *const LMDB_TX_OUTPUTS = "tx_outputs";
 
 const char *const LMDB_OUTPUT_TXS = "output_txs";
 const char *const LMDB_OUTPUT_AMOUNTS = "output_amounts";
+const char *const LMDB_RCT_DISTRIBUTION = "rct_distribution";
 const char *const LMDB_SPENT_KEYS = "spent_keys";
 
 const char *const LMDB_TXPOOL_META = "txpool_meta";
@@ -262,7 +266,8 @@ inline void lmdb_db_open(MDB_txn *txn, const char *name, int flags, MDB_dbi &dbi
 namespace cryptonote
 {
 
-typedef struct mdb_block_info
+// block_info layout of DB versions 1 and 2
+typedef struct mdb_block_info_1
 {
 	uint64_t bi_height;
 	uint64_t bi_timestamp;
@@ -270,7 +275,21 @@ typedef struct mdb_block_info
 	uint64_t bi_size; // a size_t really but we need 32-bit compat
 	difficulty_type bi_diff;
 	crypto::hash bi_hash;
-} mdb_block_info;
+} mdb_block_info_1;
+
+typedef struct mdb_block_info_3
+{
+	uint64_t bi_height;
+	uint64_t bi_timestamp;
+	uint64_t bi_coins;
+	uint64_t bi_size; // a size_t really but we need 32-bit compat
+	difficulty_type bi_diff;
+	crypto::hash bi_hash;
+	uint64_t bi_cum_emission; // miner tx outputs less fees, up to and including this block
+	uint64_t bi_cum_fees;
+} mdb_block_info_3;
+
+typedef mdb_block_info_3 mdb_block_info;
 
 typedef struct blk_height
 {
@@ -688,7 +707,7 @@ estim:
 	return threshold_size;
 }
 
-void BlockchainLMDB::add_block(const block &blk, const size_t &block_size, const difficulty_type &cumulative_difficulty, const uint64_t &coins_generated,
+void BlockchainLMDB::add_block(const block &blk, const size_t &block_size, const difficulty_type &cumulative_difficulty, const uint64_t &coins_generated, const uint64_t &block_fees,
 							   const crypto::hash &blk_hash)
 {
 	GULPS_LOG_L3("BlockchainLMDB::", __func__);
@@ -723,6 +742,14 @@ void BlockchainLMDB::add_block(const block &blk, const size_t &block_size, const
 
 	CURSOR(blocks)
 	CURSOR(block_info)
+	CURSOR(rct_distribution)
+
+	// All outputs are RCT and the block's transactions have been added by now,
+	// so the output count is the cumulative RCT count up to and including this block
+	MDB_val_copy<uint64_t> rct_count(num_outputs());
+	result = mdb_cursor_put(m_cur_rct_distribution, &key, &rct_count, MDB_APPEND);
+	if(result)
+		throw0(DB_ERROR(lmdb_error("Failed to add rct distribution to db transaction: ", result).c_str()));
 
 	// this call to mdb_cursor_put will change height()
 	MDB_val_copy<blobdata> blob(block_to_blob(blk));
@@ -730,6 +757,20 @@ void BlockchainLMDB::add_block(const block &blk, const size_t &block_size, const
 	if(result)
 		throw0(DB_ERROR(lmdb_error("Failed to add block blob to db transaction: ", result).c_str()));
 
+	uint64_t cum_emission = 0;
+	uint64_t cum_fees = 0;
+	if(m_height > 0)
+	{
+		MDB_val_copy<uint64_t> prev_key(m_height - 1);
+		MDB_val prev = prev_key;
+		result = mdb_cursor_get(m_cur_block_info, (MDB_val *)&zerokval, &prev, MDB_GET_BOTH);
+		if(result)
+			throw0(DB_ERROR(lmdb_error("Failed to get parent block info: ", result).c_str()));
+		const mdb_block_info *prev_bi = (const mdb_block_info *)prev.mv_data;
+		cum_emission = prev_bi->bi_cum_emission;
+		cum_fees = prev_bi->bi_cum_fees;
+	}
+
 	mdb_block_info bi;
 	bi.bi_height = m_height;
 	bi.bi_timestamp = blk.timestamp;
@@ -737,6 +778,8 @@ void BlockchainLMDB::add_block(const block &blk, const size_t &block_size, const
 	bi.bi_size = block_size;
 	bi.bi_diff = cumulative_difficulty;
 	bi.bi_hash = blk_hash;
+	bi.bi_cum_emission = cum_emission + get_outs_money_amount(blk.miner_tx) - block_fees;
+	bi.bi_cum_fees = cum_fees + block_fees;
 
 	MDB_val_set(val, bi);
 	result = mdb_cursor_put(m_cur_block_info, (MDB_val *)&zerokval, &val, MDB_APPENDDUP);
@@ -766,6 +809,7 @@ void BlockchainLMDB::remove_block()
 	CURSOR(block_info)
 	CURSOR(block_heights)
 	CURSOR(blocks)
+	CURSOR(rct_distribution)
 	MDB_val_copy<uint64_t> k(m_height - 1);
 	MDB_val h = k;
 	if((result = mdb_cursor_get(m_cur_block_info, (MDB_val *)&zerokval, &h, MDB_GET_BOTH)))
@@ -788,6 +832,11 @@ void BlockchainLMDB::remove_block()
 
 	if((result = mdb_cursor_del(m_cur_block_info, 0)))
 		throw1(DB_ERROR(lmdb_error("Failed to add removal of block info to db transaction: ", result).c_str()));
+
+	if((result = mdb_cursor_get(m_cur_rct_distribution, &k, NULL, MDB_SET)))
+		throw1(DB_ERROR(lmdb_error("Failed to locate rct distribution for removal: ", result).c_str()));
+	if((result = mdb_cursor_del(m_cur_rct_distribution, 0)))
+		throw1(DB_ERROR(lmdb_error("Failed to add removal of rct distribution to db transaction: ", result).c_str()));
 }
 
 uint64_t BlockchainLMDB::add_transaction_data(const crypto::hash &blk_hash, const transaction &tx, const crypto::hash &tx_hash)
@@ -800,7 +849,8 @@ uint64_t BlockchainLMDB::add_transaction_data(const crypto::hash &blk_hash, cons
 	int result;
 	uint64_t tx_id = get_tx_count();
 
-	CURSOR(txs)
+	CURSOR(txs_pruned)
+	CURSOR(txs_prunable)
 	CURSOR(tx_indices)
 
 	MDB_val_set(val_tx_id, tx_id);
@@ -829,10 +879,27 @@ uint64_t BlockchainLMDB::add_transaction_data(const crypto::hash &blk_hash, cons
 	if(result)
 		throw0(DB_ERROR(lmdb_error("Failed to add tx data to db transaction: ", result).c_str()));
 
-	MDB_val_copy<blobdata> blob(tx_to_blob(tx));
-	result = mdb_cursor_put(m_cur_txs, &val_tx_id, &blob, MDB_APPEND);
+	// The pruned part is a prefix of the full blob, so the full blob can be stored as two
+	// slices of itself and reassembled by concatenation
+	blobdata blob = tx_to_blob(tx);
+	blobdata pruned;
+	::serialization::blob_ostream os(pruned);
+	binary_span_archive<true> ba(os);
+	if(!const_cast<transaction &>(tx).serialize_base(ba))
+		throw0(DB_ERROR("Failed to serialize pruned tx"));
+	const size_t pruned_size = pruned.size();
+	if(pruned_size > blob.size() || memcmp(blob.data(), pruned.data(), pruned_size) != 0)
+		throw0(DB_ERROR("Pruned tx is not a prefix of the full tx blob"));
+
+	MDB_val pruned_blob = {pruned_size, (void *)blob.data()};
+	result = mdb_cursor_put(m_cur_txs_pruned, &val_tx_id, &pruned_blob, MDB_APPEND);
+	if(result)
+		throw0(DB_ERROR(lmdb_error("Failed to add pruned tx blob to db transaction: ", result).c_str()));
+
+	MDB_val prunable_blob = {blob.size() - pruned_size, (void *)(blob.data() + pruned_size)};
+	result = mdb_cursor_put(m_cur_txs_prunable, &val_tx_id, &prunable_blob, MDB_APPEND);
 	if(result)
-		throw0(DB_ERROR(lmdb_error("Failed to add tx blob to db transaction: ", result).c_str()));
+		throw0(DB_ERROR(lmdb_error("Failed to add prunable tx blob to db transaction: ", result).c_str()));
 
 	return tx_id;
 }
@@ -848,7 +915,8 @@ void BlockchainLMDB::remove_transaction_data(const crypto::hash &tx_hash, const
 
 	mdb_txn_cursors *m_cursors = &m_wcursors;
 	CURSOR(tx_indices)
-	CURSOR(txs)
+	CURSOR(txs_pruned)
+	CURSOR(txs_prunable)
 	CURSOR(tx_outputs)
 
 	MDB_val_set(val_h, tx_hash);
@@ -858,11 +926,17 @@ void BlockchainLMDB::remove_transaction_data(const crypto::hash &tx_hash, const
 	txindex *tip = (txindex *)val_h.mv_data;
 	MDB_val_set(val_tx_id, tip->data.tx_id);
 
-	if((result = mdb_cursor_get(m_cur_txs, &val_tx_id, NULL, MDB_SET)))
-		throw1(DB_ERROR(lmdb_error("Failed to locate tx for removal: ", result).c_str()));
-	result = mdb_cursor_del(m_cur_txs, 0);
+	if((result = mdb_cursor_get(m_cur_txs_pruned, &val_tx_id, NULL, MDB_SET)))
+		throw1(DB_ERROR(lmdb_error("Failed to locate pruned tx for removal: ", result).c_str()));
+	result = mdb_cursor_del(m_cur_txs_pruned, 0);
+	if(result)
+		throw1(DB_ERROR(lmdb_error("Failed to add removal of pruned tx to db transaction: ", result).c_str()));
+
+	if((result = mdb_cursor_get(m_cur_txs_prunable, &val_tx_id, NULL, MDB_SET)))
+		throw1(DB_ERROR(lmdb_error("Failed to locate prunable tx for removal: ", result).c_str()));
+	result = mdb_cursor_del(m_cur_txs_prunable, 0);
 	if(result)
-		throw1(DB_ERROR(lmdb_error("Failed to add removal of tx to db transaction: ", result).c_str()));
+		throw1(DB_ERROR(lmdb_error("Failed to add removal of prunable tx to db transaction: ", result).c_str()));
 
 	remove_tx_outputs(tip->data.tx_id, tx);
 
@@ -1077,9 +1151,8 @@ blobdata BlockchainLMDB::output_to_blob(const tx_out &output) const
 tx_out BlockchainLMDB::output_from_blob(const blobdata &blob) const
 {
 	GULPS_LOG_L3("BlockchainLMDB::", __func__);
-	std::stringstream ss;
-	ss << blob;
-	binary_archive<false> ba(ss);
+	::serialization::span_istream ss(epee::to_byte_span(epee::to_span(blob)));
+	binary_span_archive<false> ba(ss);
 	tx_out o;
 
 	if(!(::serialization::serialize(ba, o)))
@@ -1223,12 +1296,14 @@ void BlockchainLMDB::open(const std::string &filename, const int db_flags)
 	lmdb_db_open(txn, LMDB_BLOCK_INFO, MDB_INTEGERKEY | MDB_CREATE | MDB_DUPSORT | MDB_DUPFIXED, m_block_info, "Failed to open db handle for m_block_info");
 	lmdb_db_open(txn, LMDB_BLOCK_HEIGHTS, MDB_INTEGERKEY | MDB_CREATE | MDB_DUPSORT | MDB_DUPFIXED, m_block_heights, "Failed to open db handle for m_block_heights");
 
-	lmdb_db_open(txn, LMDB_TXS, MDB_INTEGERKEY | MDB_CREATE, m_txs, "Failed to open db handle for m_txs");
+	lmdb_db_open(txn, LMDB_TXS_PRUNED, MDB_INTEGERKEY | MDB_CREATE, m_txs_pruned, "Failed to open db handle for m_txs_pruned");
+	lmdb_db_open(txn, LMDB_TXS_PRUNABLE, MDB_INTEGERKEY | MDB_CREATE, m_txs_prunable, "Failed to open db handle for m_txs_prunable");
 	lmdb_db_open(txn, LMDB_TX_INDICES, MDB_INTEGERKEY | MDB_CREATE | MDB_DUPSORT | MDB_DUPFIXED, m_tx_indices, "Failed to open db handle for m_tx_indices");
 	lmdb_db_open(txn, LMDB_TX_OUTPUTS, MDB_INTEGERKEY | MDB_CREATE, m_tx_outputs, "Failed to open db handle for m_tx_outputs");
 
 	lmdb_db_open(txn, LMDB_OUTPUT_TXS, MDB_INTEGERKEY | MDB_CREATE | MDB_DUPSORT | MDB_DUPFIXED, m_output_txs, "Failed to open db handle for m_output_txs");
 	lmdb_db_open(txn, LMDB_OUTPUT_AMOUNTS, MDB_INTEGERKEY | MDB_DUPSORT | MDB_DUPFIXED | MDB_CREATE, m_output_amounts, "Failed to open db handle for m_output_amounts");
+	lmdb_db_open(txn, LMDB_RCT_DISTRIBUTION, MDB_INTEGERKEY | MDB_CREATE, m_rct_distribution, "Failed to open db handle for m_rct_distribution");
 
 	lmdb_db_open(txn, LMDB_SPENT_KEYS, MDB_INTEGERKEY | MDB_CREATE | MDB_DUPSORT | MDB_DUPFIXED, m_spent_keys, "Failed to open db handle for m_spent_keys");
 
@@ -1390,8 +1465,10 @@ void BlockchainLMDB::reset()
 		throw0(DB_ERROR(lmdb_error("Failed to drop m_block_info: ", result).c_str()));
 	if(auto result = mdb_drop(txn, m_block_heights, 0))
 		throw0(DB_ERROR(lmdb_error("Failed to drop m_block_heights: ", result).c_str()));
-	if(auto result = mdb_drop(txn, m_txs, 0))
-		throw0(DB_ERROR(lmdb_error("Failed to drop m_txs: ", result).c_str()));
+	if(auto result = mdb_drop(txn, m_txs_pruned, 0))
+		throw0(DB_ERROR(lmdb_error("Failed to drop m_txs_pruned: ", result).c_str()));
+	if(auto result = mdb_drop(txn, m_txs_prunable, 0))
+		throw0(DB_ERROR(lmdb_error("Failed to drop m_txs_prunable: ", result).c_str()));
 	if(auto result = mdb_drop(txn, m_tx_indices, 0))
 		throw0(DB_ERROR(lmdb_error("Failed to drop m_tx_indices: ", result).c_str()));
 	if(auto result = mdb_drop(txn, m_tx_outputs, 0))
@@ -1400,6 +1477,8 @@ void BlockchainLMDB::reset()
 		throw0(DB_ERROR(lmdb_error("Failed to drop m_output_txs: ", result).c_str()));
 	if(auto result = mdb_drop(txn, m_output_amounts, 0))
 		throw0(DB_ERROR(lmdb_error("Failed to drop m_output_amounts: ", result).c_str()));
+	if(auto result = mdb_drop(txn, m_rct_distribution, 0))
+		throw0(DB_ERROR(lmdb_error("Failed to drop m_rct_distribution: ", result).c_str()));
 	if(auto result = mdb_drop(txn, m_spent_keys, 0))
 		throw0(DB_ERROR(lmdb_error("Failed to drop m_spent_keys: ", result).c_str()));
 	(void)mdb_drop(txn, m_hf_starting_heights, 0); // this one is dropped in new code
@@ -1984,6 +2063,29 @@ uint64_t BlockchainLMDB::get_block_already_generated_coins(const uint64_t &heigh
 	return ret;
 }
 
+void BlockchainLMDB::get_block_cumulative_totals(const uint64_t &height, uint64_t &emission, uint64_t &fees) const
+{
+	GULPS_LOG_L3("BlockchainLMDB::", __func__);
+	check_open();
+
+	TXN_PREFIX_RDONLY();
+	RCURSOR(block_info);
+
+	MDB_val_set(result, height);
+	auto get_result = mdb_cursor_get(m_cur_block_info, (MDB_val *)&zerokval, &result, MDB_GET_BOTH);
+	if(get_result == MDB_NOTFOUND)
+	{
+		throw0(BLOCK_DNE(std::string("Attempt to get cumulative totals from height ").append(boost::lexical_cast<std::string>(height)).append(" failed -- block info not in db").c_str()));
+	}
+	else if(get_result)
+		throw0(DB_ERROR("Error attempting to retrieve cumulative totals from the db"));
+
+	mdb_block_info *bi = (mdb_block_info *)result.mv_data;
+	emission = bi->bi_cum_emission;
+	fees = bi->bi_cum_fees;
+	TXN_POSTFIX_RDONLY();
+}
+
 crypto::hash BlockchainLMDB::get_block_hash_from_height(const uint64_t &height) const
 {
 	GULPS_LOG_L3("BlockchainLMDB::", __func__);
@@ -2098,7 +2200,6 @@ bool BlockchainLMDB::tx_exists(const crypto::hash &h) const
 
 	TXN_PREFIX_RDONLY();
 	RCURSOR(tx_indices);
-	RCURSOR(txs);
 
 	MDB_val_set(key, h);
 	bool tx_found = false;
@@ -2111,7 +2212,7 @@ bool BlockchainLMDB::tx_exists(const crypto::hash &h) const
 		throw0(DB_ERROR(lmdb_error(std::string("DB error attempting to fetch transaction index from hash ") + epee::string_tools::pod_to_hex(h) + ": ", get_result).c_str()));
 
 	// This isn't needed as part of the check. we're not checking consistency of db.
-	// get_result = mdb_cursor_get(m_cur_txs, &val_tx_index, &result, MDB_SET);
+	// get_result = mdb_cursor_get(m_cur_txs_pruned, &val_tx_index, &result, MDB_SET);
 	TIME_MEASURE_FINISH(time1);
 	time_tx_exists += time1;
 
@@ -2194,22 +2295,57 @@ bool BlockchainLMDB::get_tx_blob(const crypto::hash &h, cryptonote::blobdata &bd
 
 	TXN_PREFIX_RDONLY();
 	RCURSOR(tx_indices);
-	RCURSOR(txs);
+	RCURSOR(txs_pruned);
+	RCURSOR(txs_prunable);
 
 	MDB_val_set(v, h);
-	MDB_val result;
+	MDB_val result0, result1;
 	auto get_result = mdb_cursor_get(m_cur_tx_indices, (MDB_val *)&zerokval, &v, MDB_GET_BOTH);
 	if(get_result == 0)
 	{
 		txindex *tip = (txindex *)v.mv_data;
 		MDB_val_set(val_tx_id, tip->data.tx_id);
-		get_result = mdb_cursor_get(m_cur_txs, &val_tx_id, &result, MDB_SET);
+		get_result = mdb_cursor_get(m_cur_txs_pruned, &val_tx_id, &result0, MDB_SET);
+		if(get_result == 0)
+			get_result = mdb_cursor_get(m_cur_txs_prunable, &val_tx_id, &result1, MDB_SET);
 	}
 	if(get_result == MDB_NOTFOUND)
 		return false;
 	else if(get_result)
 		throw0(DB_ERROR(lmdb_error("DB error attempting to fetch tx from hash", get_result).c_str()));
 
+	bd.reserve(result0.mv_size + result1.mv_size);
+	bd.assign(reinterpret_cast<char *>(result0.mv_data), result0.mv_size);
+	bd.append(reinterpret_cast<char *>(result1.mv_data), result1.mv_size);
+
+	TXN_POSTFIX_RDONLY();
+
+	return true;
+}
+
+bool BlockchainLMDB::get_pruned_tx_blob(const crypto::hash &h, cryptonote::blobdata &bd) const
+{
+	GULPS_LOG_L3("BlockchainLMDB::", __func__);
+	check_open();
+
+	TXN_PREFIX_RDONLY();
+	RCURSOR(tx_indices);
+	RCURSOR(txs_pruned);
+
+	MDB_val_set(v, h);
+	MDB_val result;
+	auto get_result = mdb_cursor_get(m_cur_tx_indices, (MDB_val *)&zerokval, &v, MDB_GET_BOTH);
+	if(get_result == 0)
+	{
+		txindex *tip = (txindex *)v.mv_data;
+		MDB_val_set(val_tx_id, tip->data.tx_id);
+		get_result = mdb_cursor_get(m_cur_txs_pruned, &val_tx_id, &result, MDB_SET);
+	}
+	if(get_result == MDB_NOTFOUND)
+		return false;
+	else if(get_result)
+		throw0(DB_ERROR(lmdb_error("DB error attempting to fetch pruned tx from hash", get_result).c_str()));
+
 	bd.assign(reinterpret_cast<char *>(result.mv_data), result.mv_size);
 
 	TXN_POSTFIX_RDONLY();
@@ -2217,14 +2353,14 @@ bool BlockchainLMDB::get_tx_blob(const crypto::hash &h, cryptonote::blobdata &bd
 	return true;
 }
 
-bool BlockchainLMDB::get_tx_blob_indexed(const crypto::hash& h, cryptonote::blobdata& bd, std::vector<uint64_t>& o_idx) const
+bool BlockchainLMDB::get_pruned_tx_blob_indexed(const crypto::hash& h, cryptonote::blobdata& bd, std::vector<uint64_t>& o_idx) const
 {
 	GULPS_LOG_L3("BlockchainLMDB::", __func__);
 	check_open();
 
 	TXN_PREFIX_RDONLY();
 	RCURSOR(tx_indices);
-	RCURSOR(txs);
+	RCURSOR(txs_pruned);
 
 	MDB_val_set(v, h);
 	MDB_val result;
@@ -2235,7 +2371,7 @@ bool BlockchainLMDB::get_tx_blob_indexed(const crypto::hash& h, cryptonote::blob
 		txindex *tip = (txindex *)v.mv_data;
 		db_tx_id = tip->data.tx_id;
 		MDB_val_set(val_tx_id, tip->data.tx_id);
-		get_result = mdb_cursor_get(m_cur_txs, &val_tx_id, &result, MDB_SET);
+		get_result = mdb_cursor_get(m_cur_txs_pruned, &val_tx_id, &result, MDB_SET);
 	}
 	if(get_result == MDB_NOTFOUND)
 		return false;
@@ -2276,8 +2412,8 @@ uint64_t BlockchainLMDB::get_tx_count() const
 	int result;
 
 	MDB_stat db_stats;
-	if((result = mdb_stat(m_txn, m_txs, &db_stats)))
-		throw0(DB_ERROR(lmdb_error("Failed to query m_txs: ", result).c_str()));
+	if((result = mdb_stat(m_txn, m_txs_pruned, &db_stats)))
+		throw0(DB_ERROR(lmdb_error("Failed to query m_txs_pruned: ", result).c_str()));
 
 	TXN_POSTFIX_RDONLY();
 
@@ -2353,7 +2489,7 @@ output_data_t BlockchainLMDB::get_output_key(const uint64_t &global_index) const
 	TXN_PREFIX_RDONLY();
 	RCURSOR(output_txs);
 	RCURSOR(tx_indices);
-	RCURSOR(txs);
+	RCURSOR(txs_pruned);
 
 	output_data_t od;
 	MDB_val_set(v, global_index);
@@ -2373,7 +2509,7 @@ output_data_t BlockchainLMDB::get_output_key(const uint64_t &global_index) const
 	txindex *tip = (txindex *)val_h.mv_data;
 	MDB_val_set(val_tx_id, tip->data.tx_id);
 	MDB_val result;
-	get_result = mdb_cursor_get(m_cur_txs, &val_tx_id, &result, MDB_SET);
+	get_result = mdb_cursor_get(m_cur_txs_pruned, &val_tx_id, &result, MDB_SET);
 	if(get_result == MDB_NOTFOUND)
 		throw1(TX_DNE(std::string("tx with hash ").append(epee::string_tools::pod_to_hex(ot->tx_hash)).append(" not found in db").c_str()));
 	else if(get_result)
@@ -2383,7 +2519,7 @@ output_data_t BlockchainLMDB::get_output_key(const uint64_t &global_index) const
 	bd.assign(reinterpret_cast<char *>(result.mv_data), result.mv_size);
 
 	transaction tx;
-	if(!parse_and_validate_tx_from_blob(bd, tx))
+	if(!parse_and_validate_tx_base_from_blob(bd, tx))
 		throw0(DB_ERROR("Failed to parse tx from blob retrieved from the db"));
 
 	const tx_out tx_output = tx.vout[ot->local_index];
@@ -2611,7 +2747,8 @@ bool BlockchainLMDB::for_all_transactions(std::function<bool(const crypto::hash
 	check_open();
 
 	TXN_PREFIX_RDONLY();
-	RCURSOR(txs);
+	RCURSOR(txs_pruned);
+	RCURSOR(txs_prunable);
 	RCURSOR(tx_indices);
 
 	MDB_val k;
@@ -2632,13 +2769,19 @@ bool BlockchainLMDB::for_all_transactions(std::function<bool(const crypto::hash
 		const crypto::hash hash = ti->key;
 		k.mv_data = (void *)&ti->data.tx_id;
 		k.mv_size = sizeof(ti->data.tx_id);
-		ret = mdb_cursor_get(m_cur_txs, &k, &v, MDB_SET);
+		ret = mdb_cursor_get(m_cur_txs_pruned, &k, &v, MDB_SET);
 		if(ret == MDB_NOTFOUND)
 			break;
 		if(ret)
 			throw0(DB_ERROR(lmdb_error("Failed to enumerate transactions: ", ret).c_str()));
 		blobdata bd;
 		bd.assign(reinterpret_cast<char *>(v.mv_data), v.mv_size);
+		ret = mdb_cursor_get(m_cur_txs_prunable, &k, &v, MDB_SET);
+		if(ret == MDB_NOTFOUND)
+			break;
+		if(ret)
+			throw0(DB_ERROR(lmdb_error("Failed to enumerate transactions: ", ret).c_str()));
+		bd.append(reinterpret_cast<char *>(v.mv_data), v.mv_size);
 		transaction tx;
 		if(!parse_and_validate_tx_from_blob(bd, tx))
 			throw0(DB_ERROR("Failed to parse tx from blob retrieved from the db"));
@@ -3283,6 +3426,9 @@ bool BlockchainLMDB::get_output_distribution(uint64_t amount, uint64_t from_heig
 	GULPS_LOG_L3("BlockchainLMDB::", __func__);
 	check_open();
 
+	if(amount == 0)
+		return get_rct_distribution(from_height, to_height, distribution, base);
+
 	TXN_PREFIX_RDONLY();
 	RCURSOR(output_amounts);
 
@@ -3319,6 +3465,55 @@ bool BlockchainLMDB::get_output_distribution(uint64_t amount, uint64_t from_heig
 	return true;
 }
 
+bool BlockchainLMDB::get_rct_distribution(uint64_t from_height, uint64_t to_height, std::vector<uint64_t> &distribution, uint64_t &base) const
+{
+	GULPS_LOG_L3("BlockchainLMDB::", __func__);
+	check_open();
+
+	TXN_PREFIX_RDONLY();
+	RCURSOR(rct_distribution);
+
+	distribution.clear();
+	const uint64_t db_height = height();
+	if(from_height >= db_height)
+		return false;
+
+	uint64_t end_height = db_height - 1;
+	if(to_height > 0 && to_height >= from_height && to_height < end_height)
+		end_height = to_height;
+	distribution.resize(end_height - from_height + 1);
+
+	uint64_t prev = 0;
+	MDB_val_set(k, from_height);
+	MDB_val v;
+	if(from_height > 0)
+	{
+		uint64_t base_height = from_height - 1;
+		MDB_val_set(kb, base_height);
+		int ret = mdb_cursor_get(m_cur_rct_distribution, &kb, &v, MDB_SET);
+		if(ret)
+			throw0(DB_ERROR(lmdb_error("Failed to get rct distribution: ", ret).c_str()));
+		prev = *(const uint64_t *)v.mv_data;
+	}
+	base = prev;
+
+	MDB_cursor_op op = MDB_SET;
+	for(uint64_t &count : distribution)
+	{
+		int ret = mdb_cursor_get(m_cur_rct_distribution, &k, &v, op);
+		op = MDB_NEXT;
+		if(ret)
+			throw0(DB_ERROR(lmdb_error("Failed to enumerate rct distribution: ", ret).c_str()));
+		const uint64_t cumulative = *(const uint64_t *)v.mv_data;
+		count = cumulative - prev;
+		prev = cumulative;
+	}
+
+	TXN_POSTFIX_RDONLY();
+
+	return true;
+}
+
 void BlockchainLMDB::check_hard_fork_info()
 {
 }
@@ -3554,7 +3749,7 @@ void BlockchainLMDB::migrate_0_1()
 			break;
 		}
 		MDB_dbi diffs, hashes, sizes, timestamps;
-		mdb_block_info bi;
+		mdb_block_info_1 bi;
 		MDB_val_set(nv, bi);
 
 		lmdb_db_open(txn, "block_diffs", 0, diffs, "Failed to open db handle for block_diffs");
@@ -3892,8 +4087,9 @@ void BlockchainLMDB::migrate_0_1()
 					throw0(DB_ERROR(lmdb_error("Failed to open a cursor for txs: ", result).c_str()));
 				if(!i)
 				{
+					// add_transaction writes the split tables, so count what landed there
 					MDB_stat ms;
-					mdb_stat(txn, m_txs, &ms);
+					mdb_stat(txn, m_txs_pruned, &ms);
 					i = ms.ms_entries;
 					if(i)
 					{
@@ -3979,12 +4175,438 @@ void BlockchainLMDB::migrate_0_1()
 	txn.commit();
 }
 
+void BlockchainLMDB::migrate_1_2()
+{
+	GULPS_LOG_L3("BlockchainLMDB::", __func__);
+	uint64_t i, m_height, rct_count, num_rct;
+	int result;
+	mdb_txn_safe txn(false);
+	MDB_val v;
+
+	GULPS_INFO_CLR(gulps::COLOR_YELLOW, "Migrating blockchain from DB version 1 to 2 - this may take a while:");
+	GULPS_INFO("building the rct_distribution table...");
+
+	do
+	{
+		result = mdb_txn_begin(m_env, NULL, 0, txn);
+		if(result)
+			throw0(DB_ERROR(lmdb_error("Failed to create a transaction for the db: ", result).c_str()));
+
+		MDB_stat db_stats;
+		if((result = mdb_stat(txn, m_blocks, &db_stats)))
+			throw0(DB_ERROR(lmdb_error("Failed to query m_blocks: ", result).c_str()));
+		m_height = db_stats.ms_entries;
+		if((result = mdb_stat(txn, m_rct_distribution, &db_stats)))
+			throw0(DB_ERROR(lmdb_error("Failed to query m_rct_distribution: ", result).c_str()));
+		i = db_stats.ms_entries;
+		if((result = mdb_stat(txn, m_output_txs, &db_stats)))
+			throw0(DB_ERROR(lmdb_error("Failed to query m_output_txs: ", result).c_str()));
+		num_rct = db_stats.ms_entries;
+		GULPSF_INFO("Total number of blocks: {}", m_height);
+
+		if(i >= m_height)
+		{
+			txn.abort();
+			GULPS_LOG_L1("  rct_distribution already migrated");
+			break;
+		}
+
+		// pick up where an interrupted migration left off
+		rct_count = 0;
+		if(i > 0)
+		{
+			uint64_t last = i - 1;
+			MDB_val_set(k, last);
+			if((result = mdb_get(txn, m_rct_distribution, &k, &v)))
+				throw0(DB_ERROR(lmdb_error("Failed to get rct distribution: ", result).c_str()));
+			rct_count = *(const uint64_t *)v.mv_data;
+		}
+
+		MDB_cursor *c_amounts, *c_dist;
+		uint64_t amount = 0;
+		MDB_val_set(ka, amount);
+		const uint64_t start = i;
+		while(i < m_height)
+		{
+			if(i == start || !(i % 2000))
+			{
+				if(i != start)
+				{
+					GULPSF_LOG_L0("{}/{}\r", i, m_height);
+
+					txn.commit();
+					result = mdb_txn_begin(m_env, NULL, 0, txn);
+					if(result)
+						throw0(DB_ERROR(lmdb_error("Failed to create a transaction for the db: ", result).c_str()));
+				}
+				result = mdb_cursor_open(txn, m_output_amounts, &c_amounts);
+				if(result)
+					throw0(DB_ERROR(lmdb_error("Failed to open a cursor for output_amounts: ", result).c_str()));
+				result = mdb_cursor_open(txn, m_rct_distribution, &c_dist);
+				if(result)
+					throw0(DB_ERROR(lmdb_error("Failed to open a cursor for rct_distribution: ", result).c_str()));
+
+				// outputs are appended in block order, so the next one to count is at amount index rct_count
+				if(rct_count < num_rct)
+				{
+					v.mv_data = &rct_count;
+					v.mv_size = sizeof(rct_count);
+					result = mdb_cursor_get(c_amounts, &ka, &v, MDB_GET_BOTH);
+					if(result)
+						throw0(DB_ERROR(lmdb_error("Failed to get output from output_amounts: ", result).c_str()));
+				}
+			}
+
+			while(rct_count < num_rct && ((const outkey *)v.mv_data)->data.height <= i)
+			{
+				rct_count++;
+				if(rct_count == num_rct)
+					break;
+				result = mdb_cursor_get(c_amounts, &ka, &v, MDB_NEXT_DUP);
+				if(result)
+					throw0(DB_ERROR(lmdb_error("Failed to enumerate output_amounts: ", result).c_str()));
+			}
+
+			MDB_val_set(kh, i);
+			MDB_val_set(vc, rct_count);
+			result = mdb_cursor_put(c_dist, &kh, &vc, MDB_APPEND);
+			if(result)
+				throw0(DB_ERROR(lmdb_error("Failed to add rct distribution: ", result).c_str()));
+			i++;
+		}
+		txn.commit();
+	} while(0);
+
+	uint32_t version = 2;
+	v.mv_data = (void *)&version;
+	v.mv_size = sizeof(version);
+	MDB_val_copy<const char *> vk("version");
+	result = mdb_txn_begin(m_env, NULL, 0, txn);
+	if(result)
+		throw0(DB_ERROR(lmdb_error("Failed to create a transaction for the db: ", result).c_str()));
+	result = mdb_put(txn, m_properties, &vk, &v, 0);
+	if(result)
+		throw0(DB_ERROR(lmdb_error("Failed to update version for the db: ", result).c_str()));
+	txn.commit();
+}
+
+void BlockchainLMDB::migrate_2_3()
+{
+	GULPS_LOG_L3("BlockchainLMDB::", __func__);
+	uint64_t i, m_height, cum_emission, cum_fees;
+	int result;
+	mdb_txn_safe txn(false);
+	MDB_val k, v;
+
+	GULPS_INFO_CLR(gulps::COLOR_YELLOW, "Migrating blockchain from DB version 2 to 3 - this may take a while:");
+	GULPS_INFO("adding cumulative emission and fees to block_info...");
+
+	do
+	{
+		result = mdb_txn_begin(m_env, NULL, 0, txn);
+		if(result)
+			throw0(DB_ERROR(lmdb_error("Failed to create a transaction for the db: ", result).c_str()));
+
+		/* The records get bigger, and a DUPFIXED table can't hold two sizes. The new
+		 * records are built in block_infn, which is then copied over block_info.
+		 */
+		MDB_dbi infn;
+		result = mdb_dbi_open(txn, "block_infn", 0, &infn);
+		if(result == MDB_NOTFOUND)
+		{
+			MDB_cursor *c_first;
+			result = mdb_cursor_open(txn, m_block_info, &c_first);
+			if(result)
+				throw0(DB_ERROR(lmdb_error("Failed to open a cursor for block_info: ", result).c_str()));
+			result = mdb_cursor_get(c_first, &k, &v, MDB_FIRST);
+			mdb_cursor_close(c_first);
+			if(result == MDB_NOTFOUND || (result == 0 && v.mv_size == sizeof(mdb_block_info)))
+			{
+				txn.abort();
+				GULPS_LOG_L1("  block_info already migrated");
+				break;
+			}
+		}
+		else if(result)
+			throw0(DB_ERROR(lmdb_error("Failed to open db handle for block_infn: ", result).c_str()));
+		lmdb_db_open(txn, "block_infn", MDB_INTEGERKEY | MDB_CREATE | MDB_DUPSORT | MDB_DUPFIXED, infn, "Failed to open db handle for block_infn");
+		mdb_set_dupsort(txn, infn, compare_uint64);
+
+		MDB_stat db_stats;
+		if((result = mdb_stat(txn, m_blocks, &db_stats)))
+			throw0(DB_ERROR(lmdb_error("Failed to query m_blocks: ", result).c_str()));
+		m_height = db_stats.ms_entries;
+		if((result = mdb_stat(txn, infn, &db_stats)))
+			throw0(DB_ERROR(lmdb_error("Failed to query block_infn: ", result).c_str()));
+		i = db_stats.ms_entries;
+		GULPSF_INFO("Total number of blocks: {}", m_height);
+
+		// pick up where an interrupted migration left off
+		cum_emission = 0;
+		cum_fees = 0;
+		if(i > 0)
+		{
+			uint64_t last = i - 1;
+			MDB_val_set(vl, last);
+			MDB_cursor *c_last;
+			result = mdb_cursor_open(txn, infn, &c_last);
+			if(result)
+				throw0(DB_ERROR(lmdb_error("Failed to open a cursor for block_infn: ", result).c_str()));
+			if((result = mdb_cursor_get(c_last, (MDB_val *)&zerokval, &vl, MDB_GET_BOTH)))
+				throw0(DB_ERROR(lmdb_error("Failed to get block_infn record: ", result).c_str()));
+			cum_emission = ((const mdb_block_info *)vl.mv_data)->bi_cum_emission;
+			cum_fees = ((const mdb_block_info *)vl.mv_data)->bi_cum_fees;
+			mdb_cursor_close(c_last);
+		}
+
+		MDB_cursor *c_old, *c_new, *c_blocks, *c_tx_indices, *c_txs, *c_txs_pruned;
+		mdb_block_info bi;
+		MDB_val_set(nv, bi);
+		const uint64_t start = i;
+		while(i < m_height)
+		{
+			if(i == start || !(i % 2000))
+			{
+				if(i != start)
+				{
+					GULPSF_LOG_L0("{}/{}\r", i, m_height);
+
+					txn.commit();
+					result = mdb_txn_begin(m_env, NULL, 0, txn);
+					if(result)
+						throw0(DB_ERROR(lmdb_error("Failed to create a transaction for the db: ", result).c_str()));
+				}
+				result = mdb_cursor_open(txn, m_block_info, &c_old);
+				if(result)
+					throw0(DB_ERROR(lmdb_error("Failed to open a cursor for block_info: ", result).c_str()));
+				result = mdb_cursor_open(txn, infn, &c_new);
+				if(result)
+					throw0(DB_ERROR(lmdb_error("Failed to open a cursor for block_infn: ", result).c_str()));
+				result = mdb_cursor_open(txn, m_blocks, &c_blocks);
+				if(result)
+					throw0(DB_ERROR(lmdb_error("Failed to open a cursor for blocks: ", result).c_str()));
+				result = mdb_cursor_open(txn, m_tx_indices, &c_tx_indices);
+				if(result)
+					throw0(DB_ERROR(lmdb_error("Failed to open a cursor for tx_indices: ", result).c_str()));
+				result = mdb_cursor_open(txn, m_txs, &c_txs);
+				if(result)
+					throw0(DB_ERROR(lmdb_error("Failed to open a cursor for txs: ", result).c_str()));
+				result = mdb_cursor_open(txn, m_txs_pruned, &c_txs_pruned);
+				if(result)
+					throw0(DB_ERROR(lmdb_error("Failed to open a cursor for txs_pruned: ", result).c_str()));
+			}
+
+			MDB_val_set(vo, i);
+			result = mdb_cursor_get(c_old, (MDB_val *)&zerokval, &vo, MDB_GET_BOTH);
+			if(result)
+				throw0(DB_ERROR(lmdb_error("Failed to get a record from block_info: ", result).c_str()));
+			memcpy(&bi, vo.mv_data, sizeof(mdb_block_info_1));
+
+			MDB_val_set(kb, i);
+			result = mdb_cursor_get(c_blocks, &kb, &v, MDB_SET);
+			if(result)
+				throw0(DB_ERROR(lmdb_error("Failed to get a record from blocks: ", result).c_str()));
+			block b;
+			if(!parse_and_validate_block_from_blob(blobdata((const char *)v.mv_data, v.mv_size), b))
+				throw0(DB_ERROR("Failed to parse block from blob retrieved from the db"));
+
+			uint64_t block_fees = 0;
+			for(const crypto::hash &tx_hash : b.tx_hashes)
+			{
+				MDB_val_set(vt, tx_hash);
+				result = mdb_cursor_get(c_tx_indices, (MDB_val *)&zerokval, &vt, MDB_GET_BOTH);
+				if(result)
+					throw0(DB_ERROR(lmdb_error("Failed to get a record from tx_indices: ", result).c_str()));
+				MDB_val_set(kt, ((const txindex *)vt.mv_data)->data.tx_id);
+				result = mdb_cursor_get(c_txs, &kt, &v, MDB_SET);
+				// a version 0 database had its txs re-added by migrate_0_1, which writes the split tables
+				if(result == MDB_NOTFOUND)
+					result = mdb_cursor_get(c_txs_pruned, &kt, &v, MDB_SET);
+				if(result)
+					throw0(DB_ERROR(lmdb_error("Failed to get a record from txs: ", result).c_str()));
+				transaction tx;
+				if(!parse_and_validate_tx_base_from_blob(blobdata((const char *)v.mv_data, v.mv_size), tx))
+					throw0(DB_ERROR("Failed to parse tx from blob retrieved from the db"));
+				block_fees += get_tx_fee(tx);
+			}
+
+			cum_emission += get_outs_money_amount(b.miner_tx) - block_fees;
+			cum_fees += block_fees;
+			bi.bi_cum_emission = cum_emission;
+			bi.bi_cum_fees = cum_fees;
+			result = mdb_cursor_put(c_new, (MDB_val *)&zerokval, &nv, MDB_APPENDDUP);
+			if(result)
+				throw0(DB_ERROR(lmdb_error("Failed to put a record into block_infn: ", result).c_str()));
+			i++;
+		}
+		txn.commit();
+
+		GULPS_LOG_L1("  replacing block_info:");
+		result = mdb_txn_begin(m_env, NULL, 0, txn);
+		if(result)
+			throw0(DB_ERROR(lmdb_error("Failed to create a transaction for the db: ", result).c_str()));
+		if((result = mdb_drop(txn, m_block_info, 0)))
+			throw0(DB_ERROR(lmdb_error("Failed to empty block_info: ", result).c_str()));
+		MDB_cursor *c_cur;
+		result = mdb_cursor_open(txn, m_block_info, &c_cur);
+		if(result)
+			throw0(DB_ERROR(lmdb_error("Failed to open a cursor for block_info: ", result).c_str()));
+		result = mdb_cursor_open(txn, infn, &c_new);
+		if(result)
+			throw0(DB_ERROR(lmdb_error("Failed to open a cursor for block_infn: ", result).c_str()));
+		while(1)
+		{
+			result = mdb_cursor_get(c_new, &k, &v, MDB_NEXT);
+			if(result == MDB_NOTFOUND)
+				break;
+			else if(result)
+				throw0(DB_ERROR(lmdb_error("Failed to get a record from block_infn: ", result).c_str()));
+			result = mdb_cursor_put(c_cur, (MDB_val *)&zerokval, &v, MDB_APPENDDUP);
+			if(result)
+				throw0(DB_ERROR(lmdb_error("Failed to put a record into block_info: ", result).c_str()));
+		}
+		mdb_cursor_close(c_new);
+		mdb_cursor_close(c_cur);
+		result = mdb_drop(txn, infn, 1);
+		if(result)
+			throw0(DB_ERROR(lmdb_error("Failed to delete block_infn from the db: ", result).c_str()));
+		txn.commit();
+	} while(0);
+
+	uint32_t version = 3;
+	v.mv_data = (void *)&version;
+	v.mv_size = sizeof(version);
+	MDB_val_copy<const char *> vk("version");
+	result = mdb_txn_begin(m_env, NULL, 0, txn);
+	if(result)
+		throw0(DB_ERROR(lmdb_error("Failed to create a transaction for the db: ", result).c_str()));
+	result = mdb_put(txn, m_properties, &vk, &v, 0);
+	if(result)
+		throw0(DB_ERROR(lmdb_error("Failed to update version for the db: ", result).c_str()));
+	txn.commit();
+}
+
+void BlockchainLMDB::migrate_3_4()
+{
+	GULPS_LOG_L3("BlockchainLMDB::", __func__);
+	uint64_t i, z;
+	int result;
+	mdb_txn_safe txn(false);
+	MDB_val k, v;
+
+	GULPS_INFO_CLR(gulps::COLOR_YELLOW, "Migrating blockchain from DB version 3 to 4 - this may take a while:");
+	GULPS_INFO("splitting txs into pruned and prunable parts...");
+
+	do
+	{
+		result = mdb_txn_begin(m_env, NULL, 0, txn);
+		if(result)
+			throw0(DB_ERROR(lmdb_error("Failed to create a transaction for the db: ", result).c_str()));
+
+		MDB_stat db_stats;
+		if((result = mdb_stat(txn, m_txs, &db_stats)))
+			throw0(DB_ERROR(lmdb_error("Failed to query m_txs: ", result).c_str()));
+		z = db_stats.ms_entries;
+		GULPSF_INFO("Total number of transactions: {}", z);
+
+		/* Each tx moves to the new tables and is deleted from txs in the same
+		 * transaction, so an interrupted migration just carries on with the rest.
+		 */
+		MDB_cursor *c_txs, *c_pruned, *c_prunable;
+		i = 0;
+		while(1)
+		{
+			if(!(i % 1000))
+			{
+				if(i)
+				{
+					GULPSF_LOG_L0("{}/{}\r", i, z);
+
+					txn.commit();
+					result = mdb_txn_begin(m_env, NULL, 0, txn);
+					if(result)
+						throw0(DB_ERROR(lmdb_error("Failed to create a transaction for the db: ", result).c_str()));
+				}
+				result = mdb_cursor_open(txn, m_txs, &c_txs);
+				if(result)
+					throw0(DB_ERROR(lmdb_error("Failed to open a cursor for txs: ", result).c_str()));
+				result = mdb_cursor_open(txn, m_txs_pruned, &c_pruned);
+				if(result)
+					throw0(DB_ERROR(lmdb_error("Failed to open a cursor for txs_pruned: ", result).c_str()));
+				result = mdb_cursor_open(txn, m_txs_prunable, &c_prunable);
+				if(result)
+					throw0(DB_ERROR(lmdb_error("Failed to open a cursor for txs_prunable: ", result).c_str()));
+			}
+
+			result = mdb_cursor_get(c_txs, &k, &v, MDB_FIRST);
+			if(result == MDB_NOTFOUND)
+				break;
+			else if(result)
+				throw0(DB_ERROR(lmdb_error("Failed to get a record from txs: ", result).c_str()));
+
+			// the pruned part is whatever serialize_base consumes from the front of the blob
+			::serialization::span_istream ss({(const uint8_t *)v.mv_data, v.mv_size});
+			binary_span_archive<false> ba(ss);
+			transaction tx;
+			if(!tx.serialize_base(ba) || !ss.good())
+				throw0(DB_ERROR("Failed to parse tx from blob retrieved from the db"));
+			const size_t pruned_size = ss.tell();
+
+			MDB_val pruned = {pruned_size, v.mv_data};
+			MDB_val prunable = {v.mv_size - pruned_size, (char *)v.mv_data + pruned_size};
+			result = mdb_cursor_put(c_pruned, &k, &pruned, MDB_APPEND);
+			if(result)
+				throw0(DB_ERROR(lmdb_error("Failed to put a record into txs_pruned: ", result).c_str()));
+			result = mdb_cursor_put(c_prunable, &k, &prunable, MDB_APPEND);
+			if(result)
+				throw0(DB_ERROR(lmdb_error("Failed to put a record into txs_prunable: ", result).c_str()));
+			result = mdb_cursor_del(c_txs, 0);
+			if(result)
+				throw0(DB_ERROR(lmdb_error("Failed to delete a record from txs: ", result).c_str()));
+			i++;
+		}
+		result = mdb_drop(txn, m_txs, 1);
+		if(result)
+			throw0(DB_ERROR(lmdb_error("Failed to delete txs from the db: ", result).c_str()));
+		txn.commit();
+	} while(0);
+
+	uint32_t version = 4;
+	v.mv_data = (void *)&version;
+	v.mv_size = sizeof(version);
+	MDB_val_copy<const char *> vk("version");
+	result = mdb_txn_begin(m_env, NULL, 0, txn);
+	if(result)
+		throw0(DB_ERROR(lmdb_error("Failed to create a transaction for the db: ", result).c_str()));
+	result = mdb_put(txn, m_properties, &vk, &v, 0);
+	if(result)
+		throw0(DB_ERROR(lmdb_error("Failed to update version for the db: ", result).c_str()));
+	txn.commit();
+}
+
 void BlockchainLMDB::migrate(const uint32_t oldversion)
 {
+	if(oldversion < 4)
+	{
+		// The migrations before version 4 read the single txs table, which migrate_3_4 splits up
+		mdb_txn_safe txn(false);
+		int result = mdb_txn_begin(m_env, NULL, 0, txn);
+		if(result)
+			throw0(DB_ERROR(lmdb_error("Failed to create a transaction for the db: ", result).c_str()));
+		lmdb_db_open(txn, "txs", MDB_INTEGERKEY | MDB_CREATE, m_txs, "Failed to open db handle for txs");
+		txn.commit();
+	}
+
 	switch(oldversion)
 	{
 	case 0:
 		migrate_0_1(); /* FALLTHRU */
+	case 1:
+		migrate_1_2(); /* FALLTHRU */
+	case 2:
+		migrate_2_3(); /* FALLTHRU */
+	case 3:
+		migrate_3_4(); /* FALLTHRU */
 	default:;
 	}
 }
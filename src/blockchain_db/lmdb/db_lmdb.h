@@ -65,8 +65,10 @@ typedef struct mdb_txn_cursors
 
 	MDB_cursor *m_txc_output_txs;
 	MDB_cursor *m_txc_output_amounts;
+	MDB_cursor *m_txc_rct_distribution;
 
-	MDB_cursor *m_txc_txs;
+	MDB_cursor *m_txc_txs_pruned;
+	MDB_cursor *m_txc_txs_prunable;
 	MDB_cursor *m_txc_tx_indices;
 	MDB_cursor *m_txc_tx_outputs;
 
@@ -83,7 +85,9 @@ typedef struct mdb_txn_cursors
 #define m_cur_block_info m_cursors->m_txc_block_info
 #define m_cur_output_txs m_cursors->m_txc_output_txs
 #define m_cur_output_amounts m_cursors->m_txc_output_amounts
-#define m_cur_txs m_cursors->m_txc_txs
+#define m_cur_rct_distribution m_cursors->m_txc_rct_distribution
+#define m_cur_txs_pruned m_cursors->m_txc_txs_pruned
+#define m_cur_txs_prunable m_cursors->m_txc_txs_prunable
 #define m_cur_tx_indices m_cursors->m_txc_tx_indices
 #define m_cur_tx_outputs m_cursors->m_txc_tx_outputs
 #define m_cur_spent_keys m_cursors->m_txc_spent_keys
@@ -99,7 +103,9 @@ typedef struct mdb_rflags
 	bool m_rf_block_info;
 	bool m_rf_output_txs;
 	bool m_rf_output_amounts;
-	bool m_rf_txs;
+	bool m_rf_rct_distribution;
+	bool m_rf_txs_pruned;
+	bool m_rf_txs_prunable;
 	bool m_rf_tx_indices;
 	bool m_rf_tx_outputs;
 	bool m_rf_spent_keys;
@@ -217,6 +223,8 @@ class BlockchainLMDB : public BlockchainDB
 
 	virtual uint64_t get_block_already_generated_coins(const uint64_t &height) const;
 
+	virtual void get_block_cumulative_totals(const uint64_t &height, uint64_t &emission, uint64_t &fees) const;
+
 	virtual crypto::hash get_block_hash_from_height(const uint64_t &height) const;
 
 	virtual std::vector<block> get_blocks_range(const uint64_t &h1, const uint64_t &h2) const;
@@ -235,7 +243,8 @@ class BlockchainLMDB : public BlockchainDB
 	virtual uint64_t get_tx_unlock_time(const crypto::hash &h) const;
 
 	virtual bool get_tx_blob(const crypto::hash &h, cryptonote::blobdata &tx) const;
-	virtual bool get_tx_blob_indexed(const crypto::hash& h, cryptonote::blobdata& bd, std::vector<uint64_t>& o_idx) const;
+	virtual bool get_pruned_tx_blob(const crypto::hash &h, cryptonote::blobdata &bd) const;
+	virtual bool get_pruned_tx_blob_indexed(const crypto::hash& h, cryptonote::blobdata& bd, std::vector<uint64_t>& o_idx) const;
 
 	virtual uint64_t get_tx_count() const;
 
@@ -309,13 +318,16 @@ class BlockchainLMDB : public BlockchainDB
 	bool get_output_distribution(uint64_t amount, uint64_t from_height, uint64_t to_height, std::vector<uint64_t> &distribution, uint64_t &base) const;
 
   private:
+	// range read of the per block cumulative RCT output counts
+	bool get_rct_distribution(uint64_t from_height, uint64_t to_height, std::vector<uint64_t> &distribution, uint64_t &base) const;
+
 	void do_resize(uint64_t size_increase = 0);
 
 	bool need_resize(uint64_t threshold_size = 0) const;
 	void check_and_resize_for_batch(uint64_t batch_num_blocks, uint64_t batch_bytes);
 	uint64_t get_estimated_batch_size(uint64_t batch_num_blocks, uint64_t batch_bytes) const;
 
-	virtual void add_block(const block &blk, const size_t &block_size, const difficulty_type &cumulative_difficulty, const uint64_t &coins_generated, const crypto::hash &block_hash);
+	virtual void add_block(const block &blk, const size_t &block_size, const difficulty_type &cumulative_difficulty, const uint64_t &coins_generated, const uint64_t &block_fees, const crypto::hash &block_hash);
 
 	virtual void remove_block();
 
@@ -379,6 +391,15 @@ class BlockchainLMDB : public BlockchainDB
 	// migrate from DB version 0 to 1
 	void migrate_0_1();
 
+	// migrate from DB version 1 to 2
+	void migrate_1_2();
+
+	// migrate from DB version 2 to 3
+	void migrate_2_3();
+
+	// migrate from DB version 3 to 4
+	void migrate_3_4();
+
 	void cleanup_batch();
 
   private:
@@ -388,12 +409,14 @@ class BlockchainLMDB : public BlockchainDB
 	MDB_dbi m_block_heights;
 	MDB_dbi m_block_info;
 
-	MDB_dbi m_txs;
+	MDB_dbi m_txs_pruned;
+	MDB_dbi m_txs_prunable;
 	MDB_dbi m_tx_indices;
 	MDB_dbi m_tx_outputs;
 
 	MDB_dbi m_output_txs;
 	MDB_dbi m_output_amounts;
+	MDB_dbi m_rct_distribution;
 
 	MDB_dbi m_spent_keys;
 
@@ -405,6 +428,8 @@ class BlockchainLMDB : public BlockchainDB
 
 	MDB_dbi m_properties;
 
+	MDB_dbi m_txs; // pre version 4 tx table, only opened while migrating
+
 	mutable uint64_t m_cum_size; // used in batch size estimation
 	mutable unsigned int m_cum_count;
 	std::string m_folder;
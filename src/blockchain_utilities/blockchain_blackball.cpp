@@ -271,6 +271,8 @@ int main(int argc, char *argv[])
 				if(printed)
 					return false;
 				return log_scr.match_msg(msg);
+				}, [](gulps::output out, gulps::level lvl) -> bool {
+				return (out == gulps::OUT_LOG_0 || out == gulps::OUT_USER_0) && log_scr.may_match(lvl);
 				});
 		gulps::inst().add_output(std::move(out));
 	}
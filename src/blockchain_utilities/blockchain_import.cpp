@@ -45,19 +45,29 @@
 
 #include <algorithm>
 #include <atomic>
+#include <chrono>
 #include <cstdio>
+#include <deque>
 #include <fstream>
+#include <map>
+#include <memory>
 
 #include "blockchain_db/db_types.h"
 #include "bootstrap_file.h"
 #include "bootstrap_serialization.h"
 #include "cryptonote_basic/cryptonote_format_utils.h"
 #include "cryptonote_core/cryptonote_core.h"
+#include "common/util.h"
 #include "include_base_utils.h"
 #include "serialization/binary_utils.h" // dump_binary(), parse_binary()
 #include "serialization/json_utils.h"   // dump_json()
 #include <boost/algorithm/string.hpp>
 #include <boost/filesystem.hpp>
+#include <boost/interprocess/file_mapping.hpp>
+#include <boost/interprocess/mapped_region.hpp>
+#include <boost/thread/condition_variable.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/thread.hpp>
 
 #include "common/gulps.hpp"
 
@@ -85,6 +95,12 @@ uint64_t db_batch_size = 100;
 // frequently saved
 uint64_t db_batch_size_verify = 5000;
 
+// threads deserializing the bootstrap file, 0 for one per core
+uint64_t parse_threads = 0;
+
+// groups of blocks queued between the reader, parse and commit stages
+uint64_t pipeline_depth = 16;
+
 std::string refresh_string = "\r                                    \r";
 }
 
@@ -177,7 +193,7 @@ int pop_blocks(cryptonote::core &core, int num_blocks)
 	return num_blocks;
 }
 
-int check_flush(cryptonote::core &core, std::list<block_complete_entry> &blocks, bool force)
+int check_flush(cryptonote::core &core, std::list<block_complete_entry> &blocks, std::list<crypto::hash> &hashes, bool force)
 {
 	if(blocks.empty())
 		return 0;
@@ -189,19 +205,7 @@ int check_flush(cryptonote::core &core, std::list<block_complete_entry> &blocks,
 	if(!force && new_height % HASH_OF_HASHES_STEP)
 		return 0;
 
-	std::list<crypto::hash> hashes;
-	for(const auto &b : blocks)
-	{
-		cryptonote::block block;
-		if(!parse_and_validate_block_from_blob(b.block, block))
-		{
-			GULPS_ERROR("Failed to parse block: ",
-				   epee::string_tools::pod_to_hex(get_blob_hash(b.block)));
-			core.cleanup_handle_incoming_blocks();
-			return 1;
-		}
-		hashes.push_back(cryptonote::get_block_hash(block));
-	}
+	// the hashes were computed by the parse threads along with the blobs
 	core.prevalidate_block_hashes(core.get_blockchain_storage().get_db().height(), hashes);
 
 	core.prepare_handle_incoming_blocks(blocks);
@@ -247,9 +251,335 @@ int check_flush(cryptonote::core &core, std::list<block_complete_entry> &blocks,
 		return 1;
 
 	blocks.clear();
+	hashes.clear();
 	return 0;
 }
 
+// Import pipeline
+//
+//   reader    - walks the memory mapped bootstrap file, faults the pages of the next
+//               group of chunks in and queues the group. A 32 bit build can't map a
+//               whole bootstrap file, there the reader maps each group on its own
+//   parsers   - deserialize the chunks of a group, build the block and tx blobs and
+//               the block hashes, several groups at a time
+//   committer - the calling thread, takes the groups back in file order and feeds them
+//               to the core (prepare_handle_incoming_blocks spreads the PoW over the
+//               threadpool) or straight to the DB
+namespace
+{
+struct chunk_ref
+{
+	uint64_t offset; // of the chunk data, past its size field
+	uint32_t size;
+};
+
+struct raw_group
+{
+	uint64_t seq;
+	std::vector<chunk_ref> chunks;
+	std::shared_ptr<boost::interprocess::mapped_region> window; // when the file isn't mapped whole
+	const char *base;		// the file from base_offset on, nullptr if it could not be mapped
+	uint64_t base_offset;
+};
+
+struct parsed_block
+{
+	bootstrap::block_package bp; // without verification
+	block_complete_entry entry;  // with verification
+	crypto::hash hash;
+};
+
+struct parsed_group
+{
+	uint64_t seq;
+	bool ok;
+	std::string error;
+	std::vector<parsed_block> blocks;
+};
+
+template <typename T>
+class bounded_queue
+{
+  public:
+	explicit bounded_queue(size_t depth) : m_depth(depth), m_closed(false) {}
+
+	bool push(T &&item)
+	{
+		boost::unique_lock<boost::mutex> lock(m_mutex);
+		while(!m_closed && m_items.size() >= m_depth)
+			m_not_full.wait(lock);
+		if(m_closed)
+			return false;
+		m_items.push_back(std::move(item));
+		m_not_empty.notify_one();
+		return true;
+	}
+
+	//! false once the queue is closed and drained
+	bool pop(T &item)
+	{
+		boost::unique_lock<boost::mutex> lock(m_mutex);
+		while(!m_closed && m_items.empty())
+			m_not_empty.wait(lock);
+		if(m_items.empty())
+			return false;
+		item = std::move(m_items.front());
+		m_items.pop_front();
+		m_not_full.notify_one();
+		return true;
+	}
+
+	void close()
+	{
+		boost::unique_lock<boost::mutex> lock(m_mutex);
+		m_closed = true;
+		m_not_full.notify_all();
+		m_not_empty.notify_all();
+	}
+
+	//! like close(), but drops what is still queued
+	void abort()
+	{
+		boost::unique_lock<boost::mutex> lock(m_mutex);
+		m_closed = true;
+		m_items.clear();
+		m_not_full.notify_all();
+		m_not_empty.notify_all();
+	}
+
+  private:
+	boost::mutex m_mutex;
+	boost::condition_variable m_not_full;
+	boost::condition_variable m_not_empty;
+	std::deque<T> m_items;
+	size_t m_depth;
+	bool m_closed;
+};
+
+// Hands the parsed groups back in file order. A parser holding a group too far
+// ahead of the committer waits, so at most depth groups are parsed and unclaimed.
+class reorder_buffer
+{
+  public:
+	reorder_buffer(size_t depth, size_t producers) : m_depth(depth), m_producers(producers), m_next(0), m_aborted(false) {}
+
+	bool push(parsed_group &&group)
+	{
+		boost::unique_lock<boost::mutex> lock(m_mutex);
+		while(!m_aborted && group.seq >= m_next + m_depth)
+			m_changed.wait(lock);
+		if(m_aborted)
+			return false;
+		const uint64_t seq = group.seq;
+		m_items.emplace(seq, std::move(group));
+		m_changed.notify_all();
+		return true;
+	}
+
+	bool pop(parsed_group &group)
+	{
+		boost::unique_lock<boost::mutex> lock(m_mutex);
+		while(!m_aborted && m_producers != 0 && m_items.find(m_next) == m_items.end())
+			m_changed.wait(lock);
+		auto it = m_items.find(m_next);
+		if(m_aborted || it == m_items.end())
+			return false;
+		group = std::move(it->second);
+		m_items.erase(it);
+		++m_next;
+		m_changed.notify_all();
+		return true;
+	}
+
+	void producer_done()
+	{
+		boost::unique_lock<boost::mutex> lock(m_mutex);
+		--m_producers;
+		m_changed.notify_all();
+	}
+
+	void abort()
+	{
+		boost::unique_lock<boost::mutex> lock(m_mutex);
+		m_aborted = true;
+		m_items.clear();
+		m_changed.notify_all();
+	}
+
+  private:
+	boost::mutex m_mutex;
+	boost::condition_variable m_changed;
+	std::map<uint64_t, parsed_group> m_items;
+	size_t m_depth;
+	size_t m_producers;
+	uint64_t m_next;
+	bool m_aborted;
+};
+
+// Index the chunks of the file, read_field(offset, str) reads the size field at offset.
+// Returns false on a malformed chunk, a truncated last chunk only ends the index.
+template <typename t_read_field>
+bool index_chunks(t_read_field read_field, uint64_t size, uint64_t offset, std::vector<chunk_ref> &chunks)
+{
+	uint32_t chunk_size;
+	std::string str1;
+	while(offset + sizeof(chunk_size) <= size)
+	{
+		if(!read_field(offset, str1) || !::serialization::parse_binary(str1, chunk_size))
+		{
+			GULPSF_ERROR("Error in deserialization of chunk size at height {}", chunks.size());
+			return false;
+		}
+		offset += sizeof(chunk_size);
+
+		if(chunk_size > BUFFER_SIZE)
+		{
+			GULPSF_WARN("WARNING: chunk_size {} > BUFFER_SIZE {}  height: {}", chunk_size, BUFFER_SIZE, chunks.size());
+			return false;
+		}
+		if(chunk_size == 0)
+		{
+			GULPSF_ERROR("ERROR: chunk_size == 0  height: {}", chunks.size());
+			return false;
+		}
+		if(offset + chunk_size > size)
+		{
+			GULPS_INFO("Bootstrap file was truncated, ignoring its last chunk");
+			break;
+		}
+		chunks.push_back({offset, chunk_size});
+		offset += chunk_size;
+	}
+	return true;
+}
+
+uint64_t count_batch_bytes(const std::vector<chunk_ref> &chunks, uint64_t first, uint64_t count)
+{
+	uint64_t bytes = 0;
+	for(uint64_t i = first; i < chunks.size() && i < first + count; ++i)
+		bytes += sizeof(uint32_t) + chunks[i].size;
+	return bytes;
+}
+
+// data is the whole mapped file, or nullptr to map each group from mapping
+void read_groups(const boost::interprocess::file_mapping &mapping, const char *data, const std::vector<chunk_ref> &chunks, uint64_t first, uint64_t last, bounded_queue<raw_group> &queue)
+{
+	const size_t page_size = boost::interprocess::mapped_region::get_page_size();
+	const uint64_t group_size = std::max<uint64_t>(1, db_batch_size / 16);
+	uint64_t seq = 0;
+	volatile char sink = 0;
+	for(uint64_t h = first; h <= last; h += group_size)
+	{
+		raw_group group;
+		group.seq = seq++;
+		group.chunks.assign(chunks.begin() + h, chunks.begin() + std::min(last + 1, h + group_size));
+
+		const uint64_t begin = group.chunks.front().offset, end = group.chunks.back().offset + group.chunks.back().size;
+		group.base = data;
+		group.base_offset = 0;
+		if(data == nullptr)
+		{
+			group.base_offset = begin - begin % page_size;
+			try
+			{
+				group.window = std::make_shared<boost::interprocess::mapped_region>(mapping, boost::interprocess::read_only, group.base_offset, end - group.base_offset);
+				group.base = static_cast<const char *>(group.window->get_address());
+			}
+			catch(const std::exception &e)
+			{
+				// the parsers report the group as failed
+				GULPSF_ERROR("Failed to map bootstrap file at offset {}: {}", begin, e.what());
+			}
+		}
+
+		// fault the group in here, so the parsers do not stall on the disk
+		if(group.base != nullptr)
+		{
+			for(uint64_t off = begin; off < end; off += page_size)
+				sink = sink + group.base[off - group.base_offset];
+			sink = sink + group.base[end - 1 - group.base_offset];
+		}
+
+		if(!queue.push(std::move(group)))
+			break;
+	}
+	queue.close();
+}
+
+void parse_groups(bounded_queue<raw_group> &in, reorder_buffer &out)
+{
+	raw_group raw;
+	std::string str1;
+	while(in.pop(raw))
+	{
+		parsed_group group;
+		group.seq = raw.seq;
+		group.ok = true;
+		group.blocks.resize(raw.chunks.size());
+		try
+		{
+			if(raw.base == nullptr)
+				throw std::runtime_error("Failed to map bootstrap file");
+			for(size_t i = 0; i < raw.chunks.size(); ++i)
+			{
+				parsed_block &pb = group.blocks[i];
+				str1.assign(raw.base + (raw.chunks[i].offset - raw.base_offset), raw.chunks[i].size);
+				if(!::serialization::parse_binary(str1, pb.bp))
+					throw std::runtime_error("Error in deserialization of chunk");
+				pb.hash = get_block_hash(pb.bp.block);
+
+				if(opt_verify)
+				{
+					cryptonote::block_to_blob(pb.bp.block, pb.entry.block);
+					for(const auto &tx : pb.bp.txs)
+					{
+						pb.entry.txs.push_back(cryptonote::blobdata());
+						cryptonote::tx_to_blob(tx, pb.entry.txs.back());
+					}
+					pb.bp = bootstrap::block_package();
+				}
+			}
+		}
+		catch(const std::exception &e)
+		{
+			group.ok = false;
+			group.error = e.what();
+			group.blocks.clear();
+		}
+		if(!out.push(std::move(group)))
+			break;
+	}
+	out.producer_done();
+}
+
+// block and byte rates since the import started, for the progress line
+class import_rate
+{
+  public:
+	import_rate() : m_start(std::chrono::steady_clock::now()), m_blocks(0), m_bytes(0) {}
+
+	void add(uint64_t bytes)
+	{
+		++m_blocks;
+		m_bytes += bytes;
+	}
+
+	double blocks_per_sec() const { return m_blocks / elapsed(); }
+	double mb_per_sec() const { return m_bytes / elapsed() / (1024 * 1024); }
+
+  private:
+	double elapsed() const
+	{
+		const double s = std::chrono::duration<double>(std::chrono::steady_clock::now() - m_start).count();
+		return s > 0.001 ? s : 0.001;
+	}
+
+	std::chrono::steady_clock::time_point m_start;
+	uint64_t m_blocks;
+	uint64_t m_bytes;
+};
+}
+
 int import_from_file(cryptonote::core &core, const std::string &import_file_path, uint64_t block_stop = 0)
 {
 	// Reset stats, in case we're using newly created db, accumulating stats
@@ -262,53 +592,86 @@ int import_from_file(cryptonote::core &core, const std::string &import_file_path
 	if(!boost::filesystem::exists(fs_import_file_path, ec))
 	{
 		GULPS_ERROR("bootstrap file not found: ", fs_import_file_path);
-		return false;
+		return 2;
 	}
 
-	uint64_t start_height = 1, seek_height;
+	uint64_t start_height = 1;
 	if(opt_resume)
 		start_height = core.get_blockchain_storage().get_current_blockchain_height();
 
-	seek_height = start_height;
+	// 4 byte magic + (currently) 1024 byte header structures
 	BootstrapFile bootstrap;
-	std::streampos pos;
-	// BootstrapFile bootstrap(import_file_path);
-	uint64_t total_source_blocks = bootstrap.count_blocks(import_file_path, pos, seek_height);
-	GULPSF_INFO("bootstrap file last block number: {} (zero-based height)  total blocks:{}", std::to_string(total_source_blocks - 1), std::to_string(total_source_blocks));
-
-	if(total_source_blocks - 1 <= start_height)
-	{
-		return false;
-	}
-
-	GULPS_PRINT( "\nPreparing to read blocks...\n" );
-
 	std::ifstream import_file;
 	import_file.open(import_file_path, std::ios_base::binary | std::ifstream::in);
-
-	uint64_t h = 0;
-	uint64_t num_imported = 0;
 	if(import_file.fail())
 	{
 		GULPS_ERROR("import_file.open() fail");
-		return false;
+		return 2;
 	}
+	const uint64_t full_header_size = bootstrap.seek_to_first_chunk(import_file);
 
-	// 4 byte magic + (currently) 1024 byte header structures
-	bootstrap.seek_to_first_chunk(import_file);
+	boost::interprocess::file_mapping import_mapping;
+	boost::interprocess::mapped_region import_region;
+	const char *data = nullptr;
+	try
+	{
+		boost::interprocess::file_mapping(import_file_path.c_str(), boost::interprocess::read_only).swap(import_mapping);
+#if ARCH_WIDTH != 32
+		boost::interprocess::mapped_region(import_mapping, boost::interprocess::read_only).swap(import_region);
+		import_region.advise(boost::interprocess::mapped_region::advice_sequential);
+		data = static_cast<const char *>(import_region.get_address());
+#endif
+	}
+	catch(const std::exception &e)
+	{
+		GULPSF_ERROR("Failed to map bootstrap file: {}", e.what());
+		return 2;
+	}
 
-	std::string str1;
-	char buffer1[1024];
-	char buffer_block[BUFFER_SIZE];
-	block b;
-	transaction tx;
-	int quit = 0;
-	uint64_t bytes_read;
+	// The chunk index replaces rescanning the file to size each DB batch
+	GULPS_INFO("Scanning blockchain from bootstrap file...");
+	std::vector<chunk_ref> chunks;
+	bool indexed;
+	if(data != nullptr)
+	{
+		indexed = index_chunks([data](uint64_t offset, std::string &field) {
+			field.assign(data + offset, sizeof(uint32_t));
+			return true;
+		}, import_region.get_size(), full_header_size, chunks);
+	}
+	else
+	{
+		// without the whole file mapped, only the size fields are read from it
+		const uint64_t file_size = boost::filesystem::file_size(fs_import_file_path, ec);
+		if(ec)
+		{
+			GULPSF_ERROR("Failed to get the size of the bootstrap file: {}", ec.message());
+			return 2;
+		}
+		indexed = index_chunks([&import_file](uint64_t offset, std::string &field) {
+			field.resize(sizeof(uint32_t));
+			import_file.seekg(offset);
+			return bool(import_file.read(&field[0], field.size()));
+		}, file_size, full_header_size, chunks);
+	}
+	if(!indexed)
+		return 2;
+
+	// also keeps the "- 1" below from wrapping on an empty bootstrap file
+	if(chunks.size() <= start_height + 1)
+	{
+		GULPSF_INFO("bootstrap file has {} blocks, nothing to import from height {}", chunks.size(), start_height);
+		return 0;
+	}
+	const uint64_t total_source_blocks = chunks.size();
+	GULPSF_INFO("bootstrap file last block number: {} (zero-based height)  total blocks:{}", std::to_string(total_source_blocks - 1), std::to_string(total_source_blocks));
+
+	GULPS_PRINT( "\nPreparing to read blocks...\n" );
 
 	// Note that a new blockchain will start with block number 0 (total blocks: 1)
 	// due to genesis block being added at initialization.
 
-	if(!block_stop)
+	if(!block_stop || block_stop > total_source_blocks - 1)
 	{
 		block_stop = total_source_blocks - 1;
 	}
@@ -317,225 +680,121 @@ int import_from_file(cryptonote::core &core, const std::string &import_file_path
 	// from source and destination blockchains, but those are the defaults.
 	GULPS_INFO("start block: {}  stop block: {}" , std::to_string(start_height), std::to_string(block_stop));
 
+	const size_t threads = parse_threads ? parse_threads : std::max<size_t>(1, tools::get_max_concurrency());
+	GULPSF_INFO("parse threads: {}  pipeline depth: {}", threads, pipeline_depth);
+
 	bool use_batch = opt_batch && !opt_verify;
 
 	GULPS_INFO("Reading blockchain from bootstrap file...\n");
 
-	std::list<block_complete_entry> blocks;
+	bounded_queue<raw_group> raw_groups(pipeline_depth);
+	reorder_buffer parsed_groups(pipeline_depth, threads);
+	std::vector<boost::thread> workers;
+	workers.emplace_back([&] { read_groups(import_mapping, data, chunks, start_height, block_stop, raw_groups); });
+	for(size_t i = 0; i < threads; ++i)
+		workers.emplace_back([&] { parse_groups(raw_groups, parsed_groups); });
 
-	// Skip to start_height before we start adding.
-	{
-		bool q2 = false;
-		import_file.seekg(pos);
-		bytes_read = bootstrap.count_bytes(import_file, start_height - seek_height, h, q2);
-		if(q2)
-		{
-			quit = 2;
-			goto quitting;
-		}
-		h = start_height;
-	}
+	std::list<block_complete_entry> blocks;
+	std::list<crypto::hash> hashes;
+	uint64_t h = start_height;
+	uint64_t num_imported = 0;
+	int quit = 0;
+	import_rate rate;
+	const int progress_interval = 10;
 
 	if(use_batch)
+		core.get_blockchain_storage().get_db().batch_start(db_batch_size, count_batch_bytes(chunks, h, db_batch_size));
+
+	parsed_group group;
+	while(!quit && parsed_groups.pop(group))
 	{
-		uint64_t bytes, h2;
-		bool q2;
-		pos = import_file.tellg();
-		bytes = bootstrap.count_bytes(import_file, db_batch_size, h2, q2);
-		if(import_file.eof())
-			import_file.clear();
-		import_file.seekg(pos);
-		core.get_blockchain_storage().get_db().batch_start(db_batch_size, bytes);
-	}
-	while(!quit)
-	{
-		uint32_t chunk_size;
-		import_file.read(buffer1, sizeof(chunk_size));
-		// TODO: bootstrap.read_chunk();
-		if(!import_file)
+		if(!group.ok)
 		{
 			GULPS_PRINT( refresh_string);
-			GULPS_INFO("End of file reached");
-			quit = 1;
+			GULPSF_ERROR("exception while reading from file, height={}: {}", h, group.error);
+			quit = 2;
 			break;
 		}
-		bytes_read += sizeof(chunk_size);
 
-		str1.assign(buffer1, sizeof(chunk_size));
-		if(!::serialization::parse_binary(str1, chunk_size))
+		for(parsed_block &pb : group.blocks)
 		{
-			throw std::runtime_error("Error in deserialization of chunk size");
-		}
-		GULPSF_LOG_L1("chunk_size: {}" , chunk_size);
+			++h;
+			GULPSF_LOG_L1("loading block number {}" , h - 1);
+			rate.add(sizeof(uint32_t) + chunks[h - 1].size);
 
-		if(chunk_size > BUFFER_SIZE)
-		{
-			GULPSF_WARN("WARNING: chunk_size {} > BUFFER_SIZE {}", chunk_size, BUFFER_SIZE);
-			throw std::runtime_error("Aborting: chunk size exceeds buffer size");
-		}
-		if(chunk_size > CHUNK_SIZE_WARNING_THRESHOLD)
-		{
-			GULPSF_INFO("NOTE: chunk_size {} > {}",  chunk_size, CHUNK_SIZE_WARNING_THRESHOLD);
-		}
-		else if(chunk_size == 0)
-		{
-			GULPS_ERROR("ERROR: chunk_size == 0");
-			return 2;
-		}
-		import_file.read(buffer_block, chunk_size);
-		if(!import_file)
-		{
-			if(import_file.eof())
-			{
-				GULPS_PRINT( refresh_string);
-				GULPS_INFO("End of file reached - file was truncated");
-				quit = 1;
-				break;
-			}
-			else
+			if((h - 1) % progress_interval == 0)
 			{
-				GULPSF_ERROR("ERROR: unexpected end of file: bytes read before error: {} of chunk_size {}",
-						import_file.gcount(), chunk_size);
-				return 2;
+				GULPSF_PRINT("{}block {} / {}  {:.1f} blocks/s  {:.2f} MB/s\r", refresh_string, h - 1, block_stop, rate.blocks_per_sec(), rate.mb_per_sec());
 			}
-		}
-		bytes_read += chunk_size;
-		GULPSF_LOG_L1("Total bytes read: {}" , bytes_read);
 
-		if(h > block_stop)
-		{
-			GULPSF_PRINT(refresh_string, "block {} / {}\n\n", h - 1, block_stop);
-			GULPSF_INFO("Specified block number reached - stopping.  block: {}  total blocks: {}", h - 1, h);
-			quit = 1;
-			break;
-		}
-
-		try
-		{
-			str1.assign(buffer_block, chunk_size);
-			bootstrap::block_package bp;
-			if(!::serialization::parse_binary(str1, bp))
-				throw std::runtime_error("Error in deserialization of chunk");
-
-			int display_interval = 1000;
-			int progress_interval = 10;
-			// NOTE: use of NUM_BLOCKS_PER_CHUNK is a placeholder in case multi-block chunks are later supported.
-			for(int chunk_ind = 0; chunk_ind < NUM_BLOCKS_PER_CHUNK; ++chunk_ind)
+			if(opt_verify)
 			{
-				++h;
-				if((h - 1) % display_interval == 0)
+				blocks.push_back(std::move(pb.entry));
+				hashes.push_back(pb.hash);
+				int ret = check_flush(core, blocks, hashes, false);
+				if(ret)
 				{
-					GULPS_PRINT( refresh_string);
-					GULPSF_LOG_L1("loading block number {}" , h - 1);
+					quit = 2; // make sure we don't commit partial block data
+					break;
 				}
-				else
+			}
+			else
+			{
+				// tx number 1: coinbase tx
+				// tx number 2 onwards: archived txs, add_block() adds the coinbase
+				// transaction itself, so it is not part of txs
+				try
 				{
-					GULPSF_LOG_L1("loading block number {}" , h - 1);
+					core.get_blockchain_storage().get_db().add_block(pb.bp.block, pb.bp.block_size, pb.bp.cumulative_difficulty, pb.bp.coins_generated, pb.bp.txs);
 				}
-				b = bp.block;
-				GULPSF_LOG_L1("block prev_id: {}", b.prev_id);
-
-				if((h - 1) % progress_interval == 0)
+				catch(const std::exception &e)
 				{
-					GULPSF_PRINT("{}block {} / {}\r", refresh_string,  h - 1, block_stop);
+					GULPS_PRINT( refresh_string);
+					GULPS_ERROR("Error adding block to blockchain: ", e.what());
+					quit = 2; // make sure we don't commit partial block data
+					break;
 				}
 
-				if(opt_verify)
-				{
-					cryptonote::blobdata block;
-					cryptonote::block_to_blob(bp.block, block);
-					std::list<cryptonote::blobdata> txs;
-					for(const auto &tx : bp.txs)
-					{
-						txs.push_back(cryptonote::blobdata());
-						cryptonote::tx_to_blob(tx, txs.back());
-					}
-					blocks.push_back({block, txs});
-					int ret = check_flush(core, blocks, false);
-					if(ret)
-					{
-						quit = 2; // make sure we don't commit partial block data
-						break;
-					}
-				}
-				else
+				if(use_batch)
 				{
-					std::vector<transaction> txs;
-					std::vector<transaction> archived_txs;
-
-					archived_txs = bp.txs;
-
-					// tx number 1: coinbase tx
-					// tx number 2 onwards: archived_txs
-					for(const transaction &tx : archived_txs)
-					{
-						// add blocks with verification.
-						// for Blockchain and blockchain_storage add_new_block().
-						// for add_block() method, without (much) processing.
-						// don't add coinbase transaction to txs.
-						//
-						// because add_block() calls
-						// add_transaction(blk_hash, blk.miner_tx) first, and
-						// then a for loop for the transactions in txs.
-						txs.push_back(tx);
-					}
-
-					size_t block_size;
-					difficulty_type cumulative_difficulty;
-					uint64_t coins_generated;
-
-					block_size = bp.block_size;
-					cumulative_difficulty = bp.cumulative_difficulty;
-					coins_generated = bp.coins_generated;
-
-					try
-					{
-						core.get_blockchain_storage().get_db().add_block(b, block_size, cumulative_difficulty, coins_generated, txs);
-					}
-					catch(const std::exception &e)
+					if((h - 1) % db_batch_size == 0)
 					{
 						GULPS_PRINT( refresh_string);
-						GULPS_ERROR("Error adding block to blockchain: ", e.what());
-						quit = 2; // make sure we don't commit partial block data
-						break;
-					}
-
-					if(use_batch)
-					{
-						if((h - 1) % db_batch_size == 0)
-						{
-							uint64_t bytes, h2;
-							bool q2;
-							GULPS_PRINT( refresh_string);
-							// zero-based height
-							GULPSF_PRINT("\n[- batch commit at height {} -]\n", h - 1);
-							core.get_blockchain_storage().get_db().batch_stop();
-							pos = import_file.tellg();
-							bytes = bootstrap.count_bytes(import_file, db_batch_size, h2, q2);
-							import_file.seekg(pos);
-							core.get_blockchain_storage().get_db().batch_start(db_batch_size, bytes);
-							GULPS_PRINT( "\n");
-							core.get_blockchain_storage().get_db().show_stats();
-						}
+						// zero-based height
+						GULPSF_PRINT("\n[- batch commit at height {} -]\n", h - 1);
+						core.get_blockchain_storage().get_db().batch_stop();
+						core.get_blockchain_storage().get_db().batch_start(db_batch_size, count_batch_bytes(chunks, h, db_batch_size));
+						GULPS_PRINT( "\n");
+						core.get_blockchain_storage().get_db().show_stats();
 					}
 				}
-				++num_imported;
 			}
+			++num_imported;
 		}
-		catch(const std::exception &e)
-		{
-			GULPS_PRINT( refresh_string);
-			GULPSF_ERROR("exception while reading from file, height={}: {}", h, e.what());
-			return 2;
-		}
-	} // while
+	}
+
+	// on an error the stages may still be blocked on a full queue
+	if(quit)
+	{
+		raw_groups.abort();
+		parsed_groups.abort();
+	}
+	for(boost::thread &worker : workers)
+		worker.join();
 
-quitting:
-	import_file.close();
+	if(!quit)
+	{
+		GULPS_PRINT( refresh_string);
+		if(block_stop < total_source_blocks - 1)
+			GULPSF_INFO("Specified block number reached - stopping.  block: {}  total blocks: {}", h - 1, h);
+		else
+			GULPS_INFO("End of file reached");
+		quit = 1;
+	}
 
-	if(opt_verify)
+	if(opt_verify && quit == 1)
 	{
-		int ret = check_flush(core, blocks, true);
+		int ret = check_flush(core, blocks, hashes, true);
 		if(ret)
 			return ret;
 	}
@@ -555,12 +814,13 @@ quitting:
 
 	core.get_blockchain_storage().get_db().show_stats();
 	GULPSF_INFO("Number of blocks imported: {}" , num_imported);
+	GULPSF_INFO("Import rate: {:.1f} blocks/s, {:.2f} MB/s", rate.blocks_per_sec(), rate.mb_per_sec());
 	if(h > 0)
 		// TODO: if there was an error, the last added block is probably at zero-based height h-2
 		GULPSF_INFO("Finished at block: {}  total blocks: {}", h - 1, h);
 
 	GULPS_PRINT( "\n");
-	return 0;
+	return quit > 1 ? 2 : 0;
 }
 
 gulps_log_level log_scr;
@@ -602,6 +862,8 @@ int main(int argc, char *argv[])
 	const command_line::arg_descriptor<std::string> arg_log_level = {"log-level", "0-4 or categories", ""};
 	const command_line::arg_descriptor<uint64_t> arg_block_stop = {"block-stop", "Stop at block number", block_stop};
 	const command_line::arg_descriptor<uint64_t> arg_batch_size = {"batch-size", "", db_batch_size};
+	const command_line::arg_descriptor<uint64_t> arg_parse_threads = {"parse-threads", "Threads deserializing the bootstrap file, 0 for one per core", parse_threads};
+	const command_line::arg_descriptor<uint64_t> arg_pipeline_depth = {"pipeline-depth", "Groups of blocks queued between the read, parse and commit stages", pipeline_depth};
 	const command_line::arg_descriptor<uint64_t> arg_pop_blocks = {"pop-blocks", "Remove blocks from end of blockchain", num_blocks};
 	const command_line::arg_descriptor<bool> arg_drop_hf = {"drop-hard-fork", "Drop hard fork subdbs", false};
 	const command_line::arg_descriptor<bool> arg_count_blocks = {
@@ -620,6 +882,8 @@ int main(int argc, char *argv[])
 	command_line::add_arg(desc_cmd_sett, arg_database);
 	command_line::add_arg(desc_cmd_sett, arg_batch_size);
 	command_line::add_arg(desc_cmd_sett, arg_block_stop);
+	command_line::add_arg(desc_cmd_sett, arg_parse_threads);
+	command_line::add_arg(desc_cmd_sett, arg_pipeline_depth);
 
 	command_line::add_arg(desc_cmd_only, arg_count_blocks);
 	command_line::add_arg(desc_cmd_only, arg_pop_blocks);
@@ -648,6 +912,8 @@ int main(int argc, char *argv[])
 	opt_resume = command_line::get_arg(vm, arg_resume);
 	block_stop = command_line::get_arg(vm, arg_block_stop);
 	db_batch_size = command_line::get_arg(vm, arg_batch_size);
+	parse_threads = command_line::get_arg(vm, arg_parse_threads);
+	pipeline_depth = command_line::get_arg(vm, arg_pipeline_depth);
 
 	m_config_folder = command_line::get_arg(vm, cryptonote::arg_data_dir);
 	db_arg_str = command_line::get_arg(vm, arg_database);
@@ -687,6 +953,8 @@ int main(int argc, char *argv[])
 				if(printed)
 					return false;
 				return log_scr.match_msg(msg);
+				}, [](gulps::output out, gulps::level lvl) -> bool {
+				return (out == gulps::OUT_LOG_0 || out == gulps::OUT_USER_0) && log_scr.may_match(lvl);
 				});
 		gulps::inst().add_output(std::move(out));
 	}
@@ -708,6 +976,11 @@ int main(int argc, char *argv[])
 		GULPS_ERROR( "Error: batch-size must be > 0" );
 		return 1;
 	}
+	if(!pipeline_depth)
+	{
+		GULPS_ERROR( "Error: pipeline-depth must be > 0" );
+		return 1;
+	}
 	if(opt_verify && command_line::is_arg_defaulted(vm, arg_batch_size))
 	{
 		// usually want batch size default lower if verify on, so progress can be
@@ -792,6 +1065,9 @@ int main(int argc, char *argv[])
 			return 1;
 		}
 		core.get_blockchain_storage().get_db().set_batch_transactions(true);
+		// the daemon default of 4 PoW threads leaves most cores idle on a local import
+		if(vm["prep-blocks-threads"].defaulted())
+			core.get_blockchain_storage().set_max_prepare_blocks_threads(tools::get_max_concurrency());
 
 		if(!command_line::is_arg_defaulted(vm, arg_pop_blocks))
 		{
@@ -810,13 +1086,14 @@ int main(int argc, char *argv[])
 			return 0;
 		}
 
-		import_from_file(core, import_file_path, block_stop);
+		const int ret = import_from_file(core, import_file_path, block_stop);
 
 		// ensure db closed
 		//   - transactions properly checked and handled
 		//   - disk sync if needed
 		//
 		core.deinit();
+		return ret;
 	}
 	catch(const DB_ERROR &e)
 	{
@@ -41,6 +41,9 @@
 // STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
 // THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
+#pragma once
+
+#include <algorithm>
 #include <vector>
 #include <random>
 
@@ -72,6 +75,11 @@ public:
 			set_bit(dist(mtgen));
 	}
 
+	inline void clear()
+	{
+		std::fill(bytes.begin(), bytes.end(), 0);
+	}
+
 	inline bool not_present(const void* data, size_t data_len)
 	{
 		crypto::hash h = crypto::cn_fast_hash(data, data_len);
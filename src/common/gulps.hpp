@@ -52,8 +52,10 @@
 #include <map>
 #include <sstream>
 #include <vector>
+#include <algorithm>
 #include <atomic>
-#include "thdq.hpp"
+#include <mutex>
+#include "mpscq.hpp"
 #include "string.hpp"
 #include <fmt/format.h>
 #include <fmt/time.h>
@@ -120,6 +122,8 @@ public:
 		LEVEL_TRACE2
 	};
 
+	static constexpr uint32_t LEVEL_COUNT = LEVEL_TRACE2 + 1;
+
 	static inline const char* level_to_str(level lvl)
 	{
 		switch(lvl)
@@ -149,6 +153,8 @@ public:
 		OUT_LOG_2
 	};
 
+	static constexpr uint32_t OUT_COUNT = OUT_LOG_2 + 1;
+
 	static inline const char* out_to_str(output out)
 	{
 		switch(out)
@@ -200,6 +206,8 @@ public:
 		bool printed = false;
 		bool logged = false;
 
+		message() = default;
+
 		message(output out, level lvl, const char* major, const char* minor, const char* path, int64_t line, std::string&& txt, color clr = COLOR_WHITE, bool add_newline = true) :
 			time(std::time(nullptr)), lvl(lvl), out(out), cat_major(major), cat_minor(minor), src_path(path), src_line(line),
 			thread_id(gulps::inst().get_thread_tag()), text(std::move(txt)), clr(clr)
@@ -244,6 +252,11 @@ public:
 	// NB Lambdas must not capture to be convertible to a function ptr
 	typedef bool (*filter_fun)(const message&, bool printed, bool logged);
 
+	// A gate answers, without seeing the message, whether its filter could ever accept
+	// a given channel and level. It is evaluated when outputs or log levels change, and
+	// the result is what lets the logging macros skip formatting altogether.
+	typedef bool (*gate_fun)(output out, level lvl);
+
 	class gulps_output
 	{
 	protected:
@@ -293,7 +306,31 @@ public:
 			return result;
 		}
 
-		void add_filter(filter_fun filter) { filters.push_back(filter); };
+		// A filter without a gate is assumed to be able to pass anything. Filters have to be
+		// added before the output is handed to gulps::add_output
+		void add_filter(filter_fun filter, gate_fun gate = nullptr)
+		{
+			filters.push_back(filter);
+			gates.push_back(gate);
+		};
+
+		// Bitmask of the levels on the channel that any of the filters may let through
+		uint32_t enabled_mask(output out) const
+		{
+			uint32_t mask = 0;
+			for(gate_fun gate : gates)
+			{
+				if(gate == nullptr)
+					return (1u << LEVEL_COUNT) - 1;
+
+				for(uint32_t lvl = 0; lvl < LEVEL_COUNT; lvl++)
+				{
+					if(gate(out, level(lvl)))
+						mask |= 1u << lvl;
+				}
+			}
+			return mask;
+		}
 
 	private:
 		gulps_output(gulps_output&& ) = delete;
@@ -302,6 +339,7 @@ public:
 		gulps_output& operator=(gulps_output& ) = delete;
 
 		std::vector<filter_fun> filters;
+		std::vector<gate_fun> gates;
 	};
 
 	class gulps_print_output : public gulps_output
@@ -315,6 +353,7 @@ public:
 		{
 			std::string header;
 			const std::string& text = msg.print_message(header, mode);
+			std::unique_lock<std::mutex> lck(stdout_mutex());
 			if(mode != TEXT_ONLY)
 				print(header, hdr_color);
 			print(text, msg.clr);
@@ -323,6 +362,13 @@ public:
 	private:
 		output_mode mode;
 
+		// Shared by all print outputs, as they all end up on the same console
+		static std::mutex& stdout_mutex()
+		{
+			static std::mutex mtx;
+			return mtx;
+		}
+
 		static void print(const std::string& txt, color clr)
 		{
 			set_console_color(clr);
@@ -443,6 +489,7 @@ public:
 
 		void log_message(const message& msg) override
 		{
+			std::unique_lock<std::mutex> lck(log_mutex);
 			log.push_back(msg);
 		}
 
@@ -452,6 +499,7 @@ public:
 		}
 
 	protected:
+		std::mutex log_mutex;
 		std::vector<message> log;
 	};
 
@@ -469,6 +517,7 @@ public:
 
 		void log_message(const message& msg) override
 		{
+			std::unique_lock<std::mutex> lck(file_mutex);
 			write_output(msg);
 		}
 
@@ -496,30 +545,29 @@ public:
 
 		std::string fname;
 		std::ofstream output_file;
+		std::mutex file_mutex;
 	};
 
-	//Class handling async logging. Async logging is thread-safe and preserves temporal order
+	//Class handling async logging. Async logging is thread-safe and preserves temporal order.
+	//Logging threads hand messages over through a lock-free ring, only the writer thread touches the file.
 	class gulps_async_file_output : public gulps_file_output
 	{
 	public:
 		gulps_async_file_output(const std::string& name) :
-			gulps_file_output(name), thd(&gulps_async_file_output::output_main, this)
+			gulps_file_output(name), msg_q(async_queue_size), thd(&gulps_async_file_output::output_main, this)
 		{
 		}
 
 		void log_message(const message& msg) override
 		{
-			msg_q.push(msg);
+			msg_q.push(message(msg));
 		}
 
 		void output_main()
 		{
-			std::unique_lock<std::mutex> lck = msg_q.get_lock();
-			while(msg_q.wait_for_pop(lck))
-			{
-				message msg = msg_q.pop(lck);
+			message msg;
+			while(msg_q.wait_pop(msg))
 				write_output(msg);
-			}
 		}
 
 		~gulps_async_file_output()
@@ -548,7 +596,9 @@ public:
 			}
 		}
 
-		thdq<message> msg_q;
+		static constexpr size_t async_queue_size = 4096;
+
+		mpscq<message> msg_q;
 		std::thread thd;
 	};
 	inline const std::string& get_thread_tag() { return thread_tag(); }
@@ -571,23 +621,44 @@ public:
 	{
 		std::unique_lock<std::mutex> lck(gulps_global);
 		outputs.insert(std::make_pair(next_handle, std::move(output)));
+		publish_outputs();
 		return next_handle++;
 	}
 
 	void remove_output(uint64_t handle)
 	{
 		std::unique_lock<std::mutex> lck(gulps_global);
-		outputs.erase(handle);
+		auto it = outputs.find(handle);
+		if(it == outputs.end())
+			return;
+
+		std::unique_ptr<gulps_output> removed = std::move(it->second);
+		outputs.erase(it);
+		// No reader can be holding the output once publish_outputs returns
+		publish_outputs();
 	}
 
-	void log(message&& in_msg)
+	// Cheap check done by the logging macros before the message is even formatted
+	inline bool is_enabled(output out, level lvl) const
+	{
+		return (enabled[out].load(std::memory_order_relaxed) >> lvl) & 1;
+	}
+
+	// Recompute the enabled levels, needs to be called when the filter gates change their minds
+	void update_gates()
 	{
 		std::unique_lock<std::mutex> lck(gulps_global);
+		update_enabled();
+	}
+
+	void log(message&& in_msg)
+	{
 		message msg = std::move(in_msg);
 		bool printed = false, logged = false;
 
-		for(const auto& it : outputs)
-			it.second->log(msg, printed, logged);
+		reader_guard guard(*this);
+		for(gulps_output* out : *guard.outputs)
+			out->log(msg, printed, logged);
 	}
 
 	inline const std::string& get_path_prefix()
@@ -596,8 +667,67 @@ public:
 	}
 
 private:
+	typedef std::vector<gulps_output*> output_list;
+
+	// Readers register in the counter of the current epoch, so a writer can swap in a new
+	// output list, advance the epoch and wait for the old epoch's readers to leave.
+	struct reader_guard
+	{
+		reader_guard(gulps& g) : g(g)
+		{
+			while(true)
+			{
+				epoch = g.epoch.load();
+				g.readers[epoch & 1].fetch_add(1);
+				if(g.epoch.load() == epoch)
+					break;
+				g.readers[epoch & 1].fetch_sub(1);
+			}
+			outputs = g.current_outputs.load();
+		}
+
+		~reader_guard() { g.readers[epoch & 1].fetch_sub(1); }
+
+		gulps& g;
+		uint32_t epoch;
+		const output_list* outputs;
+	};
+
+	// Called with gulps_global held
+	void publish_outputs()
+	{
+		std::unique_ptr<output_list> list(new output_list());
+		for(const auto& it : outputs)
+			list->push_back(it.second.get());
+
+		std::unique_ptr<const output_list> old(current_outputs.exchange(list.release()));
+		uint32_t old_epoch = epoch.fetch_add(1);
+		while(readers[old_epoch & 1].load() != 0)
+			std::this_thread::yield();
+
+		update_enabled();
+	}
+
+	// Called with gulps_global held
+	void update_enabled()
+	{
+		for(uint32_t out = 0; out < OUT_COUNT; out++)
+		{
+			uint32_t mask = 0;
+			for(const auto& it : outputs)
+				mask |= it.second->enabled_mask(output(out));
+			enabled[out].store(mask, std::memory_order_relaxed);
+		}
+	}
+
 	gulps()
 	{
+		for(std::atomic<uint32_t>& e : enabled)
+			e.store(0, std::memory_order_relaxed);
+		for(std::atomic<uint32_t>& r : readers)
+			r.store(0, std::memory_order_relaxed);
+		current_outputs.store(new output_list());
+
 		path_prefix = __FILE__;
 		size_t pos;
 		if((pos = path_prefix.find("src/common/gulps.hpp")) != std::string::npos)
@@ -614,10 +744,20 @@ private:
 		return thread_tag;
 	}
 
+	~gulps()
+	{
+		delete current_outputs.load();
+	}
+
 	std::string path_prefix;
 	uint64_t next_handle = 0;
+	// Only serialises changes to the outputs, logging itself doesn't take it
 	std::mutex gulps_global;
 	std::map<uint64_t, std::unique_ptr<gulps_output>> outputs;
+	std::atomic<const output_list*> current_outputs;
+	std::atomic<uint32_t> epoch{0};
+	std::atomic<uint32_t> readers[2];
+	std::atomic<uint32_t> enabled[OUT_COUNT];
 };
 
 class gulps_log_level
@@ -638,9 +778,12 @@ private:
 
 	std::mutex cat_mutex;
 	std::vector<cat_pair> log_cats;
-	gulps::level wildcard_level;
+	gulps::level wildcard_level = gulps::LEVEL_PRINT;
 	std::string current_cat_str;
 	bool active = false;
+	// Highest level any category lets through. It starts at the top so that nothing
+	// gets gated away before the categories are parsed.
+	std::atomic<uint32_t> max_level{gulps::LEVEL_TRACE2};
 
 public:
 	gulps_log_level() {}
@@ -713,11 +856,25 @@ public:
 		// replace old log lvl with new levels
 		log_cats.swap(log_cats_tmp);
 		active = true;
+
+		uint32_t max_lvl = wildcard_level;
+		for(const cat_pair& p : log_cats)
+			max_lvl = std::max<uint32_t>(max_lvl, p.level);
+		max_level = max_lvl;
+		lck.unlock();
+
+		gulps::inst().update_gates();
 		return true;
 	}
 
 	bool is_active() const { return active; }
 
+	// Could any category match a message at that level. Lock-free, meant for filter gates
+	bool may_match(gulps::level lvl) const
+	{
+		return lvl <= max_level.load(std::memory_order_relaxed);
+	}
+
 	bool match_msg(const gulps::message& msg)
 	{
 		std::unique_lock<std::mutex> lck(cat_mutex);
@@ -754,11 +911,15 @@ namespace debug
 
 GULPS_CAT_MINOR("");
 
-#define GULPS_OUTPUT(out, lvl, maj, min, clr, ...) gulps::inst().log(gulps::message(out, lvl, maj, min, __FILE__, __LINE__, stream_writer::write(__VA_ARGS__), clr))
-#define GULPS_OUTPUTF(out, lvl, maj, min, clr, ...) gulps::inst().log(gulps::message(out, lvl, maj, min, __FILE__, __LINE__, fmt::format(__VA_ARGS__), clr))
+// Arguments are only evaluated and formatted if some output may take the message
+#define GULPS_OUTPUT(out, lvl, maj, min, clr, ...) (gulps::inst().is_enabled(out, lvl) ? \
+		gulps::inst().log(gulps::message(out, lvl, maj, min, __FILE__, __LINE__, stream_writer::write(__VA_ARGS__), clr)) : (void)0)
+#define GULPS_OUTPUTF(out, lvl, maj, min, clr, ...) (gulps::inst().is_enabled(out, lvl) ? \
+		gulps::inst().log(gulps::message(out, lvl, maj, min, __FILE__, __LINE__, fmt::format(__VA_ARGS__), clr)) : (void)0)
 
-#define GULPS_PRINT_NOLF(...) gulps::inst().log(gulps::message(gulps::OUT_USER_0, gulps::LEVEL_PRINT, gulps_major_cat::c_str(), "input_line",  \
-		__FILE__, __LINE__, stream_writer::write(__VA_ARGS__), gulps::COLOR_WHITE, false));
+#define GULPS_PRINT_NOLF(...) (gulps::inst().is_enabled(gulps::OUT_USER_0, gulps::LEVEL_PRINT) ? \
+		gulps::inst().log(gulps::message(gulps::OUT_USER_0, gulps::LEVEL_PRINT, gulps_major_cat::c_str(), "input_line",  \
+		__FILE__, __LINE__, stream_writer::write(__VA_ARGS__), gulps::COLOR_WHITE, false)) : (void)0);
 
 #define GULPS_PRINT(...) GULPS_OUTPUT(gulps::OUT_USER_0, gulps::LEVEL_PRINT, gulps_major_cat::c_str(), gulps_minor_cat::c_str(), gulps::COLOR_WHITE, __VA_ARGS__)
 #define GULPS_PRINT_CLR(clr, ...) GULPS_OUTPUT(gulps::OUT_USER_0, gulps::LEVEL_PRINT,  gulps_major_cat::c_str(), gulps_minor_cat::c_str(), clr, __VA_ARGS__)
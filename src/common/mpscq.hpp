@@ -0,0 +1,172 @@
+// Copyright (c) 2018, pasta Currency Project
+//
+// Portions of this file are available under BSD-3 license. Please see ORIGINAL-LICENSE for details
+// All rights reserved.
+//
+// Authors and copyright holders give permission for following:
+//
+// 1. Redistribution and use in source and binary forms WITHOUT modification.
+//
+// 2. Modification of the source form for your own personal use.
+//
+// As long as the following conditions are met:
+//
+// 3. You must not distribute modified copies of the work to third parties. This includes
+//    posting the work online, or hosting copies of the modified work for download.
+//
+// 4. Any derivative version of this work is also covered by this license, including point 8.
+//
+// 5. Neither the name of the copyright holders nor the names of the authors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+//
+// 6. You agree that this licence is governed by and shall be construed in accordance
+//    with the laws of England and Wales.
+//
+// 7. You agree to submit all disputes arising out of or in connection with this licence
+//    to the exclusive jurisdiction of the Courts of England and Wales.
+//
+// Authors and copyright holders agree that:
+//
+// 8. This licence expires and the work covered by it is released into the
+//    public domain on 1st of February 2021
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+// Bounded lock-free multi producer, single consumer ring. Every cell carries a
+// sequence number which tells producers and the consumer whose turn it is, so
+// push never takes a lock. The mutex and cv are only touched when the consumer
+// has run dry and goes to sleep.
+template <typename T>
+class mpscq
+{
+public:
+	explicit mpscq(size_t capacity)
+	{
+		size_t size = 2;
+		while(size < capacity)
+			size <<= 1;
+
+		mask_ = size - 1;
+		cells_.reset(new cell[size]);
+		for(size_t i = 0; i < size; i++)
+			cells_[i].seq.store(i, std::memory_order_relaxed);
+	}
+
+	// Producers spin (yielding) while the ring is full
+	void push(T&& item)
+	{
+		cell* c;
+		size_t pos = enqueue_pos_.load(std::memory_order_relaxed);
+		while(true)
+		{
+			c = &cells_[pos & mask_];
+			size_t seq = c->seq.load(std::memory_order_acquire);
+			intptr_t diff = (intptr_t)seq - (intptr_t)pos;
+			if(diff == 0)
+			{
+				if(enqueue_pos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+					break;
+			}
+			else if(diff < 0)
+			{
+				std::this_thread::yield();
+				pos = enqueue_pos_.load(std::memory_order_relaxed);
+			}
+			else
+				pos = enqueue_pos_.load(std::memory_order_relaxed);
+		}
+
+		c->data = std::move(item);
+		c->seq.store(pos + 1, std::memory_order_release);
+
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		if(sleeping_.load(std::memory_order_relaxed))
+		{
+			std::unique_lock<std::mutex> lck(mutex_);
+			cond_.notify_one();
+		}
+	}
+
+	// Consumer side only
+	bool try_pop(T& item)
+	{
+		cell* c = &cells_[dequeue_pos_ & mask_];
+		if(c->seq.load(std::memory_order_acquire) != dequeue_pos_ + 1)
+			return false;
+
+		item = std::move(c->data);
+		c->seq.store(dequeue_pos_ + mask_ + 1, std::memory_order_release);
+		dequeue_pos_++;
+		return true;
+	}
+
+	// Consumer side only. Blocks until there is an item, returns false once
+	// the finish flag is set and the ring has been drained
+	bool wait_pop(T& item)
+	{
+		while(true)
+		{
+			if(try_pop(item))
+				return true;
+
+			std::unique_lock<std::mutex> lck(mutex_);
+			sleeping_.store(true, std::memory_order_relaxed);
+			std::atomic_thread_fence(std::memory_order_seq_cst);
+
+			if(try_pop(item))
+			{
+				sleeping_.store(false, std::memory_order_relaxed);
+				return true;
+			}
+
+			if(finish_)
+			{
+				sleeping_.store(false, std::memory_order_relaxed);
+				return false;
+			}
+
+			cond_.wait(lck);
+			sleeping_.store(false, std::memory_order_relaxed);
+		}
+	}
+
+	void set_finish_flag()
+	{
+		std::unique_lock<std::mutex> lck(mutex_);
+		finish_ = true;
+		cond_.notify_all();
+	}
+
+private:
+	struct cell
+	{
+		std::atomic<size_t> seq;
+		T data;
+	};
+
+	std::unique_ptr<cell[]> cells_;
+	size_t mask_;
+	std::atomic<size_t> enqueue_pos_{0};
+	size_t dequeue_pos_ = 0;
+	std::atomic<bool> sleeping_{false};
+	std::mutex mutex_;
+	std::condition_variable cond_;
+	bool finish_ = false;
+};
@@ -52,25 +52,116 @@
 #include "cryptonote_config.h"
 
 static __thread int depth = 0;
+static __thread int worker_index = -1;
+static __thread int current_priority = tools::threadpool::PRIORITY_NORMAL;
+
+// Past this nesting depth tasks run in the submitting thread, this bounds
+// the stack used by waiters that run queued tasks while they wait
+static constexpr int MAX_TASK_DEPTH = 16;
+// Rounds an idle worker or a waiter yields before it goes to sleep
+static constexpr unsigned WAIT_SPIN_COUNT = 64;
+// With this many tasks queued per worker, submitters run their tasks themselves
+static constexpr int MAX_QUEUED_PER_WORKER = 256;
 
 namespace tools
 {
-threadpool::threadpool() : running(true), active(0)
+// A growable ring of tasks. The owner pops at the back, thieves at the front.
+class task_ring
+{
+  public:
+	task_ring() : buf(64), head(0), count(0) {}
+
+	bool empty() const { return count == 0; }
+
+	void push_back(threadpool::task &&t)
+	{
+		if(count == buf.size())
+			grow();
+		buf[(head + count) & (buf.size() - 1)] = std::move(t);
+		count++;
+	}
+
+	void pop_back(threadpool::task &t)
+	{
+		count--;
+		t = std::move(buf[(head + count) & (buf.size() - 1)]);
+	}
+
+	void pop_front(threadpool::task &t)
+	{
+		t = std::move(buf[head]);
+		head = (head + 1) & (buf.size() - 1);
+		count--;
+	}
+
+	// Takes the newest task of the waiter out of the ring
+	bool take(const threadpool::waiter *w, threadpool::task &t)
+	{
+		const size_t mask = buf.size() - 1;
+		for(size_t i = count; i-- > 0;)
+		{
+			if(buf[(head + i) & mask].get_waiter() != w)
+				continue;
+
+			t = std::move(buf[(head + i) & mask]);
+			for(size_t j = i + 1; j < count; j++)
+				buf[(head + j - 1) & mask] = std::move(buf[(head + j) & mask]);
+			count--;
+			return true;
+		}
+		return false;
+	}
+
+  private:
+	void grow()
+	{
+		std::vector<threadpool::task> n(buf.size() * 2);
+		for(size_t i = 0; i < count; i++)
+			n[i] = std::move(buf[(head + i) & (buf.size() - 1)]);
+		buf.swap(n);
+		head = 0;
+	}
+
+	std::vector<threadpool::task> buf;
+	size_t head;
+	size_t count;
+};
+
+struct threadpool::task_queue
+{
+	task_queue()
+	{
+		for(size_t p = 0; p < PRIORITY_COUNT; p++)
+			size[p] = 0;
+	}
+
+	boost::mutex mutex;
+	task_ring tasks[PRIORITY_COUNT];
+	std::atomic<int> size[PRIORITY_COUNT];
+};
+
+threadpool::threadpool() : pending_total(0), sleeping(0), waiting(0), running(true)
 {
+	for(size_t p = 0; p < PRIORITY_COUNT; p++)
+		pending[p] = 0;
+
 	boost::thread::attributes attrs;
 	attrs.set_stack_size(THREAD_STACK_SIZE);
 	max = tools::get_max_concurrency();
-	size_t i = max;
-	while(i--)
+
+	for(int i = 0; i <= max; i++)
+		queues.emplace_back(new task_queue());
+
+	for(int i = 0; i < max; i++)
 	{
-		threads.push_back(boost::thread(attrs, boost::bind(&threadpool::run, this)));
+		threads.push_back(boost::thread(attrs, boost::bind(&threadpool::run, this, i)));
 	}
 }
 
 threadpool::~threadpool()
 {
 	{
-		const boost::unique_lock<boost::mutex> lock(mutex);
+		const boost::unique_lock<boost::mutex> lock(sleep_mutex);
 		running = false;
 		has_work.notify_all();
 	}
@@ -80,28 +171,157 @@ threadpool::~threadpool()
 	}
 }
 
-void threadpool::submit(waiter *obj, std::function<void()> f)
+threadpool::priority threadpool::get_current_priority()
+{
+	return static_cast<priority>(current_priority);
+}
+
+void threadpool::push(task &&t, priority prio)
 {
-	entry e = {obj, f};
-	boost::unique_lock<boost::mutex> lock(mutex);
-	if((active == max && !queue.empty()) || depth > 0)
+	if(depth >= MAX_TASK_DEPTH || pending_total >= max * MAX_QUEUED_PER_WORKER)
 	{
-		// if all available threads are already running
-		// and there's work waiting, just run in current thread
-		lock.unlock();
+		// nested too deep or too much work waiting, just run in current thread
+		const int prev_priority = current_priority;
+		current_priority = prio;
 		++depth;
-		f();
+		t();
 		--depth;
+		current_priority = prev_priority;
+		return;
+	}
+
+	waiter *w = t.get_waiter();
+	bool first_queued = false;
+	if(w != nullptr)
+	{
+		w->inc();
+		first_queued = w->queued++ == 0;
 	}
-	else
+
+	task_queue &q = worker_index >= 0 ? *queues[worker_index] : *queues.back();
+	{
+		const boost::unique_lock<boost::mutex> lock(q.mutex);
+		q.tasks[prio].push_back(std::move(t));
+		q.size[prio]++;
+	}
+	pending[prio]++;
+	pending_total++;
+
+	// its waiter may be blocked with nothing of its own to run
+	if(first_queued)
+		notify_waiters();
+
+	if(sleeping > 0)
 	{
-		if(obj)
-			obj->inc();
-		queue.push_back(e);
+		const boost::unique_lock<boost::mutex> lock(sleep_mutex);
 		has_work.notify_one();
 	}
 }
 
+bool threadpool::pop(task &t, priority &prio)
+{
+	if(pending_total == 0)
+		return false;
+
+	const size_t workers = queues.size() - 1;
+	const size_t self = worker_index >= 0 ? worker_index : workers;
+
+	for(size_t p = 0; p < PRIORITY_COUNT; p++)
+	{
+		if(pending[p] == 0)
+			continue;
+
+		// own queue first, then external submissions, then steal from other workers
+		for(size_t i = 0; i <= workers; i++)
+		{
+			size_t qi;
+			if(i == 0)
+				qi = self;
+			else if(self != workers)
+				qi = i == 1 ? workers : (self + i - 1) % workers;
+			else
+				qi = i - 1;
+
+			task_queue &q = *queues[qi];
+			if(q.size[p].load(std::memory_order_relaxed) == 0)
+				continue;
+
+			boost::unique_lock<boost::mutex> lock(q.mutex);
+			if(q.tasks[p].empty())
+				continue;
+
+			if(qi == self && self != workers)
+				q.tasks[p].pop_back(t);
+			else
+				q.tasks[p].pop_front(t);
+			q.size[p]--;
+			lock.unlock();
+
+			pending[p]--;
+			pending_total--;
+			if(t.get_waiter() != nullptr)
+				t.get_waiter()->queued--;
+			prio = static_cast<priority>(p);
+			return true;
+		}
+	}
+	return false;
+}
+
+bool threadpool::pop_waiter_task(const waiter *w, task &t, priority &prio)
+{
+	if(w->queued == 0)
+		return false;
+
+	for(size_t p = 0; p < PRIORITY_COUNT; p++)
+	{
+		if(pending[p] == 0)
+			continue;
+
+		for(size_t qi = 0; qi < queues.size(); qi++)
+		{
+			task_queue &q = *queues[qi];
+			if(q.size[p].load(std::memory_order_relaxed) == 0)
+				continue;
+
+			boost::unique_lock<boost::mutex> lock(q.mutex);
+			if(!q.tasks[p].take(w, t))
+				continue;
+			q.size[p]--;
+			lock.unlock();
+
+			pending[p]--;
+			pending_total--;
+			t.get_waiter()->queued--;
+			prio = static_cast<priority>(p);
+			return true;
+		}
+	}
+	return false;
+}
+
+void threadpool::execute(task &t, priority prio)
+{
+	const int prev_priority = current_priority;
+	current_priority = prio;
+	++depth;
+	t();
+	--depth;
+	current_priority = prev_priority;
+
+	if(t.get_waiter() != nullptr)
+		t.get_waiter()->dec();
+}
+
+void threadpool::notify_waiters()
+{
+	if(waiting > 0)
+	{
+		const boost::unique_lock<boost::mutex> lock(wait_mutex);
+		wait_done.notify_all();
+	}
+}
+
 int threadpool::get_max_concurrency()
 {
 	return max;
@@ -109,11 +329,8 @@ int threadpool::get_max_concurrency()
 
 threadpool::waiter::~waiter()
 {
-	{
-		boost::unique_lock<boost::mutex> lock(mt);
-		if(num)
-			GULPS_ERROR("wait should have been called before waiter dtor - waiting now");
-	}
+	if(num != 0)
+		GULPS_ERROR("wait should have been called before waiter dtor - waiting now");
 	try
 	{
 		wait();
@@ -126,48 +343,75 @@ threadpool::waiter::~waiter()
 
 void threadpool::waiter::wait()
 {
-	boost::unique_lock<boost::mutex> lock(mt);
-	while(num)
-		cv.wait(lock);
+	threadpool &pool = threadpool::getInstance();
+	unsigned spins = 0;
+	while(num.load(std::memory_order_acquire) > 0)
+	{
+		// run our own queued tasks instead of blocking, anything else
+		// could need a lock the caller holds
+		task t;
+		priority prio;
+		if(depth < MAX_TASK_DEPTH && pool.pop_waiter_task(this, t, prio))
+		{
+			pool.execute(t, prio);
+			spins = 0;
+			continue;
+		}
+
+		if(++spins < WAIT_SPIN_COUNT)
+		{
+			boost::this_thread::yield();
+			continue;
+		}
+
+		boost::unique_lock<boost::mutex> lock(pool.wait_mutex);
+		pool.waiting++;
+		while(num > 0 && (depth >= MAX_TASK_DEPTH || queued == 0))
+			pool.wait_done.wait(lock);
+		pool.waiting--;
+		spins = 0;
+	}
 }
 
 void threadpool::waiter::inc()
 {
-	const boost::unique_lock<boost::mutex> lock(mt);
 	num++;
 }
 
 void threadpool::waiter::dec()
 {
-	const boost::unique_lock<boost::mutex> lock(mt);
-	num--;
-	if(!num)
-		cv.notify_one();
+	// the waiter may be gone as soon as the count drops to zero
+	if(num.fetch_sub(1) == 1)
+		threadpool::getInstance().notify_waiters();
 }
 
-void threadpool::run()
+void threadpool::run(size_t index)
 {
-	boost::unique_lock<boost::mutex> lock(mutex);
+	worker_index = index;
+	unsigned spins = 0;
 	while(running)
 	{
-		entry e;
-		while(queue.empty() && running)
-			has_work.wait(lock);
-		if(!running)
-			break;
+		task t;
+		priority prio;
+		if(pop(t, prio))
+		{
+			execute(t, prio);
+			spins = 0;
+			continue;
+		}
 
-		active++;
-		e = queue.front();
-		queue.pop_front();
-		lock.unlock();
-		++depth;
-		e.f();
-		--depth;
+		if(++spins < WAIT_SPIN_COUNT)
+		{
+			boost::this_thread::yield();
+			continue;
+		}
+		spins = 0;
 
-		if(e.wo)
-			e.wo->dec();
-		lock.lock();
-		active--;
+		boost::unique_lock<boost::mutex> lock(sleep_mutex);
+		sleeping++;
+		while(running && pending_total == 0)
+			has_work.wait(lock);
+		sleeping--;
 	}
 }
 }
@@ -48,15 +48,19 @@
 #include <boost/thread/condition_variable.hpp>
 #include <boost/thread/mutex.hpp>
 #include <boost/thread/thread.hpp>
+#include <atomic>
 #include <cstddef>
 #include <functional>
+#include <memory>
+#include <new>
 #include <stdexcept>
+#include <type_traits>
 #include <utility>
 #include <vector>
 
 namespace tools
 {
-//! A global thread pool
+//! A global work stealing thread pool
 class threadpool
 {
 	GULPS_CAT_MAJOR("thdpool");
@@ -67,44 +71,160 @@ class threadpool
 		return instance;
 	}
 
+	// Tasks of a higher priority class are always picked
+	// before tasks of a lower one. Block validation should be
+	// high, serving RPC clients low.
+	enum priority
+	{
+		PRIORITY_HIGH = 0,
+		PRIORITY_NORMAL,
+		PRIORITY_LOW,
+		PRIORITY_COUNT
+	};
+
 	// The waiter lets the caller know when all of its
-	// tasks are completed.
+	// tasks are completed. While waiting, the calling thread
+	// runs the queued tasks of this waiter itself, never
+	// those of others, as it may hold locks they need.
 	class waiter
 	{
-		boost::mutex mt;
-		boost::condition_variable cv;
-		int num;
+		friend class threadpool;
+
+		std::atomic<int> num;
+		std::atomic<int> queued; // tasks of this waiter still in the queues
 
 	  public:
 		void inc();
 		void dec();
 		void wait(); //! Wait for a set of tasks to finish.
-		waiter() : num(0) {}
+		waiter() : num(0), queued(0) {}
 		~waiter();
 	};
 
+	// A callable stored in place, submitting never allocates
+	class task
+	{
+	  public:
+		static constexpr size_t storage_size = 128;
+
+		task() : invoke_fn(nullptr), manage_fn(nullptr), wo(nullptr) {}
+
+		template <typename F>
+		task(waiter *obj, F &&f) : wo(obj)
+		{
+			typedef typename std::decay<F>::type functor;
+			static_assert(sizeof(functor) <= storage_size, "Task is too large for the threadpool task storage, capture by reference instead");
+			static_assert(alignof(functor) <= alignof(storage_type), "Task alignment is too large for the threadpool task storage");
+
+			new(&storage) functor(std::forward<F>(f));
+			invoke_fn = [](void *p) { (*static_cast<functor *>(p))(); };
+			manage_fn = [](void *dst, void *src) {
+				if(dst != nullptr)
+					new(dst) functor(std::move(*static_cast<functor *>(src)));
+				static_cast<functor *>(src)->~functor();
+			};
+		}
+
+		task(task &&o) noexcept : invoke_fn(o.invoke_fn), manage_fn(o.manage_fn), wo(o.wo)
+		{
+			if(manage_fn != nullptr)
+				manage_fn(&storage, &o.storage);
+			o.invoke_fn = nullptr;
+			o.manage_fn = nullptr;
+			o.wo = nullptr;
+		}
+
+		task &operator=(task &&o) noexcept
+		{
+			if(this != &o)
+			{
+				reset();
+				invoke_fn = o.invoke_fn;
+				manage_fn = o.manage_fn;
+				wo = o.wo;
+				if(manage_fn != nullptr)
+					manage_fn(&storage, &o.storage);
+				o.invoke_fn = nullptr;
+				o.manage_fn = nullptr;
+				o.wo = nullptr;
+			}
+			return *this;
+		}
+
+		task(const task &) = delete;
+		task &operator=(const task &) = delete;
+
+		~task() { reset(); }
+
+		void operator()() { invoke_fn(&storage); }
+		waiter *get_waiter() const { return wo; }
+
+	  private:
+		typedef typename std::aligned_storage<storage_size, alignof(std::max_align_t)>::type storage_type;
+
+		void reset()
+		{
+			if(manage_fn != nullptr)
+			{
+				manage_fn(nullptr, &storage);
+				invoke_fn = nullptr;
+				manage_fn = nullptr;
+			}
+		}
+
+		storage_type storage;
+		void (*invoke_fn)(void *);
+		void (*manage_fn)(void *, void *);
+		waiter *wo;
+	};
+
 	// Submit a task to the pool. The waiter pointer may be
 	// NULL if the caller doesn't care to wait for the
-	// task to finish.
-	void submit(waiter *waiter, std::function<void()> f);
+	// task to finish. Tasks submitted from inside a pool task
+	// inherit its priority.
+	template <typename F>
+	void submit(waiter *obj, F &&f)
+	{
+		push(task(obj, std::forward<F>(f)), get_current_priority());
+	}
+
+	template <typename F>
+	void submit(waiter *obj, F &&f, priority prio)
+	{
+		push(task(obj, std::forward<F>(f)), prio);
+	}
 
 	int get_max_concurrency();
 
   private:
+	struct task_queue;
+
 	threadpool();
 	~threadpool();
-	typedef struct entry
-	{
-		waiter *wo;
-		std::function<void()> f;
-	} entry;
-	std::deque<entry> queue;
+
+	static priority get_current_priority();
+
+	void push(task &&t, priority prio);
+	bool pop(task &t, priority &prio);
+	bool pop_waiter_task(const waiter *w, task &t, priority &prio);
+	void execute(task &t, priority prio);
+	void notify_waiters();
+	void run(size_t index);
+
+	std::vector<std::unique_ptr<task_queue>> queues; // one per worker, the last one takes external submissions
+	std::atomic<int> pending[PRIORITY_COUNT];
+	std::atomic<int> pending_total;
+
+	boost::mutex sleep_mutex;
 	boost::condition_variable has_work;
-	boost::mutex mutex;
+	std::atomic<int> sleeping;
+
+	boost::mutex wait_mutex;
+	boost::condition_variable wait_done;
+	std::atomic<int> waiting;
+
 	std::vector<boost::thread> threads;
-	int active;
 	int max;
-	bool running;
-	void run();
+	std::atomic<bool> running;
 };
 }
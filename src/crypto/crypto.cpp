@@ -367,6 +367,79 @@ bool crypto_ops::derive_subaddress_public_key_64(const public_key& out_key, cons
 	return true;
 }
 
+// Packs the valid points into out_bytes in one go and scatters them back to
+// the slots their inputs came from
+template <typename T>
+static void batch_tobytes_64(const std::vector<ge64_p2> &points, const std::vector<size_t> &slots, std::vector<T> &out)
+{
+	static_assert(sizeof(T) == 32, "expected a 32 byte point type");
+	std::unique_ptr<fe64[]> scratch(new fe64[points.size()]);
+	std::vector<ec_point> packed(points.size());
+	ge64_tobytes_batch(reinterpret_cast<unsigned char *>(packed.data()), points.data(), scratch.get(), points.size());
+	for(size_t i = 0; i < slots.size(); ++i)
+		memcpy(&out[slots[i]], &packed[i], sizeof(T));
+}
+
+void crypto_ops::generate_key_derivations_64(const std::vector<public_key> &keys, const secret_key &key2, std::vector<key_derivation> &derivations, std::vector<bool> &results)
+{
+	std::vector<ge64_p2> points;
+	std::vector<size_t> slots;
+	points.reserve(keys.size());
+	slots.reserve(keys.size());
+	derivations.resize(keys.size());
+	results.assign(keys.size(), false);
+	assert(sc_check(&key2) == 0);
+
+	for(size_t i = 0; i < keys.size(); ++i)
+	{
+		ge64_p3 point;
+		ge64_p2 point2;
+		ge64_p1p1 point3;
+		if(ge64_frombytes_vartime(&point, &keys[i]) != 0)
+			continue;
+		ge64_scalarmult(&point2, &unwrap(key2), &point);
+		ge64_mul8(&point3, &point2);
+		ge64_p1p1_to_p2(&point2, &point3);
+		points.push_back(point2);
+		slots.push_back(i);
+		results[i] = true;
+	}
+
+	batch_tobytes_64(points, slots, derivations);
+}
+
+void crypto_ops::derive_subaddress_public_keys_64(const std::vector<public_key> &out_keys, const std::vector<key_derivation> &derivations, const std::vector<std::size_t> &output_indices,
+												   std::vector<public_key> &derived_keys, std::vector<bool> &results)
+{
+	assert(out_keys.size() == derivations.size() && out_keys.size() == output_indices.size());
+	std::vector<ge64_p2> points;
+	std::vector<size_t> slots;
+	points.reserve(out_keys.size());
+	slots.reserve(out_keys.size());
+	derived_keys.resize(out_keys.size());
+	results.assign(out_keys.size(), false);
+
+	for(size_t i = 0; i < out_keys.size(); ++i)
+	{
+		ec_scalar scalar;
+		ge64_p3 point1;
+		ge64_p3 point3;
+		ge64_p1p1 point4;
+		ge64_p2 point5;
+		if(ge64_frombytes_vartime(&point1, &out_keys[i]) != 0)
+			continue;
+		derivation_to_scalar(derivations[i], output_indices[i], scalar);
+		ge64_scalarmult_base(&point3, &scalar);
+		ge64_sub(&point4, &point1, &point3);
+		ge64_p1p1_to_p2(&point5, &point4);
+		points.push_back(point5);
+		slots.push_back(i);
+		results[i] = true;
+	}
+
+	batch_tobytes_64(points, slots, derived_keys);
+}
+
 #endif
 
 struct s_comm
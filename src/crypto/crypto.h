@@ -176,6 +176,10 @@ class crypto_ops
 	friend bool generate_key_derivation_64(const public_key &, const secret_key &, key_derivation &);
 	static bool derive_subaddress_public_key_64(const public_key &, const key_derivation &, std::size_t, public_key &);
 	friend bool derive_subaddress_public_key_64(const public_key &, const key_derivation &, std::size_t, public_key &);
+	static void generate_key_derivations_64(const std::vector<public_key> &, const secret_key &, std::vector<key_derivation> &, std::vector<bool> &);
+	friend void generate_key_derivations_64(const std::vector<public_key> &, const secret_key &, std::vector<key_derivation> &, std::vector<bool> &);
+	static void derive_subaddress_public_keys_64(const std::vector<public_key> &, const std::vector<key_derivation> &, const std::vector<std::size_t> &, std::vector<public_key> &, std::vector<bool> &);
+	friend void derive_subaddress_public_keys_64(const std::vector<public_key> &, const std::vector<key_derivation> &, const std::vector<std::size_t> &, std::vector<public_key> &, std::vector<bool> &);
 #endif
 	static void generate_signature(const hash &, const public_key &, const secret_key &, signature &);
 	friend void generate_signature(const hash &, const public_key &, const secret_key &, signature &);
@@ -292,6 +296,21 @@ inline bool derive_subaddress_public_key_64(const public_key &out_key, const key
 {
 	return crypto_ops::derive_subaddress_public_key_64(out_key, derivation, output_index, result);
 }
+
+/* Batched versions of the above for scanning many txes against one view key.
+ * All results of a call share a single field inversion. results[i] is false
+ * where keys[i] (or out_keys[i]) is not a valid point.
+ */
+inline void generate_key_derivations_64(const std::vector<public_key> &keys, const secret_key &key2, std::vector<key_derivation> &derivations, std::vector<bool> &results)
+{
+	crypto_ops::generate_key_derivations_64(keys, key2, derivations, results);
+}
+
+inline void derive_subaddress_public_keys_64(const std::vector<public_key> &out_keys, const std::vector<key_derivation> &derivations, const std::vector<std::size_t> &output_indices,
+											 std::vector<public_key> &derived_keys, std::vector<bool> &results)
+{
+	crypto_ops::derive_subaddress_public_keys_64(out_keys, derivations, output_indices, derived_keys, results);
+}
 #endif
 
 /* Generation and checking of a standard signature.
@@ -319,6 +319,40 @@ void ge64_tobytes(unsigned char s[32], const ge64_p2* h)
 	s[31] ^= fe64_isnegative(x) << 7;
 }
 
+/* Converts n points with a single field inversion (Montgomery's trick).
+   s receives 32 * n bytes, scratch holds n field elements. Every z must be
+   non-zero, which holds for any point built from valid inputs. */
+void ge64_tobytes_batch(unsigned char* s, const ge64_p2* h, fe64* scratch, size_t n)
+{
+	fe64 inv, recip, x, y;
+	size_t i;
+
+	if(n == 0)
+		return;
+
+	fe64_copy(scratch[0], h[0].z);
+	for(i = 1; i < n; ++i)
+		fe64_mul(scratch[i], scratch[i - 1], h[i].z);
+
+	fe64_invert(inv, scratch[n - 1]);
+
+	for(i = n; i-- > 0;)
+	{
+		if(i > 0)
+		{
+			fe64_mul(recip, inv, scratch[i - 1]); /* 1/z_i */
+			fe64_mul(inv, inv, h[i].z);			  /* 1/(z_0...z_(i-1)) */
+		}
+		else
+			fe64_copy(recip, inv);
+
+		fe64_mul(x, h[i].x, recip);
+		fe64_mul(y, h[i].y, recip);
+		fe64_pack(s + 32 * i, y);
+		s[32 * i + 31] ^= fe64_isnegative(x) << 7;
+	}
+}
+
 /* no overflow for this particular order */
 extern const uint64_t sc64_reduce_order[16];
 
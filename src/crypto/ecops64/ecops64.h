@@ -141,6 +141,7 @@ extern "C"
 	void ge64_mul8(ge64_p1p1* r, const ge64_p2* t);
 	int ge64_frombytes_vartime(ge64_p3* h, const unsigned char p[32]);
 	void ge64_tobytes(unsigned char s[32], const ge64_p2* h);
+	void ge64_tobytes_batch(unsigned char* s, const ge64_p2* h, fe64* scratch, size_t n);
 	void sc64_reduce32(unsigned char x[32]);
 	void ge64_scalarmult_base(ge64_p3* r, const unsigned char s[32]);
 	void ge64_scalarmult(ge64_p2* r, const unsigned char a[32], const ge64_p3* A);
@@ -0,0 +1,135 @@
+// Copyright (c) 2020, pasta Currency Project
+//
+// Portions of this file are available under BSD-3 license. Please see ORIGINAL-LICENSE for details
+// All rights reserved.
+//
+// Authors and copyright holders give permission for following:
+//
+// 1. Redistribution and use in source and binary forms WITHOUT modification.
+//
+// 2. Modification of the source form for your own personal use.
+//
+// As long as the following conditions are met:
+//
+// 3. You must not distribute modified copies of the work to third parties. This includes
+//    posting the work online, or hosting copies of the modified work for download.
+//
+// 4. Any derivative version of this work is also covered by this license, including point 8.
+//
+// 5. Neither the name of the copyright holders nor the names of the authors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+//
+// 6. You agree that this licence is governed by and shall be construed in accordance
+//    with the laws of England and Wales.
+//
+// 7. You agree to submit all disputes arising out of or in connection with this licence
+//    to the exclusive jurisdiction of the Courts of England and Wales.
+//
+// Authors and copyright holders agree that:
+//
+// 8. This licence expires and the work covered by it is released into the
+//    public domain on 1st of February 2021
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "cn_pow_ctx_pool.hpp"
+
+#if defined(__linux__)
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+void* cn_pad_alloc(size_t size, bool huge_pages, cn_pad_type& type)
+{
+#if defined(__linux__)
+	void* ptr;
+#if defined(MAP_HUGETLB)
+	if(huge_pages)
+	{
+		// Only succeeds if the admin reserved huge pages (vm.nr_hugepages)
+		ptr = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+		if(ptr != MAP_FAILED)
+		{
+			type = cn_pad_hugetlb;
+			return ptr;
+		}
+	}
+#endif
+	ptr = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if(ptr != MAP_FAILED)
+	{
+#if defined(MADV_HUGEPAGE) && defined(MADV_NOHUGEPAGE)
+		// Transparent huge pages are the fallback. Otherwise keep them off so a 4K run means 4K pages.
+		madvise(ptr, size, huge_pages ? MADV_HUGEPAGE : MADV_NOHUGEPAGE);
+#endif
+		type = cn_pad_mmap;
+		return ptr;
+	}
+#endif
+	type = cn_pad_heap;
+	return boost::alignment::aligned_alloc(4096, size);
+}
+
+void cn_pad_free(void* ptr, size_t size, cn_pad_type type)
+{
+	if(ptr == nullptr)
+		return;
+#if defined(__linux__)
+	if(type != cn_pad_heap)
+	{
+		munmap(ptr, size);
+		return;
+	}
+#endif
+	boost::alignment::aligned_free(ptr);
+}
+
+cn_pow_ctx_pool& cn_pow_ctx_pool::instance()
+{
+	static cn_pow_ctx_pool pool;
+	return pool;
+}
+
+unsigned cn_pow_ctx_pool::current_numa_node()
+{
+#if defined(__linux__) && defined(SYS_getcpu)
+	unsigned cpu = 0, node = 0;
+	if(syscall(SYS_getcpu, &cpu, &node, nullptr) == 0)
+		return node;
+#endif
+	return 0;
+}
+
+cn_pow_ctx_pool::lease cn_pow_ctx_pool::acquire()
+{
+	unsigned node = current_numa_node();
+	{
+		std::lock_guard<std::mutex> lck(mtx);
+		std::vector<std::unique_ptr<cn_pow_hash_v2>>& free_list = idle[node];
+		if(!free_list.empty())
+		{
+			std::unique_ptr<cn_pow_hash_v2> ctx = std::move(free_list.back());
+			free_list.pop_back();
+			return lease(this, node, std::move(ctx));
+		}
+	}
+
+	// Allocate outside the lock, the mapping can take a while
+	return lease(this, node, std::unique_ptr<cn_pow_hash_v2>(new cn_pow_hash_v2(true)));
+}
+
+void cn_pow_ctx_pool::give_back(unsigned node, std::unique_ptr<cn_pow_hash_v2>&& ctx)
+{
+	std::lock_guard<std::mutex> lck(mtx);
+	idle[node].emplace_back(std::move(ctx));
+}
@@ -0,0 +1,116 @@
+// Copyright (c) 2020, pasta Currency Project
+//
+// Portions of this file are available under BSD-3 license. Please see ORIGINAL-LICENSE for details
+// All rights reserved.
+//
+// Authors and copyright holders give permission for following:
+//
+// 1. Redistribution and use in source and binary forms WITHOUT modification.
+//
+// 2. Modification of the source form for your own personal use.
+//
+// As long as the following conditions are met:
+//
+// 3. You must not distribute modified copies of the work to third parties. This includes
+//    posting the work online, or hosting copies of the modified work for download.
+//
+// 4. Any derivative version of this work is also covered by this license, including point 8.
+//
+// 5. Neither the name of the copyright holders nor the names of the authors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+//
+// 6. You agree that this licence is governed by and shall be construed in accordance
+//    with the laws of England and Wales.
+//
+// 7. You agree to submit all disputes arising out of or in connection with this licence
+//    to the exclusive jurisdiction of the Courts of England and Wales.
+//
+// Authors and copyright holders agree that:
+//
+// 8. This licence expires and the work covered by it is released into the
+//    public domain on 1st of February 2021
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#pragma once
+
+#include "cn_slow_hash.hpp"
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+// Process wide pool of PoW hashing contexts. A v2 context owns a 4MB scratchpad, so instead
+// of every caller keeping its own (or all of them queueing on one) contexts are leased from
+// here and returned when the lease goes out of scope. Idle contexts are kept per NUMA node
+// and are created by the thread that first needs them, so the scratchpad pages are first
+// touched, and therefore placed, on that thread's node. Scratchpads use huge pages where
+// the system has them, see cn_pad_alloc.
+class cn_pow_ctx_pool
+{
+  public:
+	class lease
+	{
+	  public:
+		lease() : pool(nullptr), node(0) {}
+		lease(lease&& other) noexcept : pool(other.pool), node(other.node), ctx(std::move(other.ctx)) { other.pool = nullptr; }
+		lease& operator=(lease&& other) noexcept
+		{
+			if(this != &other)
+			{
+				release();
+				pool = other.pool;
+				node = other.node;
+				ctx = std::move(other.ctx);
+				other.pool = nullptr;
+			}
+			return *this;
+		}
+
+		lease(const lease&) = delete;
+		lease& operator=(const lease&) = delete;
+
+		~lease() { release(); }
+
+		cn_pow_hash_v2& operator*() { return *ctx; }
+		cn_pow_hash_v2* operator->() { return ctx.get(); }
+
+	  private:
+		friend class cn_pow_ctx_pool;
+		lease(cn_pow_ctx_pool* pool, unsigned node, std::unique_ptr<cn_pow_hash_v2>&& ctx) : pool(pool), node(node), ctx(std::move(ctx)) {}
+
+		void release()
+		{
+			if(pool != nullptr && ctx)
+				pool->give_back(node, std::move(ctx));
+			pool = nullptr;
+		}
+
+		cn_pow_ctx_pool* pool;
+		unsigned node;
+		std::unique_ptr<cn_pow_hash_v2> ctx;
+	};
+
+	static cn_pow_ctx_pool& instance();
+
+	// Returns an idle context from the caller's NUMA node, or makes a new one
+	lease acquire();
+
+  private:
+	cn_pow_ctx_pool() {}
+
+	void give_back(unsigned node, std::unique_ptr<cn_pow_hash_v2>&& ctx);
+	static unsigned current_numa_node();
+
+	std::mutex mtx;
+	std::unordered_map<unsigned, std::vector<std::unique_ptr<cn_pow_hash_v2>>> idle;
+};
@@ -118,6 +118,19 @@ inline bool hw_check_aes()
 }
 #endif
 
+// How a scratchpad was allocated, so it can be freed the same way
+enum cn_pad_type : uint8_t
+{
+	cn_pad_heap,	 // boost aligned_alloc
+	cn_pad_mmap,	 // anonymous mapping, 4K pages (or transparent huge pages if asked for)
+	cn_pad_hugetlb // MAP_HUGETLB mapping from the reserved huge page pool
+};
+
+// Allocates a page aligned scratchpad. With huge_pages MAP_HUGETLB is tried first, then a
+// normal mapping advised for transparent huge pages. Falls back to the heap where mmap is missing.
+void* cn_pad_alloc(size_t size, bool huge_pages, cn_pad_type& type);
+void cn_pad_free(void* ptr, size_t size, cn_pad_type type);
+
 // This cruft avoids casting-galore and allows us not to worry about sizeof(void*)
 class cn_sptr
 {
@@ -157,13 +170,20 @@ template <size_t MEMORY, size_t ITER, size_t VERSION>
 class cn_slow_hash
 {
   public:
-	cn_slow_hash() : borrowed_pad(false)
+	cn_slow_hash() : borrowed_pad(false), lpad_type(cn_pad_heap)
 	{
 		lpad.set(boost::alignment::aligned_alloc(4096, MEMORY));
 		spad.set(boost::alignment::aligned_alloc(4096, 4096));
 	}
 
-	cn_slow_hash(cn_slow_hash&& other) noexcept : lpad(other.lpad.as_byte()), spad(other.spad.as_byte()), borrowed_pad(other.borrowed_pad)
+	// Scratchpad mapped directly, on huge pages if asked for and available
+	explicit cn_slow_hash(bool huge_pages) : borrowed_pad(false)
+	{
+		lpad.set(cn_pad_alloc(MEMORY, huge_pages, lpad_type));
+		spad.set(boost::alignment::aligned_alloc(4096, 4096));
+	}
+
+	cn_slow_hash(cn_slow_hash&& other) noexcept : lpad(other.lpad.as_byte()), spad(other.spad.as_byte()), borrowed_pad(other.borrowed_pad), lpad_type(other.lpad_type)
 	{
 		other.lpad.set(nullptr);
 		other.spad.set(nullptr);
@@ -190,6 +210,9 @@ class cn_slow_hash
 		lpad.set(other.lpad.as_void());
 		spad.set(other.spad.as_void());
 		borrowed_pad = other.borrowed_pad;
+		lpad_type = other.lpad_type;
+		other.lpad.set(nullptr);
+		other.spad.set(nullptr);
 		return *this;
 	}
 
@@ -197,6 +220,8 @@ class cn_slow_hash
 	cn_slow_hash(const cn_slow_hash& other) = delete;
 	cn_slow_hash& operator=(const cn_slow_hash& other) = delete;
 
+	cn_pad_type scratchpad_type() const { return lpad_type; }
+
 	~cn_slow_hash()
 	{
 		free_mem();
@@ -220,6 +245,34 @@ class cn_slow_hash
 		}
 	}
 
+	// Largest number of inputs hash_multi takes in one call
+	static constexpr size_t max_ways = 4;
+
+	// Hashes `ways` (1, 2 or 4) inputs of equal length, each on its own context. The main
+	// loops of all inputs are interleaved, so while one scratchpad walk waits on an AES round
+	// or a cache miss the others have work to issue. Without x86 AES-NI this is a plain loop.
+	static void hash_multi(cn_slow_hash* const* ctx, const void* const* in, size_t len, void* const* out, size_t ways)
+	{
+#if defined(HAS_INTEL_HW)
+		if(ways > 1 && hw_check_aes() && !ctx[0]->check_override())
+		{
+			switch(ways)
+			{
+			case 2:
+				hardware_hash_multi<2>(ctx, in, len, out);
+				return;
+			case 4:
+				hardware_hash_multi<4>(ctx, in, len, out);
+				return;
+			default:
+				break;
+			}
+		}
+#endif
+		for(size_t i = 0; i < ways; i++)
+			ctx[i]->hash(in[i], len, out[i]);
+	}
+
 	void software_hash(const void* in, size_t len, void* out);
 	void software_hash_3(const void* in, size_t len, void* pout);
 
@@ -247,6 +300,7 @@ class cn_slow_hash
 		lpad.set(lptr);
 		spad.set(sptr);
 		borrowed_pad = true;
+		lpad_type = cn_pad_heap;
 	}
 
 	inline bool check_override()
@@ -271,8 +325,13 @@ class cn_slow_hash
 		if(!borrowed_pad)
 		{
 			if(lpad.as_void() != nullptr)
-				boost::alignment::aligned_free(lpad.as_void());
-			if(lpad.as_void() != nullptr)
+			{
+				if(lpad_type == cn_pad_heap)
+					boost::alignment::aligned_free(lpad.as_void());
+				else
+					cn_pad_free(lpad.as_void(), MEMORY, lpad_type);
+			}
+			if(spad.as_void() != nullptr)
 				boost::alignment::aligned_free(spad.as_void());
 		}
 
@@ -301,9 +360,19 @@ class cn_slow_hash
 	void inner_hash_3();
 	void inner_hash_3_avx();
 
+#if defined(HAS_INTEL_HW)
+	template <size_t N>
+	static void hardware_hash_multi(cn_slow_hash* const* ctx, const void* const* in, size_t len, void* const* out);
+	template <size_t N>
+	static void inner_hash_multi(cn_slow_hash* const* ctx);
+	template <size_t N>
+	static void inner_hash_3_multi(cn_slow_hash* const* ctx);
+#endif
+
 	cn_sptr lpad;
 	cn_sptr spad;
 	bool borrowed_pad;
+	cn_pad_type lpad_type;
 };
 
 extern template class cn_v1_hash_t;
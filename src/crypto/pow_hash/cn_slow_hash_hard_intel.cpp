@@ -330,6 +330,25 @@ inline uint64_t xmm_extract_64(__m128i x)
 #endif
 }
 
+inline void final_hash(uint8_t* state, uint8_t* out)
+{
+	switch(state[0] & 3)
+	{
+	case 0:
+		blake256_hash(state, out);
+		break;
+	case 1:
+		groestl_hash(state, out);
+		break;
+	case 2:
+		jh_hash(state, out);
+		break;
+	case 3:
+		skein_hash(state, out);
+		break;
+	}
+}
+
 template <size_t MEMORY, size_t ITER, size_t VERSION>
 void cn_slow_hash<MEMORY, ITER, VERSION>::hardware_hash(const void* in, size_t len, void* out)
 {
@@ -384,22 +403,7 @@ void cn_slow_hash<MEMORY, ITER, VERSION>::hardware_hash(const void* in, size_t l
 	implode_scratchpad_hard();
 
 	keccakf(spad.as_uqword());
-
-	switch(spad.as_byte(0) & 3)
-	{
-	case 0:
-		blake256_hash(spad.as_byte(), (uint8_t*)out);
-		break;
-	case 1:
-		groestl_hash(spad.as_byte(), (uint8_t*)out);
-		break;
-	case 2:
-		jh_hash(spad.as_byte(), (uint8_t*)out);
-		break;
-	case 3:
-		skein_hash(spad.as_byte(), (uint8_t*)out);
-		break;
-	}
+	final_hash(spad.as_byte(), (uint8_t*)out);
 }
 
 inline void prep_dv(cn_sptr& idx, __m128i& v, __m128& n)
@@ -612,7 +616,232 @@ void cn_slow_hash<MEMORY, ITER, VERSION>::software_hash_3(const void* in, size_t
 	memcpy(pout, spad.as_byte(), 32);
 }
 
+// Same loop as hardware_hash, run for N contexts in lockstep. Every step is done for all
+// lanes before moving on, which gives the core N independent dependency chains to overlap.
+template <size_t MEMORY, size_t ITER, size_t VERSION>
+template <size_t N>
+void cn_slow_hash<MEMORY, ITER, VERSION>::inner_hash_multi(cn_slow_hash* const* ctx)
+{
+	uint8_t* pad[N];
+	uint64_t al[N], ah[N], idx[N];
+	__m128i bx[N];
+
+	for(size_t n = 0; n < N; n++)
+	{
+		uint64_t* h0 = ctx[n]->spad.as_uqword();
+		pad[n] = ctx[n]->lpad.as_byte();
+		al[n] = h0[0] ^ h0[4];
+		ah[n] = h0[1] ^ h0[5];
+		bx[n] = _mm_set_epi64x(h0[3] ^ h0[7], h0[2] ^ h0[6]);
+		idx[n] = al[n];
+	}
+
+	for(size_t i = 0; i < ITER; i++)
+	{
+		__m128i cx[N];
+		for(size_t n = 0; n < N; n++)
+			cx[n] = _mm_load_si128(reinterpret_cast<__m128i*>(pad[n] + (idx[n] & MASK)));
+
+		for(size_t n = 0; n < N; n++)
+			cx[n] = _mm_aesenc_si128(cx[n], _mm_set_epi64x(ah[n], al[n]));
+
+		for(size_t n = 0; n < N; n++)
+		{
+			_mm_store_si128(reinterpret_cast<__m128i*>(pad[n] + (idx[n] & MASK)), _mm_xor_si128(bx[n], cx[n]));
+			idx[n] = xmm_extract_64(cx[n]);
+			bx[n] = cx[n];
+		}
+
+		for(size_t n = 0; n < N; n++)
+		{
+			uint64_t* p = reinterpret_cast<uint64_t*>(pad[n] + (uint32_t(idx[n]) & MASK));
+			uint64_t hi, lo, cl, ch;
+			cl = p[0];
+			ch = p[1];
+
+			lo = _umul128(idx[n], cl, &hi);
+
+			al[n] += hi;
+			ah[n] += lo;
+			p[0] = al[n];
+			p[1] = ah[n];
+			ah[n] ^= ch;
+			al[n] ^= cl;
+			idx[n] = al[n];
+		}
+
+		if(VERSION > 0)
+		{
+			for(size_t n = 0; n < N; n++)
+			{
+				uint8_t* p = pad[n] + (uint32_t(idx[n]) & MASK);
+				int64_t nn = *reinterpret_cast<int64_t*>(p);
+				int32_t d = *reinterpret_cast<int32_t*>(p + 8);
+				int64_t q = nn / (d | 5);
+				*reinterpret_cast<int64_t*>(p) = nn ^ q;
+				idx[n] = d ^ q;
+			}
+		}
+	}
+}
+
+// N lane version of inner_hash_3, interleaved at the granularity of single_comupte_wrap
+template <size_t MEMORY, size_t ITER, size_t VERSION>
+template <size_t N>
+void cn_slow_hash<MEMORY, ITER, VERSION>::inner_hash_3_multi(cn_slow_hash* const* ctx)
+{
+	cn_sptr idx0[N], idx1[N], idx2[N], idx3[N];
+	__m128 sum0[N];
+
+	for(size_t n = 0; n < N; n++)
+	{
+		uint32_t s = ctx[n]->spad.as_dword(0) >> 8;
+		idx0[n] = ctx[n]->scratchpad_ptr(s, 0);
+		idx1[n] = ctx[n]->scratchpad_ptr(s, 1);
+		idx2[n] = ctx[n]->scratchpad_ptr(s, 2);
+		idx3[n] = ctx[n]->scratchpad_ptr(s, 3);
+		sum0[n] = _mm_setzero_ps();
+	}
+
+	for(size_t i = 0; i < ITER; i++)
+	{
+		__m128 n0[N], n1[N], n2[N], n3[N], rc[N];
+		__m128i v0[N], v1[N], v2[N], v3[N];
+		__m128 suma[N], sumb[N], sum1[N], sum2[N], sum3[N];
+		__m128i out[N], out2[N];
+
+		for(size_t n = 0; n < N; n++)
+		{
+			prep_dv(idx0[n], v0[n], n0[n]);
+			prep_dv(idx1[n], v1[n], n1[n]);
+			prep_dv(idx2[n], v2[n], n2[n]);
+			prep_dv(idx3[n], v3[n], n3[n]);
+			rc[n] = sum0[n];
+			out[n] = _mm_setzero_si128();
+		}
+
+		for(size_t n = 0; n < N; n++)
+			single_comupte_wrap<0>(n0[n], n1[n], n2[n], n3[n], 1.3437500f, rc[n], suma[n], out[n]);
+		for(size_t n = 0; n < N; n++)
+			single_comupte_wrap<1>(n0[n], n2[n], n3[n], n1[n], 1.2812500f, rc[n], suma[n], out[n]);
+		for(size_t n = 0; n < N; n++)
+			single_comupte_wrap<2>(n0[n], n3[n], n1[n], n2[n], 1.3593750f, rc[n], sumb[n], out[n]);
+		for(size_t n = 0; n < N; n++)
+			single_comupte_wrap<3>(n0[n], n3[n], n2[n], n1[n], 1.3671875f, rc[n], sumb[n], out[n]);
+		for(size_t n = 0; n < N; n++)
+		{
+			sum0[n] = _mm_add_ps(suma[n], sumb[n]);
+			_mm_store_si128(idx0[n].template as_ptr<__m128i>(), _mm_xor_si128(v0[n], out[n]));
+			out2[n] = out[n];
+			out[n] = _mm_setzero_si128();
+		}
+
+		for(size_t n = 0; n < N; n++)
+			single_comupte_wrap<0>(n1[n], n0[n], n2[n], n3[n], 1.4296875f, rc[n], suma[n], out[n]);
+		for(size_t n = 0; n < N; n++)
+			single_comupte_wrap<1>(n1[n], n2[n], n3[n], n0[n], 1.3984375f, rc[n], suma[n], out[n]);
+		for(size_t n = 0; n < N; n++)
+			single_comupte_wrap<2>(n1[n], n3[n], n0[n], n2[n], 1.3828125f, rc[n], sumb[n], out[n]);
+		for(size_t n = 0; n < N; n++)
+			single_comupte_wrap<3>(n1[n], n3[n], n2[n], n0[n], 1.3046875f, rc[n], sumb[n], out[n]);
+		for(size_t n = 0; n < N; n++)
+		{
+			sum1[n] = _mm_add_ps(suma[n], sumb[n]);
+			_mm_store_si128(idx1[n].template as_ptr<__m128i>(), _mm_xor_si128(v1[n], out[n]));
+			out2[n] = _mm_xor_si128(out2[n], out[n]);
+			out[n] = _mm_setzero_si128();
+		}
+
+		for(size_t n = 0; n < N; n++)
+			single_comupte_wrap<0>(n2[n], n1[n], n0[n], n3[n], 1.4140625f, rc[n], suma[n], out[n]);
+		for(size_t n = 0; n < N; n++)
+			single_comupte_wrap<1>(n2[n], n0[n], n3[n], n1[n], 1.2734375f, rc[n], suma[n], out[n]);
+		for(size_t n = 0; n < N; n++)
+			single_comupte_wrap<2>(n2[n], n3[n], n1[n], n0[n], 1.2578125f, rc[n], sumb[n], out[n]);
+		for(size_t n = 0; n < N; n++)
+			single_comupte_wrap<3>(n2[n], n3[n], n0[n], n1[n], 1.2890625f, rc[n], sumb[n], out[n]);
+		for(size_t n = 0; n < N; n++)
+		{
+			sum2[n] = _mm_add_ps(suma[n], sumb[n]);
+			_mm_store_si128(idx2[n].template as_ptr<__m128i>(), _mm_xor_si128(v2[n], out[n]));
+			out2[n] = _mm_xor_si128(out2[n], out[n]);
+			out[n] = _mm_setzero_si128();
+		}
+
+		for(size_t n = 0; n < N; n++)
+			single_comupte_wrap<0>(n3[n], n1[n], n2[n], n0[n], 1.3203125f, rc[n], suma[n], out[n]);
+		for(size_t n = 0; n < N; n++)
+			single_comupte_wrap<1>(n3[n], n2[n], n0[n], n1[n], 1.3515625f, rc[n], suma[n], out[n]);
+		for(size_t n = 0; n < N; n++)
+			single_comupte_wrap<2>(n3[n], n0[n], n1[n], n2[n], 1.3359375f, rc[n], sumb[n], out[n]);
+		for(size_t n = 0; n < N; n++)
+			single_comupte_wrap<3>(n3[n], n0[n], n2[n], n1[n], 1.4609375f, rc[n], sumb[n], out[n]);
+
+		for(size_t n = 0; n < N; n++)
+		{
+			sum3[n] = _mm_add_ps(suma[n], sumb[n]);
+			_mm_store_si128(idx3[n].template as_ptr<__m128i>(), _mm_xor_si128(v3[n], out[n]));
+			out2[n] = _mm_xor_si128(out2[n], out[n]);
+			sum0[n] = _mm_add_ps(sum0[n], sum1[n]);
+			sum2[n] = _mm_add_ps(sum2[n], sum3[n]);
+			sum0[n] = _mm_add_ps(sum0[n], sum2[n]);
+
+			sum0[n] = _mm_and_ps(_mm_set1_ps_epi32(0x7fffffff), sum0[n]);
+			n0[n] = _mm_mul_ps(sum0[n], _mm_set1_ps(16777216.0f));
+			v0[n] = _mm_cvttps_epi32(n0[n]);
+			v0[n] = _mm_xor_si128(v0[n], out2[n]);
+			v1[n] = _mm_shuffle_epi32(v0[n], _MM_SHUFFLE(0, 1, 2, 3));
+			v0[n] = _mm_xor_si128(v0[n], v1[n]);
+			v1[n] = _mm_shuffle_epi32(v0[n], _MM_SHUFFLE(0, 1, 0, 1));
+			v0[n] = _mm_xor_si128(v0[n], v1[n]);
+
+			sum0[n] = _mm_div_ps(sum0[n], _mm_set1_ps(64.0f));
+			uint32_t s = _mm_cvtsi128_si32(v0[n]);
+			idx0[n] = ctx[n]->scratchpad_ptr(s, 0);
+			idx1[n] = ctx[n]->scratchpad_ptr(s, 1);
+			idx2[n] = ctx[n]->scratchpad_ptr(s, 2);
+			idx3[n] = ctx[n]->scratchpad_ptr(s, 3);
+		}
+	}
+}
+
+template <size_t MEMORY, size_t ITER, size_t VERSION>
+template <size_t N>
+void cn_slow_hash<MEMORY, ITER, VERSION>::hardware_hash_multi(cn_slow_hash* const* ctx, const void* const* in, size_t len, void* const* out)
+{
+	for(size_t n = 0; n < N; n++)
+	{
+		keccak((const uint8_t*)in[n], len, ctx[n]->spad.as_byte(), 200);
+		if(VERSION <= 1)
+			ctx[n]->explode_scratchpad_hard();
+		else
+			ctx[n]->explode_scratchpad_3();
+	}
+
+	if(VERSION <= 1)
+		inner_hash_multi<N>(ctx);
+	else
+		inner_hash_3_multi<N>(ctx);
+
+	for(size_t n = 0; n < N; n++)
+	{
+		ctx[n]->implode_scratchpad_hard();
+		keccakf(ctx[n]->spad.as_uqword());
+		if(VERSION <= 1)
+			final_hash(ctx[n]->spad.as_byte(), (uint8_t*)out[n]);
+		else
+			memcpy(out[n], ctx[n]->spad.as_byte(), 32);
+	}
+}
+
 template class cn_v1_hash_t;
 template class cn_v2_hash_t;
 template class cn_v3_hash_t;
+
+template void cn_v1_hash_t::hardware_hash_multi<2>(cn_v1_hash_t* const*, const void* const*, size_t, void* const*);
+template void cn_v1_hash_t::hardware_hash_multi<4>(cn_v1_hash_t* const*, const void* const*, size_t, void* const*);
+template void cn_v2_hash_t::hardware_hash_multi<2>(cn_v2_hash_t* const*, const void* const*, size_t, void* const*);
+template void cn_v2_hash_t::hardware_hash_multi<4>(cn_v2_hash_t* const*, const void* const*, size_t, void* const*);
+template void cn_v3_hash_t::hardware_hash_multi<2>(cn_v3_hash_t* const*, const void* const*, size_t, void* const*);
+template void cn_v3_hash_t::hardware_hash_multi<4>(cn_v3_hash_t* const*, const void* const*, size_t, void* const*);
 #endif
@@ -47,6 +47,7 @@
 #include "include_base_utils.h"
 #include "crypto/pow_hash/cn_slow_hash.hpp"
 #include "crypto/crypto.h"
+#include "common/int-util.h"
 #include "crypto/hash.h"
 #include "cryptonote_config.h"
 #include "cryptonote_format_utils.h"
@@ -139,14 +140,16 @@ namespace cryptonote
 //---------------------------------------------------------------
 void get_transaction_prefix_hash(const transaction_prefix &tx, crypto::hash &h)
 {
-	std::ostringstream s;
+	blobdata blob;
+	blob.reserve(256);
 
 	if(tx.version >= 3)
-		s << TX_FORK_ID_STR;
+		blob = TX_FORK_ID_STR;
 
-	binary_archive<true> a(s);
+	::serialization::blob_ostream s(blob);
+	binary_span_archive<true> a(s);
 	::serialization::serialize(a, const_cast<transaction_prefix &>(tx));
-	crypto::cn_fast_hash(s.str().data(), s.str().size(), h);
+	crypto::cn_fast_hash(blob.data(), blob.size(), h);
 }
 //---------------------------------------------------------------
 crypto::hash get_transaction_prefix_hash(const transaction_prefix &tx)
@@ -204,9 +207,8 @@ bool expand_transaction_1(transaction &tx, bool base_only)
 //---------------------------------------------------------------
 bool parse_and_validate_tx_from_blob(const blobdata &tx_blob, transaction &tx)
 {
-	std::stringstream ss;
-	ss << tx_blob;
-	binary_archive<false> ba(ss);
+	::serialization::span_istream ss(epee::to_byte_span(epee::to_span(tx_blob)));
+	binary_span_archive<false> ba(ss);
 	bool r = ::serialization::serialize(ba, tx);
 	GULPS_CHECK_AND_ASSERT_MES(r, false, "Failed to parse transaction from blob");
 	GULPS_CHECK_AND_ASSERT_MES(expand_transaction_1(tx, false), false, "Failed to expand transaction data");
@@ -216,9 +218,8 @@ bool parse_and_validate_tx_from_blob(const blobdata &tx_blob, transaction &tx)
 //---------------------------------------------------------------
 bool parse_and_validate_tx_base_from_blob(const blobdata &tx_blob, transaction &tx)
 {
-	std::stringstream ss;
-	ss << tx_blob;
-	binary_archive<false> ba(ss);
+	::serialization::span_istream ss(epee::to_byte_span(epee::to_span(tx_blob)));
+	binary_span_archive<false> ba(ss);
 	bool r = tx.serialize_base(ba);
 	GULPS_CHECK_AND_ASSERT_MES(r, false, "Failed to parse transaction from blob");
 	GULPS_CHECK_AND_ASSERT_MES(expand_transaction_1(tx, true), false, "Failed to expand transaction data");
@@ -227,9 +228,8 @@ bool parse_and_validate_tx_base_from_blob(const blobdata &tx_blob, transaction &
 //---------------------------------------------------------------
 bool parse_and_validate_tx_from_blob(const blobdata &tx_blob, transaction &tx, crypto::hash &tx_hash, crypto::hash &tx_prefix_hash)
 {
-	std::stringstream ss;
-	ss << tx_blob;
-	binary_archive<false> ba(ss);
+	::serialization::span_istream ss(epee::to_byte_span(epee::to_span(tx_blob)));
+	binary_span_archive<false> ba(ss);
 	bool r = ::serialization::serialize(ba, tx);
 	GULPS_CHECK_AND_ASSERT_MES(r, false, "Failed to parse transaction from blob");
 	GULPS_CHECK_AND_ASSERT_MES(expand_transaction_1(tx, false), false, "Failed to expand transaction data");
@@ -869,13 +869,14 @@ bool calculate_transaction_hash(const transaction &t, crypto::hash &res, size_t
 
 	// base rct
 	{
-		std::stringstream ss;
-		binary_archive<true> ba(ss);
+		blobdata blob;
+		::serialization::blob_ostream os(blob);
+		binary_span_archive<true> ba(os);
 		const size_t inputs = t.vin.size();
 		const size_t outputs = t.vout.size();
 		bool r = tt.rct_signatures.serialize_rctsig_base(ba, inputs, outputs);
 		GULPS_CHECK_AND_ASSERT_MES(r, false, "Failed to serialize rct signatures base");
-		cryptonote::get_blob_hash(ss.str(), hashes[1]);
+		cryptonote::get_blob_hash(blob, hashes[1]);
 	}
 
 	// prunable rct
@@ -885,14 +886,15 @@ bool calculate_transaction_hash(const transaction &t, crypto::hash &res, size_t
 	}
 	else
 	{
-		std::stringstream ss;
-		binary_archive<true> ba(ss);
+		blobdata blob;
+		::serialization::blob_ostream os(blob);
+		binary_span_archive<true> ba(os);
 		const size_t inputs = t.vin.size();
 		const size_t outputs = t.vout.size();
 		const size_t mixin = t.vin.empty() ? 0 : t.vin[0].type() == typeid(txin_to_key) ? boost::get<txin_to_key>(t.vin[0]).key_offsets.size() - 1 : 0;
 		bool r = tt.rct_signatures.p.serialize_rctsig_prunable(ba, t.rct_signatures.type, inputs, outputs, mixin);
 		GULPS_CHECK_AND_ASSERT_MES(r, false, "Failed to serialize rct signatures prunable");
-		cryptonote::get_blob_hash(ss.str(), hashes[2]);
+		cryptonote::get_blob_hash(blob, hashes[2]);
 	}
 
 	// the tx hash is the hash of the 3 hashes
@@ -989,27 +991,103 @@ crypto::hash get_block_hash(const block &b)
 //---------------------------------------------------------------
 bool get_block_longhash(network_type nettype, const block &b, cn_pow_hash_v2 &ctx, crypto::hash &res)
 {
-	block b_local = b; //workaround to avoid const errors with do_serialize
-	blobdata bd = get_block_hashing_blob(b);
+	block_hashing_template(nettype, b).get_longhash(ctx, res);
+	return true;
+}
+//---------------------------------------------------------------
+block_hashing_template::block_hashing_template(network_type nettype, const block &b)
+{
+	// same layout as get_block_hashing_blob, the header ends with the nonce
+	m_blob = t_serializable_object_to_blob(static_cast<const block_header &>(b));
+	m_nonce_offset = m_blob.size() - sizeof(uint32_t);
+	crypto::hash tree_root_hash = get_tx_tree_hash(b);
+	m_blob.append(reinterpret_cast<const char *>(&tree_root_hash), sizeof(tree_root_hash));
+	m_blob.append(tools::get_varint_data(b.tx_hashes.size() + 1));
 
 	uint8_t cn_heavy_v = get_fork_v(nettype, FORK_POW_CN_HEAVY);
 	uint8_t cn_gpu_v = get_fork_v(nettype, FORK_POW_CN_GPU);
 
-	if(cn_gpu_v != hardfork_conf::FORK_ID_DISABLED && b_local.major_version >= cn_gpu_v)
+	if(cn_gpu_v != hardfork_conf::FORK_ID_DISABLED && b.major_version >= cn_gpu_v)
+		m_pow = pow_cn_gpu;
+	else if(cn_heavy_v != hardfork_conf::FORK_ID_DISABLED && b.major_version >= cn_heavy_v)
+		m_pow = pow_cn_heavy;
+	else
+		m_pow = pow_cn_v1;
+}
+//---------------------------------------------------------------
+void block_hashing_template::set_nonce(uint32_t nonce)
+{
+	nonce = SWAP32LE(nonce);
+	memcpy(&m_blob[m_nonce_offset], &nonce, sizeof(nonce));
+}
+//---------------------------------------------------------------
+void block_hashing_template::get_longhash(cn_pow_hash_v2 &ctx, crypto::hash &res) const
+{
+	switch(m_pow)
+	{
+	case pow_cn_gpu:
 	{
 		cn_pow_hash_v3 ctx_v3 = cn_pow_hash_v3::make_borrowed_v3(ctx);
-		ctx_v3.hash(bd.data(), bd.size(), res.data);
+		ctx_v3.hash(m_blob.data(), m_blob.size(), res.data);
+		break;
 	}
-	else if(cn_heavy_v != hardfork_conf::FORK_ID_DISABLED && b_local.major_version >= cn_heavy_v)
+	case pow_cn_heavy:
+		ctx.hash(m_blob.data(), m_blob.size(), res.data);
+		break;
+	default:
 	{
-		ctx.hash(bd.data(), bd.size(), res.data);
+		cn_pow_hash_v1 ctx_v1 = cn_pow_hash_v1::make_borrowed(ctx);
+		ctx_v1.hash(m_blob.data(), m_blob.size(), res.data);
+		break;
 	}
-	else
+	}
+}
+//---------------------------------------------------------------
+void block_hashing_template::get_longhash_multi(const block_hashing_template *tpl, cn_pow_hash_v2 *const *ctx, crypto::hash *res, size_t ways)
+{
+	assert(ways <= cn_pow_hash_v2::max_ways);
+	const void *in[cn_pow_hash_v2::max_ways];
+	void *out[cn_pow_hash_v2::max_ways];
+	for(size_t i = 0; i < ways; i++)
 	{
-		cn_pow_hash_v1 ctx_v1 = cn_pow_hash_v1::make_borrowed(ctx);
-		ctx_v1.hash(bd.data(), bd.size(), res.data);
+		assert(tpl[i].m_pow == tpl[0].m_pow && tpl[i].m_blob.size() == tpl[0].m_blob.size());
+		in[i] = tpl[i].m_blob.data();
+		out[i] = res[i].data;
+	}
+
+	const size_t len = tpl[0].m_blob.size();
+	switch(tpl[0].m_pow)
+	{
+	case pow_cn_gpu:
+	{
+		std::vector<cn_pow_hash_v3> borrowed;
+		cn_pow_hash_v3 *ctx_v3[cn_pow_hash_v3::max_ways];
+		borrowed.reserve(ways);
+		for(size_t i = 0; i < ways; i++)
+		{
+			borrowed.emplace_back(cn_pow_hash_v3::make_borrowed_v3(*ctx[i]));
+			ctx_v3[i] = &borrowed[i];
+		}
+		cn_pow_hash_v3::hash_multi(ctx_v3, in, len, out, ways);
+		break;
+	}
+	case pow_cn_heavy:
+		cn_pow_hash_v2::hash_multi(ctx, in, len, out, ways);
+		break;
+	default:
+	{
+		std::vector<cn_pow_hash_v1> borrowed;
+		cn_pow_hash_v1 *ctx_v1[cn_pow_hash_v1::max_ways];
+		borrowed.reserve(ways);
+		for(size_t i = 0; i < ways; i++)
+		{
+			borrowed.emplace_back(cn_pow_hash_v1::make_borrowed(*ctx[i]));
+			ctx_v1[i] = &borrowed[i];
+		}
+		cn_pow_hash_v1::hash_multi(ctx_v1, in, len, out, ways);
+		break;
+	}
 	}
-	return true;
 }
 //---------------------------------------------------------------
 std::vector<uint64_t> relative_output_offsets_to_absolute(const std::vector<uint64_t> &off)
@@ -1034,9 +1112,8 @@ std::vector<uint64_t> absolute_output_offsets_to_relative(const std::vector<uint
 //---------------------------------------------------------------
 bool parse_and_validate_block_from_blob(const blobdata &b_blob, block &b)
 {
-	std::stringstream ss;
-	ss << b_blob;
-	binary_archive<false> ba(ss);
+	::serialization::span_istream ss(epee::to_byte_span(epee::to_span(b_blob)));
+	binary_span_archive<false> ba(ss);
 	bool r = ::serialization::serialize(ba, b);
 	GULPS_CHECK_AND_ASSERT_MES(r, false, "Failed to parse block from blob");
 	b.invalidate_hashes();
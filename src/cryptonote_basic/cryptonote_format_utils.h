@@ -129,6 +129,36 @@ bool calculate_block_hash(const block &b, crypto::hash &res);
 bool get_block_hash(const block &b, crypto::hash &res);
 crypto::hash get_block_hash(const block &b);
 bool get_block_longhash(network_type nettype, const block &b, cn_pow_hash_v2 &ctx, crypto::hash &res);
+
+/*! Hashing blob of a block, built once per block template. The nonce is the
+ *  last header field, so trying another nonce patches 4 bytes of the cached
+ *  blob instead of serializing the header and the tx tree hash again.
+ */
+class block_hashing_template
+{
+  public:
+	block_hashing_template() : m_nonce_offset(0), m_pow(pow_cn_v1) {}
+	block_hashing_template(network_type nettype, const block &b);
+
+	void set_nonce(uint32_t nonce);
+	const blobdata &blob() const { return m_blob; }
+	size_t nonce_offset() const { return m_nonce_offset; }
+	void get_longhash(cn_pow_hash_v2 &ctx, crypto::hash &res) const;
+	// Hashes `ways` consecutive copies of one template (differing only in nonce) at once, see cn_slow_hash::hash_multi
+	static void get_longhash_multi(const block_hashing_template *tpl, cn_pow_hash_v2 *const *ctx, crypto::hash *res, size_t ways);
+
+  private:
+	enum pow_variant
+	{
+		pow_cn_v1,
+		pow_cn_heavy,
+		pow_cn_gpu
+	};
+
+	blobdata m_blob;
+	size_t m_nonce_offset;
+	pow_variant m_pow;
+};
 bool parse_and_validate_block_from_blob(const blobdata &b_blob, block &b);
 bool get_inputs_money_amount(const transaction &tx, uint64_t &money);
 uint64_t get_outs_money_amount(const transaction &tx);
@@ -150,11 +180,10 @@ std::string print_money(uint64_t amount, unsigned int decimal_point = -1);
 template <class t_object>
 bool t_serializable_object_to_blob(const t_object &to, blobdata &b_blob)
 {
-	std::stringstream ss;
-	binary_archive<true> ba(ss);
-	bool r = ::serialization::serialize(ba, const_cast<t_object &>(to));
-	b_blob = ss.str();
-	return r;
+	b_blob.clear();
+	::serialization::blob_ostream os(b_blob);
+	binary_span_archive<true> ba(os);
+	return ::serialization::serialize(ba, const_cast<t_object &>(to));
 }
 //---------------------------------------------------------------
 template <class t_object>
@@ -213,11 +242,12 @@ void get_hash_stats(uint64_t &tx_hashes_calculated, uint64_t &tx_hashes_cached,
 inline blobdata get_pruned_tx_blob(transaction &tx)
 {
 	GULPS_CAT_MAJOR("formt_utils");
-	std::stringstream ss;
-	binary_archive<true> ba(ss);
+	blobdata blob;
+	::serialization::blob_ostream os(blob);
+	binary_span_archive<true> ba(os);
 	bool r = tx.serialize_base(ba);
 	GULPS_CHECK_AND_ASSERT_MES(r, cryptonote::blobdata(), "Failed to serialize rct signatures base");
-	return ss.str();
+	return blob;
 }
 //------------------------------------------------------------------------------------------------------------------------------
 inline blobdata get_pruned_tx_blob(const blobdata &blobdata)
@@ -47,6 +47,7 @@
 
 #include "boost/logic/tribool.hpp"
 #include "common/command_line.h"
+#include "crypto/pow_hash/cn_pow_ctx_pool.hpp"
 #include "cryptonote_basic_impl.h"
 #include "cryptonote_format_utils.h"
 #include "file_io_utils.h"
@@ -61,6 +62,7 @@
 #include <boost/interprocess/detail/atomic.hpp>
 #include <boost/limits.hpp>
 #include <boost/utility/value_init.hpp>
+#include <chrono>
 #include <numeric>
 #include <sstream>
 
@@ -104,6 +106,44 @@ const command_line::arg_descriptor<bool> arg_bg_mining_ignore_battery = {"bg-min
 const command_line::arg_descriptor<uint64_t> arg_bg_mining_min_idle_interval_seconds = {"bg-mining-min-idle-interval", "Specify min lookback interval in seconds for determining idle state", miner::BACKGROUND_MINING_DEFAULT_MIN_IDLE_INTERVAL_IN_SECONDS, true};
 const command_line::arg_descriptor<uint16_t> arg_bg_mining_idle_threshold_percentage = {"bg-mining-idle-threshold", "Specify minimum avg idle percentage over lookback interval", miner::BACKGROUND_MINING_DEFAULT_IDLE_THRESHOLD_PERCENTAGE, true};
 const command_line::arg_descriptor<uint16_t> arg_bg_mining_miner_target_percentage = {"bg-mining-miner-target", "Specify maximum percentage cpu use by miner(s)", miner::BACKGROUND_MINING_DEFAULT_MINING_TARGET_PERCENTAGE, true};
+
+// Hashes the template for a fixed time at every width hash_multi supports and returns the
+// fastest one. A few hashes are too noisy to tell widths apart, a second per width is a few
+// hundred. All threads calibrate at once, so the result accounts for shared cache pressure.
+size_t calibrate_hash_ways(block_hashing_template *lanes, cn_pow_hash_v2 *const *ctx, const volatile uint32_t &stop)
+{
+	GULPS_CAT_MAJOR("crybas_miner");
+	constexpr size_t max_ways = cn_pow_hash_v2::max_ways;
+	const std::chrono::steady_clock::duration time_per_width = std::chrono::seconds(1);
+	crypto::hash h[max_ways];
+
+	// first touch of the scratchpads would otherwise be billed to the first width
+	block_hashing_template::get_longhash_multi(lanes, ctx, h, max_ways);
+
+	size_t best_ways = 1;
+	double best_rate = 0.0;
+	for(size_t ways = 1; ways <= max_ways && !stop; ways *= 2)
+	{
+		const auto start = std::chrono::steady_clock::now();
+		std::chrono::steady_clock::duration elapsed;
+		size_t hashes = 0;
+		do
+		{
+			block_hashing_template::get_longhash_multi(lanes, ctx, h, ways);
+			hashes += ways;
+			elapsed = std::chrono::steady_clock::now() - start;
+		} while(elapsed < time_per_width && !stop);
+
+		const double rate = hashes / std::max(std::chrono::duration<double>(elapsed).count(), 1e-9);
+		GULPSF_LOG_L2("Hashing {} nonce(s) at a time: {} hashes, {:.2f} H/s", ways, hashes, rate);
+		if(rate > best_rate)
+		{
+			best_rate = rate;
+			best_ways = ways;
+		}
+	}
+	return best_ways;
+}
 }
 
 miner::miner(i_miner_handler *phandler) : m_stop(1),
@@ -400,11 +440,13 @@ bool miner::stop()
 //-----------------------------------------------------------------------------------------------------
 bool miner::find_nonce_for_given_block(network_type nettype, block &bl, const difficulty_type &diffic, uint64_t height)
 {
-	cn_pow_hash_v2 hash_ctx;
+	cn_pow_ctx_pool::lease hash_ctx = cn_pow_ctx_pool::instance().acquire();
+	block_hashing_template hashing_template(nettype, bl);
 	for(; bl.nonce != std::numeric_limits<uint32_t>::max(); bl.nonce++)
 	{
 		crypto::hash h;
-		get_block_longhash(nettype, bl, hash_ctx, h);
+		hashing_template.set_nonce(bl.nonce);
+		hashing_template.get_longhash(*hash_ctx, h);
 
 		if(check_hash(h, diffic))
 		{
@@ -459,7 +501,13 @@ bool miner::worker_thread()
 	difficulty_type local_diff = 0;
 	uint32_t local_template_ver = 0;
 	block b;
-	cn_pow_hash_v2 hash_ctx;
+	// one template copy and one context per interleaved nonce, the width is picked by
+	// calibrate_hash_ways whenever the block version (and so the PoW variant) changes
+	block_hashing_template lanes[cn_pow_hash_v2::max_ways];
+	cn_pow_ctx_pool::lease hash_ctx[cn_pow_hash_v2::max_ways];
+	cn_pow_hash_v2 *ctx_ptr[cn_pow_hash_v2::max_ways];
+	size_t ways = 0;
+	uint8_t ways_major_version = 0;
 
 	while(!m_stop)
 	{
@@ -492,6 +540,31 @@ bool miner::worker_thread()
 			CRITICAL_REGION_END();
 			local_template_ver = m_template_no;
 			nonce = m_starter_nonce + th_local_index;
+			lanes[0] = block_hashing_template(m_nettype, b);
+
+			if(ways == 0 || ways_major_version != b.major_version)
+			{
+				for(size_t i = 0; i < cn_pow_hash_v2::max_ways; i++)
+				{
+					if(i > 0)
+						lanes[i] = lanes[0];
+					hash_ctx[i] = cn_pow_ctx_pool::instance().acquire();
+					ctx_ptr[i] = &*hash_ctx[i];
+				}
+
+				ways = calibrate_hash_ways(lanes, ctx_ptr, m_stop);
+				ways_major_version = b.major_version;
+				GULPSF_LOG_L1("Miner thread [{}] hashes {} nonce(s) at a time", th_local_index, ways);
+
+				// give back the contexts this width does not need
+				for(size_t i = ways; i < cn_pow_hash_v2::max_ways; i++)
+					hash_ctx[i] = cn_pow_ctx_pool::lease();
+			}
+			else
+			{
+				for(size_t i = 1; i < ways; i++)
+					lanes[i] = lanes[0];
+			}
 		}
 
 		if(!local_template_ver) //no any set_block_template call
@@ -501,13 +574,20 @@ bool miner::worker_thread()
 			continue;
 		}
 
-		b.nonce = nonce;
-		crypto::hash h;
-		get_block_longhash(m_nettype, b, hash_ctx, h);
+		crypto::hash h[cn_pow_hash_v2::max_ways];
+		for(size_t i = 0; i < ways; i++)
+			lanes[i].set_nonce(nonce + i * m_threads_total);
+		block_hashing_template::get_longhash_multi(lanes, ctx_ptr, h, ways);
+
+		size_t lane = 0;
+		while(lane < ways && !check_hash(h[lane], local_diff))
+			++lane;
 
-		if(check_hash(h, local_diff))
+		if(lane < ways)
 		{
 			//we lucky!
+			b.nonce = nonce + lane * m_threads_total;
+			b.invalidate_hashes();
 			++m_config.current_extra_message_index;
 			GULPSF_PRINT_CLR(gulps::COLOR_GREEN, "Found block for difficulty: {}", local_diff);
 			if(!m_phandler->handle_block_found(b))
@@ -521,8 +601,8 @@ bool miner::worker_thread()
 					epee::serialization::store_t_to_json_file(m_config, m_config_folder_path + "/" + MINER_CONFIG_FILE_NAME);
 			}
 		}
-		nonce += m_threads_total;
-		++m_hashes;
+		nonce += ways * m_threads_total;
+		m_hashes += ways;
 	}
 	GULPSF_PRINT("Miner thread stopped [{}]", th_local_index);
 	return true;
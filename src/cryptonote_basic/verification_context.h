@@ -45,6 +45,9 @@
 // Parts of this file are originally copyright (c) 2012-2013 The Cryptonote developers
 
 #pragma once
+
+#include "crypto/hash.h"
+
 namespace cryptonote
 {
 /************************************************************************/
@@ -64,6 +67,7 @@ struct tx_verification_context
 	bool m_overspend;
 	bool m_fee_too_low;
 	bool m_not_rct;
+	crypto::hash m_tx_hash; //id of the tx, null if it could not be parsed
 };
 
 struct block_verification_context
@@ -83,6 +83,8 @@
 
 #define CRYPTONOTE_MEMPOOL_TX_LIVETIME 86400				 //seconds, one day
 #define CRYPTONOTE_MEMPOOL_TX_FROM_ALT_BLOCK_LIVETIME 604800 //seconds, one week
+#define CRYPTONOTE_RCT_VER_CACHE_SIZE 8192 //txes whose ringct signatures need no second check when they come in a block
+#define CRYPTONOTE_RCT_POINT_CACHE_SIZE 8192 //decompressed ring member keys and commitments kept for signature checks
 
 #define COMMAND_RPC_GET_BLOCKS_FAST_MAX_COUNT 250
 
@@ -106,7 +108,13 @@
 #define P2P_IDLE_CONNECTION_KILL_INTERVAL (5 * 60) //5 minutes
 
 #define P2P_SUPPORT_FLAG_FLUFFY_BLOCKS 0x01
-#define P2P_SUPPORT_FLAGS P2P_SUPPORT_FLAG_FLUFFY_BLOCKS
+#define P2P_SUPPORT_FLAG_TX_INVENTORY 0x02
+#define P2P_SUPPORT_FLAGS (P2P_SUPPORT_FLAG_FLUFFY_BLOCKS | P2P_SUPPORT_FLAG_TX_INVENTORY)
+
+#define P2P_TX_INVENTORY_MAX_HASHES 1024 // per NOTIFY_TX_INVENTORY / NOTIFY_REQUEST_TX message
+#define P2P_TX_KNOWN_FILTER_SIZE 4096	 // txids per generation of the per peer filter, at most 4096
+#define P2P_TX_REQUEST_TIMEOUT 30		 // seconds before a tx is asked from another peer
+#define P2P_TX_REQUEST_MAX_ANNOUNCERS 8 // peers remembered per requested tx to ask next on timeout
 
 #define ALLOW_DEBUG_COMMANDS
 
@@ -57,6 +57,7 @@
 #include "common/perf_timer.h"
 #include "common/threadpool.h"
 #include "crypto/hash.h"
+#include "crypto/pow_hash/cn_pow_ctx_pool.hpp"
 #include "cryptonote_basic/tx_extra.h"
 #include "cryptonote_basic/cryptonote_basic_impl.h"
 #include "cryptonote_basic/cryptonote_boost_serialization.h"
@@ -69,6 +70,7 @@
 #include "include_base_utils.h"
 #include "misc_language.h"
 #include "profile_tools.h"
+#include "ringct/point_cache.h"
 #include "ringct/rctSigs.h"
 #include "tx_pool.h"
 #include "warnings.h"
@@ -103,6 +105,9 @@ DISABLE_VS_WARNINGS(4267)
 constexpr uint64_t MAINNET_HARDFORK_V3_HEIGHT = 116520;
 constexpr uint64_t MAINNET_HARDFORK_V6_HEIGHT = 228750;
 
+// the largest difficulty calculation window, plus the depth of reorgs the window follows without a reload
+constexpr size_t difficulty_window_capacity = common_config::DIFFICULTY_BLOCKS_COUNT_V1 + 64;
+
 static const struct
 {
 	uint8_t version;
@@ -156,8 +161,8 @@ static const struct
 };
 
 //------------------------------------------------------------------
-Blockchain::Blockchain(tx_memory_pool &tx_pool) : m_db(), m_tx_pool(tx_pool), m_hardfork(NULL), m_timestamps_and_difficulties_height(0), m_current_block_cumul_sz_limit(0), m_current_block_cumul_sz_median(0),
-												  m_enforce_dns_checkpoints(false), m_max_prepare_blocks_threads(4), m_db_blocks_per_sync(1), m_db_sync_mode(db_async), m_db_default_sync(false), m_fast_sync(true), m_show_time_stats(false), m_sync_counter(0), m_cancel(false)
+Blockchain::Blockchain(tx_memory_pool &tx_pool) : m_db(), m_tx_pool(tx_pool), m_hardfork(NULL), m_current_block_cumul_sz_limit(0), m_current_block_cumul_sz_median(0), m_rct_ver_cache(CRYPTONOTE_RCT_VER_CACHE_SIZE),
+												  m_enforce_dns_checkpoints(false), m_max_prepare_blocks_threads(4), m_db_blocks_per_sync(1), m_db_sync_mode(db_async), m_db_default_sync(false), m_fast_sync(true), m_show_time_stats(false), m_key_image_index_chain(true), m_sync_counter(0), m_difficulty_window(difficulty_window_capacity), m_cancel(false)
 {
 	GULPS_LOG_L3("Blockchain::", __func__);
 }
@@ -172,6 +177,19 @@ bool Blockchain::have_tx(const crypto::hash &id) const
 	return m_db->tx_exists(id);
 }
 //------------------------------------------------------------------
+void Blockchain::get_key_images_status(const std::vector<crypto::key_image> &key_images, std::vector<key_image_index::spent_status> &status) const
+{
+	GULPS_LOG_L3("Blockchain::", __func__);
+	m_key_image_index.get_status(key_images, status);
+	if(m_key_image_index_chain)
+		return;
+
+	// the index only knows the pool spends, a chain spend takes precedence as in the index
+	for(size_t n = 0; n < key_images.size(); ++n)
+		if(have_tx_keyimg_as_spent(key_images[n]))
+			status[n] = key_image_index::SPENT_IN_CHAIN;
+}
+//------------------------------------------------------------------
 bool Blockchain::have_tx_keyimg_as_spent(const crypto::key_image &key_im) const
 {
 	GULPS_LOG_L3("Blockchain::", __func__);
@@ -499,11 +517,21 @@ bool Blockchain::init(BlockchainDB *db, const network_type nettype, bool offline
 	}
 	if(num_popped_blocks > 0)
 	{
-		m_timestamps_and_difficulties_height = 0;
+		m_difficulty_window.clear();
 		m_hardfork->reorganize_from_chain_height(get_current_blockchain_height());
 		m_tx_pool.on_blockchain_dec(m_db->height() - 1, get_tail_id());
 	}
 
+	m_key_image_index.clear_chain();
+	if(m_key_image_index_chain)
+	{
+		m_db->for_all_key_images([this](const crypto::key_image &ki) {
+			m_key_image_index.add_chain(ki);
+			return true;
+		});
+		GULPSF_LOG_L1("Key image index loaded, {} spent key images", m_key_image_index.size());
+	}
+
 	update_next_cumulative_size_limit();
 	return true;
 }
@@ -596,14 +624,21 @@ block Blockchain::pop_block_from_blockchain()
 	GULPS_LOG_L3("Blockchain::", __func__);
 	CRITICAL_REGION_LOCAL(m_blockchain_lock);
 
-	m_timestamps_and_difficulties_height = 0;
-
 	block popped_block;
 	std::vector<transaction> popped_txs;
 
 	try
 	{
 		m_db->pop_block(popped_block, popped_txs);
+		if(m_key_image_index_chain)
+		{
+			for(const transaction &tx : popped_txs)
+				m_key_image_index.remove_chain(tx);
+		}
+		if(m_difficulty_window.height() == m_db->height() + 1 && m_difficulty_window.size() > 0)
+			m_difficulty_window.pop();
+		else
+			m_difficulty_window.clear();
 	}
 	// anything that could cause this to throw is likely catastrophic,
 	// so we re-throw
@@ -653,9 +688,10 @@ bool Blockchain::reset_and_set_genesis_block(const block &b)
 {
 	GULPS_LOG_L3("Blockchain::", __func__);
 	CRITICAL_REGION_LOCAL(m_blockchain_lock);
-	m_timestamps_and_difficulties_height = 0;
+	m_difficulty_window.clear();
 	m_alternative_chains.clear();
 	m_db->reset();
+	m_key_image_index.clear_chain();
 	m_hardfork->init();
 
 	block_verification_context bvc = boost::value_initialized<block_verification_context>();
@@ -821,63 +857,52 @@ difficulty_type Blockchain::get_difficulty_for_next_block()
 	if(m_nettype == MAINNET && height >= MAINNET_HARDFORK_V6_HEIGHT && height <= (MAINNET_HARDFORK_V6_HEIGHT + common_config::DIFFICULTY_BLOCKS_COUNT_V4))
 		return (difficulty_type)480000000;
 
-	size_t block_count;
-	if(check_hard_fork_feature(FORK_V4_DIFFICULTY))
-		block_count = common_config::DIFFICULTY_BLOCKS_COUNT_V4;
-	else if(check_hard_fork_feature(FORK_V3_DIFFICULTY))
-		block_count = common_config::DIFFICULTY_BLOCKS_COUNT_V3;
-	else if(check_hard_fork_feature(FORK_V2_DIFFICULTY))
-		block_count = common_config::DIFFICULTY_BLOCKS_COUNT_V2;
-	else
-		block_count = common_config::DIFFICULTY_BLOCKS_COUNT_V1;
+	const size_t block_count = get_difficulty_blocks_count();
+	const uint64_t begin = std::max<uint64_t>(1, height - std::min<uint64_t>(height, block_count)); // skip the genesis block
 
-	// ND: Speedup
-	// 1. Keep a list of the last 735 (or less) blocks that is used to compute difficulty,
-	//    then when the next block difficulty is queried, push the latest height data and
-	//    pop the oldest one from the list. This only requires 1x read per height instead
-	//    of doing 735 (DIFFICULTY_BLOCKS_COUNT).
-	if(m_timestamps_and_difficulties_height != 0 && ((height - m_timestamps_and_difficulties_height) == 1) && timestamps.size() >= block_count && m_difficulties.size() >= block_count)
+	// The window follows the chain through pushes and pops. It is reloaded, a little deeper
+	// than needed so short reorgs can pop without a reload, when it lost track of the chain
+	// or the DB was changed behind Blockchain's back.
+	if(begin < height)
 	{
-		uint64_t index = height - 1;
-		m_timestamps.push_back(m_db->get_block_timestamp(index));
-		m_difficulties.push_back(m_db->get_block_cumulative_difficulty(index));
-
-		while(m_timestamps.size() > block_count)
-			m_timestamps.erase(m_timestamps.begin());
-		while(m_difficulties.size() > block_count)
-			m_difficulties.erase(m_difficulties.begin());
-
-		m_timestamps_and_difficulties_height = height;
-		timestamps = m_timestamps;
-		difficulties = m_difficulties;
-	}
-	else
-	{
-		size_t offset = height - std::min<size_t>(height, block_count);
-		if(offset == 0)
-			++offset;
-
-		timestamps.clear();
-		difficulties.clear();
-		for(; offset < height; offset++)
+		bool in_sync = m_difficulty_window.height() == height && m_difficulty_window.covers(begin, height);
+		if(in_sync)
+			in_sync = m_difficulty_window.back_timestamp() == m_db->get_block_timestamp(height - 1) &&
+					  m_difficulty_window.back_cumulative_difficulty() == m_db->get_block_cumulative_difficulty(height - 1);
+		if(!in_sync)
 		{
-			timestamps.push_back(m_db->get_block_timestamp(offset));
-			difficulties.push_back(m_db->get_block_cumulative_difficulty(offset));
+			const uint64_t load_begin = std::max<uint64_t>(1, height - std::min<uint64_t>(height, m_difficulty_window.capacity()));
+			m_difficulty_window.reset(load_begin);
+			for(uint64_t h = load_begin; h < height; ++h)
+				m_difficulty_window.push(m_db->get_block_timestamp(h), m_db->get_block_cumulative_difficulty(h));
 		}
-
-		m_timestamps_and_difficulties_height = height;
-		m_timestamps = timestamps;
-		m_difficulties = difficulties;
+		m_difficulty_window.copy(begin, height, timestamps, difficulties);
 	}
-
+	return next_difficulty(std::move(timestamps), std::move(difficulties));
+}
+//------------------------------------------------------------------
+size_t Blockchain::get_difficulty_blocks_count() const
+{
+	if(check_hard_fork_feature(FORK_V4_DIFFICULTY))
+		return common_config::DIFFICULTY_BLOCKS_COUNT_V4;
+	else if(check_hard_fork_feature(FORK_V3_DIFFICULTY))
+		return common_config::DIFFICULTY_BLOCKS_COUNT_V3;
+	else if(check_hard_fork_feature(FORK_V2_DIFFICULTY))
+		return common_config::DIFFICULTY_BLOCKS_COUNT_V2;
+	else
+		return common_config::DIFFICULTY_BLOCKS_COUNT_V1;
+}
+//------------------------------------------------------------------
+difficulty_type Blockchain::next_difficulty(std::vector<uint64_t> &&timestamps, std::vector<difficulty_type> &&cumulative_difficulties) const
+{
 	if(check_hard_fork_feature(FORK_V4_DIFFICULTY))
-		return next_difficulty_v4(timestamps, difficulties);
+		return next_difficulty_v4(std::move(timestamps), cumulative_difficulties);
 	else if(check_hard_fork_feature(FORK_V3_DIFFICULTY))
-		return next_difficulty_v3(timestamps, difficulties);
+		return next_difficulty_v3(timestamps, cumulative_difficulties);
 	else if(check_hard_fork_feature(FORK_V2_DIFFICULTY))
-		return next_difficulty_v2(timestamps, difficulties, common_config::DIFFICULTY_TARGET);
+		return next_difficulty_v2(std::move(timestamps), std::move(cumulative_difficulties), common_config::DIFFICULTY_TARGET);
 	else
-		return next_difficulty_v1(timestamps, difficulties, common_config::DIFFICULTY_TARGET);
+		return next_difficulty_v1(std::move(timestamps), std::move(cumulative_difficulties), common_config::DIFFICULTY_TARGET);
 }
 
 //------------------------------------------------------------------
@@ -895,8 +920,6 @@ bool Blockchain::rollback_blockchain_switching(std::list<block> &original_chain,
 		return true;
 	}
 
-	m_timestamps_and_difficulties_height = 0;
-
 	// remove blocks from blockchain until we get back to where we should be.
 	while(m_db->height() != rollback_height)
 	{
@@ -948,8 +971,6 @@ bool Blockchain::switch_to_alternative_blockchain(std::list<blocks_ext_by_hash::
 	GULPS_LOG_L3("Blockchain::", __func__);
 	CRITICAL_REGION_LOCAL(m_blockchain_lock);
 
-	m_timestamps_and_difficulties_height = 0;
-
 	// if empty alt chain passed (not sure how that could happen), return false
 	GULPS_CHECK_AND_ASSERT_MES(alt_chain.size(), false, "switch_to_alternative_blockchain: empty chain passed");
 
@@ -1109,15 +1130,7 @@ difficulty_type Blockchain::get_next_difficulty_for_alternative_chain(const std:
 	std::vector<uint64_t> timestamps;
 	std::vector<difficulty_type> cumulative_difficulties;
 
-	size_t block_count;
-	if(check_hard_fork_feature(FORK_V4_DIFFICULTY))
-		block_count = common_config::DIFFICULTY_BLOCKS_COUNT_V4;
-	else if(check_hard_fork_feature(FORK_V3_DIFFICULTY))
-		block_count = common_config::DIFFICULTY_BLOCKS_COUNT_V3;
-	else if(check_hard_fork_feature(FORK_V2_DIFFICULTY))
-		block_count = common_config::DIFFICULTY_BLOCKS_COUNT_V2;
-	else
-		block_count = common_config::DIFFICULTY_BLOCKS_COUNT_V1;
+	const size_t block_count = get_difficulty_blocks_count();
 
 	timestamps.reserve(block_count);
 	cumulative_difficulties.reserve(block_count);
@@ -1137,11 +1150,17 @@ difficulty_type Blockchain::get_next_difficulty_for_alternative_chain(const std:
 		if(!main_chain_start_offset)
 			++main_chain_start_offset; //skip genesis block
 
-		// get difficulties and timestamps from relevant main chain blocks
-		for(; main_chain_start_offset < main_chain_stop_offset; ++main_chain_start_offset)
+		// get difficulties and timestamps from relevant main chain blocks, the main
+		// chain's window still holds them if the alt chain branched off recently
+		if(m_difficulty_window.covers(main_chain_start_offset, main_chain_stop_offset))
+			m_difficulty_window.copy(main_chain_start_offset, main_chain_stop_offset, timestamps, cumulative_difficulties);
+		else
 		{
-			timestamps.push_back(m_db->get_block_timestamp(main_chain_start_offset));
-			cumulative_difficulties.push_back(m_db->get_block_cumulative_difficulty(main_chain_start_offset));
+			for(; main_chain_start_offset < main_chain_stop_offset; ++main_chain_start_offset)
+			{
+				timestamps.push_back(m_db->get_block_timestamp(main_chain_start_offset));
+				cumulative_difficulties.push_back(m_db->get_block_cumulative_difficulty(main_chain_start_offset));
+			}
 		}
 
 		// make sure we haven't accidentally grabbed too many blocks...maybe don't need this check?
@@ -1173,14 +1192,7 @@ difficulty_type Blockchain::get_next_difficulty_for_alternative_chain(const std:
 		}
 	}
 
-	if(check_hard_fork_feature(FORK_V4_DIFFICULTY))
-		return next_difficulty_v4(timestamps, cumulative_difficulties);
-	else if(check_hard_fork_feature(FORK_V3_DIFFICULTY))
-		return next_difficulty_v3(timestamps, cumulative_difficulties);
-	else if(check_hard_fork_feature(FORK_V2_DIFFICULTY))
-		return next_difficulty_v2(timestamps, cumulative_difficulties, common_config::DIFFICULTY_TARGET);
-	else
-		return next_difficulty_v1(timestamps, cumulative_difficulties, common_config::DIFFICULTY_TARGET);
+	return next_difficulty(std::move(timestamps), std::move(cumulative_difficulties));
 }
 //------------------------------------------------------------------
 // This function does a sanity check on basic things that all miner
@@ -1525,7 +1537,6 @@ bool Blockchain::handle_alternative_block(const block &b, const crypto::hash &id
 {
 	GULPS_LOG_L3("Blockchain::", __func__);
 	CRITICAL_REGION_LOCAL(m_blockchain_lock);
-	m_timestamps_and_difficulties_height = 0;
 	uint64_t block_height = get_block_height(b);
 	if(0 == block_height)
 	{
@@ -1636,7 +1647,7 @@ bool Blockchain::handle_alternative_block(const block &b, const crypto::hash &id
 		difficulty_type current_diff = get_next_difficulty_for_alternative_chain(alt_chain, bei);
 		GULPS_CHECK_AND_ASSERT_MES(current_diff, false, "!!!!!!! DIFFICULTY OVERHEAD !!!!!!!");
 		crypto::hash proof_of_work = null_hash;
-		get_block_longhash(m_nettype, bei.bl, m_pow_ctx, proof_of_work);
+		get_block_longhash(m_nettype, bei.bl, *cn_pow_ctx_pool::instance().acquire(), proof_of_work);
 		if(!check_hash(proof_of_work, current_diff))
 		{
 			GULPSF_VERIFY_ERR_BLK("Block with id: {}\nfor alternative chain, does not have enough proof of work: {}\nexpected difficulty: {}", id, proof_of_work, current_diff);
@@ -2255,7 +2266,7 @@ bool Blockchain::get_blocks(const t_ids_container &block_ids, t_blocks_container
 //TODO: return type should be void, throw on exception
 //       alternatively, return true only if no transactions missed
 template <class t_ids_container, class t_tx_container, class t_missed_container>
-bool Blockchain::get_transactions_blobs(const t_ids_container &txs_ids, t_tx_container &txs, t_missed_container &missed_txs) const
+bool Blockchain::get_transactions_blobs(const t_ids_container &txs_ids, t_tx_container &txs, t_missed_container &missed_txs, bool pruned) const
 {
 	GULPS_LOG_L3("Blockchain::", __func__);
 	CRITICAL_REGION_LOCAL(m_blockchain_lock);
@@ -2265,7 +2276,7 @@ bool Blockchain::get_transactions_blobs(const t_ids_container &txs_ids, t_tx_con
 		try
 		{
 			cryptonote::blobdata tx;
-			if(m_db->get_tx_blob(tx_hash, tx))
+			if(pruned ? m_db->get_pruned_tx_blob(tx_hash, tx) : m_db->get_tx_blob(tx_hash, tx))
 				txs.push_back(std::move(tx));
 			else
 				missed_txs.push_back(tx_hash);
@@ -2429,19 +2440,10 @@ bool Blockchain::find_blockchain_supplement_indexed(const uint64_t req_start_blo
 	std::vector<COMMAND_RPC_GET_BLOCKS_FAST::block_output_indices*> idx;
 	std::vector<std::pair<block, bool>> b;
 
-	struct tx_blob
-	{
-		cryptonote::blobdata blob;
-		size_t bi;
-		size_t txi;
-	};
-
-	std::vector<tx_blob> tx;
 	size_t max_conc = tools::get_max_concurrency();
 	ent.resize(max_conc);
 	idx.resize(max_conc);
 	b.resize(max_conc);
-	tx.resize(max_conc * 32);
 
 	tools::threadpool &tpool = tools::threadpool::getInstance();
 	tools::threadpool::waiter waiter;
@@ -2463,11 +2465,10 @@ bool Blockchain::find_blockchain_supplement_indexed(const uint64_t req_start_blo
 		}
 
 		for(size_t bi = 0; bi < batch_size; bi++)
-			tpool.submit(&waiter, [&, bi] { b[bi].second = parse_and_validate_block_from_blob(ent[bi]->block, b[bi].first); });
+			tpool.submit(&waiter, [&, bi] { b[bi].second = parse_and_validate_block_from_blob(ent[bi]->block, b[bi].first); }, tools::threadpool::PRIORITY_LOW);
 		waiter.wait();
 
-		size_t total_tx_cnt = 0;
-		size_t ttxi = 0;
+		// The DB keeps the pruned part of each tx as its own record, so it is copied out as is
 		for(size_t bi = 0; bi < batch_size; bi++)
 		{
 			GULPS_CHECK_AND_ASSERT_MES(b[bi].second, false, "internal error, invalid block");
@@ -2477,44 +2478,14 @@ bool Blockchain::find_blockchain_supplement_indexed(const uint64_t req_start_blo
 
 			get_tx_outputs_gindexs(get_transaction_hash(bl.miner_tx), idx[bi]->indices[0].indices);
 
-			total_tx_cnt += tx_cnt;
-			if(tx.size() < total_tx_cnt)
-				tx.resize(total_tx_cnt*2);
-
 			ent[bi]->txs.resize(tx_cnt);
-			for(size_t txi=0; txi < tx_cnt; txi++, ttxi++)
+			for(size_t txi=0; txi < tx_cnt; txi++)
 			{
-				GULPS_CHECK_AND_ASSERT_MES(m_db->get_tx_blob_indexed(bl.tx_hashes[txi], tx[ttxi].blob, idx[bi]->indices[txi+1].indices),
+				GULPS_CHECK_AND_ASSERT_MES(m_db->get_pruned_tx_blob_indexed(bl.tx_hashes[txi], ent[bi]->txs[txi], idx[bi]->indices[txi+1].indices),
 										   false, "internal error, transaction from block not found");
-				tx[ttxi].bi = bi;
-				tx[ttxi].txi = txi;
 			}
 		}
 
-		size_t txpt = total_tx_cnt / max_conc;
-		if(txpt > 0)
-		{
-			for(size_t thdi=0; thdi < max_conc; thdi++)
-			{
-				tpool.submit(&waiter, [&, thdi] {
-					for(size_t ttxi = thdi*txpt; ttxi < (thdi+1)*txpt; ttxi++)
-					{
-						size_t bi = tx[ttxi].bi;
-						size_t txi = tx[ttxi].txi;
-						ent[bi]->txs[txi] = cryptonote::get_pruned_tx_blob(tx[ttxi].blob);
-					}
-				});
-			}
-			waiter.wait();
-		}
-
-		for(size_t ttxi = txpt*max_conc; ttxi < total_tx_cnt; ttxi++)
-		{
-			size_t bi = tx[ttxi].bi;
-			size_t txi = tx[ttxi].txi;
-			ent[bi]->txs[txi] = cryptonote::get_pruned_tx_blob(tx[ttxi].blob);
-		}
-
 		for(size_t bi = 0; bi < batch_size; bi++)
 		{
 			size += ent[bi]->block.size();
@@ -3143,7 +3114,7 @@ bool Blockchain::check_tx_inputs(transaction &tx, tx_verification_context &tvc,
 			}
 		}
 
-		if(!rct::verRctNonSemanticsSimple(rv))
+		if(!ver_rct_non_semantics_cached(tx))
 		{
 			GULPS_VERIFY_ERR_TX("Failed to check ringct signatures!");
 			return false;
@@ -3202,7 +3173,7 @@ bool Blockchain::check_tx_inputs(transaction &tx, tx_verification_context &tvc,
 			}
 		}
 
-		if(!rct::verRct(rv, false))
+		if(!ver_rct_non_semantics_cached(tx))
 		{
 			GULPS_VERIFY_ERR_TX("Failed to check ringct signatures!");
 			return false;
@@ -3217,6 +3188,20 @@ bool Blockchain::check_tx_inputs(transaction &tx, tx_verification_context &tvc,
 	return true;
 }
 
+//------------------------------------------------------------------
+bool Blockchain::ver_rct_non_semantics_cached(const transaction &tx)
+{
+	const rct::rctSig &rv = tx.rct_signatures;
+	const crypto::hash tx_hash = get_transaction_hash(tx);
+	bool verified = false;
+	const bool valid = m_rct_ver_cache.check(tx_hash, rv, [&rv, &verified] {
+		verified = true;
+		return rv.type == rct::RCTTypeFull ? rct::verRct(rv, false) : rct::verRctNonSemanticsSimple(rv);
+	});
+	if(valid && !verified)
+		GULPS_LOG_L2("Ringct signatures of tx ", tx_hash, " already verified");
+	return valid;
+}
 //------------------------------------------------------------------
 void Blockchain::check_ring_signature(const crypto::hash &tx_prefix_hash, const crypto::key_image &key_image, const std::vector<rct::ctkey> &pubkeys, const std::vector<crypto::signature> &sig, uint64_t &result)
 {
@@ -3604,7 +3589,7 @@ bool Blockchain::handle_block_to_main_chain(const block &bl, const crypto::hash
 		}
 		else
 		{
-			get_block_longhash(m_nettype, bl, m_pow_ctx, proof_of_work);
+			get_block_longhash(m_nettype, bl, *cn_pow_ctx_pool::instance().acquire(), proof_of_work);
 		}
 
 		// validate proof_of_work versus difficulty target
@@ -3810,6 +3795,13 @@ bool Blockchain::handle_block_to_main_chain(const block &bl, const crypto::hash
 		try
 		{
 			new_height = m_db->add_block(bl, block_size, cumulative_difficulty, already_generated_coins, txs);
+			if(m_key_image_index_chain)
+			{
+				for(const transaction &tx : txs)
+					m_key_image_index.add_chain(tx);
+			}
+			if(new_height != 0 && m_difficulty_window.height() == new_height)
+				m_difficulty_window.push(bl.timestamp, cumulative_difficulty);
 		}
 		catch(const KEY_IMAGE_EXISTS &e)
 		{
@@ -3847,12 +3839,14 @@ bool Blockchain::handle_block_to_main_chain(const block &bl, const crypto::hash
 						 target_calculating_time , longhash_calculating_time,
 						 t1, t2, t3, t_exists, t_pool,
 						 t_checktx, t_dblspnd, vmt, addblock);
+		const rct::point_cache &cache = rct::point_cache::getInstance();
+		GULPSF_INFO("RingCT point cache hits: {} misses: {} warmed: {}", cache.get_hits(), cache.get_misses(), cache.get_warms());
 	}
 
 	bvc.m_added_to_main_chain = true;
 	++m_sync_counter;
 
-	// appears to be a NOP *and* is called elsewhere.  wat?
+	// updates the ready flags the pool builds block templates from
 	m_tx_pool.on_blockchain_inc(new_height, id);
 
 	return true;
@@ -3989,9 +3983,10 @@ void Blockchain::set_enforce_dns_checkpoints(bool enforce_checkpoints)
 }
 
 //------------------------------------------------------------------
-void Blockchain::block_longhash_worker(cn_pow_hash_v2 &hash_ctx, const std::vector<block> &blocks, std::unordered_map<crypto::hash, crypto::hash> &map)
+void Blockchain::block_longhash_worker(const std::vector<block> &blocks, std::unordered_map<crypto::hash, crypto::hash> &map)
 {
 	TIME_MEASURE_START(t);
+	cn_pow_ctx_pool::lease hash_ctx = cn_pow_ctx_pool::instance().acquire();
 
 	for(const auto &block : blocks)
 	{
@@ -3999,7 +3994,7 @@ void Blockchain::block_longhash_worker(cn_pow_hash_v2 &hash_ctx, const std::vect
 			break;
 		crypto::hash id = get_block_hash(block);
 		crypto::hash pow;
-		get_block_longhash(m_nettype, block, hash_ctx, pow);
+		get_block_longhash(m_nettype, block, *hash_ctx, pow);
 		map.emplace(id, pow);
 	}
 
@@ -4082,9 +4077,25 @@ void Blockchain::output_scan_worker(const uint64_t amount, const std::vector<uin
 	catch(const std::exception &e)
 	{
 		GULPS_VERIFY_ERR_TX("EXCEPTION: ", e.what());
+		return;
 	}
 	catch(...)
 	{
+		return;
+	}
+
+	// decompress the ring members here, on the prefetch threads, rather than in the signature checks
+	if(amount == 0)
+	{
+		// each output takes two entries, warm only what fits in half the cache so shards filling
+		// unevenly and the checks' own lookups don't evict the first points before they are used
+		rct::point_cache &cache = rct::point_cache::getInstance();
+		const size_t count = std::min(outputs.size(), cache.get_capacity() / 4);
+		for(size_t i = 0; i < count; ++i)
+		{
+			cache.warm(rct::pk2rct(outputs[i].pubkey), true);
+			cache.warm(outputs[i].commitment, false);
+		}
 	}
 }
 
@@ -4314,11 +4325,9 @@ bool Blockchain::prepare_handle_incoming_blocks(const std::list<block_complete_e
 			m_blocks_longhash_table.clear();
 			tools::threadpool::waiter waiter;
 
-			if(m_hash_ctxes_multi.size() < threads)
-				m_hash_ctxes_multi.resize(threads);
 			for(uint64_t i = 0; i < threads; i++)
 			{
-				tpool.submit(&waiter, boost::bind(&Blockchain::block_longhash_worker, this, std::ref(m_hash_ctxes_multi[i]), std::cref(blocks[i]), std::ref(maps[i])));
+				tpool.submit(&waiter, boost::bind(&Blockchain::block_longhash_worker, this, std::cref(blocks[i]), std::ref(maps[i])), tools::threadpool::PRIORITY_HIGH);
 			}
 
 			waiter.wait();
@@ -4456,7 +4465,7 @@ bool Blockchain::prepare_handle_incoming_blocks(const std::list<block_complete_e
 		for(size_t i = 0; i < amounts.size(); i++)
 		{
 			uint64_t amount = amounts[i];
-			tpool.submit(&waiter, boost::bind(&Blockchain::output_scan_worker, this, amount, std::cref(offset_map[amount]), std::ref(tx_map[amount]), std::ref(transactions[i])));
+			tpool.submit(&waiter, boost::bind(&Blockchain::output_scan_worker, this, amount, std::cref(offset_map[amount]), std::ref(tx_map[amount]), std::ref(transactions[i])), tools::threadpool::PRIORITY_HIGH);
 		}
 		waiter.wait();
 	}
@@ -4789,4 +4798,5 @@ bool Blockchain::for_all_outputs(uint64_t amount, std::function<bool(uint64_t he
 namespace cryptonote
 {
 template bool Blockchain::get_transactions(const std::vector<crypto::hash> &, std::list<transaction> &, std::list<crypto::hash> &) const;
+template bool Blockchain::get_transactions_blobs(const std::vector<crypto::hash> &, std::list<cryptonote::blobdata> &, std::list<crypto::hash> &, bool) const;
 }
@@ -67,6 +67,9 @@
 #include "cryptonote_basic/verification_context.h"
 #include "cryptonote_protocol/cryptonote_protocol_defs.h"
 #include "cryptonote_tx_utils.h"
+#include "difficulty_window.h"
+#include "key_image_index.h"
+#include "rct_ver_cache.h"
 #include "rpc/core_rpc_server_commands_defs.h"
 #include "string_tools.h"
 #include "syncobj.h"
@@ -683,11 +686,12 @@ class Blockchain
      * @param txs_ids a container of hashes for which to get the corresponding transactions
      * @param txs return-by-reference a container to store result transactions in
      * @param missed_txs return-by-reference a container to store missed transactions in
+     * @param pruned return the pruned blobs, without the prunable part of the signatures
      *
      * @return false if an unexpected exception occurs, else true
      */
 	template <class t_ids_container, class t_tx_container, class t_missed_container>
-	bool get_transactions_blobs(const t_ids_container &txs_ids, t_tx_container &txs, t_missed_container &missed_txs) const;
+	bool get_transactions_blobs(const t_ids_container &txs_ids, t_tx_container &txs, t_missed_container &missed_txs, bool pruned = false) const;
 	template <class t_ids_container, class t_tx_container, class t_missed_container>
 	bool get_transactions(const t_ids_container &txs_ids, t_tx_container &txs, t_missed_container &missed_txs) const;
 
@@ -736,6 +740,13 @@ class Blockchain
 	void set_user_options(uint64_t maxthreads, uint64_t blocks_per_sync,
 						  blockchain_db_sync_mode sync_mode, bool fast_sync);
 
+	/**
+     * @brief sets the max number of threads preparing blocks for addition
+     *
+     * @param maxthreads the thread count, as in set_user_options()
+     */
+	void set_max_prepare_blocks_threads(uint64_t maxthreads) { m_max_prepare_blocks_threads = maxthreads; }
+
 	/**
      * @brief Put DB in safe sync mode
      */
@@ -912,6 +923,46 @@ class Blockchain
 		return *m_db;
 	}
 
+	/**
+     * @brief get the in-memory index of key images spent on chain and in the pool
+     *
+     * The chain side is maintained by Blockchain, the pool side by tx_memory_pool.
+     * Lookups take neither the blockchain lock nor the pool lock.
+     *
+     * @return a reference to the key image index
+     */
+	key_image_index &get_key_image_index()
+	{
+		return m_key_image_index;
+	}
+
+	const key_image_index &get_key_image_index() const
+	{
+		return m_key_image_index;
+	}
+
+	/**
+     * @brief sets whether the key image index holds the images spent on chain
+     *
+     * Loading every spent key image takes time at startup and memory for as
+     * long as the daemon runs. Without it, lookups of chain spends read the
+     * database instead. Must be called before init().
+     *
+     * @param enabled whether to index the chain spends
+     */
+	void set_key_image_index_chain(bool enabled) { m_key_image_index_chain = enabled; }
+
+	/**
+     * @brief looks up whether a batch of key images are spent, on chain or in the pool
+     *
+     * Uses the key image index, and the database for the chain spends when the
+     * index doesn't hold them, see set_key_image_index_chain().
+     *
+     * @param key_images the images to look up
+     * @param status return-by-reference, one status per image, in order
+     */
+	void get_key_images_status(const std::vector<crypto::key_image> &key_images, std::vector<key_image_index::spent_status> &status) const;
+
 	/**
      * @brief get a number of outputs of a specific amount
      *
@@ -927,11 +978,12 @@ class Blockchain
 	/**
      * @brief computes the "short" and "long" hashes for a set of blocks
      *
-     * @param hash_ctx pow hash ctx
+     * Leases its hashing context from cn_pow_ctx_pool for the duration of the call.
+     *
      * @param blocks the blocks to be hashed
      * @param map return-by-reference the hashes for each block
      */
-	void block_longhash_worker(cn_pow_hash_v2 &hash_ctx, const std::vector<block> &blocks, std::unordered_map<crypto::hash, crypto::hash> &map);
+	void block_longhash_worker(const std::vector<block> &blocks, std::unordered_map<crypto::hash, crypto::hash> &map);
 
 	/**
      * @brief returns a set of known alternate chains
@@ -986,6 +1038,8 @@ class Blockchain
 
 	tx_memory_pool &m_tx_pool;
 
+	key_image_index m_key_image_index;
+
 	mutable epee::critical_section m_blockchain_lock; // TODO: add here reader/writer lock
 
 	// main chain
@@ -998,6 +1052,9 @@ class Blockchain
 	std::unordered_map<crypto::hash, crypto::hash> m_blocks_longhash_table;
 	std::unordered_map<crypto::hash, std::unordered_map<crypto::key_image, bool>> m_check_txin_table;
 
+	// txes whose ringct signatures verified, so a block does not check pool txes a second time
+	rct_ver_cache m_rct_ver_cache;
+
 	// SHA-3 hashes for each block and for fast pow checking
 	std::vector<crypto::hash> m_blocks_hash_of_hashes;
 	std::vector<crypto::hash> m_blocks_hash_check;
@@ -1009,15 +1066,14 @@ class Blockchain
 	blockchain_db_sync_mode m_db_sync_mode;
 	bool m_fast_sync;
 	bool m_show_time_stats;
+	bool m_key_image_index_chain;
 	bool m_db_default_sync;
 	uint64_t m_db_blocks_per_sync;
 	uint64_t m_max_prepare_blocks_threads;
 	uint64_t m_fake_pow_calc_time;
 	uint64_t m_fake_scan_time;
 	uint64_t m_sync_counter;
-	std::vector<uint64_t> m_timestamps;
-	std::vector<difficulty_type> m_difficulties;
-	uint64_t m_timestamps_and_difficulties_height;
+	difficulty_window m_difficulty_window;
 
 	boost::asio::io_service m_async_service;
 	boost::thread_group m_async_pool;
@@ -1029,9 +1085,6 @@ class Blockchain
 	// some invalid blocks
 	blocks_ext_by_hash m_invalid_blocks; // crypto::hash -> block_extended_info
 
-	cn_pow_hash_v2 m_pow_ctx;
-	std::vector<cn_pow_hash_v2> m_hash_ctxes_multi;
-
 	checkpoints m_checkpoints;
 	bool m_enforce_dns_checkpoints;
 
@@ -1183,6 +1236,21 @@ class Blockchain
      */
 	difficulty_type get_next_difficulty_for_alternative_chain(const std::list<blocks_ext_by_hash::iterator> &alt_chain, block_extended_info &bei) const;
 
+	/**
+     * @brief gets the number of blocks the difficulty calculation of the current hard fork looks at
+     */
+	size_t get_difficulty_blocks_count() const;
+
+	/**
+     * @brief runs the difficulty calculation of the current hard fork
+     *
+     * @param timestamps the timestamps of the window's blocks, oldest first
+     * @param cumulative_difficulties the cumulative difficulties of the same blocks
+     *
+     * @return the difficulty of the next block
+     */
+	difficulty_type next_difficulty(std::vector<uint64_t> &&timestamps, std::vector<difficulty_type> &&cumulative_difficulties) const;
+
 	/**
      * @brief sanity checks a miner transaction before validating an entire block
      *
@@ -1406,5 +1474,18 @@ class Blockchain
      * that implicit data.
      */
 	bool expand_transaction_2(transaction &tx, const crypto::hash &tx_prefix_hash, const std::vector<std::vector<rct::ctkey>> &pubkeys);
+
+	/**
+     * @brief checks the ringct signatures of an expanded transaction
+     *
+     * Successful checks are cached by tx hash and a digest of the ring members.
+     * A tx verified on entering the pool is not checked again when it comes in a
+     * block, unless a reorg changed the outputs its rings resolve to.
+     *
+     * @param tx the transaction, with its mixRing expanded
+     *
+     * @return true if the signatures are valid, otherwise false
+     */
+	bool ver_rct_non_semantics_cached(const transaction &tx);
 };
 } // namespace cryptonote
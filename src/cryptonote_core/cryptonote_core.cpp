@@ -122,6 +122,8 @@ static const command_line::arg_descriptor<bool> arg_no_fluffy_blocks = {
 	"no-fluffy-blocks", "Relay blocks as normal blocks", false};
 static const command_line::arg_descriptor<size_t> arg_max_txpool_size = {
 	"max-txpool-size", "Set maximum txpool size in bytes.", DEFAULT_TXPOOL_MAX_SIZE};
+static const command_line::arg_descriptor<bool> arg_no_key_image_index = {
+	"no-key-image-index", "Don't load the spent key images into memory at startup, key image checks read the database instead", false};
 
 //-----------------------------------------------------------------------------------------------
 core::core(i_cryptonote_protocol *pprotocol) : m_mempool(m_blockchain_storage),
@@ -230,6 +232,7 @@ void core::init_options(boost::program_options::options_description &desc)
 	command_line::add_arg(desc, arg_offline);
 	command_line::add_arg(desc, arg_disable_dns_checkpoints);
 	command_line::add_arg(desc, arg_max_txpool_size);
+	command_line::add_arg(desc, arg_no_key_image_index);
 
 	miner::init_options(desc);
 	BlockchainDB::init_options(desc);
@@ -309,9 +312,9 @@ bool core::get_blocks(uint64_t start_offset, size_t count, std::list<block> &blo
 	return true;
 }
 //-----------------------------------------------------------------------------------------------
-bool core::get_transactions(const std::vector<crypto::hash> &txs_ids, std::list<cryptonote::blobdata> &txs, std::list<crypto::hash> &missed_txs) const
+bool core::get_transactions(const std::vector<crypto::hash> &txs_ids, std::list<cryptonote::blobdata> &txs, std::list<crypto::hash> &missed_txs, bool pruned) const
 {
-	return m_blockchain_storage.get_transactions_blobs(txs_ids, txs, missed_txs);
+	return m_blockchain_storage.get_transactions_blobs(txs_ids, txs, missed_txs, pruned);
 }
 //-----------------------------------------------------------------------------------------------
 bool core::get_txpool_backlog(std::vector<tx_backlog_entry> &backlog) const
@@ -456,6 +459,7 @@ bool core::init(const boost::program_options::variables_map &vm, const char *con
 
 	m_blockchain_storage.set_user_options(blocks_threads,
 										  blocks_per_sync, sync_mode, fast_sync);
+	m_blockchain_storage.set_key_image_index_chain(!command_line::get_arg(vm, arg_no_key_image_index));
 
 	r = m_blockchain_storage.init(db.release(), m_nettype, m_offline, test_options);
 
@@ -565,6 +569,7 @@ bool core::handle_incoming_tx_pre(const blobdata &tx_blob, tx_verification_conte
 		tvc.m_verifivation_failed = true;
 		return false;
 	}
+	tvc.m_tx_hash = tx_hash;
 	//std::cout << "!"<< tx.vin.size() << std::endl;
 
 	bad_semantics_txes_lock.lock();
@@ -598,8 +603,10 @@ bool core::handle_incoming_tx_pre(const blobdata &tx_blob, tx_verification_conte
 	return true;
 }
 //-----------------------------------------------------------------------------------------------
-bool core::handle_incoming_tx_post(const blobdata &tx_blob, tx_verification_context &tvc, cryptonote::transaction &tx, crypto::hash &tx_hash, crypto::hash &tx_prefixt_hash, bool keeped_by_block, bool relayed, bool do_not_relay)
+bool core::handle_incoming_tx_post(const blobdata &tx_blob, tx_verification_context &tvc, cryptonote::transaction &tx, crypto::hash &tx_hash, crypto::hash &tx_prefixt_hash, bool keeped_by_block, bool relayed, bool do_not_relay, bool &verify_rct_semantics)
 {
+	verify_rct_semantics = false;
+
 	if(!check_tx_syntax(tx))
 	{
 		GULPSF_LOG_L1("WRONG TRANSACTION BLOB, Failed to check tx {} syntax, rejected", tx_hash );
@@ -610,22 +617,21 @@ bool core::handle_incoming_tx_post(const blobdata &tx_blob, tx_verification_cont
 	if(keeped_by_block && get_blockchain_storage().is_within_compiled_block_hash_area())
 	{
 		GULPS_LOG_L2("Skipping semantics check for tx kept by block in embedded hash area");
+		return true;
 	}
-	else if(!check_tx_semantic(tx, keeped_by_block))
+
+	if(!check_tx_semantic(tx, keeped_by_block))
 	{
 		GULPSF_LOG_L1("WRONG TRANSACTION BLOB, Failed to check tx {} semantic, rejected", tx_hash );
 		tvc.m_verifivation_failed = true;
-		bad_semantics_txes_lock.lock();
-		bad_semantics_txes[0].insert(tx_hash);
-		if(bad_semantics_txes[0].size() >= BAD_SEMANTICS_TXES_MAX_SIZE)
-		{
-			std::swap(bad_semantics_txes[0], bad_semantics_txes[1]);
-			bad_semantics_txes[0].clear();
-		}
-		bad_semantics_txes_lock.unlock();
+		add_bad_semantics_tx(tx_hash);
 		return false;
 	}
 
+	const uint8_t rct_type = tx.rct_signatures.type;
+	if((rct_type == rct::RCTTypeSimple || rct_type == rct::RCTTypeBulletproof) && !is_rct_semantics_verified(tx_hash))
+		verify_rct_semantics = true;
+
 	return true;
 }
 //-----------------------------------------------------------------------------------------------
@@ -641,10 +647,13 @@ bool core::handle_incoming_txs(const std::list<blobdata> &tx_blobs, std::vector<
 		crypto::hash prefix_hash;
 		bool in_txpool;
 		bool in_blockchain;
+		bool verify_rct_semantics;
 	};
 	std::vector<result> results(tx_blobs.size());
 
 	tvc.resize(tx_blobs.size());
+	// txes of blocks being synced must not wait behind RPC work
+	const tools::threadpool::priority prio = keeped_by_block ? tools::threadpool::PRIORITY_HIGH : tools::threadpool::PRIORITY_NORMAL;
 	tools::threadpool::waiter waiter;
 	std::list<blobdata>::const_iterator it = tx_blobs.begin();
 	for(size_t i = 0; i < tx_blobs.size(); i++, ++it)
@@ -659,7 +668,7 @@ bool core::handle_incoming_txs(const std::list<blobdata> &tx_blobs, std::vector<
 				GULPSF_VERIFY_ERR_TX("Exception in handle_incoming_tx_pre: {}", e.what());
 				results[i].res = false;
 			}
-		});
+		}, prio);
 	}
 	waiter.wait();
 	it = tx_blobs.begin();
@@ -680,18 +689,46 @@ bool core::handle_incoming_txs(const std::list<blobdata> &tx_blobs, std::vector<
 			m_threadpool.submit(&waiter, [&, i, it] {
 				try
 				{
-					results[i].res = handle_incoming_tx_post(*it, tvc[i], results[i].tx, results[i].hash, results[i].prefix_hash, keeped_by_block, relayed, do_not_relay);
+					results[i].res = handle_incoming_tx_post(*it, tvc[i], results[i].tx, results[i].hash, results[i].prefix_hash, keeped_by_block, relayed, do_not_relay, results[i].verify_rct_semantics);
 				}
 				catch(const std::exception &e)
 				{
 					GULPSF_VERIFY_ERR_TX("Exception in handle_incoming_tx_post: {}", e.what());
 					results[i].res = false;
 				}
-			});
+			}, prio);
 		}
 	}
 	waiter.wait();
 
+	// Range proofs of all txes are verified together in one multiexp
+	std::vector<const rct::rctSig *> rvv;
+	std::vector<size_t> rvv_idx;
+	for(size_t i = 0; i < results.size(); i++)
+	{
+		if(results[i].res && results[i].verify_rct_semantics)
+		{
+			rvv.push_back(&results[i].tx.rct_signatures);
+			rvv_idx.push_back(i);
+		}
+	}
+
+	std::vector<bool> rct_valid;
+	if(!rvv.empty() && !check_tx_rct_semantics(rvv, rct_valid))
+	{
+		for(size_t j = 0; j < rvv.size(); j++)
+		{
+			if(rct_valid[j])
+				continue;
+
+			result &r = results[rvv_idx[j]];
+			GULPSF_LOG_L1("WRONG TRANSACTION BLOB, Failed to check tx {} rct semantic, rejected", r.hash);
+			tvc[rvv_idx[j]].m_verifivation_failed = true;
+			r.res = false;
+			add_bad_semantics_tx(r.hash);
+		}
+	}
+
 	bool ok = true;
 	it = tx_blobs.begin();
 	for(size_t i = 0; i < tx_blobs.size(); i++, ++it)
@@ -809,13 +846,7 @@ bool core::check_tx_semantic(const transaction &tx, bool keeped_by_block) const
 		return false;
 	case rct::RCTTypeSimple:
 	case rct::RCTTypeBulletproof:
-		// Use inefficient version for now - we will be scrapping the whole system
-		// and there is very little point in polishing turds
-		if(!rct::verRctSemanticsSimple(rv))
-		{
-			GULPS_VERIFY_ERR_TX("rct signature semantics check failed");
-			return false;
-		}
+		// batch verified by the caller with check_tx_rct_semantics
 		break;
 	case rct::RCTTypeFull:
 		if(!rct::verRct(rv, true))
@@ -832,6 +863,65 @@ bool core::check_tx_semantic(const transaction &tx, bool keeped_by_block) const
 	return true;
 }
 //-----------------------------------------------------------------------------------------------
+static void ver_rct_semantics_bisect(const std::vector<const rct::rctSig *> &rvv, size_t begin, size_t end, std::vector<bool> &valid)
+{
+	if(begin == end)
+		return;
+
+	std::vector<const rct::rctSig *> batch(rvv.begin() + begin, rvv.begin() + end);
+	if(rct::verRctSemanticsSimple(batch))
+	{
+		std::fill(valid.begin() + begin, valid.begin() + end, true);
+		return;
+	}
+
+	if(end - begin == 1)
+	{
+		valid[begin] = false;
+		return;
+	}
+
+	const size_t mid = begin + (end - begin) / 2;
+	ver_rct_semantics_bisect(rvv, begin, mid, valid);
+	ver_rct_semantics_bisect(rvv, mid, end, valid);
+}
+//-----------------------------------------------------------------------------------------------
+bool core::check_tx_rct_semantics(const std::vector<const rct::rctSig *> &rvv, std::vector<bool> &valid) const
+{
+	valid.assign(rvv.size(), true);
+	if(rvv.empty() || rct::verRctSemanticsSimple(rvv))
+		return true;
+
+	GULPSF_LOG_L1("Batch rct semantics check failed for {} signatures, looking for the bad ones", rvv.size());
+	if(rvv.size() == 1)
+	{
+		valid[0] = false;
+		return false;
+	}
+
+	const size_t mid = rvv.size() / 2;
+	ver_rct_semantics_bisect(rvv, 0, mid, valid);
+	ver_rct_semantics_bisect(rvv, mid, rvv.size(), valid);
+	return false;
+}
+//-----------------------------------------------------------------------------------------------
+bool core::is_rct_semantics_verified(const crypto::hash &tx_hash)
+{
+	boost::unique_lock<boost::mutex> lock(m_rct_semantics_verified_txes_lock);
+	return m_rct_semantics_verified_txes.find(tx_hash) != m_rct_semantics_verified_txes.end();
+}
+//-----------------------------------------------------------------------------------------------
+void core::add_bad_semantics_tx(const crypto::hash &tx_hash)
+{
+	boost::unique_lock<boost::mutex> lock(bad_semantics_txes_lock);
+	bad_semantics_txes[0].insert(tx_hash);
+	if(bad_semantics_txes[0].size() >= BAD_SEMANTICS_TXES_MAX_SIZE)
+	{
+		std::swap(bad_semantics_txes[0], bad_semantics_txes[1]);
+		bad_semantics_txes[0].clear();
+	}
+}
+//-----------------------------------------------------------------------------------------------
 bool core::is_key_image_spent(const crypto::key_image &key_image) const
 {
 	return m_blockchain_storage.have_tx_keyimg_as_spent(key_image);
@@ -839,10 +929,24 @@ bool core::is_key_image_spent(const crypto::key_image &key_image) const
 //-----------------------------------------------------------------------------------------------
 bool core::are_key_images_spent(const std::vector<crypto::key_image> &key_im, std::vector<bool> &spent) const
 {
+	std::vector<key_image_index::spent_status> status;
+	m_blockchain_storage.get_key_images_status(key_im, status);
 	spent.clear();
-	for(auto &ki : key_im)
+	spent.reserve(status.size());
+	for(key_image_index::spent_status st : status)
+		spent.push_back(st == key_image_index::SPENT_IN_CHAIN);
+	return true;
+}
+//-----------------------------------------------------------------------------------------------
+bool core::get_key_images_spent_status(const std::vector<crypto::key_image> &key_im, std::vector<key_image_index::spent_status> &status, bool include_unrelayed_txes) const
+{
+	m_blockchain_storage.get_key_images_status(key_im, status);
+	if(!include_unrelayed_txes)
 	{
-		spent.push_back(m_blockchain_storage.have_tx_keyimg_as_spent(ki));
+		// only the few images found in the pool need the relayed check
+		for(size_t n = 0; n < status.size(); ++n)
+			if(status[n] == key_image_index::SPENT_IN_POOL && !m_mempool.have_relayed_tx_keyimg_as_spent(key_im[n]))
+				status[n] = key_image_index::UNSPENT;
 	}
 	return true;
 }
@@ -868,25 +972,21 @@ std::pair<uint64_t, uint64_t> core::get_coinbase_tx_sum(const uint64_t start_off
 {
 	uint64_t emission_amount = 0;
 	uint64_t total_fee_amount = 0;
-	if(count)
-	{
-		const uint64_t end = start_offset + count - 1;
-		m_blockchain_storage.for_blocks_range(start_offset, end,
-											  [this, &emission_amount, &total_fee_amount](uint64_t, const crypto::hash &hash, const block &b) {
-												  std::list<transaction> txs;
-												  std::list<crypto::hash> missed_txs;
-												  uint64_t coinbase_amount = get_outs_money_amount(b.miner_tx);
-												  this->get_transactions(b.tx_hashes, txs, missed_txs);
-												  uint64_t tx_fee_amount = 0;
-												  for(const auto &tx : txs)
-												  {
-													  tx_fee_amount += get_tx_fee(tx);
-												  }
-
-												  emission_amount += coinbase_amount - tx_fee_amount;
-												  total_fee_amount += tx_fee_amount;
-												  return true;
-											  });
+	// both ends and the height must come from the same chain, a pop in between would make the difference wrap
+	CRITICAL_REGION_LOCAL1(m_blockchain_storage);
+	const uint64_t height = m_blockchain_storage.get_current_blockchain_height();
+	if(count && start_offset < height)
+	{
+		// The DB keeps running totals per block, so a range is the difference of its two ends
+		const uint64_t end = start_offset + std::min<uint64_t>(count - 1, height - 1 - start_offset);
+		m_blockchain_storage.get_db().get_block_cumulative_totals(end, emission_amount, total_fee_amount);
+		if(start_offset > 0)
+		{
+			uint64_t emission_before, fees_before;
+			m_blockchain_storage.get_db().get_block_cumulative_totals(start_offset - 1, emission_before, fees_before);
+			emission_amount -= emission_before;
+			total_fee_amount -= fees_before;
+		}
 	}
 
 	/* Remove burned premine from emission
@@ -978,28 +1078,21 @@ bool core::relay_txpool_transactions()
 		cryptonote_connection_context fake_context = AUTO_VAL_INIT(fake_context);
 		tx_verification_context tvc = AUTO_VAL_INIT(tvc);
 		NOTIFY_NEW_TRANSACTIONS::request r;
+		std::vector<crypto::hash> tx_hashes;
 		for(auto it = txs.begin(); it != txs.end(); ++it)
 		{
 			r.txs.push_back(it->second);
+			tx_hashes.push_back(it->first);
 		}
-		get_protocol()->relay_transactions(r, fake_context);
-		m_mempool.set_relayed(txs);
+		get_protocol()->relay_transactions(r, tx_hashes, fake_context);
+		m_mempool.set_relayed(tx_hashes);
 	}
 	return true;
 }
 //-----------------------------------------------------------------------------------------------
-void core::on_transaction_relayed(const cryptonote::blobdata &tx_blob)
+void core::on_transactions_relayed(const std::vector<crypto::hash> &tx_hashes)
 {
-	std::list<std::pair<crypto::hash, cryptonote::blobdata>> txs;
-	cryptonote::transaction tx;
-	crypto::hash tx_hash, tx_prefix_hash;
-	if(!parse_and_validate_tx_from_blob(tx_blob, tx, tx_hash, tx_prefix_hash))
-	{
-		GULPS_LOG_ERROR("Failed to parse relayed transaction");
-		return;
-	}
-	txs.push_back(std::make_pair(tx_hash, std::move(tx_blob)));
-	m_mempool.set_relayed(txs);
+	m_mempool.set_relayed(tx_hashes);
 }
 //-----------------------------------------------------------------------------------------------
 bool core::get_block_template(block &b, const account_public_address &adr, difficulty_type &diffic, uint64_t &height, uint64_t &expected_reward, const blobdata &ex_nonce)
@@ -1133,9 +1226,75 @@ bool core::prepare_handle_incoming_blocks(const std::list<block_complete_entry>
 {
 	m_incoming_tx_lock.lock();
 	m_blockchain_storage.prepare_handle_incoming_blocks(blocks);
+	verify_blocks_rct_semantics(blocks);
 	return true;
 }
 
+//-----------------------------------------------------------------------------------------------
+void core::verify_blocks_rct_semantics(const std::list<block_complete_entry> &blocks)
+{
+	if(m_blockchain_storage.is_within_compiled_block_hash_area())
+		return;
+
+	std::vector<const blobdata *> blobs;
+	for(const block_complete_entry &entry : blocks)
+	{
+		for(const blobdata &blob : entry.txs)
+			blobs.push_back(&blob);
+	}
+
+	if(blobs.empty())
+		return;
+
+	struct result
+	{
+		bool res;
+		cryptonote::transaction tx;
+		crypto::hash hash;
+	};
+	std::vector<result> results(blobs.size());
+
+	tools::threadpool::waiter waiter;
+	for(size_t i = 0; i < blobs.size(); i++)
+	{
+		m_threadpool.submit(&waiter, [&, i] {
+			crypto::hash prefix_hash;
+			results[i].res = blobs[i]->size() <= get_max_tx_size() && parse_tx_from_blob(results[i].tx, results[i].hash, prefix_hash, *blobs[i]);
+		}, tools::threadpool::PRIORITY_HIGH);
+	}
+	waiter.wait();
+
+	// Unparsable txes are left for handle_incoming_txs to reject
+	std::vector<const rct::rctSig *> rvv;
+	std::vector<size_t> rvv_idx;
+	for(size_t i = 0; i < results.size(); i++)
+	{
+		const uint8_t rct_type = results[i].tx.rct_signatures.type;
+		if(results[i].res && (rct_type == rct::RCTTypeSimple || rct_type == rct::RCTTypeBulletproof))
+		{
+			rvv.push_back(&results[i].tx.rct_signatures);
+			rvv_idx.push_back(i);
+		}
+	}
+
+	if(rvv.empty())
+		return;
+
+	std::vector<bool> valid;
+	if(!check_tx_rct_semantics(rvv, valid))
+		GULPS_LOG_L1("Some transactions in incoming blocks failed rct semantics check");
+
+	boost::unique_lock<boost::mutex> lock(m_rct_semantics_verified_txes_lock);
+	for(size_t j = 0; j < rvv.size(); j++)
+	{
+		const crypto::hash &tx_hash = results[rvv_idx[j]].hash;
+		if(valid[j])
+			m_rct_semantics_verified_txes.insert(tx_hash);
+		else
+			add_bad_semantics_tx(tx_hash);
+	}
+}
+
 //-----------------------------------------------------------------------------------------------
 bool core::cleanup_handle_incoming_blocks(bool force_sync)
 {
@@ -1147,6 +1306,12 @@ bool core::cleanup_handle_incoming_blocks(bool force_sync)
 	catch(...)
 	{
 	}
+
+	{
+		boost::unique_lock<boost::mutex> lock(m_rct_semantics_verified_txes_lock);
+		m_rct_semantics_verified_txes.clear();
+	}
+
 	m_incoming_tx_lock.unlock();
 	return success;
 }
@@ -221,9 +221,11 @@ class core : public i_miner_handler
 	virtual bool get_block_template(block &b, const account_public_address &adr, difficulty_type &diffic, uint64_t &height, uint64_t &expected_reward, const blobdata &ex_nonce);
 
 	/**
-      * @brief called when a transaction is relayed
+      * @brief called when transactions are relayed
+      *
+      * @param tx_hashes the hashes of the relayed transactions
       */
-	virtual void on_transaction_relayed(const cryptonote::blobdata &tx);
+	virtual void on_transactions_relayed(const std::vector<crypto::hash> &tx_hashes);
 
 	/**
       * @brief gets the miner instance
@@ -367,7 +369,7 @@ class core : public i_miner_handler
       *
       * @note see Blockchain::get_transactions
       */
-	bool get_transactions(const std::vector<crypto::hash> &txs_ids, std::list<cryptonote::blobdata> &txs, std::list<crypto::hash> &missed_txs) const;
+	bool get_transactions(const std::vector<crypto::hash> &txs_ids, std::list<cryptonote::blobdata> &txs, std::list<crypto::hash> &missed_txs, bool pruned = false) const;
 
 	/**
       * @copydoc Blockchain::get_transactions
@@ -744,6 +746,19 @@ class core : public i_miner_handler
       */
 	bool are_key_images_spent_in_pool(const std::vector<crypto::key_image> &key_im, std::vector<bool> &spent) const;
 
+	/**
+      * @brief get where each of multiple key images is spent, on chain or in the pool
+      *
+      * Served from the in-memory key image index, without the blockchain or pool lock.
+      *
+      * @param key_im list of key images to check
+      * @param status return-by-reference status for each image checked
+      * @param include_unrelayed_txes whether key images spent only by unrelayed pool txes count as spent in pool
+      *
+      * @return true
+      */
+	bool get_key_images_spent_status(const std::vector<crypto::key_image> &key_im, std::vector<key_image_index::spent_status> &status, bool include_unrelayed_txes = true) const;
+
 	/**
       * @brief get the number of blocks to sync in one go
       *
@@ -869,6 +884,9 @@ class core : public i_miner_handler
       *                   tx not too large,
       *                   each input has a different key image.
       *
+      * RCTTypeSimple and RCTTypeBulletproof signatures are not checked here,
+      * they are batch verified by check_tx_rct_semantics.
+      *
       * @param tx the transaction to check
       * @param keeped_by_block if the transaction has been in a block
       *
@@ -876,8 +894,48 @@ class core : public i_miner_handler
       */
 	bool check_tx_semantic(const transaction &tx, bool keeped_by_block) const;
 
+	/**
+      * @brief batch verifies the semantics of simple ringct signatures
+      *
+      * All range proofs are verified with a single multiexp. If the batch
+      * fails, it is bisected until the offending signatures are found.
+      *
+      * @param rvv the signatures to check
+      * @param valid return-by-reference per signature verification result
+      *
+      * @return true if all signatures are valid, otherwise false
+      */
+	bool check_tx_rct_semantics(const std::vector<const rct::rctSig *> &rvv, std::vector<bool> &valid) const;
+
+	/**
+      * @brief check whether a transaction's ringct semantics were already verified
+      *
+      * @param tx_hash the transaction's hash
+      *
+      * @return true if the transaction was verified by prepare_handle_incoming_blocks
+      */
+	bool is_rct_semantics_verified(const crypto::hash &tx_hash);
+
+	/**
+      * @brief batch verifies the ringct semantics of all txes in a set of blocks
+      *
+      * Txes that pass are remembered until cleanup_handle_incoming_blocks so
+      * handle_incoming_txs does not check them again, txes that fail are
+      * added to the bad semantics set.
+      *
+      * @param blocks the blocks about to be handled
+      */
+	void verify_blocks_rct_semantics(const std::list<block_complete_entry> &blocks);
+
+	/**
+      * @brief remember a transaction as failing semantic checks
+      *
+      * @param tx_hash the transaction's hash
+      */
+	void add_bad_semantics_tx(const crypto::hash &tx_hash);
+
 	bool handle_incoming_tx_pre(const blobdata &tx_blob, tx_verification_context &tvc, cryptonote::transaction &tx, crypto::hash &tx_hash, crypto::hash &tx_prefixt_hash, bool keeped_by_block, bool relayed, bool do_not_relay);
-	bool handle_incoming_tx_post(const blobdata &tx_blob, tx_verification_context &tvc, cryptonote::transaction &tx, crypto::hash &tx_hash, crypto::hash &tx_prefixt_hash, bool keeped_by_block, bool relayed, bool do_not_relay);
+	bool handle_incoming_tx_post(const blobdata &tx_blob, tx_verification_context &tvc, cryptonote::transaction &tx, crypto::hash &tx_hash, crypto::hash &tx_prefixt_hash, bool keeped_by_block, bool relayed, bool do_not_relay, bool &verify_rct_semantics);
 
 	/**
       * @copydoc miner::on_block_chain_update
@@ -1003,6 +1061,9 @@ class core : public i_miner_handler
 	std::unordered_set<crypto::hash> bad_semantics_txes[2];
 	boost::mutex bad_semantics_txes_lock;
 
+	std::unordered_set<crypto::hash> m_rct_semantics_verified_txes; //!< txes of the blocks being synced whose ringct semantics were batch verified
+	boost::mutex m_rct_semantics_verified_txes_lock;
+
 	tools::threadpool &m_threadpool;
 
 	enum
@@ -0,0 +1,112 @@
+// Copyright (c) 2020, pasta Currency Project
+//
+// Portions of this file are available under BSD-3 license. Please see ORIGINAL-LICENSE for details
+// All rights reserved.
+//
+// Authors and copyright holders give permission for following:
+//
+// 1. Redistribution and use in source and binary forms WITHOUT modification.
+//
+// 2. Modification of the source form for your own personal use.
+//
+// As long as the following conditions are met:
+//
+// 3. You must not distribute modified copies of the work to third parties. This includes
+//    posting the work online, or hosting copies of the modified work for download.
+//
+// 4. Any derivative version of this work is also covered by this license, including point 8.
+//
+// 5. Neither the name of the copyright holders nor the names of the authors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+//
+// 6. You agree that this licence is governed by and shall be construed in accordance
+//    with the laws of England and Wales.
+//
+// 7. You agree to submit all disputes arising out of or in connection with this licence
+//    to the exclusive jurisdiction of the Courts of England and Wales.
+//
+// Authors and copyright holders agree that:
+//
+// 8. This licence expires and the work covered by it is released into the
+//    public domain on 1st of February 2021
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "difficulty_window.h"
+
+#include <cassert>
+
+namespace cryptonote
+{
+difficulty_window::difficulty_window(size_t capacity) : m_timestamps(capacity), m_difficulties(capacity), m_head(0), m_size(0), m_height(0)
+{
+	assert(capacity > 0);
+}
+
+void difficulty_window::clear()
+{
+	reset(0);
+}
+
+void difficulty_window::reset(uint64_t height)
+{
+	m_head = 0;
+	m_size = 0;
+	m_height = height;
+}
+
+void difficulty_window::push(uint64_t timestamp, difficulty_type cumulative_difficulty)
+{
+	const size_t cap = capacity();
+	size_t idx;
+	if(m_size < cap)
+	{
+		idx = (m_head + m_size) % cap;
+		++m_size;
+	}
+	else
+	{
+		idx = m_head;
+		m_head = (m_head + 1) % cap;
+	}
+	m_timestamps[idx] = timestamp;
+	m_difficulties[idx] = cumulative_difficulty;
+	++m_height;
+}
+
+void difficulty_window::pop()
+{
+	assert(m_size > 0);
+	--m_size;
+	--m_height;
+}
+
+bool difficulty_window::covers(uint64_t begin, uint64_t end) const
+{
+	return begin <= end && end <= m_height && begin >= m_height - m_size;
+}
+
+void difficulty_window::copy(uint64_t begin, uint64_t end, std::vector<uint64_t> &timestamps, std::vector<difficulty_type> &cumulative_difficulties) const
+{
+	assert(covers(begin, end));
+	const size_t cap = capacity();
+	const uint64_t first = m_height - m_size;
+	timestamps.reserve(timestamps.size() + (end - begin));
+	cumulative_difficulties.reserve(cumulative_difficulties.size() + (end - begin));
+	for(uint64_t h = begin; h < end; ++h)
+	{
+		const size_t idx = (m_head + (h - first)) % cap;
+		timestamps.push_back(m_timestamps[idx]);
+		cumulative_difficulties.push_back(m_difficulties[idx]);
+	}
+}
+}
@@ -0,0 +1,107 @@
+// Copyright (c) 2020, pasta Currency Project
+//
+// Portions of this file are available under BSD-3 license. Please see ORIGINAL-LICENSE for details
+// All rights reserved.
+//
+// Authors and copyright holders give permission for following:
+//
+// 1. Redistribution and use in source and binary forms WITHOUT modification.
+//
+// 2. Modification of the source form for your own personal use.
+//
+// As long as the following conditions are met:
+//
+// 3. You must not distribute modified copies of the work to third parties. This includes
+//    posting the work online, or hosting copies of the modified work for download.
+//
+// 4. Any derivative version of this work is also covered by this license, including point 8.
+//
+// 5. Neither the name of the copyright holders nor the names of the authors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+//
+// 6. You agree that this licence is governed by and shall be construed in accordance
+//    with the laws of England and Wales.
+//
+// 7. You agree to submit all disputes arising out of or in connection with this licence
+//    to the exclusive jurisdiction of the Courts of England and Wales.
+//
+// Authors and copyright holders agree that:
+//
+// 8. This licence expires and the work covered by it is released into the
+//    public domain on 1st of February 2021
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "cryptonote_basic/difficulty.h"
+
+namespace cryptonote
+{
+
+/*!
+ * \brief The timestamps and cumulative difficulties of the newest blocks of a chain
+ *
+ * A fixed size ring buffer, so following the chain tip costs one entry per
+ * block pushed or popped instead of re-reading the whole difficulty window.
+ * Holding some blocks more than the difficulty calculation needs lets short
+ * reorgs pop and push without a reload, and lets an alt chain branching
+ * off recently take its main chain part from here instead of the DB.
+ */
+class difficulty_window
+{
+  public:
+	explicit difficulty_window(size_t capacity);
+
+	//! forgets all blocks, height() is 0 until the next reset()
+	void clear();
+
+	//! forgets all blocks, the next block pushed is the one at the given height
+	void reset(uint64_t height);
+
+	//! height of the block following the newest one held, 0 if the window is not in use
+	uint64_t height() const { return m_height; }
+	size_t size() const { return m_size; }
+	size_t capacity() const { return m_timestamps.size(); }
+
+	//! data of the newest block, the window must not be empty
+	uint64_t back_timestamp() const { return m_timestamps[(m_head + m_size - 1) % capacity()]; }
+	difficulty_type back_cumulative_difficulty() const { return m_difficulties[(m_head + m_size - 1) % capacity()]; }
+
+	//! appends the block at height(), dropping the oldest one when full
+	void push(uint64_t timestamp, difficulty_type cumulative_difficulty);
+
+	//! drops the newest block
+	void pop();
+
+	//! whether the blocks of heights [begin, end) are all held
+	bool covers(uint64_t begin, uint64_t end) const;
+
+	/*!
+	 * \brief appends the data of the blocks of heights [begin, end), oldest first
+	 *
+	 * Any range covers() accepts can be copied, which is how an alt chain
+	 * forks the window at its split height.
+	 */
+	void copy(uint64_t begin, uint64_t end, std::vector<uint64_t> &timestamps, std::vector<difficulty_type> &cumulative_difficulties) const;
+
+  private:
+	std::vector<uint64_t> m_timestamps;
+	std::vector<difficulty_type> m_difficulties;
+	size_t m_head; // index of the oldest block
+	size_t m_size;
+	uint64_t m_height;
+};
+}
@@ -0,0 +1,324 @@
+// Copyright (c) 2020, pasta Currency Project
+//
+// Portions of this file are available under BSD-3 license. Please see ORIGINAL-LICENSE for details
+// All rights reserved.
+//
+// Authors and copyright holders give permission for following:
+//
+// 1. Redistribution and use in source and binary forms WITHOUT modification.
+//
+// 2. Modification of the source form for your own personal use.
+//
+// As long as the following conditions are met:
+//
+// 3. You must not distribute modified copies of the work to third parties. This includes
+//    posting the work online, or hosting copies of the modified work for download.
+//
+// 4. Any derivative version of this work is also covered by this license, including point 8.
+//
+// 5. Neither the name of the copyright holders nor the names of the authors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+//
+// 6. You agree that this licence is governed by and shall be construed in accordance
+//    with the laws of England and Wales.
+//
+// 7. You agree to submit all disputes arising out of or in connection with this licence
+//    to the exclusive jurisdiction of the Courts of England and Wales.
+//
+// Authors and copyright holders agree that:
+//
+// 8. This licence expires and the work covered by it is released into the
+//    public domain on 1st of February 2021
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "key_image_index.h"
+
+#include <boost/thread/locks.hpp>
+#include <cstring>
+
+namespace cryptonote
+{
+namespace
+{
+constexpr size_t min_capacity = 16;
+
+// Key images are curve points and already uniformly distributed, the shard
+// takes the first byte so the slot hash starts further in
+inline size_t slot_hash(const crypto::key_image &ki)
+{
+	uint64_t h;
+	memcpy(&h, reinterpret_cast<const uint8_t *>(&ki) + 8, sizeof(h));
+	return static_cast<size_t>(h);
+}
+}
+
+key_image_index::key_image_index()
+{
+}
+//---------------------------------------------------------------------------------
+const key_image_index::slot *key_image_index::shard::find(const crypto::key_image &ki) const
+{
+	if(slots.empty())
+		return nullptr;
+	const size_t mask = slots.size() - 1;
+	for(size_t i = slot_hash(ki) & mask;; i = (i + 1) & mask)
+	{
+		const slot &s = slots[i];
+		if(s.state == SLOT_EMPTY)
+			return nullptr;
+		if(s.state == SLOT_USED && s.ki == ki)
+			return &s;
+	}
+}
+//---------------------------------------------------------------------------------
+key_image_index::slot *key_image_index::shard::find(const crypto::key_image &ki)
+{
+	return const_cast<slot *>(static_cast<const shard *>(this)->find(ki));
+}
+//---------------------------------------------------------------------------------
+key_image_index::slot &key_image_index::shard::find_or_insert(const crypto::key_image &ki)
+{
+	// keep at least a quarter of the slots empty so probe runs stay short
+	if((used + deleted + 1) * 4 > slots.size() * 3)
+		rehash(std::max(min_capacity, (used + 1) * 2));
+
+	const size_t mask = slots.size() - 1;
+	slot *reuse = nullptr;
+	for(size_t i = slot_hash(ki) & mask;; i = (i + 1) & mask)
+	{
+		slot &s = slots[i];
+		if(s.state == SLOT_USED)
+		{
+			if(s.ki == ki)
+				return s;
+			continue;
+		}
+		if(s.state == SLOT_DELETED)
+		{
+			if(reuse == nullptr)
+				reuse = &s;
+			continue;
+		}
+
+		if(reuse != nullptr)
+			--deleted;
+		else
+			reuse = &s;
+		reuse->ki = ki;
+		reuse->pool_refs = 0;
+		reuse->in_chain = false;
+		reuse->state = SLOT_USED;
+		++used;
+		return *reuse;
+	}
+}
+//---------------------------------------------------------------------------------
+void key_image_index::shard::release(slot &s)
+{
+	if(s.in_chain || s.pool_refs != 0)
+		return;
+	s.state = SLOT_DELETED;
+	--used;
+	++deleted;
+}
+//---------------------------------------------------------------------------------
+void key_image_index::shard::rehash(size_t capacity)
+{
+	size_t cap = min_capacity;
+	while(cap < capacity)
+		cap <<= 1;
+
+	std::vector<slot> old(cap, slot{crypto::key_image{}, 0, false, SLOT_EMPTY});
+	old.swap(slots);
+	deleted = 0;
+
+	const size_t mask = slots.size() - 1;
+	for(const slot &s : old)
+	{
+		if(s.state != SLOT_USED)
+			continue;
+		size_t i = slot_hash(s.ki) & mask;
+		while(slots[i].state != SLOT_EMPTY)
+			i = (i + 1) & mask;
+		slots[i] = s;
+	}
+}
+//---------------------------------------------------------------------------------
+void key_image_index::shard::clear_if(bool chain)
+{
+	for(slot &s : slots)
+	{
+		if(s.state != SLOT_USED)
+			continue;
+		if(chain)
+			s.in_chain = false;
+		else
+			s.pool_refs = 0;
+		release(s);
+	}
+	rehash(used * 2);
+}
+//---------------------------------------------------------------------------------
+key_image_index::spent_status key_image_index::status_of(const slot *s)
+{
+	if(s == nullptr)
+		return UNSPENT;
+	return s->in_chain ? SPENT_IN_CHAIN : s->pool_refs ? SPENT_IN_POOL : UNSPENT;
+}
+//---------------------------------------------------------------------------------
+void key_image_index::add_chain(const crypto::key_image &ki)
+{
+	shard &sh = m_shards[shard_of(ki)];
+	boost::unique_lock<boost::shared_mutex> lock(sh.mutex);
+	sh.find_or_insert(ki).in_chain = true;
+}
+//---------------------------------------------------------------------------------
+void key_image_index::remove_chain(const crypto::key_image &ki)
+{
+	shard &sh = m_shards[shard_of(ki)];
+	boost::unique_lock<boost::shared_mutex> lock(sh.mutex);
+	slot *s = sh.find(ki);
+	if(s == nullptr)
+		return;
+	s->in_chain = false;
+	sh.release(*s);
+}
+//---------------------------------------------------------------------------------
+void key_image_index::add_chain(const transaction &tx)
+{
+	for(const txin_v &in : tx.vin)
+	{
+		if(in.type() == typeid(txin_to_key))
+			add_chain(boost::get<txin_to_key>(in).k_image);
+	}
+}
+//---------------------------------------------------------------------------------
+void key_image_index::remove_chain(const transaction &tx)
+{
+	for(const txin_v &in : tx.vin)
+	{
+		if(in.type() == typeid(txin_to_key))
+			remove_chain(boost::get<txin_to_key>(in).k_image);
+	}
+}
+//---------------------------------------------------------------------------------
+void key_image_index::add_pool(const crypto::key_image &ki)
+{
+	shard &sh = m_shards[shard_of(ki)];
+	boost::unique_lock<boost::shared_mutex> lock(sh.mutex);
+	++sh.find_or_insert(ki).pool_refs;
+}
+//---------------------------------------------------------------------------------
+void key_image_index::remove_pool(const crypto::key_image &ki)
+{
+	shard &sh = m_shards[shard_of(ki)];
+	boost::unique_lock<boost::shared_mutex> lock(sh.mutex);
+	slot *s = sh.find(ki);
+	if(s == nullptr || s->pool_refs == 0)
+		return;
+	--s->pool_refs;
+	sh.release(*s);
+}
+//---------------------------------------------------------------------------------
+void key_image_index::clear_chain()
+{
+	for(shard &sh : m_shards)
+	{
+		boost::unique_lock<boost::shared_mutex> lock(sh.mutex);
+		sh.clear_if(true);
+	}
+}
+//---------------------------------------------------------------------------------
+void key_image_index::clear_pool()
+{
+	for(shard &sh : m_shards)
+	{
+		boost::unique_lock<boost::shared_mutex> lock(sh.mutex);
+		sh.clear_if(false);
+	}
+}
+//---------------------------------------------------------------------------------
+void key_image_index::clear()
+{
+	for(shard &sh : m_shards)
+	{
+		boost::unique_lock<boost::shared_mutex> lock(sh.mutex);
+		std::vector<slot>().swap(sh.slots);
+		sh.used = 0;
+		sh.deleted = 0;
+	}
+}
+//---------------------------------------------------------------------------------
+key_image_index::spent_status key_image_index::get_status(const crypto::key_image &ki) const
+{
+	const shard &sh = m_shards[shard_of(ki)];
+	boost::shared_lock<boost::shared_mutex> lock(sh.mutex);
+	return status_of(sh.find(ki));
+}
+//---------------------------------------------------------------------------------
+template <typename fn_t>
+void key_image_index::find_batch(const std::vector<crypto::key_image> &key_images, fn_t fn) const
+{
+	if(key_images.size() == 1)
+	{
+		const shard &sh = m_shards[shard_of(key_images[0])];
+		boost::shared_lock<boost::shared_mutex> lock(sh.mutex);
+		fn(0, sh.find(key_images[0]));
+		return;
+	}
+
+	// bucket the positions by shard, then take each shard's lock once
+	std::vector<uint32_t> first(shard_count + 1, 0);
+	for(const crypto::key_image &ki : key_images)
+		++first[shard_of(ki) + 1];
+	for(size_t i = 0; i < shard_count; ++i)
+		first[i + 1] += first[i];
+	std::vector<uint32_t> order(key_images.size());
+	std::vector<uint32_t> next(first.begin(), first.end() - 1);
+	for(size_t i = 0; i < key_images.size(); ++i)
+		order[next[shard_of(key_images[i])]++] = i;
+
+	for(size_t sh_idx = 0; sh_idx < shard_count; ++sh_idx)
+	{
+		if(first[sh_idx] == first[sh_idx + 1])
+			continue;
+		const shard &sh = m_shards[sh_idx];
+		boost::shared_lock<boost::shared_mutex> lock(sh.mutex);
+		for(size_t j = first[sh_idx]; j < first[sh_idx + 1]; ++j)
+			fn(order[j], sh.find(key_images[order[j]]));
+	}
+}
+//---------------------------------------------------------------------------------
+void key_image_index::get_status(const std::vector<crypto::key_image> &key_images, std::vector<spent_status> &status) const
+{
+	status.assign(key_images.size(), UNSPENT);
+	find_batch(key_images, [&status](size_t i, const slot *s) { status[i] = status_of(s); });
+}
+//---------------------------------------------------------------------------------
+void key_image_index::get_pool_status(const std::vector<crypto::key_image> &key_images, std::vector<bool> &in_pool) const
+{
+	in_pool.assign(key_images.size(), false);
+	find_batch(key_images, [&in_pool](size_t i, const slot *s) { in_pool[i] = s != nullptr && s->pool_refs != 0; });
+}
+//---------------------------------------------------------------------------------
+size_t key_image_index::size() const
+{
+	size_t n = 0;
+	for(const shard &sh : m_shards)
+	{
+		boost::shared_lock<boost::shared_mutex> lock(sh.mutex);
+		n += sh.used;
+	}
+	return n;
+}
+}
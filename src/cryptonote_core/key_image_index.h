@@ -0,0 +1,162 @@
+// Copyright (c) 2020, pasta Currency Project
+//
+// Portions of this file are available under BSD-3 license. Please see ORIGINAL-LICENSE for details
+// All rights reserved.
+//
+// Authors and copyright holders give permission for following:
+//
+// 1. Redistribution and use in source and binary forms WITHOUT modification.
+//
+// 2. Modification of the source form for your own personal use.
+//
+// As long as the following conditions are met:
+//
+// 3. You must not distribute modified copies of the work to third parties. This includes
+//    posting the work online, or hosting copies of the modified work for download.
+//
+// 4. Any derivative version of this work is also covered by this license, including point 8.
+//
+// 5. Neither the name of the copyright holders nor the names of the authors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+//
+// 6. You agree that this licence is governed by and shall be construed in accordance
+//    with the laws of England and Wales.
+//
+// 7. You agree to submit all disputes arising out of or in connection with this licence
+//    to the exclusive jurisdiction of the Courts of England and Wales.
+//
+// Authors and copyright holders agree that:
+//
+// 8. This licence expires and the work covered by it is released into the
+//    public domain on 1st of February 2021
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#pragma once
+
+#include <boost/thread/shared_mutex.hpp>
+#include <vector>
+
+#include "crypto/crypto.h"
+#include "cryptonote_basic/cryptonote_basic.h"
+
+namespace cryptonote
+{
+
+/*!
+ * \brief An in-memory index of every spent key image, on chain and in the pool
+ *
+ * Answers "is this key image spent, and where" without the database, the
+ * blockchain lock or the pool lock. The images are split into shards by their
+ * first byte, each shard an open addressing table behind its own reader/writer
+ * lock, so RPC readers and the single writer rarely meet on one lock.
+ *
+ * The chain side mirrors the key image table of the DB and is kept up to date
+ * by Blockchain on block add and pop. The pool side counts the pool txes
+ * spending each image, as tx_memory_pool's own key image map does.
+ */
+class key_image_index
+{
+  public:
+	enum spent_status : uint8_t
+	{
+		UNSPENT = 0,
+		SPENT_IN_CHAIN = 1,
+		SPENT_IN_POOL = 2
+	};
+
+	static constexpr size_t shard_count = 64;
+
+	key_image_index();
+
+	void add_chain(const crypto::key_image &ki);
+	void remove_chain(const crypto::key_image &ki);
+
+	//! adds / removes the key images of every input of a tx
+	void add_chain(const transaction &tx);
+	void remove_chain(const transaction &tx);
+
+	void add_pool(const crypto::key_image &ki);
+	void remove_pool(const crypto::key_image &ki);
+
+	void clear_chain();
+	void clear_pool();
+	void clear();
+
+	spent_status get_status(const crypto::key_image &ki) const;
+
+	/*!
+	 * \brief looks up a batch of key images
+	 *
+	 * Every shard is locked once for all the images of the batch that fall
+	 * into it, instead of once per image.
+	 *
+	 * \param key_images the images to look up
+	 * \param status return-by-reference, one status per image, in order
+	 */
+	void get_status(const std::vector<crypto::key_image> &key_images, std::vector<spent_status> &status) const;
+
+	/*!
+	 * \brief looks up whether pool txes spend a batch of key images
+	 *
+	 * Unlike get_status, an image also spent on chain is still reported if a
+	 * pool tx spends it, as tx_memory_pool's own key image map would.
+	 *
+	 * \param key_images the images to look up
+	 * \param in_pool return-by-reference, one flag per image, in order
+	 */
+	void get_pool_status(const std::vector<crypto::key_image> &key_images, std::vector<bool> &in_pool) const;
+
+	//! number of distinct key images known, on chain or in the pool
+	size_t size() const;
+
+  private:
+	enum slot_state : uint8_t
+	{
+		SLOT_EMPTY = 0,
+		SLOT_USED,
+		SLOT_DELETED
+	};
+
+	struct slot
+	{
+		crypto::key_image ki;
+		uint32_t pool_refs;
+		bool in_chain;
+		slot_state state;
+	};
+
+	struct alignas(64) shard
+	{
+		mutable boost::shared_mutex mutex;
+		std::vector<slot> slots;
+		size_t used = 0;
+		size_t deleted = 0;
+
+		const slot *find(const crypto::key_image &ki) const;
+		slot *find(const crypto::key_image &ki);
+		slot &find_or_insert(const crypto::key_image &ki);
+		void release(slot &s);
+		void rehash(size_t capacity);
+		void clear_if(bool chain);
+	};
+
+	static size_t shard_of(const crypto::key_image &ki) { return reinterpret_cast<const uint8_t *>(&ki)[0] % shard_count; }
+	static spent_status status_of(const slot *s);
+
+	//! calls fn(position, slot or nullptr) for every image, locking each shard once
+	template <typename fn_t>
+	void find_batch(const std::vector<crypto::key_image> &key_images, fn_t fn) const;
+
+	shard m_shards[shard_count];
+};
+}
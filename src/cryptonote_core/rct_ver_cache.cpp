@@ -0,0 +1,95 @@
+// Copyright (c) 2020, pasta Currency Project
+//
+// Portions of this file are available under BSD-3 license. Please see ORIGINAL-LICENSE for details
+// All rights reserved.
+//
+// Authors and copyright holders give permission for following:
+//
+// 1. Redistribution and use in source and binary forms WITHOUT modification.
+//
+// 2. Modification of the source form for your own personal use.
+//
+// As long as the following conditions are met:
+//
+// 3. You must not distribute modified copies of the work to third parties. This includes
+//    posting the work online, or hosting copies of the modified work for download.
+//
+// 4. Any derivative version of this work is also covered by this license, including point 8.
+//
+// 5. Neither the name of the copyright holders nor the names of the authors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+//
+// 6. You agree that this licence is governed by and shall be construed in accordance
+//    with the laws of England and Wales.
+//
+// 7. You agree to submit all disputes arising out of or in connection with this licence
+//    to the exclusive jurisdiction of the Courts of England and Wales.
+//
+// Authors and copyright holders agree that:
+//
+// 8. This licence expires and the work covered by it is released into the
+//    public domain on 1st of February 2021
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "rct_ver_cache.h"
+
+namespace cryptonote
+{
+rct_ver_cache::rct_ver_cache(size_t capacity) : m_capacity(capacity)
+{
+}
+//---------------------------------------------------------------------------------
+bool rct_ver_cache::contains(const crypto::hash &tx_hash, const crypto::hash &ring_digest) const
+{
+	CRITICAL_REGION_LOCAL(m_lock);
+	auto it = m_digests.find(tx_hash);
+	return it != m_digests.end() && it->second == ring_digest;
+}
+//---------------------------------------------------------------------------------
+void rct_ver_cache::insert(const crypto::hash &tx_hash, const crypto::hash &ring_digest)
+{
+	CRITICAL_REGION_LOCAL(m_lock);
+	auto ins = m_digests.emplace(tx_hash, ring_digest);
+	if(!ins.second)
+	{
+		ins.first->second = ring_digest;
+		return;
+	}
+	m_order.push_back(tx_hash);
+	if(m_order.size() > m_capacity)
+	{
+		m_digests.erase(m_order.front());
+		m_order.pop_front();
+	}
+}
+//---------------------------------------------------------------------------------
+size_t rct_ver_cache::size() const
+{
+	CRITICAL_REGION_LOCAL(m_lock);
+	return m_digests.size();
+}
+//---------------------------------------------------------------------------------
+crypto::hash rct_ver_cache::ring_digest(const rct::rctSig &rv)
+{
+	std::vector<rct::key> ring_keys;
+	for(const rct::ctkeyV &row : rv.mixRing)
+		for(const rct::ctkey &k : row)
+		{
+			ring_keys.push_back(k.dest);
+			ring_keys.push_back(k.mask);
+		}
+	crypto::hash digest;
+	crypto::cn_fast_hash(ring_keys.data(), ring_keys.size() * sizeof(rct::key), digest);
+	return digest;
+}
+}
@@ -0,0 +1,105 @@
+// Copyright (c) 2020, pasta Currency Project
+//
+// Portions of this file are available under BSD-3 license. Please see ORIGINAL-LICENSE for details
+// All rights reserved.
+//
+// Authors and copyright holders give permission for following:
+//
+// 1. Redistribution and use in source and binary forms WITHOUT modification.
+//
+// 2. Modification of the source form for your own personal use.
+//
+// As long as the following conditions are met:
+//
+// 3. You must not distribute modified copies of the work to third parties. This includes
+//    posting the work online, or hosting copies of the modified work for download.
+//
+// 4. Any derivative version of this work is also covered by this license, including point 8.
+//
+// 5. Neither the name of the copyright holders nor the names of the authors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+//
+// 6. You agree that this licence is governed by and shall be construed in accordance
+//    with the laws of England and Wales.
+//
+// 7. You agree to submit all disputes arising out of or in connection with this licence
+//    to the exclusive jurisdiction of the Courts of England and Wales.
+//
+// Authors and copyright holders agree that:
+//
+// 8. This licence expires and the work covered by it is released into the
+//    public domain on 1st of February 2021
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#pragma once
+
+#include <deque>
+#include <unordered_map>
+
+#include "crypto/hash.h"
+#include "ringct/rctTypes.h"
+#include "syncobj.h"
+
+namespace cryptonote
+{
+
+/*!
+ * \brief Ringct signature checks that succeeded, so a tx verified on entering
+ * the pool is not checked again when it comes in a block
+ *
+ * Entries are keyed by tx hash, which covers the signatures, and hold a digest
+ * of the ring members the tx was verified against. A reorg that changes the
+ * outputs a ring resolves to changes the digest, so the tx is checked again.
+ * Failed checks are never stored. Oldest entries are dropped first.
+ */
+class rct_ver_cache
+{
+  public:
+	explicit rct_ver_cache(size_t capacity);
+
+	/*!
+	 * \brief checks the signatures of an expanded ringct tx, calling verify()
+	 * only if no earlier success for the same tx and ring members is held
+	 *
+	 * \param tx_hash hash of the tx
+	 * \param rv the tx's signatures, with the mixRing expanded
+	 * \param verify the signature check, a callable returning bool
+	 *
+	 * \return the cached or the fresh result of verify()
+	 */
+	template <typename verify_t>
+	bool check(const crypto::hash &tx_hash, const rct::rctSig &rv, verify_t verify)
+	{
+		const crypto::hash digest = ring_digest(rv);
+		if(contains(tx_hash, digest))
+			return true;
+		if(!verify())
+			return false;
+		insert(tx_hash, digest);
+		return true;
+	}
+
+	bool contains(const crypto::hash &tx_hash, const crypto::hash &ring_digest) const;
+	void insert(const crypto::hash &tx_hash, const crypto::hash &ring_digest);
+	size_t size() const;
+
+	//! hash of the dest and mask keys of every ring member
+	static crypto::hash ring_digest(const rct::rctSig &rv);
+
+  private:
+	const size_t m_capacity;
+	std::unordered_map<crypto::hash, crypto::hash> m_digests;
+	std::deque<crypto::hash> m_order;
+	mutable epee::critical_section m_lock;
+};
+}
@@ -131,7 +131,7 @@ class LockedTXN
 }
 //---------------------------------------------------------------------------------
 //---------------------------------------------------------------------------------
-tx_memory_pool::tx_memory_pool(Blockchain &bchs) : m_blockchain(bchs), m_txpool_max_size(DEFAULT_TXPOOL_MAX_SIZE), m_txpool_size(0)
+tx_memory_pool::tx_memory_pool(Blockchain &bchs) : m_parsed_txs_hf_version(0), m_blockchain(bchs), m_txpool_max_size(DEFAULT_TXPOOL_MAX_SIZE), m_txpool_size(0)
 {
 }
 //---------------------------------------------------------------------------------
@@ -246,6 +246,8 @@ bool tx_memory_pool::add_tx(transaction &tx, /*const crypto::hash& tx_prefix_has
 				if(!insert_key_images(tx, kept_by_block))
 					return false;
 				m_txs_by_fee_and_receive_time.emplace(std::pair<double, std::time_t>(fee / (double)blob_size, receive_time), id);
+				// not evaluated yet, the next block or pop runs the full check
+				cache_parsed_tx(id, tx, meta, false, 0);
 			}
 			catch(const std::exception &e)
 			{
@@ -289,6 +291,10 @@ bool tx_memory_pool::add_tx(transaction &tx, /*const crypto::hash& tx_prefix_has
 			if(!insert_key_images(tx, kept_by_block))
 				return false;
 			m_txs_by_fee_and_receive_time.emplace(std::pair<double, std::time_t>(fee / (double)blob_size, receive_time), id);
+			// the inputs were just checked, what is_transaction_ready_to_go would add is the chain key image check
+			const uint64_t height = m_blockchain.get_current_blockchain_height();
+			const bool ready = max_used_block_height < height && !m_blockchain.have_tx_keyimges_as_spent(tx);
+			cache_parsed_tx(id, tx, meta, ready, height);
 		}
 		catch(const std::exception &e)
 		{
@@ -373,6 +379,7 @@ void tx_memory_pool::prune(size_t bytes)
 			m_blockchain.remove_txpool_tx(txid);
 			m_txpool_size -= txblob.size();
 			remove_transaction_keyimages(tx);
+			m_parsed_txs.erase(txid);
 			GULPSF_INFO("Pruned tx {} from txpool: size: {}, fee/byte: {}", txid , it->first.second , it->first.first);
 			m_txs_by_fee_and_receive_time.erase(it--);
 		}
@@ -397,6 +404,7 @@ bool tx_memory_pool::insert_key_images(const transaction &tx, bool kept_by_block
 																												 ,",  kei_image_set.size()=", kei_image_set.size(), "\ntxin.k_image=", txin.k_image, "\ntx_id=", id);
 		auto ins_res = kei_image_set.insert(id);
 		GULPS_CHECK_AND_ASSERT_MES(ins_res.second, false, "internal error: try to insert duplicate iterator in key_image set");
+		m_blockchain.get_key_image_index().add_pool(txin.k_image);
 	}
 	return true;
 }
@@ -425,6 +433,7 @@ bool tx_memory_pool::remove_transaction_keyimages(const transaction &tx)
 		GULPS_CHECK_AND_ASSERT_MES(it_in_set != key_image_set.end(), false, "transaction id not found in key_image set, img=" , txin.k_image , "\n"
 																														, "transaction id = " , actual_hash);
 		key_image_set.erase(it_in_set);
+		m_blockchain.get_key_image_index().remove_pool(txin.k_image);
 		if(!key_image_set.size())
 		{
 			//it is now empty hash container for this key_image
@@ -452,11 +461,19 @@ bool tx_memory_pool::take_tx(const crypto::hash &id, transaction &tx, size_t &bl
 			GULPS_ERROR("Failed to find tx in txpool");
 			return false;
 		}
-		cryptonote::blobdata txblob = m_blockchain.get_txpool_tx_blob(id);
-		if(!parse_and_validate_tx_from_blob(txblob, tx))
+		auto parsed = m_parsed_txs.find(id);
+		if(parsed != m_parsed_txs.end())
 		{
-			GULPS_ERROR("Failed to parse tx from txpool");
-			return false;
+			tx = parsed->second.tx;
+		}
+		else
+		{
+			cryptonote::blobdata txblob = m_blockchain.get_txpool_tx_blob(id);
+			if(!parse_and_validate_tx_from_blob(txblob, tx))
+			{
+				GULPS_ERROR("Failed to parse tx from txpool");
+				return false;
+			}
 		}
 		blob_size = meta.blob_size;
 		fee = meta.fee;
@@ -476,6 +493,7 @@ bool tx_memory_pool::take_tx(const crypto::hash &id, transaction &tx, size_t &bl
 	}
 
 	m_txs_by_fee_and_receive_time.erase(sorted_it);
+	m_parsed_txs.erase(id);
 	return true;
 }
 //---------------------------------------------------------------------------------
@@ -540,6 +558,7 @@ bool tx_memory_pool::remove_stuck_transactions()
 					m_blockchain.remove_txpool_tx(txid);
 					m_txpool_size -= bd.size();
 					remove_transaction_keyimages(tx);
+					m_parsed_txs.erase(txid);
 				}
 			}
 			catch(const std::exception &e)
@@ -586,22 +605,22 @@ bool tx_memory_pool::get_relayable_transactions(std::list<std::pair<crypto::hash
 	return true;
 }
 //---------------------------------------------------------------------------------
-void tx_memory_pool::set_relayed(const std::list<std::pair<crypto::hash, cryptonote::blobdata>> &txs)
+void tx_memory_pool::set_relayed(const std::vector<crypto::hash> &tx_hashes)
 {
 	CRITICAL_REGION_LOCAL(m_transactions_lock);
 	CRITICAL_REGION_LOCAL1(m_blockchain);
 	const time_t now = time(NULL);
 	LockedTXN lock(m_blockchain);
-	for(auto it = txs.begin(); it != txs.end(); ++it)
+	for(const crypto::hash &tx_hash : tx_hashes)
 	{
 		try
 		{
 			txpool_tx_meta_t meta;
-			if(m_blockchain.get_txpool_tx_meta(it->first, meta))
+			if(m_blockchain.get_txpool_tx_meta(tx_hash, meta))
 			{
 				meta.relayed = true;
 				meta.last_relayed_time = now;
-				m_blockchain.update_txpool_tx(it->first, meta);
+				m_blockchain.update_txpool_tx(tx_hash, meta);
 			}
 		}
 		catch(const std::exception &e)
@@ -860,19 +879,35 @@ bool tx_memory_pool::get_pool_for_rpc(std::vector<cryptonote::rpc::tx_in_pool> &
 	return true;
 }
 //---------------------------------------------------------------------------------
-bool tx_memory_pool::check_for_key_images(const std::vector<crypto::key_image> &key_images, std::vector<bool> spent) const
+bool tx_memory_pool::check_for_key_images(const std::vector<crypto::key_image> &key_images, std::vector<bool> &spent) const
+{
+	// the index mirrors m_spent_key_images, so the pool lock is not needed
+	m_blockchain.get_key_image_index().get_pool_status(key_images, spent);
+
+	return true;
+}
+//---------------------------------------------------------------------------------
+bool tx_memory_pool::have_relayed_tx_keyimg_as_spent(const crypto::key_image &key_im) const
 {
 	CRITICAL_REGION_LOCAL(m_transactions_lock);
 	CRITICAL_REGION_LOCAL1(m_blockchain);
-
-	spent.clear();
-
-	for(const auto &image : key_images)
+	auto it = m_spent_key_images.find(key_im);
+	if(it == m_spent_key_images.end())
+		return false;
+	for(const crypto::hash &txid : it->second)
 	{
-		spent.push_back(m_spent_key_images.find(image) == m_spent_key_images.end() ? false : true);
+		txpool_tx_meta_t meta;
+		try
+		{
+			if(m_blockchain.get_txpool_tx_meta(txid, meta) && meta.relayed)
+				return true;
+		}
+		catch(const std::exception &e)
+		{
+			GULPSF_ERROR("Failed to get tx meta from txpool: {}", e.what());
+		}
 	}
-
-	return true;
+	return false;
 }
 //---------------------------------------------------------------------------------
 bool tx_memory_pool::get_transaction(const crypto::hash &id, cryptonote::blobdata &txblob) const
@@ -891,11 +926,68 @@ bool tx_memory_pool::get_transaction(const crypto::hash &id, cryptonote::blobdat
 //---------------------------------------------------------------------------------
 bool tx_memory_pool::on_blockchain_inc(uint64_t new_block_height, const crypto::hash &top_block_id)
 {
+	CRITICAL_REGION_LOCAL(m_transactions_lock);
+	CRITICAL_REGION_LOCAL1(m_blockchain);
+
+	// a fork may change the rules the inputs were checked with
+	const uint8_t hf_version = m_blockchain.get_current_hard_fork_version_num();
+	const bool recheck_all = hf_version != m_parsed_txs_hf_version;
+	m_parsed_txs_hf_version = hf_version;
+	const uint64_t height = m_blockchain.get_current_blockchain_height();
+	if(m_parsed_txs.empty())
+		return true;
+
+	LockedTXN lock(m_blockchain);
+
+	for(auto &e : m_parsed_txs)
+	{
+		parsed_tx &ptx = e.second;
+		if(recheck_all || ptx.checked_height == 0)
+		{
+			update_tx_readiness(e.first, ptx);
+		}
+		else if(ptx.ready)
+		{
+			// A new block can not make checked inputs invalid, outputs only get more unlocked.
+			// It can spend the same key images though, which fails the tx without a full check.
+			if(m_blockchain.have_tx_keyimges_as_spent(ptx.tx))
+				mark_tx_failed(e.first, ptx);
+		}
+		else if(ptx.max_used_block_height >= ptx.checked_height && ptx.max_used_block_height < height)
+		{
+			// was waiting for the block holding its newest ring member, which is here now
+			update_tx_readiness(e.first, ptx);
+		}
+		// Everything else failed on this chain and is_transaction_ready_to_go keeps
+		// failing it for as long as the failed block stays, adding blocks changes nothing
+	}
 	return true;
 }
 //---------------------------------------------------------------------------------
 bool tx_memory_pool::on_blockchain_dec(uint64_t new_block_height, const crypto::hash &top_block_id)
 {
+	CRITICAL_REGION_LOCAL(m_transactions_lock);
+	CRITICAL_REGION_LOCAL1(m_blockchain);
+
+	const uint8_t hf_version = m_blockchain.get_current_hard_fork_version_num();
+	const bool recheck_all = hf_version != m_parsed_txs_hf_version;
+	m_parsed_txs_hf_version = hf_version;
+	const uint64_t height = m_blockchain.get_current_blockchain_height();
+	if(m_parsed_txs.empty())
+		return true;
+
+	LockedTXN lock(m_blockchain);
+
+	// The chain below the new height is the one a tx checked at or below it was checked
+	// against, plus blocks on top, so its result stands. Txes checked above it can have
+	// used outputs of the popped blocks, outputs the pop locks again or key images the
+	// pop unspends, and are evaluated again.
+	for(auto &e : m_parsed_txs)
+	{
+		parsed_tx &ptx = e.second;
+		if(recheck_all || ptx.checked_height == 0 || ptx.checked_height > height)
+			update_tx_readiness(e.first, ptx);
+	}
 	return true;
 }
 //---------------------------------------------------------------------------------
@@ -983,26 +1075,75 @@ bool tx_memory_pool::is_transaction_ready_to_go(txpool_tx_meta_t &txd, transacti
 	return true;
 }
 //---------------------------------------------------------------------------------
-bool tx_memory_pool::have_key_images(const std::unordered_set<crypto::key_image> &k_images, const transaction &tx)
+void tx_memory_pool::cache_parsed_tx(const crypto::hash &id, const transaction &tx, const txpool_tx_meta_t &meta, bool ready, uint64_t checked_height)
 {
-	for(size_t i = 0; i != tx.vin.size(); i++)
+	parsed_tx &ptx = m_parsed_txs[id];
+	ptx.tx = tx;
+	ptx.key_images.clear();
+	ptx.key_images.reserve(tx.vin.size());
+	for(const txin_v &in : tx.vin)
 	{
-		CHECKED_GET_SPECIFIC_VARIANT(tx.vin[i], const txin_to_key, itk, false);
-		if(k_images.count(itk.k_image))
-			return true;
+		if(in.type() == typeid(txin_to_key))
+			ptx.key_images.push_back(boost::get<txin_to_key>(in).k_image);
 	}
-	return false;
+	ptx.blob_size = meta.blob_size;
+	ptx.fee = meta.fee;
+	ptx.max_used_block_height = meta.max_used_block_height;
+	ptx.checked_height = checked_height;
+	ptx.ready = ready;
 }
 //---------------------------------------------------------------------------------
-bool tx_memory_pool::append_key_images(std::unordered_set<crypto::key_image> &k_images, const transaction &tx)
+void tx_memory_pool::update_tx_readiness(const crypto::hash &id, parsed_tx &ptx)
 {
-	for(size_t i = 0; i != tx.vin.size(); i++)
+	ptx.checked_height = m_blockchain.get_current_blockchain_height();
+	txpool_tx_meta_t meta;
+	if(!m_blockchain.get_txpool_tx_meta(id, meta))
 	{
-		CHECKED_GET_SPECIFIC_VARIANT(tx.vin[i], const txin_to_key, itk, false);
-		auto i_res = k_images.insert(itk.k_image);
-		GULPS_CHECK_AND_ASSERT_MES(i_res.second, false, "internal error: key images pool cache - inserted duplicate image in set: " , itk.k_image);
+		GULPS_ERROR("Failed to find tx meta in txpool");
+		ptx.ready = false;
+		return;
+	}
+
+	const cryptonote::txpool_tx_meta_t original_meta = meta;
+	ptx.ready = is_transaction_ready_to_go(meta, ptx.tx);
+	ptx.max_used_block_height = meta.max_used_block_height;
+	if(memcmp(&original_meta, &meta, sizeof(meta)))
+	{
+		try
+		{
+			m_blockchain.update_txpool_tx(id, meta);
+		}
+		catch(const std::exception &e)
+		{
+			GULPSF_ERROR("Failed to update tx meta: {}" , e.what());
+			// continue, not fatal
+		}
+	}
+}
+//---------------------------------------------------------------------------------
+void tx_memory_pool::mark_tx_failed(const crypto::hash &id, parsed_tx &ptx)
+{
+	ptx.ready = false;
+	ptx.checked_height = m_blockchain.get_current_blockchain_height();
+	txpool_tx_meta_t meta;
+	if(!m_blockchain.get_txpool_tx_meta(id, meta))
+	{
+		GULPS_ERROR("Failed to find tx meta in txpool");
+		return;
+	}
+
+	// what a failed check_tx_inputs in is_transaction_ready_to_go would record
+	meta.last_failed_height = ptx.checked_height - 1;
+	meta.last_failed_id = m_blockchain.get_block_id_by_height(meta.last_failed_height);
+	try
+	{
+		m_blockchain.update_txpool_tx(id, meta);
+	}
+	catch(const std::exception &e)
+	{
+		GULPSF_ERROR("Failed to update tx meta: {}" , e.what());
+		// continue, not fatal
 	}
-	return true;
 }
 //---------------------------------------------------------------------------------
 void tx_memory_pool::mark_double_spend(const transaction &tx)
@@ -1083,8 +1224,9 @@ bool tx_memory_pool::fill_block_template(block &bl, size_t median_size, uint64_t
 	// coins as an argument and appears to do nothing
 	// with it.
 
+	// Everything needed is in the parsed tx cache, whose ready flags are kept
+	// current by add_tx and on_blockchain_inc/dec, so the blockchain is not locked
 	CRITICAL_REGION_LOCAL(m_transactions_lock);
-	CRITICAL_REGION_LOCAL1(m_blockchain);
 
 	uint64_t best_coinbase = 0;
 	total_size = 0;
@@ -1098,20 +1240,19 @@ bool tx_memory_pool::fill_block_template(block &bl, size_t median_size, uint64_t
 
 	GULPSF_LOG_L2("Filling block template, median size {}, {} txes in the pool", median_size, m_txs_by_fee_and_receive_time.size());
 
-	LockedTXN lock(m_blockchain);
-
 	for(auto& tx_hash : m_txs_by_fee_and_receive_time)
 	{
-		txpool_tx_meta_t meta;
-		if(!m_blockchain.get_txpool_tx_meta(tx_hash.second, meta))
+		auto parsed = m_parsed_txs.find(tx_hash.second);
+		if(parsed == m_parsed_txs.end())
 		{
-			GULPS_ERROR("  failed to find tx meta");
+			GULPS_ERROR("  failed to find tx in the parsed tx cache");
 			continue;
 		}
-		GULPSF_LOG_L2("Considering {}, size {}, current block size {}/{}, current coinbase {}", tx_hash.second, meta.blob_size, total_size, max_total_size, print_money(best_coinbase));
+		const parsed_tx &ptx = parsed->second;
+		GULPSF_LOG_L2("Considering {}, size {}, current block size {}/{}, current coinbase {}", tx_hash.second, ptx.blob_size, total_size, max_total_size, print_money(best_coinbase));
 
 		// Can not exceed maximum block size
-		if(max_total_size < total_size + meta.blob_size)
+		if(max_total_size < total_size + ptx.blob_size)
 		{
 			GULPS_LOG_L2("  would exceed maximum block size");
 			continue;
@@ -1120,59 +1261,37 @@ bool tx_memory_pool::fill_block_template(block &bl, size_t median_size, uint64_t
 		// If we're getting lower coinbase tx,
 		// stop including more tx
 		uint64_t block_reward;
-		if(!get_block_reward(m_blockchain.get_nettype(), median_size, total_size + meta.blob_size + CRYPTONOTE_COINBASE_BLOB_RESERVED_SIZE, already_generated_coins, block_reward, height))
+		if(!get_block_reward(m_blockchain.get_nettype(), median_size, total_size + ptx.blob_size + CRYPTONOTE_COINBASE_BLOB_RESERVED_SIZE, already_generated_coins, block_reward, height))
 		{
 			GULPS_LOG_L2("  would exceed maximum block size");
 			continue;
 		}
-		uint64_t coinbase = block_reward + fee + meta.fee;
+		uint64_t coinbase = block_reward + fee + ptx.fee;
 		if(coinbase < template_accept_threshold(best_coinbase))
 		{
 			GULPS_LOG_L2("  would decrease coinbase to ", print_money(coinbase));
 			continue;
 		}
 
-		cryptonote::blobdata txblob = m_blockchain.get_txpool_tx_blob(tx_hash.second);
-		cryptonote::transaction tx;
-		if(!parse_and_validate_tx_from_blob(txblob, tx))
-		{
-			GULPS_ERROR("Failed to parse tx from txpool");
-			continue;
-		}
-
 		// Skip transactions that are not ready to be
 		// included into the blockchain or that are
 		// missing key images
-		const cryptonote::txpool_tx_meta_t original_meta = meta;
-		bool ready = is_transaction_ready_to_go(meta, tx);
-		if(memcmp(&original_meta, &meta, sizeof(meta)))
-		{
-			try
-			{
-				m_blockchain.update_txpool_tx(tx_hash.second, meta);
-			}
-			catch(const std::exception &e)
-			{
-				GULPSF_ERROR("Failed to update tx meta: {}" , e.what());
-				// continue, not fatal
-			}
-		}
-		if(!ready)
+		if(!ptx.ready)
 		{
 			GULPS_LOG_L2("  not ready to go");
 			continue;
 		}
-		if(have_key_images(k_images, tx))
+		if(std::any_of(ptx.key_images.begin(), ptx.key_images.end(), [&k_images](const crypto::key_image &ki) { return k_images.count(ki) != 0; }))
 		{
 			GULPS_LOG_L2("  key images already seen");
 			continue;
 		}
 
 		bl.tx_hashes.push_back(tx_hash.second);
-		total_size += meta.blob_size;
-		fee += meta.fee;
+		total_size += ptx.blob_size;
+		fee += ptx.fee;
 		best_coinbase = coinbase;
-		append_key_images(k_images, tx);
+		k_images.insert(ptx.key_images.begin(), ptx.key_images.end());
 		GULPSF_LOG_L2("  added, new block size {}/{}, coinbase {}", total_size, max_total_size, print_money(best_coinbase));
 	}
 
@@ -1225,6 +1344,7 @@ size_t tx_memory_pool::validate()
 				m_blockchain.remove_txpool_tx(txid);
 				m_txpool_size -= txblob.size();
 				remove_transaction_keyimages(tx);
+				m_parsed_txs.erase(txid);
 				auto sorted_it = find_tx_in_sorted_container(txid);
 				if(sorted_it == m_txs_by_fee_and_receive_time.end())
 				{
@@ -1254,6 +1374,8 @@ bool tx_memory_pool::init(size_t max_txpool_size)
 	m_txpool_max_size = max_txpool_size ? max_txpool_size : DEFAULT_TXPOOL_MAX_SIZE;
 	m_txs_by_fee_and_receive_time.clear();
 	m_spent_key_images.clear();
+	m_blockchain.get_key_image_index().clear_pool();
+	m_parsed_txs.clear();
 	m_txpool_size = 0;
 	std::vector<crypto::hash> remove;
 
@@ -1270,6 +1392,7 @@ bool tx_memory_pool::init(size_t max_txpool_size)
 			{
 				GULPS_WARN("Failed to parse tx from txpool, removing");
 				remove.push_back(txid);
+				return true;
 			}
 			if(!insert_key_images(tx, meta.kept_by_block))
 			{
@@ -1278,6 +1401,7 @@ bool tx_memory_pool::init(size_t max_txpool_size)
 			}
 			m_txs_by_fee_and_receive_time.emplace(std::pair<double, time_t>(meta.fee / (double)meta.blob_size, meta.receive_time), txid);
 			m_txpool_size += meta.blob_size;
+			cache_parsed_tx(txid, tx, meta, false, 0);
 			return true;
 		},
 												  true);
@@ -1300,6 +1424,15 @@ bool tx_memory_pool::init(size_t max_txpool_size)
 			}
 		}
 	}
+
+	// one full check per tx here, from now on the ready flags are maintained incrementally
+	m_parsed_txs_hf_version = m_blockchain.get_current_hard_fork_version_num();
+	if(!m_parsed_txs.empty())
+	{
+		LockedTXN lock(m_blockchain);
+		for(auto &e : m_parsed_txs)
+			update_tx_readiness(e.first, e.second);
+	}
 	return true;
 }
 
@@ -176,7 +176,12 @@ class tx_memory_pool : boost::noncopyable
 	/**
      * @brief action to take when notified of a block added to the blockchain
      *
-     * Currently does nothing
+     * Updates the ready flags of the parsed tx cache.  Ready transactions
+     * only have their key images checked against the chain, and a spent one
+     * fails them without a full check.  Of the others only the ones waiting
+     * for the block holding their newest ring member, and the ones never
+     * evaluated, get the full check.  Everything is re-evaluated on a hard
+     * fork change.
      *
      * @param new_block_height the height of the blockchain after the change
      * @param top_block_id the hash of the new top block
@@ -188,7 +193,9 @@ class tx_memory_pool : boost::noncopyable
 	/**
      * @brief action to take when notified of a block removed from the blockchain
      *
-     * Currently does nothing
+     * Re-evaluates the transactions, ready or not, whose ready flag was
+     * computed at a height above the new one.  The removed blocks may hold
+     * their ring members or key images, or have unlocked their inputs.
      *
      * @param new_block_height the height of the blockchain after the change
      * @param top_block_id the hash of the new top block
@@ -239,6 +246,9 @@ class tx_memory_pool : boost::noncopyable
 	/**
      * @brief Chooses transactions for a block to include
      *
+     * Greedy pass over the parsed tx cache in fee order, no transaction is
+     * read from the db, parsed or verified here.
+     *
      * @param bl return-by-reference the block to fill in with transactions
      * @param median_size the current median block size
      * @param already_generated_coins the current total number of coins "minted"
@@ -320,7 +330,19 @@ class tx_memory_pool : boost::noncopyable
      *
      * @return true
      */
-	bool check_for_key_images(const std::vector<crypto::key_image> &key_images, std::vector<bool> spent) const;
+	bool check_for_key_images(const std::vector<crypto::key_image> &key_images, std::vector<bool> &spent) const;
+
+	/**
+     * @brief check if a key image is spent by a pool transaction which was relayed
+     *
+     * Restricted RPC does not disclose key images spent only by transactions
+     * which were never relayed.
+     *
+     * @param key_im the key image to search for
+     *
+     * @return true if a relayed pool transaction spends the key image, else false
+     */
+	bool have_relayed_tx_keyimg_as_spent(const crypto::key_image &key_im) const;
 
 	/**
      * @brief get a specific transaction from the pool
@@ -350,9 +372,9 @@ class tx_memory_pool : boost::noncopyable
 	/**
      * @brief tell the pool that certain transactions were just relayed
      *
-     * @param txs the list of transactions (and their hashes)
+     * @param tx_hashes the hashes of the transactions
      */
-	void set_relayed(const std::list<std::pair<crypto::hash, cryptonote::blobdata>> &txs);
+	void set_relayed(const std::vector<crypto::hash> &tx_hashes);
 
 	/**
      * @brief get the total number of transactions in the pool
@@ -496,38 +518,50 @@ class tx_memory_pool : boost::noncopyable
 	bool remove_transaction_keyimages(const transaction &tx);
 
 	/**
-     * @brief check if any of a transaction's spent key images are present in a given set
+     * @brief check if a transaction is a valid candidate for inclusion in a block
      *
-     * @param kic the set of key images to check against
-     * @param tx the transaction to check
+     * @param txd the transaction to check (and info about it)
      *
-     * @return true if any key images present in the set, otherwise false
+     * @return true if the transaction is good to go, otherwise false
      */
-	static bool have_key_images(const std::unordered_set<crypto::key_image> &kic, const transaction &tx);
+	bool is_transaction_ready_to_go(txpool_tx_meta_t &txd, transaction &tx) const;
 
 	/**
-     * @brief append the key images from a transaction to the given set
-     *
-     * @param kic the set of key images to append to
-     * @param tx the transaction
-     *
-     * @return false if any append fails, otherwise true
+     * @brief mark all transactions double spending the one passed
      */
-	static bool append_key_images(std::unordered_set<crypto::key_image> &kic, const transaction &tx);
+	void mark_double_spend(const transaction &tx);
+
+	//! a pool transaction in parsed form, so building a block template needs neither the db nor a parse
+	struct parsed_tx
+	{
+		transaction tx;
+		std::vector<crypto::key_image> key_images;
+		size_t blob_size;
+		uint64_t fee;
+		uint64_t max_used_block_height; //!< copy of the meta field, while not below the chain height the tx waits for that block
+		uint64_t checked_height; //!< chain height ready was computed at, 0 if never
+		bool ready; //!< is_transaction_ready_to_go at the current top block
+	};
 
 	/**
-     * @brief check if a transaction is a valid candidate for inclusion in a block
-     *
-     * @param txd the transaction to check (and info about it)
+     * @brief add (or replace) a transaction in the parsed tx cache
+     */
+	void cache_parsed_tx(const crypto::hash &id, const transaction &tx, const txpool_tx_meta_t &meta, bool ready, uint64_t checked_height);
+
+	/**
+     * @brief run is_transaction_ready_to_go on a cached transaction and store the result
      *
-     * @return true if the transaction is good to go, otherwise false
+     * Writes the updated meta back to the db if the check changed it
      */
-	bool is_transaction_ready_to_go(txpool_tx_meta_t &txd, transaction &tx) const;
+	void update_tx_readiness(const crypto::hash &id, parsed_tx &ptx);
 
 	/**
-     * @brief mark all transactions double spending the one passed
+     * @brief fail a ready transaction whose key image got spent on chain
+     *
+     * Records the failure in the meta as is_transaction_ready_to_go would,
+     * without running check_tx_inputs
      */
-	void mark_double_spend(const transaction &tx);
+	void mark_tx_failed(const crypto::hash &id, parsed_tx &ptx);
 
 	/**
      * @brief prune lowest fee/byte txes till we're not above bytes
@@ -575,6 +609,10 @@ class tx_memory_pool : boost::noncopyable
      */
 	sorted_tx_container::iterator find_tx_in_sorted_container(const crypto::hash &id) const;
 
+	//! parsed copies of all the pool transactions, with their ready flag kept up to date
+	std::unordered_map<crypto::hash, parsed_tx> m_parsed_txs;
+	uint8_t m_parsed_txs_hf_version; //!< hard fork version the ready flags were computed for
+
 	//! transactions which are unlikely to be included in blocks
 	/*! These transactions are kept in RAM in case they *are* included
      *  in a block eventually, but this container is not saved to disk.
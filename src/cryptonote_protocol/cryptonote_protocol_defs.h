@@ -308,4 +308,38 @@ struct NOTIFY_REQUEST_FLUFFY_MISSING_TX
 		END_KV_SERIALIZE_MAP()
 	};
 };
+
+/************************************************************************/
+/*                                                                      */
+/************************************************************************/
+struct NOTIFY_TX_INVENTORY
+{
+	const static int ID = BC_COMMANDS_POOL_BASE + 10;
+
+	struct request
+	{
+		std::vector<crypto::hash> tx_hashes;
+
+		BEGIN_KV_SERIALIZE_MAP(request)
+		KV_SERIALIZE_CONTAINER_POD_AS_BLOB(tx_hashes)
+		END_KV_SERIALIZE_MAP()
+	};
+};
+
+/************************************************************************/
+/*                                                                      */
+/************************************************************************/
+struct NOTIFY_REQUEST_TX
+{
+	const static int ID = BC_COMMANDS_POOL_BASE + 11;
+
+	struct request
+	{
+		std::vector<crypto::hash> tx_hashes;
+
+		BEGIN_KV_SERIALIZE_MAP(request)
+		KV_SERIALIZE_CONTAINER_POD_AS_BLOB(tx_hashes)
+		END_KV_SERIALIZE_MAP()
+	};
+};
 }
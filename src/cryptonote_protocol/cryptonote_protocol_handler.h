@@ -54,14 +54,18 @@
 #include <string>
 
 #include "block_queue.h"
+#include "common/bloom_filter.hpp"
 #include "cryptonote_basic/connection_context.h"
 #include "cryptonote_basic/cryptonote_stat_info.h"
 #include "cryptonote_protocol_defs.h"
 #include "cryptonote_protocol_handler_common.h"
 #include "math_helper.h"
 #include "storages/levin_abstract_invoke2.h"
+#include "tx_relay.h"
 #include "warnings.h"
 #include <boost/circular_buffer.hpp>
+#include <map>
+#include <unordered_map>
 
 #include "common/gulps.hpp"
 
@@ -111,6 +115,8 @@ class t_cryptonote_protocol_handler : public i_cryptonote_protocol, cryptonote_p
 	HANDLE_NOTIFY_T2(NOTIFY_RESPONSE_CHAIN_ENTRY, &cryptonote_protocol_handler::handle_response_chain_entry)
 	HANDLE_NOTIFY_T2(NOTIFY_NEW_FLUFFY_BLOCK, &cryptonote_protocol_handler::handle_notify_new_fluffy_block)
 	HANDLE_NOTIFY_T2(NOTIFY_REQUEST_FLUFFY_MISSING_TX, &cryptonote_protocol_handler::handle_request_fluffy_missing_tx)
+	HANDLE_NOTIFY_T2(NOTIFY_TX_INVENTORY, &cryptonote_protocol_handler::handle_notify_tx_inventory)
+	HANDLE_NOTIFY_T2(NOTIFY_REQUEST_TX, &cryptonote_protocol_handler::handle_request_tx)
 	END_INVOKE_MAP2()
 
 	bool on_idle();
@@ -141,10 +147,12 @@ class t_cryptonote_protocol_handler : public i_cryptonote_protocol, cryptonote_p
 	int handle_response_chain_entry(int command, NOTIFY_RESPONSE_CHAIN_ENTRY::request &arg, cryptonote_connection_context &context);
 	int handle_notify_new_fluffy_block(int command, NOTIFY_NEW_FLUFFY_BLOCK::request &arg, cryptonote_connection_context &context);
 	int handle_request_fluffy_missing_tx(int command, NOTIFY_REQUEST_FLUFFY_MISSING_TX::request &arg, cryptonote_connection_context &context);
+	int handle_notify_tx_inventory(int command, NOTIFY_TX_INVENTORY::request &arg, cryptonote_connection_context &context);
+	int handle_request_tx(int command, NOTIFY_REQUEST_TX::request &arg, cryptonote_connection_context &context);
 
 	//----------------- i_bc_protocol_layout ---------------------------------------
 	virtual bool relay_block(NOTIFY_NEW_BLOCK::request &arg, cryptonote_connection_context &exclude_context);
-	virtual bool relay_transactions(NOTIFY_NEW_TRANSACTIONS::request &arg, cryptonote_connection_context &exclude_context);
+	virtual bool relay_transactions(NOTIFY_NEW_TRANSACTIONS::request &arg, const std::vector<crypto::hash> &tx_hashes, cryptonote_connection_context &exclude_context);
 	//----------------------------------------------------------------------------------
 	//bool get_payload_sync_data(HANDSHAKE_DATA::request& hshd, cryptonote_connection_context& context);
 	bool request_missing_objects(cryptonote_connection_context &context, bool check_having_blocks, bool force_next_span = false);
@@ -154,6 +162,7 @@ class t_cryptonote_protocol_handler : public i_cryptonote_protocol, cryptonote_p
 	void drop_connection(cryptonote_connection_context &context, bool add_fail, bool flush_all_spans);
 	bool kick_idle_peers();
 	int try_add_next_blocks(cryptonote_connection_context &context);
+	bool flush_tx_inventory();
 
 	t_core &m_core;
 
@@ -166,6 +175,46 @@ class t_cryptonote_protocol_handler : public i_cryptonote_protocol, cryptonote_p
 	block_queue m_block_queue;
 	epee::math_helper::once_a_time_seconds<30> m_idle_peer_kicker;
 
+	/*! Tx relay state of a peer that takes tx inventories instead of full txes.
+	 *  Txids the peer has seen are kept in two bloom filter generations, the
+	 *  older one is dropped once the newer one holds P2P_TX_KNOWN_FILTER_SIZE txids.
+	 */
+	struct tx_relay_peer
+	{
+		tx_relay_peer()
+		{
+			known_txs[0].init(P2P_TX_KNOWN_FILTER_SIZE);
+			known_txs[1].init(P2P_TX_KNOWN_FILTER_SIZE);
+		}
+
+		bool is_known(const crypto::hash &txid)
+		{
+			return !known_txs[0].not_present(&txid, sizeof(txid)) || !known_txs[1].not_present(&txid, sizeof(txid));
+		}
+
+		void add_known(const crypto::hash &txid)
+		{
+			if(is_known(txid))
+				return;
+			if(known_count == P2P_TX_KNOWN_FILTER_SIZE)
+			{
+				std::swap(known_txs[0], known_txs[1]);
+				known_txs[0].clear();
+				known_count = 0;
+			}
+			known_txs[0].add_element(&txid, sizeof(txid));
+			known_count++;
+		}
+
+		bloom_filter known_txs[2];
+		size_t known_count = 0;
+		std::vector<crypto::hash> announce_queue;
+	};
+
+	boost::mutex m_tx_relay_lock;
+	std::map<boost::uuids::uuid, tx_relay_peer> m_tx_relay_peers;
+	tx_request_tracker m_tx_requests;
+
 	boost::mutex m_buffer_mutex;
 	double get_avg_block_size();
 	boost::circular_buffer<size_t> m_avg_buffer = boost::circular_buffer<size_t>(10);
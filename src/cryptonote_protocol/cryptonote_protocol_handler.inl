@@ -750,6 +750,7 @@ int t_cryptonote_protocol_handler<t_core>::handle_notify_new_transactions(int co
 		return 1;
 	}
 
+	std::vector<crypto::hash> tx_hashes;
 	for(auto tx_blob_it = arg.txs.begin(); tx_blob_it != arg.txs.end();)
 	{
 		cryptonote::tx_verification_context tvc = AUTO_VAL_INIT(tvc);
@@ -761,17 +762,107 @@ int t_cryptonote_protocol_handler<t_core>::handle_notify_new_transactions(int co
 			return 1;
 		}
 		if(tvc.m_should_be_relayed)
+		{
+			tx_hashes.push_back(tvc.m_tx_hash);
 			++tx_blob_it;
+		}
 		else
 			arg.txs.erase(tx_blob_it++);
 	}
 
 	if(arg.txs.size())
+		relay_transactions(arg, tx_hashes, context);
+
+	return 1;
+}
+//------------------------------------------------------------------------------------------------------------------------
+template <class t_core>
+int t_cryptonote_protocol_handler<t_core>::handle_notify_tx_inventory(int command, NOTIFY_TX_INVENTORY::request &arg, cryptonote_connection_context &context)
+{
+	GULPS_P2P_MESSAGE("Received NOTIFY_TX_INVENTORY ({} txes)", arg.tx_hashes.size());
+	if(context.m_state != cryptonote_connection_context::state_normal)
+		return 1;
+
+	if(!is_synchronized())
+	{
+		GULPS_LOG_L1(context_str, " Received tx inventory while syncing, ignored");
+		return 1;
+	}
+
+	if(arg.tx_hashes.size() > P2P_TX_INVENTORY_MAX_HASHES)
+	{
+		GULPSF_INFO("{} Tx inventory of {} txes is too large, dropping connection", context_str, arg.tx_hashes.size());
+		drop_connection(context, false, false);
+		return 1;
+	}
+
+	// the pool is asked before taking m_tx_relay_lock, the core relays with its own locks held
+	std::vector<crypto::hash> missing;
+	for(const crypto::hash &txid : arg.tx_hashes)
+	{
+		if(!m_core.pool_has_tx(txid))
+			missing.push_back(txid);
+	}
+
+	NOTIFY_REQUEST_TX::request req;
+	{
+		CRITICAL_REGION_LOCAL(m_tx_relay_lock);
+		tx_relay_peer &peer = m_tx_relay_peers[context.m_connection_id];
+		for(const crypto::hash &txid : arg.tx_hashes)
+			peer.add_known(txid);
+
+		const time_t now = time(nullptr);
+		for(const crypto::hash &txid : missing)
+		{
+			if(m_tx_requests.announced(txid, context.m_connection_id, now))
+				req.tx_hashes.push_back(txid);
+		}
+	}
+
+	if(!req.tx_hashes.empty())
+	{
+		GULPSF_LOG_L1("{} -->>NOTIFY_REQUEST_TX: txs.size()={}", context_str, req.tx_hashes.size());
+		post_notify<NOTIFY_REQUEST_TX>(req, context);
+	}
+	return 1;
+}
+//------------------------------------------------------------------------------------------------------------------------
+template <class t_core>
+int t_cryptonote_protocol_handler<t_core>::handle_request_tx(int command, NOTIFY_REQUEST_TX::request &arg, cryptonote_connection_context &context)
+{
+	GULPS_P2P_MESSAGE("Received NOTIFY_REQUEST_TX ({} txes)", arg.tx_hashes.size());
+	if(arg.tx_hashes.size() > P2P_TX_INVENTORY_MAX_HASHES)
+	{
+		GULPSF_INFO("{} Tx request of {} txes is too large, dropping connection", context_str, arg.tx_hashes.size());
+		drop_connection(context, false, false);
+		return 1;
+	}
+
+	// only hand out txes this peer has been told about, the pool also holds txes that are not to be relayed
+	std::vector<crypto::hash> txids;
+	{
+		CRITICAL_REGION_LOCAL(m_tx_relay_lock);
+		tx_relay_peer &peer = m_tx_relay_peers[context.m_connection_id];
+		for(const crypto::hash &txid : arg.tx_hashes)
+		{
+			if(peer.is_known(txid))
+				txids.push_back(txid);
+		}
+	}
+
+	NOTIFY_NEW_TRANSACTIONS::request rsp;
+	for(const crypto::hash &txid : txids)
 	{
-		//TODO: add announce usage here
-		relay_transactions(arg, context);
+		cryptonote::blobdata tx_blob;
+		if(m_core.get_pool_transaction(txid, tx_blob))
+			rsp.txs.push_back(std::move(tx_blob));
 	}
 
+	if(!rsp.txs.empty())
+	{
+		GULPSF_LOG_L1("{} -->>NOTIFY_NEW_TRANSACTIONS: txs.size()={}", context_str, rsp.txs.size());
+		post_notify<NOTIFY_NEW_TRANSACTIONS>(rsp, context);
+	}
 	return 1;
 }
 //------------------------------------------------------------------------------------------------------------------------
@@ -1167,6 +1258,7 @@ template <class t_core>
 bool t_cryptonote_protocol_handler<t_core>::on_idle()
 {
 	m_idle_peer_kicker.do_call(boost::bind(&t_cryptonote_protocol_handler<t_core>::kick_idle_peers, this));
+	flush_tx_inventory();
 	return m_core.on_idle();
 }
 //------------------------------------------------------------------------------------------------------------------------
@@ -1201,6 +1293,68 @@ bool t_cryptonote_protocol_handler<t_core>::kick_idle_peers()
 }
 //------------------------------------------------------------------------------------------------------------------------
 template <class t_core>
+bool t_cryptonote_protocol_handler<t_core>::flush_tx_inventory()
+{
+	std::list<std::pair<boost::uuids::uuid, NOTIFY_TX_INVENTORY::request>> batches;
+	std::map<boost::uuids::uuid, std::vector<crypto::hash>> rerequests;
+	{
+		CRITICAL_REGION_LOCAL(m_tx_relay_lock);
+		for(auto &peer : m_tx_relay_peers)
+		{
+			std::vector<crypto::hash> &queue = peer.second.announce_queue;
+			for(size_t i = 0; i < queue.size(); i += P2P_TX_INVENTORY_MAX_HASHES)
+			{
+				batches.emplace_back();
+				batches.back().first = peer.first;
+				batches.back().second.tx_hashes.assign(queue.begin() + i, queue.begin() + std::min(queue.size(), i + P2P_TX_INVENTORY_MAX_HASHES));
+			}
+			queue.clear();
+		}
+
+		// requests nobody answered go to the next peer that announced the tx
+		m_tx_requests.expire(time(nullptr), rerequests);
+	}
+
+	for(auto &batch : batches)
+	{
+		std::string blob;
+		epee::serialization::store_t_to_binary(batch.second, blob);
+		m_p2p->relay_notify_to_list(NOTIFY_TX_INVENTORY::ID, blob, std::list<boost::uuids::uuid>{batch.first});
+	}
+
+	// the pool is asked outside m_tx_relay_lock, see handle_notify_tx_inventory
+	std::vector<crypto::hash> arrived;
+	for(auto &rerequest : rerequests)
+	{
+		std::vector<crypto::hash> missing;
+		for(const crypto::hash &txid : rerequest.second)
+		{
+			if(m_core.pool_has_tx(txid))
+				arrived.push_back(txid);
+			else
+				missing.push_back(txid);
+		}
+		for(size_t i = 0; i < missing.size(); i += P2P_TX_INVENTORY_MAX_HASHES)
+		{
+			NOTIFY_REQUEST_TX::request batch;
+			batch.tx_hashes.assign(missing.begin() + i, missing.begin() + std::min(missing.size(), i + P2P_TX_INVENTORY_MAX_HASHES));
+			GULPSF_LOG_L1("-->>NOTIFY_REQUEST_TX: txs.size()={}, asking the next announcer", batch.tx_hashes.size());
+			std::string blob;
+			epee::serialization::store_t_to_binary(batch, blob);
+			m_p2p->relay_notify_to_list(NOTIFY_REQUEST_TX::ID, blob, std::list<boost::uuids::uuid>{rerequest.first});
+		}
+	}
+
+	if(!arrived.empty())
+	{
+		CRITICAL_REGION_LOCAL(m_tx_relay_lock);
+		for(const crypto::hash &txid : arrived)
+			m_tx_requests.received(txid);
+	}
+	return true;
+}
+//------------------------------------------------------------------------------------------------------------------------
+template <class t_core>
 int t_cryptonote_protocol_handler<t_core>::handle_request_chain(int command, NOTIFY_REQUEST_CHAIN::request &arg, cryptonote_connection_context &context)
 {
 	GULPS_P2P_MESSAGE("Received NOTIFY_REQUEST_CHAIN ({} blocks", arg.block_ids.size() );
@@ -1668,12 +1822,48 @@ bool t_cryptonote_protocol_handler<t_core>::relay_block(NOTIFY_NEW_BLOCK::reques
 }
 //------------------------------------------------------------------------------------------------------------------------
 template <class t_core>
-bool t_cryptonote_protocol_handler<t_core>::relay_transactions(NOTIFY_NEW_TRANSACTIONS::request &arg, cryptonote_connection_context &exclude_context)
+bool t_cryptonote_protocol_handler<t_core>::relay_transactions(NOTIFY_NEW_TRANSACTIONS::request &arg, const std::vector<crypto::hash> &tx_hashes, cryptonote_connection_context &exclude_context)
 {
 	// no check for success, so tell core they're relayed unconditionally
-	for(auto tx_blob_it = arg.txs.begin(); tx_blob_it != arg.txs.end(); ++tx_blob_it)
-		m_core.on_transaction_relayed(*tx_blob_it);
-	return relay_post_notify<NOTIFY_NEW_TRANSACTIONS>(arg, exclude_context);
+	m_core.on_transactions_relayed(tx_hashes);
+
+	{
+		CRITICAL_REGION_LOCAL(m_tx_relay_lock);
+		for(const crypto::hash &tx_hash : tx_hashes)
+			m_tx_requests.received(tx_hash);
+	}
+
+	// peers taking inventories get the txids on the next idle tick, the rest the full txes now
+	// the announce queues are filled while the connection is known to be open, so a peer closing
+	// during the walk has its relay state erased by on_connection_close rather than recreated here
+	std::list<boost::uuids::uuid> full_connections;
+	m_p2p->for_each_connection([this, &exclude_context, &full_connections, &tx_hashes](connection_context &context, nodetool::peerid_type peer_id, uint32_t support_flags) {
+		if(peer_id && exclude_context.m_connection_id != context.m_connection_id)
+		{
+			if(support_flags & P2P_SUPPORT_FLAG_TX_INVENTORY)
+			{
+				CRITICAL_REGION_LOCAL(m_tx_relay_lock);
+				tx_relay_peer &peer = m_tx_relay_peers[context.m_connection_id];
+				for(const crypto::hash &tx_hash : tx_hashes)
+				{
+					if(peer.is_known(tx_hash))
+						continue;
+					peer.add_known(tx_hash);
+					peer.announce_queue.push_back(tx_hash);
+				}
+			}
+			else
+				full_connections.push_back(context.m_connection_id);
+		}
+		return true;
+	});
+
+	if(full_connections.empty())
+		return true;
+
+	std::string arg_buff;
+	epee::serialization::store_t_to_binary(arg, arg_buff);
+	return m_p2p->relay_notify_to_list(NOTIFY_NEW_TRANSACTIONS::ID, arg_buff, full_connections);
 }
 //------------------------------------------------------------------------------------------------------------------------
 template <class t_core>
@@ -1703,6 +1893,10 @@ void t_cryptonote_protocol_handler<t_core>::on_connection_close(cryptonote_conne
 	}
 
 	m_block_queue.flush_spans(context.m_connection_id, false);
+
+	CRITICAL_REGION_LOCAL(m_tx_relay_lock);
+	m_tx_relay_peers.erase(context.m_connection_id);
+	m_tx_requests.flush_connection(context.m_connection_id);
 }
 
 //------------------------------------------------------------------------------------------------------------------------
@@ -57,7 +57,8 @@ namespace cryptonote
 struct i_cryptonote_protocol
 {
 	virtual bool relay_block(NOTIFY_NEW_BLOCK::request &arg, cryptonote_connection_context &exclude_context) = 0;
-	virtual bool relay_transactions(NOTIFY_NEW_TRANSACTIONS::request &arg, cryptonote_connection_context &exclude_context) = 0;
+	//! tx_hashes holds the hash of each of arg.txs, in the same order
+	virtual bool relay_transactions(NOTIFY_NEW_TRANSACTIONS::request &arg, const std::vector<crypto::hash> &tx_hashes, cryptonote_connection_context &exclude_context) = 0;
 	//virtual bool request_objects(NOTIFY_REQUEST_GET_OBJECTS::request& arg, cryptonote_connection_context& context)=0;
 };
 
@@ -70,7 +71,7 @@ struct cryptonote_protocol_stub : public i_cryptonote_protocol
 	{
 		return false;
 	}
-	virtual bool relay_transactions(NOTIFY_NEW_TRANSACTIONS::request &arg, cryptonote_connection_context &exclude_context)
+	virtual bool relay_transactions(NOTIFY_NEW_TRANSACTIONS::request &arg, const std::vector<crypto::hash> &tx_hashes, cryptonote_connection_context &exclude_context)
 	{
 		return false;
 	}
@@ -0,0 +1,127 @@
+// Copyright (c) 2020, pasta Currency Project
+// Portions copyright (c) 2014-2018, The Monero Project
+//
+// Portions of this file are available under BSD-3 license. Please see ORIGINAL-LICENSE for details
+// All rights reserved.
+//
+// Authors and copyright holders give permission for following:
+//
+// 1. Redistribution and use in source and binary forms WITHOUT modification.
+//
+// 2. Modification of the source form for your own personal use.
+//
+// As long as the following conditions are met:
+//
+// 3. You must not distribute modified copies of the work to third parties. This includes
+//    posting the work online, or hosting copies of the modified work for download.
+//
+// 4. Any derivative version of this work is also covered by this license, including point 8.
+//
+// 5. Neither the name of the copyright holders nor the names of the authors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+//
+// 6. You agree that this licence is governed by and shall be construed in accordance
+//    with the laws of England and Wales.
+//
+// 7. You agree to submit all disputes arising out of or in connection with this licence
+//    to the exclusive jurisdiction of the Courts of England and Wales.
+//
+// Authors and copyright holders agree that:
+//
+// 8. This licence expires and the work covered by it is released into the
+//    public domain on 1st of February 2021
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "tx_relay.h"
+#include "cryptonote_config.h"
+#include <algorithm>
+
+namespace cryptonote
+{
+
+bool tx_request_tracker::announced(const crypto::hash &txid, const boost::uuids::uuid &connection_id, time_t now)
+{
+	auto it = m_requests.find(txid);
+	if(it == m_requests.end())
+	{
+		m_requests.emplace(txid, request{connection_id, now, {}});
+		return true;
+	}
+
+	request &req = it->second;
+	if(req.connection_id == connection_id)
+		return false;
+
+	std::deque<boost::uuids::uuid> &announcers = req.announcers;
+	auto announcer = std::find(announcers.begin(), announcers.end(), connection_id);
+	if(now - req.time > P2P_TX_REQUEST_TIMEOUT)
+	{
+		// the peer asked went quiet and expire has not run yet, ask this one straight away
+		if(announcer != announcers.end())
+			announcers.erase(announcer);
+		req.connection_id = connection_id;
+		req.time = now;
+		return true;
+	}
+
+	if(announcer == announcers.end() && announcers.size() < P2P_TX_REQUEST_MAX_ANNOUNCERS)
+		announcers.push_back(connection_id);
+	return false;
+}
+
+void tx_request_tracker::received(const crypto::hash &txid)
+{
+	m_requests.erase(txid);
+}
+
+void tx_request_tracker::flush_connection(const boost::uuids::uuid &connection_id)
+{
+	for(auto &req : m_requests)
+	{
+		std::deque<boost::uuids::uuid> &announcers = req.second.announcers;
+		announcers.erase(std::remove(announcers.begin(), announcers.end(), connection_id), announcers.end());
+		if(req.second.connection_id == connection_id)
+			req.second.time = 0;
+	}
+}
+
+void tx_request_tracker::expire(time_t now, std::map<boost::uuids::uuid, std::vector<crypto::hash>> &requests)
+{
+	for(auto it = m_requests.begin(); it != m_requests.end();)
+	{
+		request &req = it->second;
+		if(now - req.time <= P2P_TX_REQUEST_TIMEOUT)
+		{
+			++it;
+			continue;
+		}
+
+		if(req.announcers.empty())
+		{
+			it = m_requests.erase(it);
+			continue;
+		}
+
+		req.connection_id = req.announcers.front();
+		req.announcers.pop_front();
+		req.time = now;
+		requests[req.connection_id].push_back(it->first);
+		++it;
+	}
+}
+
+bool tx_request_tracker::requested(const crypto::hash &txid) const
+{
+	return m_requests.find(txid) != m_requests.end();
+}
+}
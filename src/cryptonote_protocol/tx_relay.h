@@ -0,0 +1,91 @@
+// Copyright (c) 2020, pasta Currency Project
+// Portions copyright (c) 2014-2018, The Monero Project
+//
+// Portions of this file are available under BSD-3 license. Please see ORIGINAL-LICENSE for details
+// All rights reserved.
+//
+// Authors and copyright holders give permission for following:
+//
+// 1. Redistribution and use in source and binary forms WITHOUT modification.
+//
+// 2. Modification of the source form for your own personal use.
+//
+// As long as the following conditions are met:
+//
+// 3. You must not distribute modified copies of the work to third parties. This includes
+//    posting the work online, or hosting copies of the modified work for download.
+//
+// 4. Any derivative version of this work is also covered by this license, including point 8.
+//
+// 5. Neither the name of the copyright holders nor the names of the authors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+//
+// 6. You agree that this licence is governed by and shall be construed in accordance
+//    with the laws of England and Wales.
+//
+// 7. You agree to submit all disputes arising out of or in connection with this licence
+//    to the exclusive jurisdiction of the Courts of England and Wales.
+//
+// Authors and copyright holders agree that:
+//
+// 8. This licence expires and the work covered by it is released into the
+//    public domain on 1st of February 2021
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#pragma once
+
+#include <boost/uuid/uuid.hpp>
+#include <ctime>
+#include <deque>
+#include <map>
+#include <unordered_map>
+#include <vector>
+#include "crypto/hash.h"
+
+namespace cryptonote
+{
+/*! Txes asked from peers after they announced them in a tx inventory.
+ *  Each request remembers the peer asked and the other peers that announced
+ *  the same tx meanwhile, so a request nobody answers moves on to the next
+ *  announcer instead of waiting for the tx to be announced again.
+ *  Not thread safe, the protocol handler holds m_tx_relay_lock around it.
+ */
+class tx_request_tracker
+{
+  public:
+	/*! A peer announced txid, returns true if it is to be asked for it now.
+	 *  Otherwise the peer is kept as a fallback for the outstanding request.
+	 */
+	bool announced(const crypto::hash &txid, const boost::uuids::uuid &connection_id, time_t now);
+	//! txid arrived or is no longer wanted, forget its request
+	void received(const crypto::hash &txid);
+	//! the connection closed, its requests move to the next announcer on the next expire
+	void flush_connection(const boost::uuids::uuid &connection_id);
+	/*! Moves requests older than P2P_TX_REQUEST_TIMEOUT to their next announcer
+	 *  and adds them to requests, requests with no announcer left are dropped.
+	 */
+	void expire(time_t now, std::map<boost::uuids::uuid, std::vector<crypto::hash>> &requests);
+	bool requested(const crypto::hash &txid) const;
+	size_t size() const { return m_requests.size(); }
+
+  private:
+	struct request
+	{
+		boost::uuids::uuid connection_id;
+		time_t time; //!< when connection_id was asked, 0 if it closed
+		std::deque<boost::uuids::uuid> announcers;
+	};
+
+	std::unordered_map<crypto::hash, request> m_requests;
+};
+}
@@ -276,7 +276,7 @@ int main(int argc, char* argv[])
 				if(msg.out == gulps::OUT_USER_1)
 					return true;
 				return false;
-			});
+			}, [](gulps::output out, gulps::level lvl) -> bool { return out == gulps::OUT_USER_1; });
 			gulps::inst().add_output(std::move(gout_ptr));
 
 			auto command = command_line::get_arg(vm, daemon_args::arg_command);
@@ -342,7 +342,7 @@ int main(int argc, char* argv[])
 			if(msg.out == gulps::OUT_USER_1)
 				return !printed;
 			return false;
-		});
+		}, [](gulps::output out, gulps::level lvl) -> bool { return out == gulps::OUT_USER_1; });
 		gulps::inst().add_output(std::move(gout_ptr));
 
 		// OS
@@ -358,13 +358,14 @@ int main(int argc, char* argv[])
 			if(printed)
 				return false;
 			return log_scr.match_msg(msg);
-		});
+		}, [](gulps::output out, gulps::level lvl) -> bool { return log_scr.may_match(lvl); });
 		gulps::inst().add_output(std::move(gout_ptr));
 
 		if(log_dsk.is_active())
 		{
 			gout_ptr.reset(new gulps::gulps_async_file_output(log_file_path.string()));
-			gout_ptr->add_filter([](const gulps::message& msg, bool printed, bool logged) -> bool { return log_dsk.match_msg(msg); });
+			gout_ptr->add_filter([](const gulps::message& msg, bool printed, bool logged) -> bool { return log_dsk.match_msg(msg); },
+				[](gulps::output out, gulps::level lvl) -> bool { return log_dsk.may_match(lvl); });
 			gulps::inst().add_output(std::move(gout_ptr));
 		}
 		gulps::inst().remove_output(temp_out_id);
@@ -0,0 +1,153 @@
+// Copyright (c) 2020, pasta Currency Project
+//
+// Portions of this file are available under BSD-3 license. Please see ORIGINAL-LICENSE for details
+// All rights reserved.
+//
+// Authors and copyright holders give permission for following:
+//
+// 1. Redistribution and use in source and binary forms WITHOUT modification.
+//
+// 2. Modification of the source form for your own personal use.
+//
+// As long as the following conditions are met:
+//
+// 3. You must not distribute modified copies of the work to third parties. This includes
+//    posting the work online, or hosting copies of the modified work for download.
+//
+// 4. Any derivative version of this work is also covered by this license, including point 8.
+//
+// 5. Neither the name of the copyright holders nor the names of the authors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+//
+// 6. You agree that this licence is governed by and shall be construed in accordance
+//    with the laws of England and Wales.
+//
+// 7. You agree to submit all disputes arising out of or in connection with this licence
+//    to the exclusive jurisdiction of the Courts of England and Wales.
+//
+// Authors and copyright holders agree that:
+//
+// 8. This licence expires and the work covered by it is released into the
+//    public domain on 1st of February 2021
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "point_cache.h"
+#include "cryptonote_config.h"
+
+namespace rct
+{
+point_cache::point_cache() : m_capacity(CRYPTONOTE_RCT_POINT_CACHE_SIZE), m_hits(0), m_misses(0), m_warms(0)
+{
+	ge_p3 base_p3;
+	ge_frombytes_vartime(&base_p3, G.bytes);
+	ge_dsm_precomp(m_base, &base_p3);
+}
+
+std::shared_ptr<const point_cache::entry> point_cache::lookup(const key &k, bool with_hash_point, bool count)
+{
+	const size_t capacity = m_capacity;
+	if(capacity == 0)
+		return nullptr;
+
+	shard &s = m_shards[k.bytes[0] % shard_count];
+	std::shared_ptr<const entry> found;
+	{
+		std::lock_guard<std::mutex> lock(s.lock);
+		auto it = s.map.find(k);
+		if(it != s.map.end())
+		{
+			s.lru.splice(s.lru.begin(), s.lru, it->second);
+			found = it->second->second;
+		}
+	}
+
+	if(found && (found->has_hash_point || !with_hash_point))
+	{
+		if(count)
+			++m_hits;
+		return found;
+	}
+	if(count)
+		++m_misses;
+
+	// Decompress outside the lock, two threads racing on one key just do the work twice
+	std::shared_ptr<entry> e = std::make_shared<entry>();
+	if(found)
+	{
+		*e = *found;
+	}
+	else
+	{
+		if(ge_frombytes_vartime(&e->p3, k.bytes) != 0)
+			return nullptr;
+		ge_dsm_precomp(e->point, &e->p3);
+		e->has_hash_point = false;
+	}
+
+	if(with_hash_point)
+	{
+		key hash_point;
+		ge_p3 hash_p3;
+		hashToPoint(hash_point, k);
+		if(hash_point == identity() || ge_frombytes_vartime(&hash_p3, hash_point.bytes) != 0)
+			return nullptr;
+		ge_dsm_precomp(e->hash_point, &hash_p3);
+		e->has_hash_point = true;
+	}
+
+	std::lock_guard<std::mutex> lock(s.lock);
+	auto it = s.map.find(k);
+	if(it != s.map.end())
+	{
+		if(e->has_hash_point || !it->second->second->has_hash_point)
+			it->second->second = e;
+		s.lru.splice(s.lru.begin(), s.lru, it->second);
+	}
+	else
+	{
+		s.lru.emplace_front(k, e);
+		s.map.emplace(k, s.lru.begin());
+		evict(s, (capacity + shard_count - 1) / shard_count);
+	}
+	return e;
+}
+
+void point_cache::set_capacity(size_t capacity)
+{
+	m_capacity = capacity;
+	for(shard &s : m_shards)
+	{
+		std::lock_guard<std::mutex> lock(s.lock);
+		evict(s, (capacity + shard_count - 1) / shard_count);
+	}
+}
+
+void point_cache::clear()
+{
+	for(shard &s : m_shards)
+	{
+		std::lock_guard<std::mutex> lock(s.lock);
+		s.map.clear();
+		s.lru.clear();
+	}
+}
+
+void point_cache::evict(shard &s, size_t shard_capacity)
+{
+	while(s.lru.size() > shard_capacity)
+	{
+		s.map.erase(s.lru.back().first);
+		s.lru.pop_back();
+	}
+}
+}
@@ -0,0 +1,157 @@
+// Copyright (c) 2020, pasta Currency Project
+//
+// Portions of this file are available under BSD-3 license. Please see ORIGINAL-LICENSE for details
+// All rights reserved.
+//
+// Authors and copyright holders give permission for following:
+//
+// 1. Redistribution and use in source and binary forms WITHOUT modification.
+//
+// 2. Modification of the source form for your own personal use.
+//
+// As long as the following conditions are met:
+//
+// 3. You must not distribute modified copies of the work to third parties. This includes
+//    posting the work online, or hosting copies of the modified work for download.
+//
+// 4. Any derivative version of this work is also covered by this license, including point 8.
+//
+// 5. Neither the name of the copyright holders nor the names of the authors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+//
+// 6. You agree that this licence is governed by and shall be construed in accordance
+//    with the laws of England and Wales.
+//
+// 7. You agree to submit all disputes arising out of or in connection with this licence
+//    to the exclusive jurisdiction of the Courts of England and Wales.
+//
+// Authors and copyright holders agree that:
+//
+// 8. This licence expires and the work covered by it is released into the
+//    public domain on 1st of February 2021
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#pragma once
+
+#ifndef RCT_POINT_CACHE_H
+#define RCT_POINT_CACHE_H
+
+#include <atomic>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+
+#include "rctOps.h"
+
+namespace rct
+{
+/*!
+ * \brief A process wide LRU of decompressed ring member points
+ *
+ * Verifying a ring signature decompresses every ring member's output key and
+ * commitment and hashes each key to a point, and the same popular outputs come
+ * up as decoys in tx after tx. Entries are keyed by the compressed point itself,
+ * so a reorg or a pool tx spending outputs we have not seen can never make an
+ * entry stale; a key that does not decompress is never cached.
+ *
+ * The table is split into shards by the first key byte, each an LRU list behind
+ * its own mutex, so the verification threads rarely wait on one another.
+ * Entries are handed out as shared pointers and stay valid after eviction.
+ */
+class point_cache
+{
+  public:
+	struct entry
+	{
+		ge_p3 p3;			  //!< the point itself
+		ge_dsmp point;		  //!< precomputed multiples of the point
+		bool has_hash_point;  //!< whether hash_point is filled in
+		ge_dsmp hash_point;   //!< precomputed multiples of hashToPoint(key)
+	};
+
+	static constexpr size_t shard_count = 16;
+
+	static point_cache &getInstance()
+	{
+		static point_cache instance;
+		return instance;
+	}
+
+	/*!
+	 * \brief get the decompressed point, decompressing it on a miss
+	 *
+	 * @param k the compressed point
+	 * @param with_hash_point also fill in the key's hashed point, as needed
+	 *        for the key image rows of an MLSAG
+	 *
+	 * @return the entry, or nullptr if the cache is disabled, k is not a
+	 *         valid point or it hashes to the identity
+	 */
+	std::shared_ptr<const entry> get(const key &k, bool with_hash_point) { return lookup(k, with_hash_point, true); }
+
+	/*!
+	 * \brief decompress k ahead of its verification, e.g. while prefetching ring members
+	 *
+	 * Counted as a warm rather than a hit or miss, so the hit rate reflects the
+	 * signature checks only. Warming more points than the cache holds evicts the
+	 * ones warmed first before they are used.
+	 */
+	void warm(const key &k, bool with_hash_point)
+	{
+		++m_warms;
+		lookup(k, with_hash_point, false);
+	}
+
+	//! precomputed multiples of the base point G
+	const ge_cached *base() const { return m_base; }
+
+	/*!
+	 * \brief set the number of cached points, 0 disables the cache
+	 *
+	 * Each entry takes about 2.7 kB.
+	 */
+	void set_capacity(size_t capacity);
+	size_t get_capacity() const { return m_capacity; }
+
+	void clear();
+
+	uint64_t get_hits() const { return m_hits; }
+	uint64_t get_misses() const { return m_misses; }
+	uint64_t get_warms() const { return m_warms; }
+
+  private:
+	typedef std::list<std::pair<key, std::shared_ptr<const entry>>> lru_list;
+
+	struct shard
+	{
+		std::mutex lock;
+		lru_list lru;
+		std::unordered_map<key, lru_list::iterator> map;
+	};
+
+	point_cache();
+
+	std::shared_ptr<const entry> lookup(const key &k, bool with_hash_point, bool count);
+	void evict(shard &s, size_t shard_capacity);
+
+	shard m_shards[shard_count];
+	std::atomic<size_t> m_capacity;
+	std::atomic<uint64_t> m_hits;
+	std::atomic<uint64_t> m_misses;
+	std::atomic<uint64_t> m_warms;
+	ge_dsmp m_base;
+};
+}
+
+#endif
@@ -46,6 +46,7 @@
 
 #include "rctSigs.h"
 #include "bulletproofs.h"
+#include "point_cache.h"
 #include "common/perf_timer.h"
 #include "common/threadpool.h"
 #include "common/util.h"
@@ -334,16 +335,26 @@ bool MLSAG_Ver(const key &message, const keyM &pk, const mgSig &rv, size_t dsRow
 	size_t ndsRows = 3 * dsRows; //non Double Spendable Rows (see identity chains paper
 	keyV toHash(1 + 3 * dsRows + 2 * (rows - dsRows));
 	toHash[0] = message;
+	point_cache &cache = point_cache::getInstance();
 	i = 0;
 	while(i < cols)
 	{
 		sc_0(c.bytes);
 		for(j = 0; j < dsRows; j++)
 		{
-			addKeys2(L, rv.ss[i][j], c_old, pk[i][j]);
-			hashToPoint(Hi, pk[i][j]);
-			GULPS_CHECK_AND_ASSERT_MES(!(Hi == rct::identity()), false, "Data hashed to point at infinity");
-			addKeys3(R, rv.ss[i][j], Hi, c_old, Ip[j].k);
+			std::shared_ptr<const point_cache::entry> pt = cache.get(pk[i][j], true);
+			if(pt)
+			{
+				addKeys3(L, rv.ss[i][j], cache.base(), c_old, pt->point);
+				addKeys3(R, rv.ss[i][j], pt->hash_point, c_old, Ip[j].k);
+			}
+			else
+			{
+				addKeys2(L, rv.ss[i][j], c_old, pk[i][j]);
+				hashToPoint(Hi, pk[i][j]);
+				GULPS_CHECK_AND_ASSERT_MES(!(Hi == rct::identity()), false, "Data hashed to point at infinity");
+				addKeys3(R, rv.ss[i][j], Hi, c_old, Ip[j].k);
+			}
 			toHash[3 * j + 1] = pk[i][j];
 			toHash[3 * j + 2] = L;
 			toHash[3 * j + 3] = R;
@@ -670,11 +681,25 @@ bool verRctMGSimple(const key &message, const mgSig &mg, const ctkeyV &pubs, con
 		keyV tmp(rows + 1);
 		size_t i;
 		keyM M(cols, tmp);
+		point_cache &cache = point_cache::getInstance();
+		ge_p3 C_p3, M_p3;
+		ge_cached C_cached;
+		ge_p1p1 M_p1p1;
+		GULPS_CHECK_AND_ASSERT_MES(ge_frombytes_vartime(&C_p3, C.bytes) == 0, false, "Bad pseudo out");
+		ge_p3_to_cached(&C_cached, &C_p3);
 		//create the matrix to mg sig
 		for(i = 0; i < cols; i++)
 		{
 			M[i][0] = pubs[i].dest;
-			subKeys(M[i][1], pubs[i].mask, C);
+			std::shared_ptr<const point_cache::entry> pt = cache.get(pubs[i].mask, false);
+			if(pt)
+			{
+				ge_sub(&M_p1p1, &pt->p3, &C_cached);
+				ge_p1p1_to_p3(&M_p3, &M_p1p1);
+				ge_p3_tobytes(M[i][1].bytes, &M_p3);
+			}
+			else
+				subKeys(M[i][1], pubs[i].mask, C);
 		}
 		//DP(C);
 		return MLSAG_Ver(message, M, mg, rows);
@@ -64,6 +64,7 @@ extern "C" {
 
 #include "hex.h"
 #include "serialization/binary_archive.h"
+#include "serialization/binary_span_archive.h"
 #include "serialization/debug_archive.h"
 #include "serialization/json_archive.h"
 #include "serialization/vector.h"
@@ -59,7 +59,6 @@ using namespace epee;
 #include "cryptonote_basic/account.h"
 #include "cryptonote_basic/cryptonote_basic_impl.h"
 #include "cryptonote_basic/cryptonote_format_utils.h"
-#include "get_output_distribution_cache.h"
 #include "misc_language.h"
 #include "p2p/net_node.h"
 #include "rpc/rpc_args.h"
@@ -516,9 +515,11 @@ bool core_rpc_server::on_get_transactions(const COMMAND_RPC_GET_TRANSACTIONS::re
 		}
 		vh.push_back(*reinterpret_cast<const crypto::hash *>(b.data()));
 	}
+	// Txes in the chain are served straight from the DB, which stores the pruned part separately,
+	// they are only parsed when asked for as JSON
 	std::list<crypto::hash> missed_txs;
-	std::list<transaction> txs;
-	bool r = m_core.get_transactions(vh, txs, missed_txs);
+	std::list<blobdata> txs;
+	bool r = m_core.get_transactions(vh, txs, missed_txs, req.prune);
 	if(!r)
 	{
 		res.status = "Failed";
@@ -538,7 +539,7 @@ bool core_rpc_server::on_get_transactions(const COMMAND_RPC_GET_TRANSACTIONS::re
 		if(r)
 		{
 			// sort to match original request
-			std::list<transaction> sorted_txs;
+			std::list<blobdata> sorted_txs;
 			std::vector<tx_info>::const_iterator i;
 			for(const crypto::hash &h : vh)
 			{
@@ -550,23 +551,17 @@ bool core_rpc_server::on_get_transactions(const COMMAND_RPC_GET_TRANSACTIONS::re
 						return true;
 					}
 					// core returns the ones it finds in the right order
-					if(get_transaction_hash(txs.front()) != h)
-					{
-						res.status = "Failed: tx hash mismatch";
-						return true;
-					}
 					sorted_txs.push_back(std::move(txs.front()));
 					txs.pop_front();
 				}
 				else if((i = std::find_if(pool_tx_info.begin(), pool_tx_info.end(), [h](const tx_info &txi) { return epee::string_tools::pod_to_hex(h) == txi.id_hash; })) != pool_tx_info.end())
 				{
-					cryptonote::transaction tx;
-					if(!cryptonote::parse_and_validate_tx_from_blob(i->tx_blob, tx))
+					sorted_txs.push_back(req.prune ? get_pruned_tx_blob(i->tx_blob) : i->tx_blob);
+					if(sorted_txs.back().empty())
 					{
 						res.status = "Failed to parse and validate tx from blob";
 						return true;
 					}
-					sorted_txs.push_back(tx);
 					missed_txs.remove(h);
 					pool_tx_hashes.insert(h);
 					const std::string hash_string = epee::string_tools::pod_to_hex(h);
@@ -581,24 +576,31 @@ bool core_rpc_server::on_get_transactions(const COMMAND_RPC_GET_TRANSACTIONS::re
 					++found_in_pool;
 				}
 			}
-			txs = sorted_txs;
+			txs = std::move(sorted_txs);
 		}
 		GULPSF_LOG_L2("Found {}/{} transactions in the pool", found_in_pool , vh.size() );
 	}
 
 	std::list<std::string>::const_iterator txhi = req.txs_hashes.begin();
 	std::vector<crypto::hash>::const_iterator vhi = vh.begin();
-	for(auto &tx : txs)
+	for(const blobdata &blob : txs)
 	{
 		res.txs.push_back(COMMAND_RPC_GET_TRANSACTIONS::entry());
 		COMMAND_RPC_GET_TRANSACTIONS::entry &e = res.txs.back();
 
 		crypto::hash tx_hash = *vhi++;
 		e.tx_hash = *txhi++;
-		blobdata blob = req.prune ? get_pruned_tx_blob(tx) : t_serializable_object_to_blob(tx);
 		e.as_hex = string_tools::buff_to_hex_nodelimer(blob);
 		if(req.decode_as_json)
+		{
+			transaction tx;
+			if(!(req.prune ? parse_and_validate_tx_base_from_blob(blob, tx) : parse_and_validate_tx_from_blob(blob, tx)))
+			{
+				res.status = "Failed to parse and validate tx from blob";
+				return true;
+			}
 			e.as_json = obj_to_json_str(tx);
+		}
 		e.in_pool = pool_tx_hashes.find(tx_hash) != pool_tx_hashes.end();
 		if(e.in_pool)
 		{
@@ -669,46 +671,17 @@ bool core_rpc_server::on_is_key_image_spent(const COMMAND_RPC_IS_KEY_IMAGE_SPENT
 		}
 		key_images.push_back(*reinterpret_cast<const crypto::key_image *>(b.data()));
 	}
-	std::vector<bool> spent_status;
-	bool r = m_core.are_key_images_spent(key_images, spent_status);
+	std::vector<key_image_index::spent_status> spent_status;
+	bool r = m_core.get_key_images_spent_status(key_images, spent_status, !request_has_rpc_origin || !m_restricted);
 	if(!r)
 	{
 		res.status = "Failed";
 		return true;
 	}
 	res.spent_status.clear();
-	for(size_t n = 0; n < spent_status.size(); ++n)
-		res.spent_status.push_back(spent_status[n] ? COMMAND_RPC_IS_KEY_IMAGE_SPENT::SPENT_IN_BLOCKCHAIN : COMMAND_RPC_IS_KEY_IMAGE_SPENT::UNSPENT);
-
-	// check the pool too
-	std::vector<cryptonote::tx_info> txs;
-	std::vector<cryptonote::spent_key_image_info> ki;
-	r = m_core.get_pool_transactions_and_spent_keys_info(txs, ki, !request_has_rpc_origin || !m_restricted);
-	if(!r)
-	{
-		res.status = "Failed";
-		return true;
-	}
-	for(std::vector<cryptonote::spent_key_image_info>::const_iterator i = ki.begin(); i != ki.end(); ++i)
-	{
-		crypto::hash hash;
-		crypto::key_image spent_key_image;
-		if(parse_hash256(i->id_hash, hash))
-		{
-			memcpy(&spent_key_image, &hash, sizeof(hash)); // a bit dodgy, should be other parse functions somewhere
-			for(size_t n = 0; n < res.spent_status.size(); ++n)
-			{
-				if(res.spent_status[n] == COMMAND_RPC_IS_KEY_IMAGE_SPENT::UNSPENT)
-				{
-					if(key_images[n] == spent_key_image)
-					{
-						res.spent_status[n] = COMMAND_RPC_IS_KEY_IMAGE_SPENT::SPENT_IN_POOL;
-						break;
-					}
-				}
-			}
-		}
-	}
+	res.spent_status.reserve(spent_status.size());
+	for(key_image_index::spent_status st : spent_status)
+		res.spent_status.push_back(st == key_image_index::SPENT_IN_CHAIN ? COMMAND_RPC_IS_KEY_IMAGE_SPENT::SPENT_IN_BLOCKCHAIN : st == key_image_index::SPENT_IN_POOL ? COMMAND_RPC_IS_KEY_IMAGE_SPENT::SPENT_IN_POOL : COMMAND_RPC_IS_KEY_IMAGE_SPENT::UNSPENT);
 
 	res.status = CORE_RPC_STATUS_OK;
 	return true;
@@ -776,7 +749,7 @@ bool core_rpc_server::on_send_raw_tx(const COMMAND_RPC_SEND_RAW_TX::request &req
 
 	NOTIFY_NEW_TRANSACTIONS::request r;
 	r.txs.push_back(tx_blob);
-	m_core.get_protocol()->relay_transactions(r, fake_context);
+	m_core.get_protocol()->relay_transactions(r, {tvc.m_tx_hash}, fake_context);
 	//TODO: make sure that tx has reached other nodes here, probably wait to receive reflections from other nodes
 	res.status = CORE_RPC_STATUS_OK;
 	return true;
@@ -1973,7 +1946,7 @@ bool core_rpc_server::on_relay_tx(const COMMAND_RPC_RELAY_TX::request &req, COMM
 			cryptonote_connection_context fake_context = AUTO_VAL_INIT(fake_context);
 			NOTIFY_NEW_TRANSACTIONS::request r;
 			r.txs.push_back(txblob);
-			m_core.get_protocol()->relay_transactions(r, fake_context);
+			m_core.get_protocol()->relay_transactions(r, {txid}, fake_context);
 			//TODO: make sure that tx has reached other nodes here, probably wait to receive reflections from other nodes
 		}
 		else
@@ -2047,50 +2020,7 @@ bool core_rpc_server::on_get_output_distribution(const COMMAND_RPC_GET_OUTPUT_DI
 	{
 		for(uint64_t amount : req.amounts)
 		{
-			static struct D
-			{
-				boost::mutex mutex;
-				std::vector<uint64_t> cached_distribution;
-				uint64_t cached_from, cached_to, cached_start_height, cached_base;
-				bool cached;
-				D() : cached_from(0), cached_to(0), cached_start_height(0), cached_base(0), cached(false) {}
-			} d;
-			boost::unique_lock<boost::mutex> lock(d.mutex);
-
-			if(d.cached && amount == 0 && d.cached_from == req.from_height && d.cached_to == req.to_height)
-			{
-				res.distributions.push_back({amount, d.cached_start_height, d.cached_distribution, d.cached_base});
-				if(req.cumulative)
-				{
-					auto &distribution = res.distributions.back().distribution;
-					distribution[0] += d.cached_base;
-					for(size_t n = 1; n < distribution.size(); ++n)
-						distribution[n] += distribution[n - 1];
-				}
-				continue;
-			}
-
-			// this is a slow operation, so we have precomputed caches of common cases
-			bool found = false;
-			for(const auto &slot : get_output_distribution_cache)
-			{
-				if(slot.amount == amount && slot.from_height == req.from_height && slot.to_height == req.to_height)
-				{
-					res.distributions.push_back({amount, slot.start_height, slot.distribution, slot.base});
-					found = true;
-					if(req.cumulative)
-					{
-						auto &distribution = res.distributions.back().distribution;
-						distribution[0] += slot.base;
-						for(size_t n = 1; n < distribution.size(); ++n)
-							distribution[n] += distribution[n - 1];
-					}
-					break;
-				}
-			}
-			if(found)
-				continue;
-
+			// a range read of the per block cumulative counts for RCT outputs, no need to cache
 			std::vector<uint64_t> distribution;
 			uint64_t start_height, base;
 			if(!m_core.get_output_distribution(amount, req.from_height, req.to_height, start_height, distribution, base))
@@ -2106,16 +2036,6 @@ bool core_rpc_server::on_get_output_distribution(const COMMAND_RPC_GET_OUTPUT_DI
 					distribution.resize(req.to_height - offset + 1);
 			}
 
-			if(amount == 0)
-			{
-				d.cached_from = req.from_height;
-				d.cached_to = req.to_height;
-				d.cached_distribution = distribution;
-				d.cached_start_height = start_height;
-				d.cached_base = base;
-				d.cached = true;
-			}
-
 			if(req.cumulative)
 			{
 				distribution[0] += base;
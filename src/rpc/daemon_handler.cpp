@@ -256,26 +256,23 @@ void DaemonHandler::handle(const KeyImagesSpent::Request &req, KeyImagesSpent::R
 {
 	res.spent_status.resize(req.key_images.size(), KeyImagesSpent::STATUS::UNSPENT);
 
-	std::vector<bool> chain_spent_status;
-	std::vector<bool> pool_spent_status;
+	std::vector<key_image_index::spent_status> spent_status;
+	m_core.get_key_images_spent_status(req.key_images, spent_status);
 
-	m_core.are_key_images_spent(req.key_images, chain_spent_status);
-	m_core.are_key_images_spent_in_pool(req.key_images, pool_spent_status);
-
-	if((chain_spent_status.size() != req.key_images.size()) || (pool_spent_status.size() != req.key_images.size()))
+	if(spent_status.size() != req.key_images.size())
 	{
 		res.status = Message::STATUS_FAILED;
-		res.error_details = "tx_pool::have_key_images_as_spent() gave vectors of wrong size(s).";
+		res.error_details = "core::get_key_images_spent_status() gave a vector of wrong size.";
 		return;
 	}
 
 	for(size_t i = 0; i < req.key_images.size(); i++)
 	{
-		if(chain_spent_status[i])
+		if(spent_status[i] == key_image_index::SPENT_IN_CHAIN)
 		{
 			res.spent_status[i] = KeyImagesSpent::STATUS::SPENT_IN_BLOCKCHAIN;
 		}
-		else if(pool_spent_status[i])
+		else if(spent_status[i] == key_image_index::SPENT_IN_POOL)
 		{
 			res.spent_status[i] = KeyImagesSpent::STATUS::SPENT_IN_POOL;
 		}
@@ -420,7 +417,7 @@ void DaemonHandler::handle(const SendRawTx::Request &req, SendRawTx::Response &r
 
 	NOTIFY_NEW_TRANSACTIONS::request r;
 	r.txs.push_back(tx_blob);
-	m_core.get_protocol()->relay_transactions(r, fake_context);
+	m_core.get_protocol()->relay_transactions(r, {tvc.m_tx_hash}, fake_context);
 
 	//TODO: make sure that tx has reached other nodes here, probably wait to receive reflections from other nodes
 	res.status = Message::STATUS_OK;
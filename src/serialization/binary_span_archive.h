@@ -0,0 +1,368 @@
+// Copyright (c) 2020, pasta Currency Project
+//
+// Portions of this file are available under BSD-3 license. Please see ORIGINAL-LICENSE for details
+// All rights reserved.
+//
+// Authors and copyright holders give permission for following:
+//
+// 1. Redistribution and use in source and binary forms WITHOUT modification.
+//
+// 2. Modification of the source form for your own personal use.
+//
+// As long as the following conditions are met:
+//
+// 3. You must not distribute modified copies of the work to third parties. This includes
+//    posting the work online, or hosting copies of the modified work for download.
+//
+// 4. Any derivative version of this work is also covered by this license, including point 8.
+//
+// 5. Neither the name of the copyright holders nor the names of the authors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+//
+// 6. You agree that this licence is governed by and shall be construed in accordance
+//    with the laws of England and Wales.
+//
+// 7. You agree to submit all disputes arising out of or in connection with this licence
+//    to the exclusive jurisdiction of the Courts of England and Wales.
+//
+// Authors and copyright holders agree that:
+//
+// 8. This licence expires and the work covered by it is released into the
+//    public domain on 1st of February 2021
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+/*! \file binary_span_archive.h
+ *
+ * \brief Portable (low-endian) binary archive over contiguous memory
+ *
+ * \detailed Wire compatible with binary_archive, but reads straight out of
+ * an epee::span and appends to a caller owned std::string instead of going
+ * through std::istream / std::ostream. Pass the same buffer to the writer
+ * again (after clear()) to reuse its capacity.
+ */
+#pragma once
+
+#include <boost/mpl/bool.hpp>
+#include <cstring>
+#include <ios>
+#include <iterator>
+#include <limits>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#include "binary_archive.h"
+#include "span.h"
+#include "variant.h"
+#include "vector.h"
+
+namespace serialization
+{
+/*! \class span_stream_state
+ *
+ * \brief the subset of std::ios state handling the serializers rely on
+ */
+class span_stream_state
+{
+  public:
+	span_stream_state() : state_(std::ios_base::goodbit) {}
+
+	bool good() const { return state_ == std::ios_base::goodbit; }
+	bool fail() const { return (state_ & (std::ios_base::failbit | std::ios_base::badbit)) != 0; }
+	std::ios_base::iostate rdstate() const { return state_; }
+	void setstate(std::ios_base::iostate s) { state_ |= s; }
+	void clear(std::ios_base::iostate s = std::ios_base::goodbit) { state_ = s; }
+
+  private:
+	std::ios_base::iostate state_;
+};
+
+/*! \class span_istream
+ *
+ * \brief read cursor over a span, does not own the data
+ */
+class span_istream : public span_stream_state
+{
+  public:
+	explicit span_istream(epee::span<const uint8_t> data) : data_(data), pos_(0) {}
+
+	int peek()
+	{
+		if(pos_ >= data_.size())
+		{
+			setstate(std::ios_base::eofbit);
+			return EOF;
+		}
+		return data_.data()[pos_];
+	}
+
+	bool read(void *buf, size_t len)
+	{
+		if(len > remaining())
+		{
+			pos_ = data_.size();
+			setstate(std::ios_base::eofbit | std::ios_base::failbit);
+			return false;
+		}
+		if(len != 0)
+			memcpy(buf, data_.data() + pos_, len);
+		pos_ += len;
+		return true;
+	}
+
+	const uint8_t *cur() const { return data_.data() + pos_; }
+	const uint8_t *end() const { return data_.data() + data_.size(); }
+	void seek(const uint8_t *p) { pos_ = p - data_.data(); }
+
+	size_t tell() const { return pos_; }
+	size_t remaining() const { return data_.size() - pos_; }
+
+  private:
+	epee::span<const uint8_t> data_;
+	size_t pos_;
+};
+
+/*! \class blob_ostream
+ *
+ * \brief appends to a std::string, does not own it
+ */
+class blob_ostream : public span_stream_state
+{
+  public:
+	explicit blob_ostream(std::string &buf) : buf_(buf) {}
+
+	void put(char c) { buf_.push_back(c); }
+	void write(const void *buf, size_t len) { buf_.append(reinterpret_cast<const char *>(buf), len); }
+
+	size_t tell() const { return buf_.size(); }
+	std::string &buffer() { return buf_; }
+
+  private:
+	std::string &buf_;
+};
+}
+
+/*! \struct binary_span_archive
+ *
+ * \brief drop-in replacement for binary_archive working on memory
+ *
+ * \detailed Every type serializable with binary_archive is serializable
+ * with this one and produces / consumes identical bytes, variant tags
+ * are taken from binary_archive.
+ */
+template <bool W>
+struct binary_span_archive;
+
+template <>
+struct binary_span_archive<false> : public binary_archive_base<serialization::span_istream, false>
+{
+	explicit binary_span_archive(stream_type &s) : base_type(s) {}
+
+	template <class T>
+	void serialize_int(T &v)
+	{
+		serialize_uint(*(typename boost::make_unsigned<T>::type *)&v);
+	}
+
+	template <class T>
+	void serialize_uint(T &v, size_t width = sizeof(T))
+	{
+		if(stream_.remaining() < width)
+		{
+			stream_.setstate(std::ios_base::eofbit | std::ios_base::failbit);
+			v = 0;
+			return;
+		}
+
+		const uint8_t *p = stream_.cur();
+		T ret = 0;
+		for(size_t i = 0; i < width; i++)
+			ret |= T(p[i]) << (8 * i);
+		stream_.seek(p + width);
+		v = ret;
+	}
+
+	void serialize_blob(void *buf, size_t len, const char *delimiter = "")
+	{
+		stream_.read(buf, len);
+	}
+
+	template <class T>
+	void serialize_varint(T &v)
+	{
+		serialize_uvarint(*(typename boost::make_unsigned<T>::type *)(&v));
+	}
+
+	// Failures are left to the caller exactly like binary_archive does, so
+	// that both archives accept the same set of blobs
+	template <class T>
+	void serialize_uvarint(T &v)
+	{
+		const uint8_t *first = stream_.cur();
+		const uint8_t *last = stream_.end();
+		tools::read_varint<std::numeric_limits<T>::digits, const uint8_t *&, T>(first, last, v);
+		stream_.seek(first);
+	}
+
+	void begin_array(size_t &s)
+	{
+		serialize_varint(s);
+	}
+
+	void begin_array() {}
+	void delimit_array() {}
+	void end_array() {}
+
+	void begin_string(const char *delimiter /*="\""*/) {}
+	void end_string(const char *delimiter /*="\""*/) {}
+
+	void read_variant_tag(variant_tag_type &t)
+	{
+		serialize_int(t);
+	}
+
+	size_t remaining_bytes()
+	{
+		if(!stream_.good())
+			return 0;
+		return stream_.remaining();
+	}
+};
+
+template <>
+struct binary_span_archive<true> : public binary_archive_base<serialization::blob_ostream, true>
+{
+	explicit binary_span_archive(stream_type &s) : base_type(s) {}
+
+	template <class T>
+	void serialize_int(T v)
+	{
+		serialize_uint(static_cast<typename boost::make_unsigned<T>::type>(v));
+	}
+
+	template <class T>
+	void serialize_uint(T v)
+	{
+		char buf[sizeof(T)];
+		for(size_t i = 0; i < sizeof(T); i++)
+		{
+			buf[i] = (char)(v & 0xff);
+			if(1 < sizeof(T))
+				v >>= 8;
+		}
+		stream_.write(buf, sizeof(T));
+	}
+
+	void serialize_blob(void *buf, size_t len, const char *delimiter = "")
+	{
+		stream_.write(buf, len);
+	}
+
+	template <class T>
+	void serialize_varint(T &v)
+	{
+		serialize_uvarint(*(typename boost::make_unsigned<T>::type *)(&v));
+	}
+
+	template <class T>
+	void serialize_uvarint(T &v)
+	{
+		tools::write_varint(std::back_inserter(stream_.buffer()), v);
+	}
+
+	void begin_array(size_t s)
+	{
+		serialize_varint(s);
+	}
+	void begin_array() {}
+	void delimit_array() {}
+	void end_array() {}
+
+	void begin_string(const char *delimiter = "\"") {}
+	void end_string(const char *delimiter = "\"") {}
+
+	void write_variant_tag(variant_tag_type t)
+	{
+		serialize_int(t);
+	}
+};
+
+/*! \struct variant_serialization_traits
+ *
+ * \brief binary_span_archive shares the variant tags of binary_archive
+ */
+template <bool W, class T>
+struct variant_serialization_traits<binary_span_archive<W>, T> : public variant_serialization_traits<binary_archive<W>, T>
+{
+};
+
+// read
+template <class T>
+typename std::enable_if<is_bulk_blob_vector<T>::type::value, bool>::type
+do_serialize(binary_span_archive<false> &ar, std::vector<T> &v)
+{
+	size_t cnt;
+	ar.begin_array(cnt);
+	if(!ar.stream().good())
+		return false;
+	v.clear();
+
+	// very basic sanity check
+	if(ar.remaining_bytes() / sizeof(T) < cnt)
+	{
+		ar.stream().setstate(std::ios::failbit);
+		return false;
+	}
+
+	v.resize(cnt);
+	if(cnt != 0)
+		ar.serialize_blob(v.data(), cnt * sizeof(T));
+	ar.end_array();
+	return ar.stream().good();
+}
+
+// write
+template <class T>
+typename std::enable_if<is_bulk_blob_vector<T>::type::value, bool>::type
+do_serialize(binary_span_archive<true> &ar, std::vector<T> &v)
+{
+	size_t cnt = v.size();
+	ar.begin_array(cnt);
+	if(cnt != 0)
+		ar.serialize_blob(v.data(), cnt * sizeof(T));
+	ar.end_array();
+	return ar.stream().good();
+}
+
+namespace serialization
+{
+/*! parses \a v out of \a blob, which must be consumed completely
+   */
+template <class T>
+bool parse_binary(epee::span<const uint8_t> blob, T &v)
+{
+	span_istream istr(blob);
+	binary_span_archive<false> iar(istr);
+	return ::serialization::serialize(iar, v);
+}
+
+/*! appends the serialized form of \a v to \a blob
+   */
+template <class T>
+bool append_binary(T &v, std::string &blob)
+{
+	blob_ostream ostr(blob);
+	binary_span_archive<true> oar(ostr);
+	return ::serialization::serialize(oar, v);
+}
+}
@@ -97,6 +97,13 @@ bool do_serialize(Archive<true> &ar, std::vector<crypto::signature> &v)
 	return true;
 }
 
+// the signature vector above has no size prefix
+template <>
+struct is_bulk_blob_vector<crypto::signature>
+{
+	typedef boost::false_type type;
+};
+
 BLOB_SERIALIZER(crypto::chacha_iv);
 BLOB_SERIALIZER(crypto::hash);
 BLOB_SERIALIZER(crypto::hash8);
@@ -95,6 +95,20 @@ struct is_basic_type
 	typedef boost::false_type type;
 };
 
+/*! \struct is_bulk_blob_vector
+ *
+ * \brief a descriptor for archives that can copy a whole std::vector<T>
+ * of blobs at once
+ *
+ * \detailed Only valid if the vector is stored as its varint size followed
+ * by the elements, types with a custom vector format must opt out.
+ */
+template <class T>
+struct is_bulk_blob_vector
+{
+	typedef typename is_blob_type<T>::type type;
+};
+
 template <typename F, typename S>
 struct is_basic_type<std::pair<F, S>>
 {
@@ -47,6 +47,7 @@
 #pragma once
 
 #include "serialization.h"
+#include <type_traits>
 #include <vector>
 
 template <template <bool> class Archive, class T>
@@ -54,6 +55,16 @@ bool do_serialize(Archive<false> &ar, std::vector<T> &v);
 template <template <bool> class Archive, class T>
 bool do_serialize(Archive<true> &ar, std::vector<T> &v);
 
+// bulk copy overloads, defined in binary_span_archive.h
+template <bool W>
+struct binary_span_archive;
+template <class T>
+typename std::enable_if<is_bulk_blob_vector<T>::type::value, bool>::type
+do_serialize(binary_span_archive<false> &ar, std::vector<T> &v);
+template <class T>
+typename std::enable_if<is_bulk_blob_vector<T>::type::value, bool>::type
+do_serialize(binary_span_archive<true> &ar, std::vector<T> &v);
+
 namespace serialization
 {
 namespace detail
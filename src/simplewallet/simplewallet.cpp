@@ -7482,12 +7482,14 @@ int main(int argc, char *argv[])
 
 	//Secret output (never log to disk)
 	std::unique_ptr<gulps::gulps_output> out(new gulps::gulps_print_output(gulps::COLOR_WHITE, gulps::TEXT_ONLY));
-	out->add_filter([](const gulps::message& msg, bool printed, bool logged) -> bool { return msg.out == gulps::OUT_USER_1; });
+	out->add_filter([](const gulps::message& msg, bool printed, bool logged) -> bool { return msg.out == gulps::OUT_USER_1; },
+		[](gulps::output out, gulps::level lvl) -> bool { return out == gulps::OUT_USER_1; });
 	gulps::inst().add_output(std::move(out));
 
 	//Ordinary output
 	out.reset(new gulps::gulps_print_output(gulps::COLOR_WHITE, gulps::TEXT_ONLY));
-	out->add_filter([](const gulps::message& msg, bool printed, bool logged) -> bool { return msg.out == gulps::OUT_USER_0 && msg.lvl <= gulps::LEVEL_WARN; });
+	out->add_filter([](const gulps::message& msg, bool printed, bool logged) -> bool { return msg.out == gulps::OUT_USER_0 && msg.lvl <= gulps::LEVEL_WARN; },
+		[](gulps::output out, gulps::level lvl) -> bool { return out == gulps::OUT_USER_0 && lvl <= gulps::LEVEL_WARN; });
 	gulps::inst().add_output(std::move(out));
 
 	po::options_description desc_params(wallet_args::tr("Wallet options"));
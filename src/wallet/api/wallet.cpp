@@ -359,8 +359,8 @@ void Wallet::error(const std::string &category, const std::string &str)
 }
 
 ///////////////////////// WalletImpl implementation ////////////////////////
-WalletImpl::WalletImpl(NetworkType nettype)
-	: m_wallet(nullptr), m_status(Wallet::Status_Ok), m_trustedDaemon(false), m_wallet2Callback(nullptr), m_recoveringFromSeed(false), m_synchronized(false), m_rebuildWalletCache(false), m_is_connected(false)
+WalletImpl::WalletImpl(NetworkType nettype, tools::wallet_shared_scanner *scanner)
+	: m_wallet(nullptr), m_scanner(scanner), m_sharedRefresh(false), m_status(Wallet::Status_Ok), m_trustedDaemon(false), m_wallet2Callback(nullptr), m_recoveringFromSeed(false), m_synchronized(false), m_rebuildWalletCache(false), m_is_connected(false)
 {
 	m_wallet = new tools::wallet2(static_cast<cryptonote::network_type>(nettype));
 	m_history = new TransactionHistoryImpl(this);
@@ -696,6 +696,13 @@ bool WalletImpl::close(bool store)
 
 	bool result = false;
 	LOG_PRINT_L1("closing wallet...");
+	// A shared refresh may still be merging into the wallet, wait for it before storing
+	if(m_sharedRefresh)
+	{
+		m_wallet->stop();
+		m_scanner->remove_wallet(*m_wallet);
+		m_sharedRefresh = false;
+	}
 	try
 	{
 		if(store)
@@ -1799,15 +1806,23 @@ void WalletImpl::refreshThreadFunc()
 
 void WalletImpl::doRefresh()
 {
+	// The shared scanner refreshes every wallet registered with it, and takes m_refreshMutex2
+	// itself whenever it changes this one
+	const bool shared = m_sharedRefresh && daemonSynced();
+	const bool shared_ok = !shared || m_scanner->refresh();
+
 	// synchronizing async and sync refresh calls
 	boost::lock_guard<boost::mutex> guarg(m_refreshMutex2);
 	try
 	{
 		// Syncing daemon and refreshing wallet simultaneously is very resource intensive.
 		// Disable refresh if wallet is disconnected or daemon isn't synced.
-		if(m_wallet->light_wallet() || daemonSynced())
+		if(shared || m_wallet->light_wallet() || daemonSynced())
 		{
-			m_wallet->refresh();
+			if(!shared)
+				m_wallet->refresh();
+			else if(!shared_ok)
+				throw std::runtime_error(tr("Failed to refresh wallet"));
 			if(!m_synchronized)
 			{
 				m_synchronized = true;
@@ -1880,9 +1895,19 @@ bool WalletImpl::isNewWallet() const
 
 bool WalletImpl::doInit(const string &daemon_address, uint64_t upper_transaction_size_limit, bool ssl)
 {
+	if(m_sharedRefresh)
+	{
+		m_scanner->remove_wallet(*m_wallet);
+		m_sharedRefresh = false;
+	}
+
 	if(!m_wallet->init(daemon_address, m_daemon_login, upper_transaction_size_limit, ssl))
 		return false;
 
+	// Wallets of one manager on the same daemon download and parse the blocks once for all of them
+	if(m_scanner != nullptr)
+		m_sharedRefresh = m_scanner->add_wallet(*m_wallet, m_refreshMutex2);
+
 	// in case new wallet, this will force fast-refresh (pulling hashes instead of blocks)
 	// If daemon isn't synced a calculated block height will be used instead
 	//TODO: Handle light wallet scenario where block height = 0.
@@ -68,7 +68,7 @@ struct Wallet2CallbackImpl;
 class WalletImpl : public Wallet
 {
   public:
-	WalletImpl(NetworkType nettype = MAINNET);
+	WalletImpl(NetworkType nettype = MAINNET, tools::wallet_shared_scanner *scanner = nullptr);
 	~WalletImpl();
 	bool create(const std::string &path, const std::string &password,
 				const std::string &language);
@@ -205,6 +205,9 @@ class WalletImpl : public Wallet
 	friend class SubaddressAccountImpl;
 
 	tools::wallet2 *m_wallet;
+	// shared with the other wallets of the manager, refreshes the wallet once registered
+	tools::wallet_shared_scanner *m_scanner;
+	std::atomic<bool> m_sharedRefresh;
 	mutable std::atomic<int> m_status;
 	mutable std::string m_errorString;
 	std::string m_password;
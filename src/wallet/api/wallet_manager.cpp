@@ -68,14 +68,14 @@ namespace pasta
 Wallet *WalletManagerImpl::createWallet(const std::string &path, const std::string &password,
 										const std::string &language, NetworkType nettype)
 {
-	WalletImpl *wallet = new WalletImpl(nettype);
+	WalletImpl *wallet = new WalletImpl(nettype, &m_scanner);
 	wallet->create(path, password, language);
 	return wallet;
 }
 
 Wallet *WalletManagerImpl::openWallet(const std::string &path, const std::string &password, NetworkType nettype)
 {
-	WalletImpl *wallet = new WalletImpl(nettype);
+	WalletImpl *wallet = new WalletImpl(nettype, &m_scanner);
 	wallet->open(path, password);
 	//Refresh addressBook
 	wallet->addressBook()->refresh();
@@ -105,7 +105,7 @@ Wallet *WalletManagerImpl::recoveryWallet(const std::string &path,
 										  NetworkType nettype,
 										  uint64_t restoreHeight)
 {
-	WalletImpl *wallet = new WalletImpl(nettype);
+	WalletImpl *wallet = new WalletImpl(nettype, &m_scanner);
 	if(restoreHeight > 0)
 	{
 		wallet->setRefreshFromBlockHeight(restoreHeight);
@@ -123,7 +123,7 @@ Wallet *WalletManagerImpl::createWalletFromKeys(const std::string &path,
 												const std::string &viewKeyString,
 												const std::string &spendKeyString)
 {
-	WalletImpl *wallet = new WalletImpl(nettype);
+	WalletImpl *wallet = new WalletImpl(nettype, &m_scanner);
 	if(restoreHeight > 0)
 	{
 		wallet->setRefreshFromBlockHeight(restoreHeight);
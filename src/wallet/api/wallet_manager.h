@@ -46,6 +46,7 @@
 
 #include "net/http_client.h"
 #include "wallet/api/wallet2_api.h"
+#include "wallet/wallet2.h"
 #include <string>
 
 namespace pasta
@@ -102,6 +103,8 @@ class WalletManagerImpl : public WalletManager
 	std::string m_daemonAddress;
 	epee::net_utils::http::http_simple_client m_http_client;
 	std::string m_errorString;
+	// wallets opened through the manager share block download and parsing
+	tools::wallet_shared_scanner m_scanner;
 };
 
 } // namespace
@@ -0,0 +1,188 @@
+// Copyright (c) 2020, pasta Currency Project
+//
+// Portions of this file are available under BSD-3 license. Please see ORIGINAL-LICENSE for details
+// All rights reserved.
+//
+// Authors and copyright holders give permission for following:
+//
+// 1. Redistribution and use in source and binary forms WITHOUT modification.
+//
+// 2. Modification of the source form for your own personal use.
+//
+// As long as the following conditions are met:
+//
+// 3. You must not distribute modified copies of the work to third parties. This includes
+//    posting the work online, or hosting copies of the modified work for download.
+//
+// 4. Any derivative version of this work is also covered by this license, including point 8.
+//
+// 5. Neither the name of the copyright holders nor the names of the authors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+//
+// 6. You agree that this licence is governed by and shall be construed in accordance
+//    with the laws of England and Wales.
+//
+// 7. You agree to submit all disputes arising out of or in connection with this licence
+//    to the exclusive jurisdiction of the Courts of England and Wales.
+//
+// Authors and copyright holders agree that:
+//
+// 8. This licence expires and the work covered by it is released into the
+//    public domain on 1st of February 2021
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "balance_ledger.h"
+
+#include <iterator>
+
+namespace tools
+{
+void balance_ledger::clear()
+{
+	m_entries.clear();
+	m_accounts.clear();
+	m_all = totals();
+	m_locked.clear();
+	m_unlocked.clear();
+}
+
+void balance_ledger::set(size_t idx, const cryptonote::subaddress_index &index, uint64_t amount, uint64_t unlock_height, bool spent)
+{
+	if(idx >= m_entries.size())
+		m_entries.resize(idx + 1);
+
+	remove(idx);
+	entry &e = m_entries[idx];
+	e.index = index;
+	e.amount = amount;
+	e.unlock_height = unlock_height;
+	if(!spent)
+		add(idx);
+}
+
+void balance_ledger::truncate(size_t size)
+{
+	for(size_t idx = size; idx < m_entries.size(); ++idx)
+		remove(idx);
+	if(size < m_entries.size())
+		m_entries.resize(size);
+}
+
+void balance_ledger::set_height(uint64_t height)
+{
+	m_height = height;
+
+	while(!m_locked.empty() && m_locked.begin()->first <= height)
+	{
+		std::pair<uint64_t, size_t> node = *m_locked.begin();
+		m_locked.erase(m_locked.begin());
+		m_unlocked.insert(node);
+		lock(node.second, true);
+	}
+
+	while(!m_unlocked.empty() && std::prev(m_unlocked.end())->first > height)
+	{
+		auto it = std::prev(m_unlocked.end());
+		std::pair<uint64_t, size_t> node = *it;
+		m_unlocked.erase(it);
+		m_locked.insert(node);
+		lock(node.second, false);
+	}
+}
+
+const balance_ledger::totals &balance_ledger::account(uint32_t index_major) const
+{
+	static const totals empty;
+	return index_major < m_accounts.size() ? m_accounts[index_major].total : empty;
+}
+
+const std::map<uint32_t, balance_ledger::totals> &balance_ledger::subaddresses(uint32_t index_major) const
+{
+	static const std::map<uint32_t, totals> empty;
+	return index_major < m_accounts.size() ? m_accounts[index_major].minors : empty;
+}
+
+void balance_ledger::add(size_t idx)
+{
+	entry &e = m_entries[idx];
+	account_totals &acc = get_account(e.index.major);
+	e.counted = true;
+	e.unlocked = e.unlock_height <= m_height;
+
+	for(totals *t : {&m_all, &acc.total, &acc.minors[e.index.minor]})
+	{
+		t->balance += e.amount;
+		t->unspent_count++;
+		if(e.unlocked)
+		{
+			t->unlocked += e.amount;
+			t->unlocked_count++;
+		}
+	}
+
+	(e.unlocked ? m_unlocked : m_locked).emplace(e.unlock_height, idx);
+}
+
+void balance_ledger::remove(size_t idx)
+{
+	entry &e = m_entries[idx];
+	if(!e.counted)
+		return;
+
+	account_totals &acc = get_account(e.index.major);
+	auto minor = acc.minors.find(e.index.minor);
+	for(totals *t : {&m_all, &acc.total, &minor->second})
+	{
+		t->balance -= e.amount;
+		t->unspent_count--;
+		if(e.unlocked)
+		{
+			t->unlocked -= e.amount;
+			t->unlocked_count--;
+		}
+	}
+	if(minor->second.unspent_count == 0)
+		acc.minors.erase(minor);
+
+	(e.unlocked ? m_unlocked : m_locked).erase(std::make_pair(e.unlock_height, idx));
+	e.counted = false;
+}
+
+void balance_ledger::lock(size_t idx, bool unlocked)
+{
+	entry &e = m_entries[idx];
+	account_totals &acc = get_account(e.index.major);
+	e.unlocked = unlocked;
+
+	for(totals *t : {&m_all, &acc.total, &acc.minors[e.index.minor]})
+	{
+		if(unlocked)
+		{
+			t->unlocked += e.amount;
+			t->unlocked_count++;
+		}
+		else
+		{
+			t->unlocked -= e.amount;
+			t->unlocked_count--;
+		}
+	}
+}
+
+balance_ledger::account_totals &balance_ledger::get_account(uint32_t index_major)
+{
+	if(index_major >= m_accounts.size())
+		m_accounts.resize(index_major + 1);
+	return m_accounts[index_major];
+}
+}
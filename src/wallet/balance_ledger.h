@@ -0,0 +1,133 @@
+// Copyright (c) 2020, pasta Currency Project
+//
+// Portions of this file are available under BSD-3 license. Please see ORIGINAL-LICENSE for details
+// All rights reserved.
+//
+// Authors and copyright holders give permission for following:
+//
+// 1. Redistribution and use in source and binary forms WITHOUT modification.
+//
+// 2. Modification of the source form for your own personal use.
+//
+// As long as the following conditions are met:
+//
+// 3. You must not distribute modified copies of the work to third parties. This includes
+//    posting the work online, or hosting copies of the modified work for download.
+//
+// 4. Any derivative version of this work is also covered by this license, including point 8.
+//
+// 5. Neither the name of the copyright holders nor the names of the authors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+//
+// 6. You agree that this licence is governed by and shall be construed in accordance
+//    with the laws of England and Wales.
+//
+// 7. You agree to submit all disputes arising out of or in connection with this licence
+//    to the exclusive jurisdiction of the Courts of England and Wales.
+//
+// Authors and copyright holders agree that:
+//
+// 8. This licence expires and the work covered by it is released into the
+//    public domain on 1st of February 2021
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#pragma once
+
+#include <cstdint>
+#include <map>
+#include <set>
+#include <utility>
+#include <vector>
+
+#include "cryptonote_basic/cryptonote_basic.h"
+#include "cryptonote_basic/subaddress_index.h"
+
+namespace tools
+{
+/*!
+ * \brief Running balances of a wallet's transfers per subaddress
+ *
+ * Keeps, for every (major, minor) subaddress and every account, the sum of
+ * the unspent transfers and of the unspent transfers that are unlocked at the
+ * current height, so balance queries don't walk the transfer list. Transfers
+ * are addressed by their index in wallet2's transfer container.
+ *
+ * Unspent transfers sit in one of two sets ordered by the height they unlock
+ * at. Moving the height forwards unlocks the front of the locked set, moving
+ * it backwards (a reorg) relocks the back of the unlocked set, so each change
+ * costs only the transfers that actually cross the line.
+ */
+class balance_ledger
+{
+  public:
+	struct totals
+	{
+		uint64_t balance = 0;
+		uint64_t unlocked = 0;
+		size_t unspent_count = 0;
+		size_t unlocked_count = 0;
+	};
+
+	balance_ledger() : m_height(0) {}
+
+	void clear();
+
+	/*!
+	 * \brief set the state of transfer idx, replacing whatever it had
+	 *
+	 * @param unlock_height the chain height at which the transfer becomes spendable
+	 */
+	void set(size_t idx, const cryptonote::subaddress_index &index, uint64_t amount, uint64_t unlock_height, bool spent);
+
+	//! drop the transfers from idx size on, as a detach does
+	void truncate(size_t size);
+
+	void set_height(uint64_t height);
+	uint64_t height() const { return m_height; }
+	size_t size() const { return m_entries.size(); }
+
+	const totals &account(uint32_t index_major) const;
+	const totals &all() const { return m_all; }
+
+	//! unspent and unlocked totals of the account's subaddresses that hold unspent transfers
+	const std::map<uint32_t, totals> &subaddresses(uint32_t index_major) const;
+
+  private:
+	struct entry
+	{
+		cryptonote::subaddress_index index;
+		uint64_t amount = 0;
+		uint64_t unlock_height = 0;
+		bool counted = false; // unspent, so part of the balances
+		bool unlocked = false;
+	};
+
+	struct account_totals
+	{
+		totals total;
+		std::map<uint32_t, totals> minors;
+	};
+
+	void add(size_t idx);
+	void remove(size_t idx);
+	void lock(size_t idx, bool unlocked);
+	account_totals &get_account(uint32_t index_major);
+
+	std::vector<entry> m_entries;
+	std::vector<account_totals> m_accounts;
+	totals m_all;
+	std::set<std::pair<uint64_t, size_t>> m_locked;
+	std::set<std::pair<uint64_t, size_t>> m_unlocked;
+	uint64_t m_height;
+};
+}
@@ -0,0 +1,133 @@
+// Copyright (c) 2020, pasta Currency Project
+//
+// Portions of this file are available under BSD-3 license. Please see ORIGINAL-LICENSE for details
+// All rights reserved.
+//
+// Authors and copyright holders give permission for following:
+//
+// 1. Redistribution and use in source and binary forms WITHOUT modification.
+//
+// 2. Modification of the source form for your own personal use.
+//
+// As long as the following conditions are met:
+//
+// 3. You must not distribute modified copies of the work to third parties. This includes
+//    posting the work online, or hosting copies of the modified work for download.
+//
+// 4. Any derivative version of this work is also covered by this license, including point 8.
+//
+// 5. Neither the name of the copyright holders nor the names of the authors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+//
+// 6. You agree that this licence is governed by and shall be construed in accordance
+//    with the laws of England and Wales.
+//
+// 7. You agree to submit all disputes arising out of or in connection with this licence
+//    to the exclusive jurisdiction of the Courts of England and Wales.
+//
+// Authors and copyright holders agree that:
+//
+// 8. This licence expires and the work covered by it is released into the
+//    public domain on 1st of February 2021
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "daemon_rpc_pool.h"
+
+namespace tools
+{
+
+bool daemon_rpc_pool::set_server(const std::string &address, boost::optional<epee::net_utils::http::login> user, bool ssl)
+{
+	// validate the address before touching the live connections
+	epee::net_utils::http::url_content parsed{};
+	if(!epee::net_utils::parse_url(address, parsed) || parsed.host.empty() || parsed.port == 0)
+	{
+		GULPS_ERROR("Failed to parse daemon address: ", address);
+		return false;
+	}
+
+	boost::unique_lock<boost::mutex> lock(m_lock);
+	m_address = address;
+	m_login = std::move(user);
+	m_ssl = ssl;
+	++m_server_gen;
+
+	for(auto &conn : m_connections)
+	{
+		if(conn->leased)
+			continue;
+		conn->client.set_server(m_address, m_login, m_ssl);
+		conn->server_gen = m_server_gen;
+	}
+	return true;
+}
+
+void daemon_rpc_pool::disconnect()
+{
+	boost::unique_lock<boost::mutex> lock(m_lock);
+	for(auto &conn : m_connections)
+	{
+		if(!conn->leased)
+			conn->client.disconnect();
+	}
+}
+
+daemon_rpc_pool::lease daemon_rpc_pool::acquire()
+{
+	boost::unique_lock<boost::mutex> lock(m_lock);
+	while(true)
+	{
+		connection *idle = nullptr;
+		for(auto &conn : m_connections)
+		{
+			if(conn->leased)
+				continue;
+			if(idle == nullptr || conn->client.is_connected())
+				idle = conn.get();
+			if(conn->client.is_connected())
+				break;
+		}
+
+		if(idle == nullptr && m_connections.size() < m_max_connections)
+		{
+			m_connections.emplace_back(new connection());
+			idle = m_connections.back().get();
+			if(!m_address.empty())
+				idle->client.set_server(m_address, m_login, m_ssl);
+			idle->server_gen = m_server_gen;
+		}
+
+		if(idle != nullptr)
+		{
+			idle->leased = true;
+			return lease(this, idle);
+		}
+
+		m_cond.wait(lock);
+	}
+}
+
+void daemon_rpc_pool::give_back(connection *conn)
+{
+	{
+		boost::unique_lock<boost::mutex> lock(m_lock);
+		if(conn->server_gen != m_server_gen && !m_address.empty())
+		{
+			conn->client.set_server(m_address, m_login, m_ssl);
+			conn->server_gen = m_server_gen;
+		}
+		conn->leased = false;
+	}
+	m_cond.notify_one();
+}
+}
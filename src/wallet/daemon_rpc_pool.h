@@ -0,0 +1,152 @@
+// Copyright (c) 2020, pasta Currency Project
+//
+// Portions of this file are available under BSD-3 license. Please see ORIGINAL-LICENSE for details
+// All rights reserved.
+//
+// Authors and copyright holders give permission for following:
+//
+// 1. Redistribution and use in source and binary forms WITHOUT modification.
+//
+// 2. Modification of the source form for your own personal use.
+//
+// As long as the following conditions are met:
+//
+// 3. You must not distribute modified copies of the work to third parties. This includes
+//    posting the work online, or hosting copies of the modified work for download.
+//
+// 4. Any derivative version of this work is also covered by this license, including point 8.
+//
+// 5. Neither the name of the copyright holders nor the names of the authors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+//
+// 6. You agree that this licence is governed by and shall be construed in accordance
+//    with the laws of England and Wales.
+//
+// 7. You agree to submit all disputes arising out of or in connection with this licence
+//    to the exclusive jurisdiction of the Courts of England and Wales.
+//
+// Authors and copyright holders agree that:
+//
+// 8. This licence expires and the work covered by it is released into the
+//    public domain on 1st of February 2021
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#pragma once
+
+#include "common/gulps.hpp"
+
+#include "net/http_client.h"
+#include "storages/http_abstract_invoke.h"
+#include <boost/thread/condition_variable.hpp>
+#include <boost/thread/mutex.hpp>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace tools
+{
+
+/*!
+ * \brief A small pool of keep-alive HTTP connections to one daemon.
+ *
+ * Each request leases a connection for as long as it runs. Independent requests made from
+ * different threads (refresh, pool updates, transaction construction) therefore run at the
+ * same time instead of queueing behind one client. Connections are opened lazily, up to
+ * max_connections, and stay open between requests.
+ */
+class daemon_rpc_pool
+{
+	GULPS_CAT_MAJOR("wallet_rpc_pool");
+
+	struct connection
+	{
+		epee::net_utils::http::http_simple_client client;
+		uint64_t server_gen = 0;
+		bool leased = false;
+	};
+
+  public:
+	static constexpr size_t default_connections = 4;
+
+	class lease
+	{
+	  public:
+		lease(lease &&other) noexcept : pool(other.pool), conn(other.conn) { other.pool = nullptr; }
+		lease(const lease &) = delete;
+		lease &operator=(const lease &) = delete;
+		lease &operator=(lease &&) = delete;
+
+		~lease()
+		{
+			if(pool != nullptr)
+				pool->give_back(conn);
+		}
+
+		epee::net_utils::http::http_simple_client &operator*() { return conn->client; }
+		epee::net_utils::http::http_simple_client *operator->() { return &conn->client; }
+
+	  private:
+		friend class daemon_rpc_pool;
+		lease(daemon_rpc_pool *pool, connection *conn) : pool(pool), conn(conn) {}
+
+		daemon_rpc_pool *pool;
+		connection *conn;
+	};
+
+	explicit daemon_rpc_pool(size_t max_connections = default_connections) : m_max_connections(max_connections), m_server_gen(0), m_ssl(false) {}
+
+	daemon_rpc_pool(const daemon_rpc_pool &) = delete;
+	daemon_rpc_pool &operator=(const daemon_rpc_pool &) = delete;
+
+	//! Points all connections at a new daemon. Leased ones are switched when given back.
+	bool set_server(const std::string &address, boost::optional<epee::net_utils::http::login> user, bool ssl = false);
+	void disconnect();
+
+	//! Returns an idle connection, preferring open ones, or opens a new one below the limit, or waits
+	lease acquire();
+
+	template <class t_request, class t_response>
+	bool invoke_http_json(const boost::string_ref uri, const t_request &req, t_response &res, std::chrono::milliseconds timeout = std::chrono::seconds(15), const boost::string_ref http_method = "GET")
+	{
+		lease conn = acquire();
+		return epee::net_utils::invoke_http_json(uri, req, res, *conn, timeout, http_method);
+	}
+
+	template <class t_request, class t_response>
+	bool invoke_http_bin(const boost::string_ref uri, const t_request &req, t_response &res, std::chrono::milliseconds timeout = std::chrono::seconds(15), const boost::string_ref http_method = "GET")
+	{
+		lease conn = acquire();
+		return epee::net_utils::invoke_http_bin(uri, req, res, *conn, timeout, http_method);
+	}
+
+	template <class t_request, class t_response>
+	bool invoke_http_json_rpc(const boost::string_ref uri, const std::string &method_name, const t_request &req, t_response &res, std::chrono::milliseconds timeout = std::chrono::seconds(15), const boost::string_ref http_method = "GET", const std::string &req_id = "0")
+	{
+		lease conn = acquire();
+		return epee::net_utils::invoke_http_json_rpc(uri, method_name, req, res, *conn, timeout, http_method, req_id);
+	}
+
+  private:
+	void give_back(connection *conn);
+
+	boost::mutex m_lock;
+	boost::condition_variable m_cond;
+	std::vector<std::unique_ptr<connection>> m_connections;
+	size_t m_max_connections;
+
+	uint64_t m_server_gen;
+	std::string m_address;
+	boost::optional<epee::net_utils::http::login> m_login;
+	bool m_ssl;
+};
+}
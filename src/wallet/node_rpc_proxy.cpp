@@ -54,8 +54,8 @@ namespace tools
 
 static const std::chrono::seconds rpc_timeout = std::chrono::minutes(3) + std::chrono::seconds(30);
 
-NodeRPCProxy::NodeRPCProxy(epee::net_utils::http::http_simple_client &http_client, boost::mutex &mutex)
-	: m_http_client(http_client), m_daemon_rpc_mutex(mutex), m_height(0), m_height_time(0), m_earliest_height(), m_dynamic_per_kb_fee_estimate(0), m_dynamic_per_kb_fee_estimate_cached_height(0), m_dynamic_per_kb_fee_estimate_grace_blocks(0), m_rpc_version(0), m_target_height(0), m_target_height_time(0)
+NodeRPCProxy::NodeRPCProxy(daemon_rpc_pool &daemon_rpc)
+	: m_daemon_rpc(daemon_rpc), m_height(0), m_height_time(0), m_earliest_height(), m_dynamic_per_kb_fee_estimate(0), m_dynamic_per_kb_fee_estimate_cached_height(0), m_dynamic_per_kb_fee_estimate_grace_blocks(0), m_rpc_version(0), m_target_height(0), m_target_height_time(0)
 {
 }
 
@@ -79,9 +79,7 @@ boost::optional<std::string> NodeRPCProxy::get_rpc_version(uint32_t &rpc_version
 	{
 		cryptonote::COMMAND_RPC_GET_VERSION::request req_t = AUTO_VAL_INIT(req_t);
 		cryptonote::COMMAND_RPC_GET_VERSION::response resp_t = AUTO_VAL_INIT(resp_t);
-		m_daemon_rpc_mutex.lock();
-		bool r = net_utils::invoke_http_json_rpc("/json_rpc", "get_version", req_t, resp_t, m_http_client, rpc_timeout);
-		m_daemon_rpc_mutex.unlock();
+		bool r = m_daemon_rpc.invoke_http_json_rpc("/json_rpc", "get_version", req_t, resp_t, rpc_timeout);
 		GULPS_CHECK_AND_ASSERT_MES(r, std::string(), "Failed to connect to daemon");
 		GULPS_CHECK_AND_ASSERT_MES(resp_t.status != CORE_RPC_STATUS_BUSY, resp_t.status, "Failed to connect to daemon");
 		GULPS_CHECK_AND_ASSERT_MES(resp_t.status == CORE_RPC_STATUS_OK, resp_t.status, "Failed to get daemon RPC version");
@@ -99,9 +97,7 @@ boost::optional<std::string> NodeRPCProxy::get_height(uint64_t &height) const
 		cryptonote::COMMAND_RPC_GET_HEIGHT::request req = AUTO_VAL_INIT(req);
 		cryptonote::COMMAND_RPC_GET_HEIGHT::response res = AUTO_VAL_INIT(res);
 
-		m_daemon_rpc_mutex.lock();
-		bool r = net_utils::invoke_http_json("/getheight", req, res, m_http_client, rpc_timeout);
-		m_daemon_rpc_mutex.unlock();
+		bool r = m_daemon_rpc.invoke_http_json("/getheight", req, res, rpc_timeout);
 		GULPS_CHECK_AND_ASSERT_MES(r, std::string(), "Failed to connect to daemon");
 		GULPS_CHECK_AND_ASSERT_MES(res.status != CORE_RPC_STATUS_BUSY, res.status, "Failed to connect to daemon");
 		GULPS_CHECK_AND_ASSERT_MES(res.status == CORE_RPC_STATUS_OK, res.status, "Failed to get current blockchain height");
@@ -125,9 +121,7 @@ boost::optional<std::string> NodeRPCProxy::get_target_height(uint64_t &height) c
 		cryptonote::COMMAND_RPC_GET_INFO::request req_t = AUTO_VAL_INIT(req_t);
 		cryptonote::COMMAND_RPC_GET_INFO::response resp_t = AUTO_VAL_INIT(resp_t);
 
-		m_daemon_rpc_mutex.lock();
-		bool r = net_utils::invoke_http_json_rpc("/json_rpc", "get_info", req_t, resp_t, m_http_client, rpc_timeout);
-		m_daemon_rpc_mutex.unlock();
+		bool r = m_daemon_rpc.invoke_http_json_rpc("/json_rpc", "get_info", req_t, resp_t, rpc_timeout);
 
 		GULPS_CHECK_AND_ASSERT_MES(r, std::string(), "Failed to connect to daemon");
 		GULPS_CHECK_AND_ASSERT_MES(resp_t.status != CORE_RPC_STATUS_BUSY, resp_t.status, "Failed to connect to daemon");
@@ -146,10 +140,8 @@ boost::optional<std::string> NodeRPCProxy::get_earliest_height(uint8_t version,
 		cryptonote::COMMAND_RPC_HARD_FORK_INFO::request req_t = AUTO_VAL_INIT(req_t);
 		cryptonote::COMMAND_RPC_HARD_FORK_INFO::response resp_t = AUTO_VAL_INIT(resp_t);
 
-		m_daemon_rpc_mutex.lock();
 		req_t.version = version;
-		bool r = net_utils::invoke_http_json_rpc("/json_rpc", "hard_fork_info", req_t, resp_t, m_http_client, rpc_timeout);
-		m_daemon_rpc_mutex.unlock();
+		bool r = m_daemon_rpc.invoke_http_json_rpc("/json_rpc", "hard_fork_info", req_t, resp_t, rpc_timeout);
 		GULPS_CHECK_AND_ASSERT_MES(r, std::string(), "Failed to connect to daemon");
 		GULPS_CHECK_AND_ASSERT_MES(resp_t.status != CORE_RPC_STATUS_BUSY, resp_t.status, "Failed to connect to daemon");
 		GULPS_CHECK_AND_ASSERT_MES(resp_t.status == CORE_RPC_STATUS_OK, resp_t.status, "Failed to get hard fork status");
@@ -46,9 +46,8 @@
 
 #include "common/gulps.hpp"
 
+#include "daemon_rpc_pool.h"
 #include "include_base_utils.h"
-#include "net/http_client.h"
-#include <boost/thread/mutex.hpp>
 #include <string>
 
 namespace tools
@@ -58,7 +57,7 @@ class NodeRPCProxy
 {
 	GULPS_CAT_MAJOR("wallet_rpc_proxy");
   public:
-	NodeRPCProxy(epee::net_utils::http::http_simple_client &http_client, boost::mutex &mutex);
+	NodeRPCProxy(daemon_rpc_pool &daemon_rpc);
 
 	void invalidate();
 
@@ -69,8 +68,7 @@ class NodeRPCProxy
 	boost::optional<std::string> get_earliest_height(uint8_t version, uint64_t &earliest_height) const;
 
   private:
-	epee::net_utils::http::http_simple_client &m_http_client;
-	boost::mutex &m_daemon_rpc_mutex;
+	daemon_rpc_pool &m_daemon_rpc;
 
 	mutable uint64_t m_height;
 	mutable time_t m_height_time;
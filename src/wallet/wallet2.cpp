@@ -52,6 +52,7 @@
 #include <boost/format.hpp>
 #include <boost/optional/optional.hpp>
 #include <boost/utility/value_init.hpp>
+#include <future>
 #include <numeric>
 #include <random>
 #include <tuple>
@@ -631,12 +632,19 @@ wallet2::wallet2(network_type nettype, bool restricted) : m_multisig_rescan_info
 														  m_is_initialized(false),
 														  m_restricted(restricted),
 														  is_old_file_format(false),
-														  m_node_rpc_proxy(m_http_client, m_daemon_rpc_mutex),
+														  m_node_rpc_proxy(m_daemon_rpc),
 														  m_subaddress_lookahead_major(SUBADDRESS_LOOKAHEAD_MAJOR),
 														  m_subaddress_lookahead_minor(SUBADDRESS_LOOKAHEAD_MINOR),
 														  m_key_on_device(false),
 														  m_ring_history_saved(false),
-														  m_ringdb()
+														  m_ringdb(),
+														  m_balance_ledger_valid(false),
+														  m_journal_valid(false),
+														  m_journal_base_size(0),
+														  m_journal_size(0),
+														  m_journal_blockchain_size(0),
+														  m_journal_transfers_size(0),
+														  m_journal_address_book_dirty(false)
 {
 }
 
@@ -714,13 +722,12 @@ std::unique_ptr<wallet2> wallet2::make_dummy(const boost::program_options::varia
 bool wallet2::init(std::string daemon_address, boost::optional<epee::net_utils::http::login> daemon_login, uint64_t upper_transaction_size_limit, bool ssl)
 {
 	m_checkpoints.init_default_checkpoints(m_nettype);
-	if(m_http_client.is_connected())
-		m_http_client.disconnect();
+	m_daemon_rpc.disconnect();
 	m_is_initialized = true;
 	m_upper_transaction_size_limit = upper_transaction_size_limit;
 	m_daemon_address = std::move(daemon_address);
 	m_daemon_login = std::move(daemon_login);
-	return m_http_client.set_server(get_daemon_address(), get_daemon_login(), ssl);
+	return m_daemon_rpc.set_server(get_daemon_address(), get_daemon_login(), ssl);
 }
 //----------------------------------------------------------------------------------------------------
 bool wallet2::get_seed(std::string &electrum_words, bool &short_seed) const
@@ -901,9 +908,13 @@ void wallet2::expand_subaddresses(const cryptonote::subaddress_index &index)
 			for(index2.minor = 0; index2.minor < end; ++index2.minor)
 			{
 				const crypto::public_key &D = pkeys[index2.minor];
-				m_subaddresses[D] = index2;
+				// Keys already in the lookahead are derived again, only new ones are journaled
+				if(m_subaddresses.emplace(D, index2).second)
+					m_journal_subaddresses.emplace_back(D, index2);
 			}
 		}
+		for(uint32_t major = m_subaddress_labels.size(); major <= index.major; ++major)
+			m_journal_dirty_accounts.insert(major);
 		m_subaddress_labels.resize(index.major + 1, {"Untitled account"});
 		m_subaddress_labels[index.major].resize(index.minor + 1);
 	}
@@ -917,8 +928,10 @@ void wallet2::expand_subaddresses(const cryptonote::subaddress_index &index)
 		for(; index2.minor < end; ++index2.minor)
 		{
 			const crypto::public_key &D = pkeys[index2.minor - begin];
-			m_subaddresses[D] = index2;
+			if(m_subaddresses.emplace(D, index2).second)
+				m_journal_subaddresses.emplace_back(D, index2);
 		}
+		m_journal_dirty_accounts.insert(index.major);
 		m_subaddress_labels[index.major].resize(index.minor + 1);
 	}
 }
@@ -938,6 +951,7 @@ void wallet2::set_subaddress_label(const cryptonote::subaddress_index &index, co
 	THROW_WALLET_EXCEPTION_IF(index.major >= m_subaddress_labels.size(), error::account_index_outofbound);
 	THROW_WALLET_EXCEPTION_IF(index.minor >= m_subaddress_labels[index.major].size(), error::address_index_outofbound);
 	m_subaddress_labels[index.major][index.minor] = label;
+	m_journal_dirty_accounts.insert(index.major);
 }
 //----------------------------------------------------------------------------------------------------
 void wallet2::set_subaddress_lookahead(size_t major, size_t minor)
@@ -962,6 +976,8 @@ void wallet2::set_spent(size_t idx, uint64_t height)
 	GULPS_LOG_L2("Setting SPENT at ", height, ": ki ", td.m_key_image, ", amount ", print_money(td.m_amount));
 	td.m_spent = true;
 	td.m_spent_height = height;
+	m_journal_dirty_transfers.insert(idx);
+	update_balance_ledger(idx);
 }
 //----------------------------------------------------------------------------------------------------
 void wallet2::set_unspent(size_t idx)
@@ -970,6 +986,41 @@ void wallet2::set_unspent(size_t idx)
 	GULPS_LOG_L2("Setting UNSPENT: ki ", td.m_key_image, ", amount ", print_money(td.m_amount));
 	td.m_spent = false;
 	td.m_spent_height = 0;
+	m_journal_dirty_transfers.insert(idx);
+	update_balance_ledger(idx);
+}
+//----------------------------------------------------------------------------------------------------
+uint64_t wallet2::get_transfer_unlock_height(const transfer_details &td)
+{
+	// the lowest m_local_bc_height for which is_transfer_unlocked(td) holds
+	uint64_t height = td.m_block_height + CRYPTONOTE_DEFAULT_TX_SPENDABLE_AGE;
+	if(td.m_tx.unlock_time >= CRYPTONOTE_LOCKED_TX_ALLOWED_DELTA_BLOCKS)
+		height = std::max<uint64_t>(height, td.m_tx.unlock_time - CRYPTONOTE_LOCKED_TX_ALLOWED_DELTA_BLOCKS + 1);
+	return height;
+}
+//----------------------------------------------------------------------------------------------------
+void wallet2::update_balance_ledger(size_t idx)
+{
+	if(!m_balance_ledger_valid)
+		return;
+	const transfer_details &td = m_transfers[idx];
+	m_balance_ledger.set(idx, td.m_subaddr_index, td.amount(), get_transfer_unlock_height(td), td.m_spent);
+}
+//----------------------------------------------------------------------------------------------------
+void wallet2::sync_balance_ledger() const
+{
+	if(!m_balance_ledger_valid || m_balance_ledger.size() != m_transfers.size())
+	{
+		m_balance_ledger.clear();
+		m_balance_ledger.set_height(m_local_bc_height);
+		for(size_t i = 0; i < m_transfers.size(); ++i)
+		{
+			const transfer_details &td = m_transfers[i];
+			m_balance_ledger.set(i, td.m_subaddr_index, td.amount(), get_transfer_unlock_height(td), td.m_spent);
+		}
+		m_balance_ledger_valid = true;
+	}
+	m_balance_ledger.set_height(m_local_bc_height);
 }
 //----------------------------------------------------------------------------------------------------
 void wallet2::check_acc_out_precomp(const tx_out &o, const crypto::key_derivation &derivation, const std::vector<crypto::key_derivation> &additional_derivations, size_t i, tx_scan_info_t &tx_scan_info) const
@@ -1284,6 +1335,7 @@ void wallet2::process_new_transaction(const crypto::hash &txid, const cryptonote
 					if(!pool)
 					{
 						transfer_details &td = m_transfers[kit->second];
+						m_journal_dirty_transfers.insert(kit->second);
 						td.m_block_height = height;
 						td.m_internal_output_index = o;
 						td.m_global_output_index = o_indices[o];
@@ -1308,6 +1360,7 @@ void wallet2::process_new_transaction(const crypto::hash &txid, const cryptonote
 							td.m_mask = rct::identity();
 							td.m_rct = false;
 						}
+						update_balance_ledger(kit->second);
 						if(m_multisig)
 						{
 							THROW_WALLET_EXCEPTION_IF(!m_multisig_rescan_k && m_multisig_rescan_info,
@@ -1353,6 +1406,8 @@ void wallet2::process_new_transaction(const crypto::hash &txid, const cryptonote
 					//   2) the wallet set the highest amount among them to transfer_details::m_amount, and
 					//   3) the wallet somehow spent that output with an amount smaller than the above amount, causing inconsistency
 					td.m_amount = amount;
+					m_journal_dirty_transfers.insert(it->second);
+					update_balance_ledger(it->second);
 				}
 			}
 			else
@@ -1486,7 +1541,10 @@ void wallet2::process_new_transaction(const crypto::hash &txid, const cryptonote
 					m_callback->on_unconfirmed_money_received(height, txid, tx, payment.m_amount, payment.m_subaddr_index);
 			}
 			else
+			{
 				m_payments.emplace(payment_id, payment);
+				m_journal_payments.emplace_back(payment_id, payment);
+			}
 			GULPS_LOG_L2("Payment found in ", (pool ? "pool" : "block"), ": ", payment_id, " / ", payment.m_tx_hash, " / ", payment.m_amount);
 		}
 	}
@@ -1505,6 +1563,7 @@ void wallet2::process_unconfirmed(const crypto::hash &txid, const cryptonote::tr
 			try
 			{
 				m_confirmed_txs.insert(std::make_pair(txid, confirmed_transfer_details(unconf_it->second, height)));
+				m_journal_dirty_txs.insert(txid);
 			}
 			catch(...)
 			{
@@ -1519,6 +1578,7 @@ void wallet2::process_unconfirmed(const crypto::hash &txid, const cryptonote::tr
 void wallet2::process_outgoing(const crypto::hash &txid, const cryptonote::transaction &tx, uint64_t height, uint64_t ts, uint64_t spent, uint64_t received, uint32_t subaddr_account, const std::set<uint32_t> &subaddr_indices)
 {
 	std::pair<std::unordered_map<crypto::hash, confirmed_transfer_details>::iterator, bool> entry = m_confirmed_txs.insert(std::make_pair(txid, confirmed_transfer_details()));
+	m_journal_dirty_txs.insert(txid);
 	// fill with the info we know, some info might already be there
 	if(entry.second)
 	{
@@ -1602,9 +1662,7 @@ void wallet2::pull_hashes(uint64_t start_height, uint64_t &blocks_start_height,
 	req.block_ids = short_chain_history;
 
 	req.start_height = start_height;
-	m_daemon_rpc_mutex.lock();
-	bool r = net_utils::invoke_http_bin("/gethashes.bin", req, res, m_http_client, rpc_timeout);
-	m_daemon_rpc_mutex.unlock();
+	bool r = m_daemon_rpc.invoke_http_bin("/gethashes.bin", req, res, rpc_timeout);
 	THROW_WALLET_EXCEPTION_IF(!r, error::no_connection_to_daemon, "gethashes.bin");
 	THROW_WALLET_EXCEPTION_IF(res.status == CORE_RPC_STATUS_BUSY, error::daemon_busy, "gethashes.bin");
 	THROW_WALLET_EXCEPTION_IF(res.status != CORE_RPC_STATUS_OK, error::get_hashes_error, res.status);
@@ -1653,6 +1711,17 @@ void wallet2::remove_obsolete_pool_txs(const std::vector<crypto::hash> &tx_hashe
 	}
 }
 
+//----------------------------------------------------------------------------------------------------
+void wallet2::add_scanned_pool_tx(const crypto::hash &txid)
+{
+	m_scanned_pool_txs[0].insert(txid);
+	if(m_scanned_pool_txs[0].size() > 5000)
+	{
+		std::swap(m_scanned_pool_txs[0], m_scanned_pool_txs[1]);
+		m_scanned_pool_txs[0].clear();
+	}
+	m_journal_scanned_pool_txs.push_back(txid);
+}
 //----------------------------------------------------------------------------------------------------
 void wallet2::update_pool_state(bool refreshed)
 {
@@ -1661,9 +1730,7 @@ void wallet2::update_pool_state(bool refreshed)
 	// get the pool state
 	cryptonote::COMMAND_RPC_GET_TRANSACTION_POOL_HASHES::request req;
 	cryptonote::COMMAND_RPC_GET_TRANSACTION_POOL_HASHES::response res;
-	m_daemon_rpc_mutex.lock();
-	bool r = epee::net_utils::invoke_http_json("/get_transaction_pool_hashes.bin", req, res, m_http_client, rpc_timeout);
-	m_daemon_rpc_mutex.unlock();
+	bool r = m_daemon_rpc.invoke_http_json("/get_transaction_pool_hashes.bin", req, res, rpc_timeout);
 	THROW_WALLET_EXCEPTION_IF(!r, error::no_connection_to_daemon, "get_transaction_pool_hashes.bin");
 	THROW_WALLET_EXCEPTION_IF(res.status == CORE_RPC_STATUS_BUSY, error::daemon_busy, "get_transaction_pool_hashes.bin");
 	THROW_WALLET_EXCEPTION_IF(res.status != CORE_RPC_STATUS_OK, error::get_tx_pool_error);
@@ -1808,9 +1875,7 @@ void wallet2::update_pool_state(bool refreshed)
 		GULPS_LOG_L1("asking for ", txids.size(), " transactions");
 		req.decode_as_json = false;
 		req.prune = false;
-		m_daemon_rpc_mutex.lock();
-		bool r = epee::net_utils::invoke_http_json("/gettransactions", req, res, m_http_client, rpc_timeout);
-		m_daemon_rpc_mutex.unlock();
+		bool r = m_daemon_rpc.invoke_http_json("/gettransactions", req, res, rpc_timeout);
 		GULPS_LOG_L1("Got ", r, " and ", res.status);
 		if(r && res.status == CORE_RPC_STATUS_OK)
 		{
@@ -1832,12 +1897,7 @@ void wallet2::update_pool_state(bool refreshed)
 								if(i != txids.end())
 								{
 									process_new_transaction(tx_hash, tx, std::vector<uint64_t>(), 0, time(NULL), false, true, tx_entry.double_spend_seen);
-									m_scanned_pool_txs[0].insert(tx_hash);
-									if(m_scanned_pool_txs[0].size() > 5000)
-									{
-										std::swap(m_scanned_pool_txs[0], m_scanned_pool_txs[1]);
-										m_scanned_pool_txs[0].clear();
-									}
+									add_scanned_pool_tx(tx_hash);
 								}
 								else
 								{
@@ -1950,6 +2010,7 @@ bool wallet2::add_address_book_row(const cryptonote::account_public_address &add
 
 	auto old_size = m_address_book.size();
 	m_address_book.push_back(a);
+	m_journal_address_book_dirty = true;
 	if(m_address_book.size() == old_size + 1)
 		return true;
 	return false;
@@ -1961,23 +2022,25 @@ bool wallet2::delete_address_book_row(std::size_t row_id)
 		return false;
 
 	m_address_book.erase(m_address_book.begin() + row_id);
+	m_journal_address_book_dirty = true;
 
 	return true;
 }
 
 //----------------------------------------------------------------------------------------------------
-void wallet2::integrate_scanned_result(std::unique_ptr<wallet_rpc_scan_data>& res)
+void wallet2::integrate_scanned_result(wallet_rpc_scan_data& res, wallet_rpc_scan_data::account_scan_result& found)
 {
 	// First things, first, check for any forks, our data is new so it overrides anything else
 	// Including previous data (can happen if there is a fork during the scan)
 	GULPSF_LOG_L1("m_blockchain top: {} - {}", m_blockchain.size()-1, m_blockchain[m_blockchain.size()-1]);
-	GULPSF_LOG_L1("blocks_parsed front: {} - {}", res->blocks_parsed.front().block_height, res->blocks_parsed.front().block_hash);
-	THROW_WALLET_EXCEPTION_IF(res->blocks_parsed.size() == 0, error::wallet_internal_error, "Integrated blocks vector is empty");
-	THROW_WALLET_EXCEPTION_IF(!m_blockchain.is_in_bounds(res->blocks_parsed.front().block_height), error::wallet_internal_error, "Index out of bounds of hashchain");
-	GULPSF_LOG_L1("Integrating results blocks: {} - {}", res->blocks_parsed.front().block_height, res->blocks_parsed.back().block_height);
+	GULPSF_LOG_L1("blocks_parsed front: {} - {}", res.blocks_parsed.front().block_height, res.blocks_parsed.front().block_hash);
+	THROW_WALLET_EXCEPTION_IF(res.blocks_parsed.size() == 0, error::wallet_internal_error, "Integrated blocks vector is empty");
+	THROW_WALLET_EXCEPTION_IF(!m_blockchain.is_in_bounds(res.blocks_parsed.front().block_height), error::wallet_internal_error, "Index out of bounds of hashchain");
+	GULPSF_LOG_L1("Integrating results blocks: {} - {}", res.blocks_parsed.front().block_height, res.blocks_parsed.back().block_height);
 	
-	for(auto& bl : res->blocks_parsed)
+	for(size_t blk_idx = 0; blk_idx < res.blocks_parsed.size(); blk_idx++)
 	{
+		const auto& bl = res.blocks_parsed[blk_idx];
 		if(bl.block_height < m_blockchain.size())
 		{
 			if(m_blockchain[bl.block_height] != bl.block_hash)
@@ -1988,7 +2051,7 @@ void wallet2::integrate_scanned_result(std::unique_ptr<wallet_rpc_scan_data>& re
 			else
 			{
 				GULPSF_LOG_L1("Block is already in blockchain: {}", bl.block_hash);
-				bl.skipped = true;
+				found.skipped[blk_idx] = true;
 				continue;
 			}
 		}
@@ -2005,23 +2068,23 @@ void wallet2::integrate_scanned_result(std::unique_ptr<wallet_rpc_scan_data>& re
 
 	tx_call_map tx_calls;
 	// Now, process incoming funds
-	for(const auto& i : res->indices_found)
+	for(const auto& i : found.indices_found)
 	{
-		if(res->blocks_parsed[i.block_idx].skipped)
+		if(found.skipped[i.block_idx])
 			continue;
 
-		const cryptonote::block& b = res->blocks_parsed[i.block_idx].block;
-		const std::vector<uint64_t>& tx_indices = res->o_indices[i.block_idx].indices[i.tx_idx].indices;
-		size_t height = res->blocks_parsed[i.block_idx].block_height;
+		const cryptonote::block& b = res.blocks_parsed[i.block_idx].block;
+		const std::vector<uint64_t>& tx_indices = res.o_indices[i.block_idx].indices[i.tx_idx].indices;
+		size_t height = res.blocks_parsed[i.block_idx].block_height;
 
 		if(i.tx_idx == 0)
 		{
-			const crypto::hash& tx_id = res->blocks_parsed[i.block_idx].miner_tx_hash;
+			const crypto::hash& tx_id = res.blocks_parsed[i.block_idx].miner_tx_hash;
 			add_new_tx_call(tx_calls, tx_id, b.miner_tx, tx_indices, height, b.timestamp, true);
 		}
 		else
 		{
-			const cryptonote::transaction& tx = res->blocks_parsed[i.block_idx].txes[i.tx_idx-1];
+			const cryptonote::transaction& tx = res.blocks_parsed[i.block_idx].txes[i.tx_idx-1];
 			add_new_tx_call(tx_calls, b.tx_hashes[i.tx_idx-1], tx, tx_indices, height, b.timestamp, false);
 		}
 	}
@@ -2030,7 +2093,7 @@ void wallet2::integrate_scanned_result(std::unique_ptr<wallet_rpc_scan_data>& re
 	bool needs_full_scan = false;
 	for(const auto& n : m_key_images)
 	{
-		if(!res->key_images.not_present(&n.first, sizeof(crypto::key_image)))
+		if(!res.key_images.not_present(&n.first, sizeof(crypto::key_image)))
 		{
 			needs_full_scan = true;
 			break;
@@ -2039,9 +2102,9 @@ void wallet2::integrate_scanned_result(std::unique_ptr<wallet_rpc_scan_data>& re
 
 	if(!needs_full_scan)
 	{
-		for(const auto& n : res->incoming_kimg)
+		for(const auto& n : found.incoming_kimg)
 		{
-			if(!res->key_images.not_present(&n, sizeof(crypto::key_image)))
+			if(!res.key_images.not_present(&n, sizeof(crypto::key_image)))
 			{
 				needs_full_scan = true;
 				break;
@@ -2051,25 +2114,25 @@ void wallet2::integrate_scanned_result(std::unique_ptr<wallet_rpc_scan_data>& re
 
 	if(needs_full_scan)
 	{
-		for(size_t blk_idx = 0; blk_idx < res->blocks_parsed.size(); blk_idx++)
+		for(size_t blk_idx = 0; blk_idx < res.blocks_parsed.size(); blk_idx++)
 		{
-			if(res->blocks_parsed[blk_idx].skipped)
+			if(found.skipped[blk_idx])
 				continue;
 
-			for(size_t tx_idx = 0; tx_idx < res->blocks_parsed[blk_idx].txes.size(); tx_idx++)
+			for(size_t tx_idx = 0; tx_idx < res.blocks_parsed[blk_idx].txes.size(); tx_idx++)
 			{
-				for(const auto& in : res->blocks_parsed[blk_idx].txes[tx_idx].vin)
+				for(const auto& in : res.blocks_parsed[blk_idx].txes[tx_idx].vin)
 				{
 					if(in.type() != typeid(cryptonote::txin_to_key))
 						continue;
 
 					const crypto::key_image& ki = boost::get<cryptonote::txin_to_key>(in).k_image;
-					if(m_key_images.find(ki) != m_key_images.end() || res->incoming_kimg.find(ki) != res->incoming_kimg.end())
+					if(m_key_images.find(ki) != m_key_images.end() || found.incoming_kimg.find(ki) != found.incoming_kimg.end())
 					{
-						const cryptonote::block& b = res->blocks_parsed[blk_idx].block;
-						size_t height = res->blocks_parsed[blk_idx].block_height;
-						const std::vector<uint64_t>& tx_indices = res->o_indices[blk_idx].indices[tx_idx+1].indices;
-						const cryptonote::transaction& tx = res->blocks_parsed[blk_idx].txes[tx_idx];
+						const cryptonote::block& b = res.blocks_parsed[blk_idx].block;
+						size_t height = res.blocks_parsed[blk_idx].block_height;
+						const std::vector<uint64_t>& tx_indices = res.o_indices[blk_idx].indices[tx_idx+1].indices;
+						const cryptonote::transaction& tx = res.blocks_parsed[blk_idx].txes[tx_idx];
 						add_new_tx_call(tx_calls, b.tx_hashes[tx_idx], tx, tx_indices, height, b.timestamp, false);
 					}
 				}
@@ -2132,7 +2195,7 @@ void wallet2::refresh(uint64_t start_height, uint64_t &blocks_fetched, bool &rec
 		return;
 
 	//Download thread will likely be network or disk bound, so it should be in addition to max_conurrency
-	wallet_refresh_ctx refresh_ctx;
+	wallet_refresh_ctx refresh_ctx(m_run);
 	wallet_block_dl_ctx ctx(refresh_ctx);
 	size_t thd_max = std::min<size_t>(tools::get_max_concurrency(), 8);
 	ctx.scan_thd_cnt = thd_max;
@@ -2140,7 +2203,8 @@ void wallet2::refresh(uint64_t start_height, uint64_t &blocks_fetched, bool &rec
 	ctx.start_height = start_height;
 	ctx.thd = std::thread(&wallet2::block_download_thd, this, std::ref(ctx));
 
-	wallet_scan_ctx ct(*this, refresh_ctx);
+	std::vector<wallet_scan_ctx> scan_ctxs;
+	scan_ctxs.emplace_back(*this);
 	refresh_ctx.m_running_scan_thd_cnt = thd_max;
 
 	GULPSF_LOG_L1("Running {} scanning threads", refresh_ctx.m_running_scan_thd_cnt);
@@ -2148,50 +2212,10 @@ void wallet2::refresh(uint64_t start_height, uint64_t &blocks_fetched, bool &rec
 	std::vector<std::thread> scan_thds;
 	scan_thds.reserve(thd_max);
 	for(size_t i=0; i < thd_max; i++)
-		scan_thds.emplace_back(&wallet2::block_scan_thd, this, std::cref(ct));
-
-	size_t result_idx=0;
-	std::list<std::unique_ptr<wallet2::wallet_rpc_scan_data>> result_list;
-	std::unique_lock<std::mutex> lck = refresh_ctx.m_scan_out_queue.get_lock();
-	while(refresh_ctx.m_scan_out_queue.wait_for_pop(lck))
-	{
-		result_list.emplace_back(refresh_ctx.m_scan_out_queue.pop(lck));
+		scan_thds.emplace_back(&wallet2::block_scan_thd, std::cref(scan_ctxs), std::ref(refresh_ctx));
 
-		if(!m_run)
-			break;
-
-		bool processed;
-		do
-		{
-			// Integrate scanned results in order they were fanned out
-			processed = false;
-			for(auto it = result_list.begin(); it != result_list.end();)
-			{
-				std::unique_ptr<wallet2::wallet_rpc_scan_data>& res = *it;
-				if(result_idx != res->dl_order)
-				{
-					it++;
-					continue;
-				}
-				result_idx++;
-				processed = true;
-				try
-				{
-					integrate_scanned_result(res);
-				}
-				catch(std::exception &e)
-				{
-					GULPS_LOG_ERROR("Integrate scanned results exception:\n", e.what());
-					ctx.error = true;
-					refresh_ctx.m_scan_error = true;
-					m_run = false;
-					break;
-				}
-				it = result_list.erase(it);
-			}
-		}
-		while(processed);
-	}
+	if(!integrate_scanned_in_order(refresh_ctx, [this](wallet_rpc_scan_data& res) { integrate_scanned_result(res, res.accounts[0]); }))
+		ctx.error = true;
 
 	GULPS_LOG_L1("Joining threads...");
 	ctx.thd.join();
@@ -2265,9 +2289,7 @@ bool wallet2::get_output_distribution(uint64_t &start_height, std::vector<uint64
 	req.amounts.push_back(0);
 	req.from_height = 0;
 	req.cumulative = true;
-	m_daemon_rpc_mutex.lock();
-	bool r = net_utils::invoke_http_json_rpc("/json_rpc", "get_output_distribution", req, res, m_http_client, rpc_timeout);
-	m_daemon_rpc_mutex.unlock();
+	bool r = m_daemon_rpc.invoke_http_json_rpc("/json_rpc", "get_output_distribution", req, res, rpc_timeout);
 	if(!r)
 	{
 		GULPS_WARN("Failed to request output distribution: no connection to daemon");
@@ -2301,6 +2323,7 @@ bool wallet2::get_output_distribution(uint64_t &start_height, std::vector<uint64
 void wallet2::detach_blockchain(uint64_t height)
 {
 	GULPS_LOG_L0("Detaching blockchain on height ", height);
+	invalidate_journal();
 
 	// size  1 2 3 4 5 6 7 8 9
 	// block 0 1 2 3 4 5 6 7 8
@@ -2339,6 +2362,8 @@ void wallet2::detach_blockchain(uint64_t height)
 		m_pub_keys.erase(it_pk);
 	}
 	m_transfers.erase(it, m_transfers.end());
+	if(m_balance_ledger_valid)
+		m_balance_ledger.truncate(m_transfers.size());
 
 	size_t blocks_detached = m_blockchain.size() - height;
 	m_blockchain.crop(height);
@@ -2371,8 +2396,10 @@ bool wallet2::deinit()
 //----------------------------------------------------------------------------------------------------
 bool wallet2::clear()
 {
+	invalidate_journal();
 	m_blockchain.clear();
 	m_transfers.clear();
+	m_balance_ledger_valid = false;
 	m_key_images.clear();
 	m_pub_keys.clear();
 	m_unconfirmed_txs.clear();
@@ -3660,12 +3687,12 @@ bool wallet2::check_connection(uint32_t *version, uint32_t timeout)
 {
 	THROW_WALLET_EXCEPTION_IF(!m_is_initialized, error::wallet_not_initialized);
 
-	boost::lock_guard<boost::mutex> lock(m_daemon_rpc_mutex);
+	daemon_rpc_pool::lease conn = m_daemon_rpc.acquire();
 
-	if(!m_http_client.is_connected())
+	if(!conn->is_connected())
 	{
 		m_node_rpc_proxy.invalidate();
-		if(!m_http_client.connect(std::chrono::milliseconds(timeout)))
+		if(!conn->connect(std::chrono::milliseconds(timeout)))
 			return false;
 	}
 
@@ -3673,7 +3700,7 @@ bool wallet2::check_connection(uint32_t *version, uint32_t timeout)
 	{
 		cryptonote::COMMAND_RPC_GET_VERSION::request req_t = AUTO_VAL_INIT(req_t);
 		cryptonote::COMMAND_RPC_GET_VERSION::response resp_t = AUTO_VAL_INIT(resp_t);
-		bool r = net_utils::invoke_http_json_rpc("/json_rpc", "get_version", req_t, resp_t, m_http_client);
+		bool r = net_utils::invoke_http_json_rpc("/json_rpc", "get_version", req_t, resp_t, *conn);
 		if(!r)
 		{
 			*version = 0;
@@ -3720,6 +3747,7 @@ void wallet2::load(const std::string &wallet_, const epee::wipeable_string &pass
 	{
 		wallet2::cache_file_data cache_file_data;
 		std::string buf;
+		bool journal_base = false;
 		bool r = epee::file_io_utils::load_file_to_string(m_wallet_file, buf);
 		THROW_WALLET_EXCEPTION_IF(!r, error::file_read_error, m_wallet_file);
 
@@ -3742,6 +3770,7 @@ void wallet2::load(const std::string &wallet_, const epee::wipeable_string &pass
 				iss << cache_data;
 				boost::archive::portable_binary_iarchive ar(iss);
 				ar >> *this;
+				journal_base = true;
 			}
 			catch(...)
 			{
@@ -3808,6 +3837,16 @@ void wallet2::load(const std::string &wallet_, const epee::wipeable_string &pass
 			m_account_public_address.m_spend_public_key != m_account.get_keys().m_account_address.m_spend_public_key ||
 				m_account_public_address.m_view_public_key != m_account.get_keys().m_account_address.m_view_public_key,
 			error::wallet_files_doesnt_correspond, m_keys_file, m_wallet_file);
+
+		// Only a current format snapshot can have a journal on top of it
+		if(journal_base)
+		{
+			crypto::chacha_key key;
+			generate_chacha_key_from_secret_keys(key);
+			m_journal_base_iv = cache_file_data.iv;
+			m_journal_base_size = cache_file_data.cache_data.size();
+			load_journal(key);
+		}
 	}
 
 	cryptonote::block genesis;
@@ -3853,15 +3892,14 @@ void wallet2::trim_hashchain()
 		GULPS_LOG_L0("Fixing empty hashchain");
 		cryptonote::COMMAND_RPC_GET_BLOCK_HEADER_BY_HEIGHT::request req = AUTO_VAL_INIT(req);
 		cryptonote::COMMAND_RPC_GET_BLOCK_HEADER_BY_HEIGHT::response res = AUTO_VAL_INIT(res);
-		m_daemon_rpc_mutex.lock();
 		req.height = m_blockchain.size() - 1;
-		bool r = net_utils::invoke_http_json_rpc("/json_rpc", "getblockheaderbyheight", req, res, m_http_client, rpc_timeout);
-		m_daemon_rpc_mutex.unlock();
+		bool r = m_daemon_rpc.invoke_http_json_rpc("/json_rpc", "getblockheaderbyheight", req, res, rpc_timeout);
 		if(r && res.status == CORE_RPC_STATUS_OK)
 		{
 			crypto::hash hash;
 			epee::string_tools::hex_to_pod(res.block_header.hash, hash);
 			m_blockchain.refill(hash);
+			invalidate_journal();
 		}
 		else
 		{
@@ -3928,6 +3966,13 @@ void wallet2::store_to(const std::string &path, const epee::wipeable_string &pas
 			}
 		}
 	}
+	crypto::chacha_key key;
+	generate_chacha_key_from_secret_keys(key);
+
+	// Append the changes since the last store, unless the journal has to be compacted
+	if(same_file && store_journal_record(key))
+		return;
+
 	// preparing wallet data
 	std::stringstream oss;
 	boost::archive::portable_binary_oarchive ar(oss);
@@ -3935,8 +3980,6 @@ void wallet2::store_to(const std::string &path, const epee::wipeable_string &pas
 
 	wallet2::cache_file_data cache_file_data = boost::value_initialized<wallet2::cache_file_data>();
 	cache_file_data.cache_data = oss.str();
-	crypto::chacha_key key;
-	generate_chacha_key_from_secret_keys(key);
 	std::string cipher;
 	cipher.resize(cache_file_data.cache_data.size());
 	cache_file_data.iv = crypto::rand<crypto::chacha_iv>();
@@ -3980,6 +4023,10 @@ void wallet2::store_to(const std::string &path, const epee::wipeable_string &pas
 		{
 			GULPS_LOG_ERROR("error removing file: ", old_address_file);
 		}
+		// the old journal belongs to the removed cache
+		boost::system::error_code ec;
+		boost::filesystem::remove(old_file + ".journal", ec);
+		invalidate_journal();
 	}
 	else
 	{
@@ -4007,39 +4054,37 @@ void wallet2::store_to(const std::string &path, const epee::wipeable_string &pas
 		// here we have "*.new" file, we need to rename it to be without ".new"
 		std::error_code e = tools::replace_file(new_file, m_wallet_file);
 		THROW_WALLET_EXCEPTION_IF(e, error::file_save_error, m_wallet_file, e);
+
+		// the snapshot now holds everything, start a new journal on top of it
+		reset_journal(cache_file_data.iv, cache_file_data.cache_data.size());
 	}
 }
 //----------------------------------------------------------------------------------------------------
 uint64_t wallet2::balance(uint32_t index_major) const
 {
-	uint64_t amount = 0;
-	for(const auto &i : balance_per_subaddress(index_major))
-		amount += i.second;
+	sync_balance_ledger();
+	uint64_t amount = m_balance_ledger.account(index_major).balance;
+	for(const auto &utx : m_unconfirmed_txs)
+	{
+		// all changes go to 0-th subaddress (in the current subaddress account)
+		if(utx.second.m_subaddr_account == index_major && utx.second.m_state != wallet2::unconfirmed_transfer_details::failed)
+			amount += utx.second.m_change;
+	}
 	return amount;
 }
 //----------------------------------------------------------------------------------------------------
 uint64_t wallet2::unlocked_balance(uint32_t index_major) const
 {
-	uint64_t amount = 0;
-	for(const auto &i : unlocked_balance_per_subaddress(index_major))
-		amount += i.second;
-	return amount;
+	sync_balance_ledger();
+	return m_balance_ledger.account(index_major).unlocked;
 }
 //----------------------------------------------------------------------------------------------------
 std::map<uint32_t, uint64_t> wallet2::balance_per_subaddress(uint32_t index_major) const
 {
+	sync_balance_ledger();
 	std::map<uint32_t, uint64_t> amount_per_subaddr;
-	for(const auto &td : m_transfers)
-	{
-		if(td.m_subaddr_index.major == index_major && !td.m_spent)
-		{
-			auto found = amount_per_subaddr.find(td.m_subaddr_index.minor);
-			if(found == amount_per_subaddr.end())
-				amount_per_subaddr[td.m_subaddr_index.minor] = td.amount();
-			else
-				found->second += td.amount();
-		}
-	}
+	for(const auto &minor : m_balance_ledger.subaddresses(index_major))
+		amount_per_subaddr[minor.first] = minor.second.balance;
 	for(const auto &utx : m_unconfirmed_txs)
 	{
 		if(utx.second.m_subaddr_account == index_major && utx.second.m_state != wallet2::unconfirmed_transfer_details::failed)
@@ -4057,35 +4102,32 @@ std::map<uint32_t, uint64_t> wallet2::balance_per_subaddress(uint32_t index_majo
 //----------------------------------------------------------------------------------------------------
 std::map<uint32_t, uint64_t> wallet2::unlocked_balance_per_subaddress(uint32_t index_major) const
 {
+	sync_balance_ledger();
 	std::map<uint32_t, uint64_t> amount_per_subaddr;
-	for(const transfer_details &td : m_transfers)
+	for(const auto &minor : m_balance_ledger.subaddresses(index_major))
 	{
-		if(td.m_subaddr_index.major == index_major && !td.m_spent && is_transfer_unlocked(td))
-		{
-			auto found = amount_per_subaddr.find(td.m_subaddr_index.minor);
-			if(found == amount_per_subaddr.end())
-				amount_per_subaddr[td.m_subaddr_index.minor] = td.amount();
-			else
-				found->second += td.amount();
-		}
+		if(minor.second.unlocked_count != 0)
+			amount_per_subaddr[minor.first] = minor.second.unlocked;
 	}
 	return amount_per_subaddr;
 }
 //----------------------------------------------------------------------------------------------------
 uint64_t wallet2::balance_all() const
 {
-	uint64_t r = 0;
-	for(uint32_t index_major = 0; index_major < get_num_subaddress_accounts(); ++index_major)
-		r += balance(index_major);
+	sync_balance_ledger();
+	uint64_t r = m_balance_ledger.all().balance;
+	for(const auto &utx : m_unconfirmed_txs)
+	{
+		if(utx.second.m_subaddr_account < get_num_subaddress_accounts() && utx.second.m_state != wallet2::unconfirmed_transfer_details::failed)
+			r += utx.second.m_change;
+	}
 	return r;
 }
 //----------------------------------------------------------------------------------------------------
 uint64_t wallet2::unlocked_balance_all() const
 {
-	uint64_t r = 0;
-	for(uint32_t index_major = 0; index_major < get_num_subaddress_accounts(); ++index_major)
-		r += unlocked_balance(index_major);
-	return r;
+	sync_balance_ledger();
+	return m_balance_ledger.all().unlocked;
 }
 //----------------------------------------------------------------------------------------------------
 void wallet2::get_transfers(wallet2::transfer_container &incoming_transfers) const
@@ -4171,9 +4213,7 @@ void wallet2::rescan_spent()
 		COMMAND_RPC_IS_KEY_IMAGE_SPENT::response daemon_resp = AUTO_VAL_INIT(daemon_resp);
 		for(size_t n = start_offset; n < start_offset + n_outputs; ++n)
 			req.key_images.push_back(string_tools::pod_to_hex(m_transfers[n].m_key_image));
-		m_daemon_rpc_mutex.lock();
-		bool r = epee::net_utils::invoke_http_json("/is_key_image_spent", req, daemon_resp, m_http_client, rpc_timeout);
-		m_daemon_rpc_mutex.unlock();
+		bool r = m_daemon_rpc.invoke_http_json("/is_key_image_spent", req, daemon_resp, rpc_timeout);
 		THROW_WALLET_EXCEPTION_IF(!r, error::no_connection_to_daemon, "is_key_image_spent");
 		THROW_WALLET_EXCEPTION_IF(daemon_resp.status == CORE_RPC_STATUS_BUSY, error::daemon_busy, "is_key_image_spent");
 		THROW_WALLET_EXCEPTION_IF(daemon_resp.status != CORE_RPC_STATUS_OK, error::is_key_image_spent_error, daemon_resp.status);
@@ -4487,9 +4527,7 @@ void wallet2::commit_tx(pending_tx &ptx)
 	req.tx_as_hex = epee::string_tools::buff_to_hex_nodelimer(tx_to_blob(ptx.tx));
 	req.do_not_relay = false;
 	COMMAND_RPC_SEND_RAW_TX::response daemon_send_resp;
-	m_daemon_rpc_mutex.lock();
-	bool r = epee::net_utils::invoke_http_json("/sendrawtransaction", req, daemon_send_resp, m_http_client, rpc_timeout);
-	m_daemon_rpc_mutex.unlock();
+	bool r = m_daemon_rpc.invoke_http_json("/sendrawtransaction", req, daemon_send_resp, rpc_timeout);
 	THROW_WALLET_EXCEPTION_IF(!r, error::no_connection_to_daemon, "sendrawtransaction");
 	THROW_WALLET_EXCEPTION_IF(daemon_send_resp.status == CORE_RPC_STATUS_BUSY, error::daemon_busy, "sendrawtransaction");
 	THROW_WALLET_EXCEPTION_IF(daemon_send_resp.status != CORE_RPC_STATUS_OK, error::tx_rejected, ptx.tx, daemon_send_resp.status, daemon_send_resp.reason);
@@ -4518,6 +4556,7 @@ void wallet2::commit_tx(pending_tx &ptx)
 	{
 		m_tx_keys.insert(std::make_pair(txid, ptx.tx_key));
 		m_additional_tx_keys.insert(std::make_pair(txid, ptx.additional_tx_keys));
+		m_journal_dirty_txs.insert(txid);
 	}
 
 	GULPS_LOG_L2("transaction ", txid, " generated ok and sent to daemon, key_images: [", ptx.key_images, "]");
@@ -4700,6 +4739,7 @@ bool wallet2::sign_tx(unsigned_tx_set &exported_txs, const std::string &signed_f
 			const crypto::hash txid = get_transaction_hash(ptx.tx);
 			m_tx_keys.insert(std::make_pair(txid, tx_key));
 			m_additional_tx_keys.insert(std::make_pair(txid, additional_tx_keys));
+			m_journal_dirty_txs.insert(txid);
 		}
 
 		std::string key_images;
@@ -4864,6 +4904,7 @@ bool wallet2::load_tx(const std::string &signed_filename, std::vector<tools::wal
 		GULPS_LOG_L1("More key images returned that we know outputs for");
 		return false;
 	}
+	invalidate_journal();
 	for(size_t i = 0; i < signed_txs.key_images.size(); ++i)
 	{
 		transfer_details &td = m_transfers[i];
@@ -5008,6 +5049,7 @@ bool wallet2::load_multisig_tx(cryptonote::blobdata s, multisig_tx_set &exported
 			{
 				m_tx_keys.insert(std::make_pair(txid, ptx.tx_key));
 				m_additional_tx_keys.insert(std::make_pair(txid, ptx.additional_tx_keys));
+				m_journal_dirty_txs.insert(txid);
 			}
 		}
 	}
@@ -5129,6 +5171,7 @@ bool wallet2::sign_multisig_tx(multisig_tx_set &exported_txs, std::vector<crypto
 			{
 				m_tx_keys.insert(std::make_pair(txid, ptx.tx_key));
 				m_additional_tx_keys.insert(std::make_pair(txid, ptx.additional_tx_keys));
+				m_journal_dirty_txs.insert(txid);
 			}
 			txids.push_back(txid);
 		}
@@ -5218,9 +5261,7 @@ uint32_t wallet2::adjust_priority(uint32_t priority)
 			// get the current full reward zone
 			cryptonote::COMMAND_RPC_GET_INFO::request getinfo_req = AUTO_VAL_INIT(getinfo_req);
 			cryptonote::COMMAND_RPC_GET_INFO::response getinfo_res = AUTO_VAL_INIT(getinfo_res);
-			m_daemon_rpc_mutex.lock();
-			bool r = net_utils::invoke_http_json_rpc("/json_rpc", "get_info", getinfo_req, getinfo_res, m_http_client);
-			m_daemon_rpc_mutex.unlock();
+			bool r = m_daemon_rpc.invoke_http_json_rpc("/json_rpc", "get_info", getinfo_req, getinfo_res);
 			THROW_WALLET_EXCEPTION_IF(!r, error::no_connection_to_daemon, "get_info");
 			THROW_WALLET_EXCEPTION_IF(getinfo_res.status == CORE_RPC_STATUS_BUSY, error::daemon_busy, "get_info");
 			THROW_WALLET_EXCEPTION_IF(getinfo_res.status != CORE_RPC_STATUS_OK, error::get_tx_pool_error);
@@ -5236,11 +5277,9 @@ uint32_t wallet2::adjust_priority(uint32_t priority)
 			}
 			cryptonote::COMMAND_RPC_GET_BLOCK_HEADERS_RANGE::request getbh_req = AUTO_VAL_INIT(getbh_req);
 			cryptonote::COMMAND_RPC_GET_BLOCK_HEADERS_RANGE::response getbh_res = AUTO_VAL_INIT(getbh_res);
-			m_daemon_rpc_mutex.lock();
 			getbh_req.start_height = m_blockchain.size() - N;
 			getbh_req.end_height = m_blockchain.size() - 1;
-			r = net_utils::invoke_http_json_rpc("/json_rpc", "getblockheadersrange", getbh_req, getbh_res, m_http_client, rpc_timeout);
-			m_daemon_rpc_mutex.unlock();
+			r = m_daemon_rpc.invoke_http_json_rpc("/json_rpc", "getblockheadersrange", getbh_req, getbh_res, rpc_timeout);
 			THROW_WALLET_EXCEPTION_IF(!r, error::no_connection_to_daemon, "getblockheadersrange");
 			THROW_WALLET_EXCEPTION_IF(getbh_res.status == CORE_RPC_STATUS_BUSY, error::daemon_busy, "getblockheadersrange");
 			THROW_WALLET_EXCEPTION_IF(getbh_res.status != CORE_RPC_STATUS_OK, error::get_blocks_error, getbh_res.status);
@@ -5448,11 +5487,7 @@ bool wallet2::find_and_save_rings(bool force)
 		size_t ntxes = slice + SLICE_SIZE > txs_hashes.size() ? txs_hashes.size() - slice : SLICE_SIZE;
 		for(size_t s = slice; s < slice + ntxes; ++s)
 			req.txs_hashes.push_back(epee::string_tools::pod_to_hex(txs_hashes[s]));
-		bool r;
-		{
-			const boost::lock_guard<boost::mutex> lock{m_daemon_rpc_mutex};
-			r = epee::net_utils::invoke_http_json("/gettransactions", req, res, m_http_client, rpc_timeout);
-		}
+		bool r = m_daemon_rpc.invoke_http_json("/gettransactions", req, res, rpc_timeout);
 		THROW_WALLET_EXCEPTION_IF(!r, error::no_connection_to_daemon, "gettransactions");
 		THROW_WALLET_EXCEPTION_IF(res.status == CORE_RPC_STATUS_BUSY, error::daemon_busy, "gettransactions");
 		THROW_WALLET_EXCEPTION_IF(res.status != CORE_RPC_STATUS_OK, error::wallet_internal_error, "gettransactions");
@@ -5581,7 +5616,6 @@ void wallet2::get_outs(std::vector<std::vector<tools::wallet2::get_outs_entry>>
 		// get histogram for the amounts we need
 		cryptonote::COMMAND_RPC_GET_OUTPUT_HISTOGRAM::request req_t = AUTO_VAL_INIT(req_t);
 		cryptonote::COMMAND_RPC_GET_OUTPUT_HISTOGRAM::response resp_t = AUTO_VAL_INIT(resp_t);
-		m_daemon_rpc_mutex.lock();
 		for(size_t idx : selected_transfers)
 			req_t.amounts.push_back(m_transfers[idx].is_rct() ? 0 : m_transfers[idx].amount());
 		std::sort(req_t.amounts.begin(), req_t.amounts.end());
@@ -5589,39 +5623,43 @@ void wallet2::get_outs(std::vector<std::vector<tools::wallet2::get_outs_entry>>
 		req_t.amounts.resize(std::distance(req_t.amounts.begin(), end));
 		req_t.unlocked = true;
 		req_t.recent_cutoff = time(NULL) - RECENT_OUTPUT_ZONE;
-		bool r = net_utils::invoke_http_json_rpc("/json_rpc", "get_output_histogram", req_t, resp_t, m_http_client, rpc_timeout);
-		m_daemon_rpc_mutex.unlock();
+
+		// if we want to segregate fake outs pre or post fork, get distribution. It does not depend
+		// on the histogram, so it is requested at the same time over a second pooled connection.
+		const bool want_distribution = is_after_segregation_fork && (m_segregate_pre_fork_outputs || m_key_reuse_mitigation2);
+		cryptonote::COMMAND_RPC_GET_OUTPUT_DISTRIBUTION::request req_d = AUTO_VAL_INIT(req_d);
+		cryptonote::COMMAND_RPC_GET_OUTPUT_DISTRIBUTION::response resp_d = AUTO_VAL_INIT(resp_d);
+		std::future<bool> distribution_done;
+		if(want_distribution)
+		{
+			req_d.amounts = req_t.amounts;
+			req_d.from_height = std::max<uint64_t>(segregation_fork_height, RECENT_OUTPUT_BLOCKS) - RECENT_OUTPUT_BLOCKS;
+			req_d.to_height = segregation_fork_height + 1;
+			req_d.cumulative = true;
+			distribution_done = std::async(std::launch::async, [this, &req_d, &resp_d]() {
+				return m_daemon_rpc.invoke_http_json_rpc("/json_rpc", "get_output_distribution", req_d, resp_d, rpc_timeout * 1000);
+			});
+		}
+
+		bool r = m_daemon_rpc.invoke_http_json_rpc("/json_rpc", "get_output_histogram", req_t, resp_t, rpc_timeout);
 		THROW_WALLET_EXCEPTION_IF(!r, error::no_connection_to_daemon, "transfer_selected");
 		THROW_WALLET_EXCEPTION_IF(resp_t.status == CORE_RPC_STATUS_BUSY, error::daemon_busy, "get_output_histogram");
 		THROW_WALLET_EXCEPTION_IF(resp_t.status != CORE_RPC_STATUS_OK, error::get_histogram_error, resp_t.status);
 
-		// if we want to segregate fake outs pre or post fork, get distribution
 		std::unordered_map<uint64_t, std::pair<uint64_t, uint64_t>> segregation_limit;
-		if(is_after_segregation_fork && (m_segregate_pre_fork_outputs || m_key_reuse_mitigation2))
+		if(want_distribution)
 		{
-			cryptonote::COMMAND_RPC_GET_OUTPUT_DISTRIBUTION::request req_t = AUTO_VAL_INIT(req_t);
-			cryptonote::COMMAND_RPC_GET_OUTPUT_DISTRIBUTION::response resp_t = AUTO_VAL_INIT(resp_t);
-			for(size_t idx : selected_transfers)
-				req_t.amounts.push_back(m_transfers[idx].is_rct() ? 0 : m_transfers[idx].amount());
-			std::sort(req_t.amounts.begin(), req_t.amounts.end());
-			auto end = std::unique(req_t.amounts.begin(), req_t.amounts.end());
-			req_t.amounts.resize(std::distance(req_t.amounts.begin(), end));
-			req_t.from_height = std::max<uint64_t>(segregation_fork_height, RECENT_OUTPUT_BLOCKS) - RECENT_OUTPUT_BLOCKS;
-			req_t.to_height = segregation_fork_height + 1;
-			req_t.cumulative = true;
-			m_daemon_rpc_mutex.lock();
-			bool r = net_utils::invoke_http_json_rpc("/json_rpc", "get_output_distribution", req_t, resp_t, m_http_client, rpc_timeout * 1000);
-			m_daemon_rpc_mutex.unlock();
+			bool r = distribution_done.get();
 			THROW_WALLET_EXCEPTION_IF(!r, error::no_connection_to_daemon, "transfer_selected");
-			THROW_WALLET_EXCEPTION_IF(resp_t.status == CORE_RPC_STATUS_BUSY, error::daemon_busy, "get_output_distribution");
-			THROW_WALLET_EXCEPTION_IF(resp_t.status != CORE_RPC_STATUS_OK, error::get_output_distribution, resp_t.status);
+			THROW_WALLET_EXCEPTION_IF(resp_d.status == CORE_RPC_STATUS_BUSY, error::daemon_busy, "get_output_distribution");
+			THROW_WALLET_EXCEPTION_IF(resp_d.status != CORE_RPC_STATUS_OK, error::get_output_distribution, resp_d.status);
 
 			// check we got all data
 			for(size_t idx : selected_transfers)
 			{
 				const uint64_t amount = m_transfers[idx].is_rct() ? 0 : m_transfers[idx].amount();
 				bool found = false;
-				for(const auto &d : resp_t.distributions)
+				for(const auto &d : resp_d.distributions)
 				{
 					if(d.amount == amount)
 					{
@@ -5875,9 +5913,7 @@ void wallet2::get_outs(std::vector<std::vector<tools::wallet2::get_outs_entry>>
 			GULPS_LOG_L1("asking for output ", i.index, " for ", print_money(i.amount));
 
 		// get the keys for those
-		m_daemon_rpc_mutex.lock();
-		r = epee::net_utils::invoke_http_bin("/get_outs.bin", req, daemon_resp, m_http_client, rpc_timeout);
-		m_daemon_rpc_mutex.unlock();
+		r = m_daemon_rpc.invoke_http_bin("/get_outs.bin", req, daemon_resp, rpc_timeout);
 		THROW_WALLET_EXCEPTION_IF(!r, error::no_connection_to_daemon, "get_outs.bin");
 		THROW_WALLET_EXCEPTION_IF(daemon_resp.status == CORE_RPC_STATUS_BUSY, error::daemon_busy, "get_outs.bin");
 		THROW_WALLET_EXCEPTION_IF(daemon_resp.status != CORE_RPC_STATUS_OK, error::get_random_outs_error, daemon_resp.status);
@@ -7230,15 +7266,13 @@ std::vector<size_t> wallet2::select_available_outputs_from_histogram(uint64_t co
 {
 	cryptonote::COMMAND_RPC_GET_OUTPUT_HISTOGRAM::request req_t = AUTO_VAL_INIT(req_t);
 	cryptonote::COMMAND_RPC_GET_OUTPUT_HISTOGRAM::response resp_t = AUTO_VAL_INIT(resp_t);
-	m_daemon_rpc_mutex.lock();
 	if(trusted_daemon)
 		req_t.amounts = get_unspent_amounts_vector();
 	req_t.min_count = count;
 	req_t.max_count = 0;
 	req_t.unlocked = unlocked;
 	req_t.recent_cutoff = 0;
-	bool r = net_utils::invoke_http_json_rpc("/json_rpc", "get_output_histogram", req_t, resp_t, m_http_client, rpc_timeout);
-	m_daemon_rpc_mutex.unlock();
+	bool r = m_daemon_rpc.invoke_http_json_rpc("/json_rpc", "get_output_histogram", req_t, resp_t, rpc_timeout);
 	THROW_WALLET_EXCEPTION_IF(!r, error::no_connection_to_daemon, "select_available_outputs_from_histogram");
 	THROW_WALLET_EXCEPTION_IF(resp_t.status == CORE_RPC_STATUS_BUSY, error::daemon_busy, "get_output_histogram");
 	THROW_WALLET_EXCEPTION_IF(resp_t.status != CORE_RPC_STATUS_OK, error::get_histogram_error, resp_t.status);
@@ -7271,14 +7305,12 @@ uint64_t wallet2::get_num_rct_outputs()
 {
 	cryptonote::COMMAND_RPC_GET_OUTPUT_HISTOGRAM::request req_t = AUTO_VAL_INIT(req_t);
 	cryptonote::COMMAND_RPC_GET_OUTPUT_HISTOGRAM::response resp_t = AUTO_VAL_INIT(resp_t);
-	m_daemon_rpc_mutex.lock();
 	req_t.amounts.push_back(0);
 	req_t.min_count = 0;
 	req_t.max_count = 0;
 	req_t.unlocked = true;
 	req_t.recent_cutoff = 0;
-	bool r = net_utils::invoke_http_json_rpc("/json_rpc", "get_output_histogram", req_t, resp_t, m_http_client, rpc_timeout);
-	m_daemon_rpc_mutex.unlock();
+	bool r = m_daemon_rpc.invoke_http_json_rpc("/json_rpc", "get_output_histogram", req_t, resp_t, rpc_timeout);
 	THROW_WALLET_EXCEPTION_IF(!r, error::no_connection_to_daemon, "get_num_rct_outputs");
 	THROW_WALLET_EXCEPTION_IF(resp_t.status == CORE_RPC_STATUS_BUSY, error::daemon_busy, "get_output_histogram");
 	THROW_WALLET_EXCEPTION_IF(resp_t.status != CORE_RPC_STATUS_OK, error::get_histogram_error, resp_t.status);
@@ -7325,11 +7357,7 @@ std::string wallet2::get_spend_proof(const crypto::hash &txid, const std::string
 	req.decode_as_json = false;
 	req.prune = false;
 	COMMAND_RPC_GET_TRANSACTIONS::response res = AUTO_VAL_INIT(res);
-	bool r;
-	{
-		const boost::lock_guard<boost::mutex> lock{m_daemon_rpc_mutex};
-		r = epee::net_utils::invoke_http_json("/gettransactions", req, res, m_http_client, rpc_timeout);
-	}
+	bool r = m_daemon_rpc.invoke_http_json("/gettransactions", req, res, rpc_timeout);
 	THROW_WALLET_EXCEPTION_IF(!r, error::no_connection_to_daemon, "gettransactions");
 	THROW_WALLET_EXCEPTION_IF(res.status == CORE_RPC_STATUS_BUSY, error::daemon_busy, "gettransactions");
 	THROW_WALLET_EXCEPTION_IF(res.status != CORE_RPC_STATUS_OK, error::wallet_internal_error, "gettransactions");
@@ -7389,11 +7417,7 @@ std::string wallet2::get_spend_proof(const crypto::hash &txid, const std::string
 			req.outputs[j].index = absolute_offsets[j];
 		}
 		COMMAND_RPC_GET_OUTPUTS_BIN::response res = AUTO_VAL_INIT(res);
-		bool r;
-		{
-			const boost::lock_guard<boost::mutex> lock{m_daemon_rpc_mutex};
-			r = epee::net_utils::invoke_http_bin("/get_outs.bin", req, res, m_http_client, rpc_timeout);
-		}
+		bool r = m_daemon_rpc.invoke_http_bin("/get_outs.bin", req, res, rpc_timeout);
 		THROW_WALLET_EXCEPTION_IF(!r, error::no_connection_to_daemon, "get_outs.bin");
 		THROW_WALLET_EXCEPTION_IF(res.status == CORE_RPC_STATUS_BUSY, error::daemon_busy, "get_outs.bin");
 		THROW_WALLET_EXCEPTION_IF(res.status != CORE_RPC_STATUS_OK, error::wallet_internal_error, "get_outs.bin");
@@ -7445,11 +7469,7 @@ bool wallet2::check_spend_proof(const crypto::hash &txid, const std::string &mes
 	req.decode_as_json = false;
 	req.prune = false;
 	COMMAND_RPC_GET_TRANSACTIONS::response res = AUTO_VAL_INIT(res);
-	bool r;
-	{
-		const boost::lock_guard<boost::mutex> lock{m_daemon_rpc_mutex};
-		r = epee::net_utils::invoke_http_json("/gettransactions", req, res, m_http_client, rpc_timeout);
-	}
+	bool r = m_daemon_rpc.invoke_http_json("/gettransactions", req, res, rpc_timeout);
 	THROW_WALLET_EXCEPTION_IF(!r, error::no_connection_to_daemon, "gettransactions");
 	THROW_WALLET_EXCEPTION_IF(res.status == CORE_RPC_STATUS_BUSY, error::daemon_busy, "gettransactions");
 	THROW_WALLET_EXCEPTION_IF(res.status != CORE_RPC_STATUS_OK, error::wallet_internal_error, "gettransactions");
@@ -7519,11 +7539,7 @@ bool wallet2::check_spend_proof(const crypto::hash &txid, const std::string &mes
 			req.outputs[j].index = absolute_offsets[j];
 		}
 		COMMAND_RPC_GET_OUTPUTS_BIN::response res = AUTO_VAL_INIT(res);
-		bool r;
-		{
-			const boost::lock_guard<boost::mutex> lock{m_daemon_rpc_mutex};
-			r = epee::net_utils::invoke_http_bin("/get_outs.bin", req, res, m_http_client, rpc_timeout);
-		}
+		bool r = m_daemon_rpc.invoke_http_bin("/get_outs.bin", req, res, rpc_timeout);
 		THROW_WALLET_EXCEPTION_IF(!r, error::no_connection_to_daemon, "get_outs.bin");
 		THROW_WALLET_EXCEPTION_IF(res.status == CORE_RPC_STATUS_BUSY, error::daemon_busy, "get_outs.bin");
 		THROW_WALLET_EXCEPTION_IF(res.status != CORE_RPC_STATUS_OK, error::wallet_internal_error, "get_outs.bin");
@@ -7568,9 +7584,7 @@ void wallet2::check_tx_key_helper(const crypto::hash &txid, const crypto::key_de
 	req.txs_hashes.push_back(epee::string_tools::pod_to_hex(txid));
 	req.decode_as_json = false;
 	req.prune = false;
-	m_daemon_rpc_mutex.lock();
-	bool ok = epee::net_utils::invoke_http_json("/gettransactions", req, res, m_http_client);
-	m_daemon_rpc_mutex.unlock();
+	bool ok = m_daemon_rpc.invoke_http_json("/gettransactions", req, res);
 	THROW_WALLET_EXCEPTION_IF(!ok || (res.txs.size() != 1 && res.txs_as_hex.size() != 1),
 							  error::wallet_internal_error, "Failed to get transaction from daemon");
 
@@ -7706,9 +7720,7 @@ std::string wallet2::get_tx_proof(const crypto::hash &txid, const cryptonote::ac
 		req.txs_hashes.push_back(epee::string_tools::pod_to_hex(txid));
 		req.decode_as_json = false;
 		req.prune = false;
-		m_daemon_rpc_mutex.lock();
-		bool ok = net_utils::invoke_http_json("/gettransactions", req, res, m_http_client);
-		m_daemon_rpc_mutex.unlock();
+		bool ok = m_daemon_rpc.invoke_http_json("/gettransactions", req, res);
 		THROW_WALLET_EXCEPTION_IF(!ok || (res.txs.size() != 1 && res.txs_as_hex.size() != 1),
 								  error::wallet_internal_error, "Failed to get transaction from daemon");
 
@@ -7818,9 +7830,7 @@ bool wallet2::check_tx_proof(const crypto::hash &txid, const cryptonote::account
 	req.txs_hashes.push_back(epee::string_tools::pod_to_hex(txid));
 	req.decode_as_json = false;
 	req.prune = false;
-	m_daemon_rpc_mutex.lock();
-	bool ok = net_utils::invoke_http_json("/gettransactions", req, res, m_http_client);
-	m_daemon_rpc_mutex.unlock();
+	bool ok = m_daemon_rpc.invoke_http_json("/gettransactions", req, res);
 	THROW_WALLET_EXCEPTION_IF(!ok || (res.txs.size() != 1 && res.txs_as_hex.size() != 1),
 							  error::wallet_internal_error, "Failed to get transaction from daemon");
 
@@ -8044,9 +8054,7 @@ bool wallet2::check_reserve_proof(const cryptonote::account_public_address &addr
 		gettx_req.txs_hashes.push_back(epee::string_tools::pod_to_hex(proofs[i].txid));
 	gettx_req.decode_as_json = false;
 	gettx_req.prune = false;
-	m_daemon_rpc_mutex.lock();
-	bool ok = net_utils::invoke_http_json("/gettransactions", gettx_req, gettx_res, m_http_client);
-	m_daemon_rpc_mutex.unlock();
+	bool ok = m_daemon_rpc.invoke_http_json("/gettransactions", gettx_req, gettx_res);
 	THROW_WALLET_EXCEPTION_IF(!ok || gettx_res.txs.size() != proofs.size(),
 							  error::wallet_internal_error, "Failed to get transaction from daemon");
 
@@ -8055,9 +8063,7 @@ bool wallet2::check_reserve_proof(const cryptonote::account_public_address &addr
 	COMMAND_RPC_IS_KEY_IMAGE_SPENT::response kispent_res;
 	for(size_t i = 0; i < proofs.size(); ++i)
 		kispent_req.key_images.push_back(epee::string_tools::pod_to_hex(proofs[i].key_image));
-	m_daemon_rpc_mutex.lock();
-	ok = epee::net_utils::invoke_http_json("/is_key_image_spent", kispent_req, kispent_res, m_http_client, rpc_timeout);
-	m_daemon_rpc_mutex.unlock();
+	ok = m_daemon_rpc.invoke_http_json("/is_key_image_spent", kispent_req, kispent_res, rpc_timeout);
 	THROW_WALLET_EXCEPTION_IF(!ok || kispent_res.spent_status.size() != proofs.size(),
 							  error::wallet_internal_error, "Failed to get key image spent status from daemon");
 
@@ -8167,9 +8173,7 @@ uint64_t wallet2::get_daemon_blockchain_target_height(string &err)
 {
 	cryptonote::COMMAND_RPC_GET_INFO::request req_t = AUTO_VAL_INIT(req_t);
 	cryptonote::COMMAND_RPC_GET_INFO::response resp_t = AUTO_VAL_INIT(resp_t);
-	m_daemon_rpc_mutex.lock();
-	bool ok = net_utils::invoke_http_json_rpc("/json_rpc", "get_info", req_t, resp_t, m_http_client);
-	m_daemon_rpc_mutex.unlock();
+	bool ok = m_daemon_rpc.invoke_http_json_rpc("/json_rpc", "get_info", req_t, resp_t);
 	if(ok)
 	{
 		if(resp_t.status == CORE_RPC_STATUS_BUSY)
@@ -8212,6 +8216,7 @@ uint64_t wallet2::get_approximate_blockchain_height() const
 void wallet2::set_tx_note(const crypto::hash &txid, const std::string &note)
 {
 	m_tx_notes[txid] = note;
+	m_journal_dirty_txs.insert(txid);
 }
 
 std::string wallet2::get_tx_note(const crypto::hash &txid) const
@@ -8225,6 +8230,7 @@ std::string wallet2::get_tx_note(const crypto::hash &txid) const
 void wallet2::set_attribute(const std::string &key, const std::string &value)
 {
 	m_attributes[key] = value;
+	m_journal_dirty_attributes.insert(key);
 }
 
 std::string wallet2::get_attribute(const std::string &key) const
@@ -8470,6 +8476,7 @@ uint64_t wallet2::import_key_images(const std::vector<std::pair<crypto::key_imag
 
 	THROW_WALLET_EXCEPTION_IF(signed_key_images.size() > m_transfers.size(), error::wallet_internal_error,
 							  "The blockchain is out of date compared to the signed key images");
+	invalidate_journal();
 
 	if(signed_key_images.empty())
 	{
@@ -8515,9 +8522,7 @@ uint64_t wallet2::import_key_images(const std::vector<std::pair<crypto::key_imag
 	if(!check_spent)
 		return m_transfers[signed_key_images.size() - 1].m_block_height;
 
-	m_daemon_rpc_mutex.lock();
-	bool r = epee::net_utils::invoke_http_json("/is_key_image_spent", req, daemon_resp, m_http_client, rpc_timeout);
-	m_daemon_rpc_mutex.unlock();
+	bool r = m_daemon_rpc.invoke_http_json("/is_key_image_spent", req, daemon_resp, rpc_timeout);
 	THROW_WALLET_EXCEPTION_IF(!r, error::no_connection_to_daemon, "is_key_image_spent");
 	THROW_WALLET_EXCEPTION_IF(daemon_resp.status == CORE_RPC_STATUS_BUSY, error::daemon_busy, "is_key_image_spent");
 	THROW_WALLET_EXCEPTION_IF(daemon_resp.status != CORE_RPC_STATUS_OK, error::is_key_image_spent_error, daemon_resp.status);
@@ -8529,6 +8534,7 @@ uint64_t wallet2::import_key_images(const std::vector<std::pair<crypto::key_imag
 		transfer_details &td = m_transfers[n];
 		td.m_spent = daemon_resp.spent_status[n] != COMMAND_RPC_IS_KEY_IMAGE_SPENT::UNSPENT;
 	}
+	m_balance_ledger_valid = false;
 
 	std::unordered_set<crypto::hash> spent_txids; // For each spent key image, search for a tx in m_transfers that uses it as input.
 	std::vector<uint64_t> swept_transfers;		  // If such a spending tx wasn't found in m_transfers, this means the spending tx
@@ -8576,9 +8582,7 @@ uint64_t wallet2::import_key_images(const std::vector<std::pair<crypto::key_imag
 	gettxs_req.prune = false;
 	for(const crypto::hash &spent_txid : spent_txids)
 		gettxs_req.txs_hashes.push_back(epee::string_tools::pod_to_hex(spent_txid));
-	m_daemon_rpc_mutex.lock();
-	r = epee::net_utils::invoke_http_json("/gettransactions", gettxs_req, gettxs_res, m_http_client, rpc_timeout);
-	m_daemon_rpc_mutex.unlock();
+	r = m_daemon_rpc.invoke_http_json("/gettransactions", gettxs_req, gettxs_res, rpc_timeout);
 	THROW_WALLET_EXCEPTION_IF(!r, error::no_connection_to_daemon, "gettransactions");
 	THROW_WALLET_EXCEPTION_IF(gettxs_res.status == CORE_RPC_STATUS_BUSY, error::daemon_busy, "gettransactions");
 	THROW_WALLET_EXCEPTION_IF(gettxs_res.txs.size() != spent_txids.size(), error::wallet_internal_error,
@@ -8708,6 +8712,7 @@ wallet2::payment_container wallet2::export_payments() const
 }
 void wallet2::import_payments(const payment_container &payments)
 {
+	invalidate_journal();
 	m_payments.clear();
 	for(auto const &p : payments)
 	{
@@ -8716,6 +8721,7 @@ void wallet2::import_payments(const payment_container &payments)
 }
 void wallet2::import_payments_out(const std::list<std::pair<crypto::hash, wallet2::confirmed_transfer_details>> &confirmed_payments)
 {
+	invalidate_journal();
 	m_confirmed_txs.clear();
 	for(auto const &p : confirmed_payments)
 	{
@@ -8737,6 +8743,7 @@ std::tuple<size_t, crypto::hash, std::vector<crypto::hash>> wallet2::export_bloc
 
 void wallet2::import_blockchain(const std::tuple<size_t, crypto::hash, std::vector<crypto::hash>> &bc)
 {
+	invalidate_journal();
 	m_blockchain.clear();
 	if(std::get<0>(bc))
 	{
@@ -8772,8 +8779,10 @@ std::vector<tools::wallet2::transfer_details> wallet2::export_outputs() const
 //----------------------------------------------------------------------------------------------------
 size_t wallet2::import_outputs(const std::vector<tools::wallet2::transfer_details> &outputs)
 {
+	invalidate_journal();
 	m_transfers.clear();
 	m_transfers.reserve(outputs.size());
+	m_balance_ledger_valid = false;
 	for(size_t i = 0; i < outputs.size(); ++i)
 	{
 		transfer_details td = outputs[i];
@@ -9328,7 +9337,7 @@ uint64_t wallet2::get_blockchain_height_by_date(uint16_t year, uint8_t month, ui
 				height_min,
 				height_mid,
 				height_max};
-		bool r = net_utils::invoke_http_bin("/getblocks_by_height.bin", req, res, m_http_client, rpc_timeout);
+		bool r = m_daemon_rpc.invoke_http_bin("/getblocks_by_height.bin", req, res, rpc_timeout);
 		if(!r || res.status != CORE_RPC_STATUS_OK)
 		{
 			std::ostringstream oss;
@@ -9402,18 +9411,14 @@ std::vector<std::pair<uint64_t, uint64_t>> wallet2::estimate_backlog(const std::
 	// get txpool backlog
 	cryptonote::COMMAND_RPC_GET_TRANSACTION_POOL_BACKLOG::request req = AUTO_VAL_INIT(req);
 	cryptonote::COMMAND_RPC_GET_TRANSACTION_POOL_BACKLOG::response res = AUTO_VAL_INIT(res);
-	m_daemon_rpc_mutex.lock();
-	bool r = net_utils::invoke_http_json_rpc("/json_rpc", "get_txpool_backlog", req, res, m_http_client, rpc_timeout);
-	m_daemon_rpc_mutex.unlock();
+	bool r = m_daemon_rpc.invoke_http_json_rpc("/json_rpc", "get_txpool_backlog", req, res, rpc_timeout);
 	THROW_WALLET_EXCEPTION_IF(!r, error::no_connection_to_daemon, "Failed to connect to daemon");
 	THROW_WALLET_EXCEPTION_IF(res.status == CORE_RPC_STATUS_BUSY, error::daemon_busy, "get_txpool_backlog");
 	THROW_WALLET_EXCEPTION_IF(res.status != CORE_RPC_STATUS_OK, error::get_tx_pool_error);
 
 	cryptonote::COMMAND_RPC_GET_INFO::request req_t = AUTO_VAL_INIT(req_t);
 	cryptonote::COMMAND_RPC_GET_INFO::response resp_t = AUTO_VAL_INIT(resp_t);
-	m_daemon_rpc_mutex.lock();
-	r = net_utils::invoke_http_json_rpc("/json_rpc", "get_info", req_t, resp_t, m_http_client);
-	m_daemon_rpc_mutex.unlock();
+	r = m_daemon_rpc.invoke_http_json_rpc("/json_rpc", "get_info", req_t, resp_t);
 	THROW_WALLET_EXCEPTION_IF(!r, error::no_connection_to_daemon, "get_info");
 	THROW_WALLET_EXCEPTION_IF(resp_t.status == CORE_RPC_STATUS_BUSY, error::daemon_busy, "get_info");
 	THROW_WALLET_EXCEPTION_IF(resp_t.status != CORE_RPC_STATUS_OK, error::get_tx_pool_error);
@@ -74,10 +74,15 @@
 
 #include "common/bloom_filter.hpp"
 #include "common/password.h"
+#include "common/thdq.hpp"
+#include "balance_ledger.h"
+#include "daemon_rpc_pool.h"
 #include "node_rpc_proxy.h"
 #include "wallet_errors.h"
 
 class Serialization_portability_wallet_Test;
+class WalletJournal;
+class WalletSharedScanner;
 
 namespace tools
 {
@@ -159,6 +164,9 @@ public:
 class wallet2
 {
 	friend class ::Serialization_portability_wallet_Test;
+	friend class ::WalletJournal;
+	friend class ::WalletSharedScanner;
+	friend class wallet_shared_scanner;
 
   public:
 	static constexpr const std::chrono::seconds rpc_timeout = std::chrono::minutes(3) + std::chrono::seconds(30);
@@ -457,6 +465,32 @@ class wallet2
 		END_SERIALIZE()
 	};
 
+	// Plaintext head of the cache journal, ties it to the snapshot it applies on top of
+	struct cache_journal_header
+	{
+		uint32_t version;
+		crypto::chacha_iv base_iv;
+
+		BEGIN_SERIALIZE_OBJECT()
+		VARINT_FIELD(version)
+		FIELD(base_iv)
+		END_SERIALIZE()
+	};
+
+	// One encrypted store worth of changes, check is the hash of record_data
+	struct cache_journal_record
+	{
+		crypto::chacha_iv iv;
+		std::string record_data;
+		crypto::hash check;
+
+		BEGIN_SERIALIZE_OBJECT()
+		FIELD(iv)
+		FIELD(record_data)
+		FIELD(check)
+		END_SERIALIZE()
+	};
+
 	// GUI Address book
 	struct address_book_row
 	{
@@ -1046,20 +1080,17 @@ class wallet2
 	template <class t_request, class t_response>
 	inline bool invoke_http_json(const boost::string_ref uri, const t_request &req, t_response &res, std::chrono::milliseconds timeout = std::chrono::seconds(15), const boost::string_ref http_method = "GET")
 	{
-		boost::lock_guard<boost::mutex> lock(m_daemon_rpc_mutex);
-		return epee::net_utils::invoke_http_json(uri, req, res, m_http_client, timeout, http_method);
+		return m_daemon_rpc.invoke_http_json(uri, req, res, timeout, http_method);
 	}
 	template <class t_request, class t_response>
 	inline bool invoke_http_bin(const boost::string_ref uri, const t_request &req, t_response &res, std::chrono::milliseconds timeout = std::chrono::seconds(15), const boost::string_ref http_method = "GET")
 	{
-		boost::lock_guard<boost::mutex> lock(m_daemon_rpc_mutex);
-		return epee::net_utils::invoke_http_bin(uri, req, res, m_http_client, timeout, http_method);
+		return m_daemon_rpc.invoke_http_bin(uri, req, res, timeout, http_method);
 	}
 	template <class t_request, class t_response>
 	inline bool invoke_http_json_rpc(const boost::string_ref uri, const std::string &method_name, const t_request &req, t_response &res, std::chrono::milliseconds timeout = std::chrono::seconds(15), const boost::string_ref http_method = "GET", const std::string &req_id = "0")
 	{
-		boost::lock_guard<boost::mutex> lock(m_daemon_rpc_mutex);
-		return epee::net_utils::invoke_http_json_rpc(uri, method_name, req, res, m_http_client, timeout, http_method, req_id);
+		return m_daemon_rpc.invoke_http_json_rpc(uri, method_name, req, res, timeout, http_method, req_id);
 	}
 
 	bool set_ring_database(const std::string &filename);
@@ -1114,6 +1145,9 @@ class wallet2
 	std::vector<size_t> pick_preferred_rct_inputs(uint64_t needed_money, uint32_t subaddr_account, const std::set<uint32_t> &subaddr_indices) const;
 	void set_spent(size_t idx, uint64_t height);
 	void set_unspent(size_t idx);
+	static uint64_t get_transfer_unlock_height(const transfer_details &td);
+	void update_balance_ledger(size_t idx);
+	void sync_balance_ledger() const;
 	void get_outs(std::vector<std::vector<get_outs_entry>> &outs, const std::vector<size_t> &selected_transfers, size_t fake_outputs_count);
 	bool tx_add_fake_output(std::vector<std::vector<tools::wallet2::get_outs_entry>> &outs, uint64_t global_index, const crypto::public_key &tx_public_key, const rct::key &mask, uint64_t real_index, bool unlocked) const;
 	crypto::public_key get_tx_pub_key_from_received_outs(const tools::wallet2::transfer_details &td) const;
@@ -1121,6 +1155,12 @@ class wallet2
 	std::vector<size_t> get_only_rct(const std::vector<size_t> &unused_dust_indices, const std::vector<size_t> &unused_transfers_indices) const;
 	void scan_output(const cryptonote::transaction &tx, const crypto::public_key &tx_pub_key, size_t i, tx_scan_info_t &tx_scan_info, int &num_vouts_received, std::unordered_map<cryptonote::subaddress_index, uint64_t> &tx_money_got_in_outs, std::vector<size_t> &outs) const;
 	void trim_hashchain();
+	std::string journal_file() const { return m_wallet_file + ".journal"; }
+	bool store_journal_record(const crypto::chacha_key &key);
+	void load_journal(const crypto::chacha_key &key);
+	void reset_journal(const crypto::chacha_iv &base_iv, uint64_t base_size);
+	void invalidate_journal() { m_journal_valid = false; }
+	void add_scanned_pool_tx(const crypto::hash &txid);
 	crypto::key_image get_multisig_composite_key_image(size_t n) const;
 	rct::multisig_kLRki get_multisig_composite_kLRki(size_t n, const crypto::public_key &ignore, std::unordered_set<rct::key> &used_L, std::unordered_set<rct::key> &new_used_L) const;
 	rct::multisig_kLRki get_multisig_kLRki(size_t n, const rct::key &k) const;
@@ -1140,7 +1180,7 @@ class wallet2
 	std::string m_daemon_address;
 	std::string m_wallet_file;
 	std::string m_keys_file;
-	epee::net_utils::http::http_simple_client m_http_client;
+	daemon_rpc_pool m_daemon_rpc;
 	hashchain m_blockchain;
 	std::atomic<uint64_t> m_local_bc_height; //temporary workaround
 	std::unordered_map<crypto::hash, unconfirmed_transfer_details> m_unconfirmed_txs;
@@ -1167,8 +1207,6 @@ class wallet2
 
 	std::atomic<bool> m_run;
 
-	boost::mutex m_daemon_rpc_mutex;
-
 	i_wallet2_callback *m_callback;
 	bool m_key_on_device;
 	cryptonote::network_type m_nettype;
@@ -1227,6 +1265,96 @@ class wallet2
 	bool m_ring_history_saved;
 	std::unique_ptr<ringdb> m_ringdb;
 
+	// Balances of m_transfers, rebuilt on the next query when not valid
+	mutable balance_ledger m_balance_ledger;
+	mutable bool m_balance_ledger_valid;
+
+	// Journal of the changes since the last full cache snapshot, see wallet2_journal.cpp
+	bool m_journal_valid; // false makes the next store write a full snapshot
+	crypto::chacha_iv m_journal_base_iv;
+	uint64_t m_journal_base_size;
+	uint64_t m_journal_size;
+	uint64_t m_journal_blockchain_size;
+	uint64_t m_journal_transfers_size;
+	std::set<size_t> m_journal_dirty_transfers;
+	std::vector<std::pair<crypto::hash, payment_details>> m_journal_payments;
+	std::unordered_set<crypto::hash> m_journal_dirty_txs; // keys of m_confirmed_txs, m_tx_keys, m_additional_tx_keys and m_tx_notes
+	std::vector<std::pair<crypto::public_key, cryptonote::subaddress_index>> m_journal_subaddresses;
+	std::set<uint32_t> m_journal_dirty_accounts; // rows of m_subaddress_labels
+	std::set<std::string> m_journal_dirty_attributes;
+	std::vector<crypto::hash> m_journal_scanned_pool_txs;
+	bool m_journal_address_book_dirty;
+
+	// One journal record, the cache changes between two stores. Containers that only grow are
+	// journaled as the entries changed since the previous store, the remaining state is small
+	// and written whole. Keep in sync with serialize().
+	struct cache_journal_delta
+	{
+		uint64_t blockchain_from;
+		std::vector<crypto::hash> blockchain;
+		uint64_t transfers_from;
+		transfer_container transfers;
+		std::vector<std::pair<uint64_t, transfer_details>> changed_transfers;
+		std::vector<std::pair<crypto::hash, payment_details>> payments;
+		std::vector<std::pair<crypto::hash, confirmed_transfer_details>> confirmed_txs;
+		std::vector<std::pair<crypto::hash, crypto::secret_key>> tx_keys;
+		std::vector<std::pair<crypto::hash, std::vector<crypto::secret_key>>> additional_tx_keys;
+		std::vector<std::pair<crypto::hash, std::string>> tx_notes;
+		std::vector<std::pair<crypto::public_key, cryptonote::subaddress_index>> subaddresses;
+		uint64_t accounts;
+		std::vector<std::pair<uint32_t, std::vector<std::string>>> subaddress_labels;
+		std::vector<std::pair<std::string, std::string>> attributes;
+		bool address_book_changed;
+		std::vector<address_book_row> address_book;
+		std::vector<crypto::hash> scanned_pool_txs;
+
+		cryptonote::account_public_address account_public_address;
+		std::unordered_map<crypto::hash, unconfirmed_transfer_details> unconfirmed_txs;
+		std::unordered_multimap<crypto::hash, pool_payment_details> unconfirmed_payments;
+		std::pair<std::map<std::string, std::string>, std::vector<std::string>> account_tags;
+		bool ring_history_saved;
+
+		template <class t_archive>
+		inline void serialize(t_archive &a, const unsigned int ver)
+		{
+			a &blockchain_from;
+			a &blockchain;
+			a &transfers_from;
+			a &transfers;
+			a &changed_transfers;
+			a &payments;
+			a &confirmed_txs;
+			a &tx_keys;
+			a &additional_tx_keys;
+			a &tx_notes;
+			a &subaddresses;
+			a &accounts;
+			a &subaddress_labels;
+			a &attributes;
+			a &address_book_changed;
+			a &address_book;
+			a &scanned_pool_txs;
+			a &account_public_address;
+			a &unconfirmed_txs;
+			a &unconfirmed_payments;
+			a &account_tags;
+			a &ring_history_saved;
+		}
+	};
+
+	void get_journal_delta(cache_journal_delta &delta) const;
+	bool journal_delta_applies(const cache_journal_delta &delta) const;
+	void apply_journal_delta(cache_journal_delta &delta);
+	void clear_journal_marks();
+
+	// Per transaction data the scan needs for every account, extracted once
+	struct tx_scan_keys
+	{
+		bool valid;
+		crypto::public_key tx_pub_key;
+		std::vector<crypto::public_key> additional_tx_pub_keys;
+	};
+
 	struct wallet_rpc_scan_data
 	{
 		struct block_complete_entry_parsed
@@ -1236,7 +1364,8 @@ class wallet2
 			cryptonote::block block;
 			crypto::hash miner_tx_hash;
 			std::vector<cryptonote::transaction> txes;
-			bool skipped;
+			std::vector<tx_scan_keys> tx_keys; // miner tx first, then txes
+			bool skipped; // no account needed the transactions parsed
 		};
 
 		struct found_output_idx
@@ -1246,6 +1375,14 @@ class wallet2
 			size_t tx_idx;
 		};
 
+		// What the scan found for one of the accounts sharing the blocks
+		struct account_scan_result
+		{
+			std::vector<found_output_idx> indices_found;
+			std::unordered_set<crypto::key_image> incoming_kimg;
+			std::vector<bool> skipped; // per block, true if the account doesn't need it
+		};
+
 		size_t dl_order;
 		uint64_t blocks_start_height;
 		const std::list<crypto::hash> short_chain_history;
@@ -1253,32 +1390,32 @@ class wallet2
 		std::vector<cryptonote::COMMAND_RPC_GET_BLOCKS_FAST::block_output_indices> o_indices;
 
 		std::vector<block_complete_entry_parsed> blocks_parsed;
-		std::vector<found_output_idx> indices_found;
 		bloom_filter key_images;
-		std::unordered_set<crypto::key_image> incoming_kimg;
+		std::vector<account_scan_result> accounts; // same order as the scan contexts
 	};
 
 	std::unique_ptr<wallet_rpc_scan_data> pull_blocks(uint64_t start_height, const std::list<crypto::hash> &short_chain_history);
 
 	struct wallet_refresh_ctx
 	{
-		wallet_refresh_ctx() : m_scan_error(false) {};
+		wallet_refresh_ctx(std::atomic<bool>& run) : m_scan_error(false), m_run(run) {};
 
 		thdq<std::unique_ptr<wallet_rpc_scan_data>> m_scan_in_queue;
 		thdq<std::unique_ptr<wallet_rpc_scan_data>> m_scan_out_queue;
 		std::atomic<size_t> m_running_scan_thd_cnt;
 		std::atomic<bool> m_scan_error;
+		std::atomic<bool>& m_run; // run flag of the wallet doing the download
 	};
 
 	struct wallet_scan_ctx
 	{
-		wallet_scan_ctx(const wallet2& parent, wallet_refresh_ctx& refresh_ctx) : 
+		wallet_scan_ctx(const wallet2& parent) : 
 			explicit_refresh(parent.m_explicit_refresh_from_block_height),
 			wallet_create_time(parent.m_account.get_createtime()),
 			refresh_height(parent.m_refresh_from_block_height),
 			account(parent.m_account),
 			scan_type(parent.m_refresh_type),
-			refresh_ctx(refresh_ctx)
+			wallet(parent)
 			{}
 
 		bool explicit_refresh;
@@ -1286,7 +1423,7 @@ class wallet2
 		uint64_t refresh_height;
 		const cryptonote::account_base& account;
 		RefreshType scan_type;
-		wallet_refresh_ctx& refresh_ctx;
+		const wallet2& wallet;
 	};
 
 	struct wallet_block_dl_ctx
@@ -1305,10 +1442,16 @@ class wallet2
 		wallet_refresh_ctx& refresh_ctx;
 	};
 
-	void integrate_scanned_result(std::unique_ptr<wallet_rpc_scan_data>& res);
+	void integrate_scanned_result(wallet_rpc_scan_data& res, wallet_rpc_scan_data::account_scan_result& found);
 	void block_download_thd(wallet2::wallet_block_dl_ctx& ctx);
-	void block_scan_thd(const wallet_scan_ctx& ctx);
-	bool block_scan_tx(const wallet_scan_ctx& ctx, const crypto::hash& txid, const cryptonote::transaction& tx, bloom_filter& in_kimg, std::unordered_set<crypto::key_image>& inc_kimg);
+	static void block_scan_thd(const std::vector<wallet_scan_ctx>& ctxs, wallet_refresh_ctx& refresh_ctx);
+	static void get_tx_scan_keys(const crypto::hash& txid, const cryptonote::transaction& tx, tx_scan_keys& keys);
+	// Finds the account's outputs in a span, deriving the keys of all its txes in batches
+	void block_scan_span(const wallet_scan_ctx& ctx, const wallet_rpc_scan_data& res, wallet_rpc_scan_data::account_scan_result& acc) const;
+	bool block_scan_output(const wallet_scan_ctx& ctx, const crypto::public_key& out_pubkey, const crypto::key_derivation& derivation, size_t out_idx,
+						   const crypto::public_key& subaddress_spendkey, std::unordered_set<crypto::key_image>& inc_kimg) const;
+	// Pops scanned spans and hands them to integrate in download order, returns false if integrate threw
+	static bool integrate_scanned_in_order(wallet_refresh_ctx& refresh_ctx, const std::function<void(wallet_rpc_scan_data&)>& integrate);
 	using tx_call_map = std::unordered_map<crypto::hash, std::pair<std::function<void()>, uint64_t>>;
 	inline void add_new_tx_call(tx_call_map& map, const crypto::hash& txid, const cryptonote::transaction& tx, const std::vector<uint64_t>& o_indices, 
 								uint64_t height, uint64_t ts, bool miner_tx)
@@ -1320,6 +1463,68 @@ class wallet2
 			std::bind(&wallet2::process_new_transaction, this, std::cref(txid), std::cref(tx), std::cref(o_indices), height, ts, miner_tx, false, false), height));
 	}
 };
+
+/*!
+ * \brief Refreshes a set of wallets living in the same process against one daemon.
+ *
+ * Each getblocks.bin span is downloaded once, through the wallet that is furthest behind,
+ * and each block and transaction in it is parsed once. Only the key derivation and the
+ * subaddress lookup are done per account, and the results are merged into the owning
+ * wallets. Every wallet is registered with the mutex its owner holds while using it, the
+ * scanner holds that mutex whenever it changes the wallet.
+ */
+class wallet_shared_scanner
+{
+	friend class ::WalletSharedScanner;
+
+  public:
+	wallet_shared_scanner() : m_refreshes_started(0), m_last_refresh_ok(true) {}
+
+	/*!
+	 * \brief Register a wallet for shared refreshes
+	 * \param lock held by the scanner while it changes the wallet, must not be held when calling refresh()
+	 * \return false if the wallet uses another daemon or network than the registered ones
+	 */
+	bool add_wallet(wallet2 &wallet, boost::mutex &lock);
+	void remove_wallet(wallet2 &wallet);
+	size_t wallet_count();
+
+	/*!
+	 * \brief Refresh all registered wallets
+	 *
+	 * A call waiting for a refresh that started after it was made returns that refresh's result.
+	 * \return false if any of the wallets failed to refresh
+	 */
+	bool refresh();
+	void stop();
+
+  private:
+	struct registered_wallet
+	{
+		wallet2 *wallet;
+		boost::mutex *lock;
+	};
+
+	// A wallet taking part in one shared refresh
+	struct scan_member
+	{
+		registered_wallet reg;
+		uint64_t entry_height;
+		bool failed;
+		bool alone; // its hashchain didn't reach a span, refreshes on its own afterwards
+	};
+
+	bool refresh_wallets(const std::vector<registered_wallet> &wallets);
+	static bool refresh_alone(const registered_wallet &reg);
+	// Merges one span into the members, res.accounts is in the same order as members
+	static void merge_span(wallet2::wallet_rpc_scan_data &res, std::vector<scan_member> &members);
+
+	boost::mutex m_wallets_lock;
+	std::vector<registered_wallet> m_wallets;
+	boost::mutex m_refresh_lock;
+	std::atomic<uint64_t> m_refreshes_started;
+	bool m_last_refresh_ok;
+};
 }
 BOOST_CLASS_VERSION(tools::wallet2, 24)
 BOOST_CLASS_VERSION(tools::wallet2::transfer_details, 9)
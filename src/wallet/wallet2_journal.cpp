@@ -0,0 +1,374 @@
+// Copyright (c) 2020, pasta Currency Project
+//
+// Authors and copyright holders give permission for following:
+//
+// 1. Redistribution and use in source and binary forms WITHOUT modification.
+//
+// 2. Modification of the source form for your own personal use.
+//
+// As long as the following conditions are met:
+//
+// 3. You must not distribute modified copies of the work to third parties. This includes
+//    posting the work online, or hosting copies of the modified work for download.
+//
+// 4. Any derivative version of this work is also covered by this license, including point 8.
+//
+// 5. Neither the name of the copyright holders nor the names of the authors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+//
+// 6. You agree that this licence is governed by and shall be construed in accordance
+//    with the laws of England and Wales.
+//
+// 7. You agree to submit all disputes arising out of or in connection with this licence
+//    to the exclusive jurisdiction of the Courts of England and Wales.
+//
+// Authors and copyright holders agree that:
+//
+// 8. This licence expires and the work covered by it is released into the
+//    public domain on 1st of February 2021
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+// The wallet cache is stored as a full encrypted snapshot (<wallet>) plus an append-only
+// journal (<wallet>.journal). Each store() appends one encrypted record with the entries
+// added or changed since the previous store, tracked by the m_journal_* marks, and the small
+// remaining state. Load checks each record against the wallet before replaying it on top of
+// the snapshot, and stops at the first one that doesn't fit.
+// Changes that don't fit the append model (reorgs, imports, multisig) invalidate the journal
+// and the next store writes a full snapshot instead, as does a journal grown past half the
+// snapshot size.
+
+#include "wallet2.h"
+#include "common/boost_serialization_helper.h"
+#include "cryptonote_basic/cryptonote_boost_serialization.h"
+#include "file_io_utils.h"
+#include "serialization/binary_utils.h"
+#include "serialization/string.h"
+
+namespace tools
+{
+GULPS_CAT_MAJOR("wallet_journal");
+
+namespace
+{
+constexpr uint32_t CACHE_JOURNAL_VERSION = 2;
+}
+
+void wallet2::clear_journal_marks()
+{
+	m_journal_blockchain_size = m_blockchain.size();
+	m_journal_transfers_size = m_transfers.size();
+	m_journal_dirty_transfers.clear();
+	m_journal_payments.clear();
+	m_journal_dirty_txs.clear();
+	m_journal_subaddresses.clear();
+	m_journal_dirty_accounts.clear();
+	m_journal_dirty_attributes.clear();
+	m_journal_scanned_pool_txs.clear();
+	m_journal_address_book_dirty = false;
+}
+
+void wallet2::reset_journal(const crypto::chacha_iv &base_iv, uint64_t base_size)
+{
+	boost::system::error_code ec;
+	boost::filesystem::remove(journal_file(), ec);
+	if(ec)
+		GULPS_LOG_ERROR("error removing file: ", journal_file());
+
+	m_journal_valid = !ec;
+	m_journal_base_iv = base_iv;
+	m_journal_base_size = base_size;
+	m_journal_size = 0;
+	clear_journal_marks();
+}
+
+void wallet2::get_journal_delta(cache_journal_delta &delta) const
+{
+	delta.blockchain_from = m_journal_blockchain_size;
+	for(size_t i = m_journal_blockchain_size; i < m_blockchain.size(); i++)
+		delta.blockchain.push_back(m_blockchain[i]);
+
+	delta.transfers_from = m_journal_transfers_size;
+	delta.transfers.assign(m_transfers.begin() + m_journal_transfers_size, m_transfers.end());
+	for(auto it = m_journal_dirty_transfers.begin(); it != m_journal_dirty_transfers.lower_bound(m_journal_transfers_size); ++it)
+		delta.changed_transfers.emplace_back(*it, m_transfers[*it]);
+
+	delta.payments = m_journal_payments;
+
+	for(const crypto::hash &txid : m_journal_dirty_txs)
+	{
+		auto ctx = m_confirmed_txs.find(txid);
+		if(ctx != m_confirmed_txs.end())
+			delta.confirmed_txs.emplace_back(*ctx);
+		auto key = m_tx_keys.find(txid);
+		if(key != m_tx_keys.end())
+			delta.tx_keys.emplace_back(*key);
+		auto keys = m_additional_tx_keys.find(txid);
+		if(keys != m_additional_tx_keys.end())
+			delta.additional_tx_keys.emplace_back(*keys);
+		auto note = m_tx_notes.find(txid);
+		if(note != m_tx_notes.end())
+			delta.tx_notes.emplace_back(*note);
+	}
+
+	delta.subaddresses = m_journal_subaddresses;
+	delta.accounts = m_subaddress_labels.size();
+	for(uint32_t major : m_journal_dirty_accounts)
+	{
+		if(major < m_subaddress_labels.size())
+			delta.subaddress_labels.emplace_back(major, m_subaddress_labels[major]);
+	}
+
+	for(const std::string &key : m_journal_dirty_attributes)
+	{
+		auto attr = m_attributes.find(key);
+		if(attr != m_attributes.end())
+			delta.attributes.emplace_back(*attr);
+	}
+
+	delta.address_book_changed = m_journal_address_book_dirty;
+	if(m_journal_address_book_dirty)
+		delta.address_book = m_address_book;
+	delta.scanned_pool_txs = m_journal_scanned_pool_txs;
+
+	delta.account_public_address = m_account_public_address;
+	delta.unconfirmed_txs = m_unconfirmed_txs;
+	delta.unconfirmed_payments = m_unconfirmed_payments;
+	delta.account_tags = m_account_tags;
+	delta.ring_history_saved = m_ring_history_saved;
+}
+
+bool wallet2::journal_delta_applies(const cache_journal_delta &delta) const
+{
+	if(delta.blockchain_from != m_blockchain.size())
+	{
+		GULPS_LOG_ERROR("Wallet cache journal doesn't match the hashchain");
+		return false;
+	}
+	if(delta.transfers_from != m_transfers.size())
+	{
+		GULPS_LOG_ERROR("Wallet cache journal doesn't match the transfers");
+		return false;
+	}
+	for(const auto &changed : delta.changed_transfers)
+	{
+		if(changed.first >= delta.transfers_from)
+		{
+			GULPS_LOG_ERROR("Wallet cache journal transfer index out of range");
+			return false;
+		}
+	}
+	for(const auto &labels : delta.subaddress_labels)
+	{
+		if(labels.first >= delta.accounts)
+		{
+			GULPS_LOG_ERROR("Wallet cache journal account index out of range");
+			return false;
+		}
+	}
+	return true;
+}
+
+void wallet2::apply_journal_delta(cache_journal_delta &delta)
+{
+	for(const crypto::hash &hash : delta.blockchain)
+		m_blockchain.push_back(hash);
+
+	m_transfers.reserve(m_transfers.size() + delta.transfers.size());
+	for(transfer_details &td : delta.transfers)
+		m_transfers.push_back(std::move(td));
+	for(auto &changed : delta.changed_transfers)
+		m_transfers[changed.first] = std::move(changed.second);
+
+	auto index_transfer = [this](size_t idx) {
+		const transfer_details &td = m_transfers[idx];
+		if(td.m_key_image_known && !td.m_key_image_partial)
+			m_key_images[td.m_key_image] = idx;
+		m_pub_keys[td.get_public_key()] = idx;
+	};
+	for(size_t idx = delta.transfers_from; idx < m_transfers.size(); idx++)
+		index_transfer(idx);
+	for(const auto &changed : delta.changed_transfers)
+		index_transfer(changed.first);
+
+	for(const auto &p : delta.payments)
+		m_payments.emplace(p);
+
+	for(auto &p : delta.confirmed_txs)
+		m_confirmed_txs[p.first] = std::move(p.second);
+	for(const auto &p : delta.tx_keys)
+		m_tx_keys[p.first] = p.second;
+	for(auto &p : delta.additional_tx_keys)
+		m_additional_tx_keys[p.first] = std::move(p.second);
+	for(auto &p : delta.tx_notes)
+		m_tx_notes[p.first] = std::move(p.second);
+
+	for(const auto &p : delta.subaddresses)
+		m_subaddresses[p.first] = p.second;
+	m_subaddress_labels.resize(delta.accounts);
+	for(auto &labels : delta.subaddress_labels)
+		m_subaddress_labels[labels.first] = std::move(labels.second);
+
+	for(auto &p : delta.attributes)
+		m_attributes[p.first] = std::move(p.second);
+	if(delta.address_book_changed)
+		m_address_book = std::move(delta.address_book);
+	for(const crypto::hash &txid : delta.scanned_pool_txs)
+		add_scanned_pool_tx(txid);
+
+	m_account_public_address = delta.account_public_address;
+	m_unconfirmed_txs = std::move(delta.unconfirmed_txs);
+	m_unconfirmed_payments = std::move(delta.unconfirmed_payments);
+	m_account_tags = std::move(delta.account_tags);
+	m_ring_history_saved = delta.ring_history_saved;
+}
+
+bool wallet2::store_journal_record(const crypto::chacha_key &key)
+{
+	if(!m_journal_valid || m_multisig)
+		return false;
+
+	if(m_journal_size > m_journal_base_size / 2)
+	{
+		GULPS_LOG_L1("Compacting wallet cache journal, ", m_journal_size, " bytes");
+		return false;
+	}
+
+	// Only appends are journaled, anything that went below the marks needs a snapshot
+	if(m_blockchain.size() < m_journal_blockchain_size || m_blockchain.offset() > m_journal_blockchain_size ||
+	   m_transfers.size() < m_journal_transfers_size)
+		return false;
+
+	cache_journal_delta delta = boost::value_initialized<cache_journal_delta>();
+	get_journal_delta(delta);
+
+	std::stringstream oss;
+	{
+		boost::archive::portable_binary_oarchive ar(oss);
+		ar << delta;
+	}
+
+	cache_journal_record rec = boost::value_initialized<cache_journal_record>();
+	const std::string plain = oss.str();
+	rec.iv = crypto::rand<crypto::chacha_iv>();
+	rec.record_data.resize(plain.size());
+	crypto::chacha20(plain.data(), plain.size(), key, rec.iv, &rec.record_data[0]);
+	rec.check = crypto::cn_fast_hash(rec.record_data.data(), rec.record_data.size());
+
+	std::stringstream ostr;
+	binary_archive<true> oar(ostr);
+	bool success = true;
+	if(m_journal_size == 0)
+	{
+		cache_journal_header hdr = boost::value_initialized<cache_journal_header>();
+		hdr.version = CACHE_JOURNAL_VERSION;
+		hdr.base_iv = m_journal_base_iv;
+		success = ::serialization::serialize(oar, hdr);
+	}
+	success = success && ::serialization::serialize(oar, rec);
+	if(!success)
+		return false;
+
+	const std::string blob = ostr.str();
+	if(m_journal_size == 0)
+		success = epee::file_io_utils::save_string_to_file(journal_file(), blob);
+	else
+		success = epee::file_io_utils::append_string_to_file(journal_file(), blob);
+
+	if(!success)
+	{
+		// A partial record may be on disk, only a snapshot gets us back to a known state
+		GULPS_LOG_ERROR("Failed to append to ", journal_file(), ", writing a full snapshot");
+		invalidate_journal();
+		return false;
+	}
+
+	GULPS_LOG_L1("Appended ", blob.size(), " bytes to the wallet cache journal");
+	m_journal_size += blob.size();
+	clear_journal_marks();
+	return true;
+}
+
+void wallet2::load_journal(const crypto::chacha_key &key)
+{
+	std::string buf;
+	boost::system::error_code e;
+	if(!boost::filesystem::exists(journal_file(), e) || e || !epee::file_io_utils::load_file_to_string(journal_file(), buf))
+		buf.clear();
+
+	m_journal_valid = true;
+	m_journal_size = 0;
+	if(!buf.empty())
+	{
+		std::istringstream istr(buf);
+		binary_archive<false> iar(istr);
+		cache_journal_header hdr;
+		// Header and records follow each other, so only the last read may end at EOF
+		if(!::do_serialize(iar, hdr) || !istr.good() || hdr.version != CACHE_JOURNAL_VERSION ||
+		   memcmp(&hdr.base_iv, &m_journal_base_iv, sizeof(crypto::chacha_iv)) != 0)
+		{
+			// Left behind by a snapshot that was written after it
+			GULPS_LOG_L0("Ignoring stale wallet cache journal ", journal_file());
+			m_journal_valid = false;
+		}
+
+		size_t records = 0;
+		while(m_journal_valid && iar.remaining_bytes() > 0)
+		{
+			cache_journal_record rec;
+			if(!::do_serialize(iar, rec) || istr.fail() ||
+			   crypto::cn_fast_hash(rec.record_data.data(), rec.record_data.size()) != rec.check)
+			{
+				// Torn append, the records before it are good
+				GULPS_LOG_ERROR("Wallet cache journal is truncated after ", records, " records");
+				m_journal_valid = false;
+				break;
+			}
+
+			std::string plain;
+			plain.resize(rec.record_data.size());
+			crypto::chacha20(rec.record_data.data(), rec.record_data.size(), key, rec.iv, &plain[0]);
+
+			cache_journal_delta delta = boost::value_initialized<cache_journal_delta>();
+			bool parsed = true;
+			try
+			{
+				std::stringstream iss;
+				iss << plain;
+				boost::archive::portable_binary_iarchive ar(iss);
+				ar >> delta;
+			}
+			catch(const std::exception &ex)
+			{
+				GULPS_LOG_ERROR("Failed to parse wallet cache journal record: ", ex.what());
+				parsed = false;
+			}
+
+			// Nothing of a record is applied unless all of it fits, the wallet stays at the
+			// snapshot plus the records before it and refreshes from there
+			if(!parsed || !journal_delta_applies(delta))
+			{
+				GULPS_LOG_ERROR("Wallet cache journal record ", records, " doesn't match the wallet, ignoring the rest of the journal");
+				m_journal_valid = false;
+				break;
+			}
+
+			apply_journal_delta(delta);
+			m_journal_size = istr.tellg();
+			records++;
+		}
+
+		GULPS_LOG_L1("Replayed ", records, " wallet cache journal records");
+	}
+
+	clear_journal_marks();
+}
+}
@@ -53,9 +53,7 @@ std::unique_ptr<wallet2::wallet_rpc_scan_data> wallet2::pull_blocks(uint64_t sta
 	req.block_ids = short_chain_history;
 	req.prune = true;
 	req.start_height = start_height;
-	m_daemon_rpc_mutex.lock();
-	bool r = epee::net_utils::invoke_http_bin("/getblocks.bin", req, res, m_http_client, rpc_timeout);
-	m_daemon_rpc_mutex.unlock();
+	bool r = m_daemon_rpc.invoke_http_bin("/getblocks.bin", req, res, rpc_timeout);
 	THROW_WALLET_EXCEPTION_IF(!r, error::no_connection_to_daemon, "getblocks.bin");
 	THROW_WALLET_EXCEPTION_IF(res.status == CORE_RPC_STATUS_BUSY, error::daemon_busy, "getblocks.bin");
 	THROW_WALLET_EXCEPTION_IF(res.status != CORE_RPC_STATUS_OK, error::get_blocks_error, res.status);
@@ -162,20 +160,8 @@ void wallet2::block_download_thd(wallet2::wallet_block_dl_ctx& ctx)
 	}
 }
 
-bool wallet2::block_scan_tx(const wallet_scan_ctx& ctx, const crypto::hash& txid, const cryptonote::transaction& tx, bloom_filter& in_kimg, std::unordered_set<crypto::key_image>& inc_kimg)
+void wallet2::get_tx_scan_keys(const crypto::hash& txid, const cryptonote::transaction& tx, tx_scan_keys& keys)
 {
-	hw::core::device_default dummy_dev;
-	const cryptonote::account_keys &keys = ctx.account.get_keys();
-	GULPS_LOG_L2("Scanning tx ", txid);
-	for(const auto& tx_in : tx.vin)
-	{
-		if(tx_in.type() != typeid(cryptonote::txin_to_key))
-			continue;
-
-		const crypto::key_image& ki = boost::get<cryptonote::txin_to_key>(tx_in).k_image;
-		in_kimg.add_element(&ki, sizeof(crypto::key_image));
-	}
-
 	std::vector<cryptonote::tx_extra_field> tx_extra_fields;
 	if(!parse_tx_extra(tx.extra, tx_extra_fields))
 	{
@@ -187,140 +173,211 @@ bool wallet2::block_scan_tx(const wallet_scan_ctx& ctx, const crypto::hash& txid
 	if(!find_tx_extra_field_by_type(tx_extra_fields, pub_key_field))
 	{
 		GULPS_LOG_L0("Public key wasn't found in the transaction extra. Skipping transaction ", txid);
-		return false;
+		keys.valid = false;
+		return;
 	}
 
-	const crypto::public_key& tx_pub_key = pub_key_field.pub_key;
-	crypto::key_derivation derivation;
-	bool derivation_res;
+	keys.valid = true;
+	keys.tx_pub_key = pub_key_field.pub_key;
+	cryptonote::tx_extra_additional_pub_keys additional_pub_keys;
+	if(find_tx_extra_field_by_type(tx_extra_fields, additional_pub_keys))
+		keys.additional_tx_pub_keys = std::move(additional_pub_keys.data);
+	else
+		keys.additional_tx_pub_keys.clear();
+}
+
+// With the 64 bit curve code every result of a batch shares one field inversion
+static void generate_key_derivations(const std::vector<crypto::public_key>& pub_keys, const crypto::secret_key& view_key,
+									 std::vector<crypto::key_derivation>& derivations, std::vector<bool>& results)
+{
+#ifdef HAVE_EC_64
+	crypto::generate_key_derivations_64(pub_keys, view_key, derivations, results);
+#else
+	derivations.resize(pub_keys.size());
+	results.resize(pub_keys.size());
+	for(size_t i = 0; i < pub_keys.size(); i++)
+		results[i] = crypto::generate_key_derivation(pub_keys[i], view_key, derivations[i]);
+#endif
+}
+
+static void derive_subaddress_public_keys(const std::vector<crypto::public_key>& out_keys, const std::vector<crypto::key_derivation>& derivations,
+										  const std::vector<size_t>& output_indices, std::vector<crypto::public_key>& spend_keys, std::vector<bool>& results)
+{
 #ifdef HAVE_EC_64
-	derivation_res = crypto::generate_key_derivation_64(tx_pub_key, keys.m_view_secret_key, derivation);
+	crypto::derive_subaddress_public_keys_64(out_keys, derivations, output_indices, spend_keys, results);
 #else
-	derivation_res = crypto::generate_key_derivation(tx_pub_key, keys.m_view_secret_key, derivation);
+	spend_keys.resize(out_keys.size());
+	results.resize(out_keys.size());
+	for(size_t i = 0; i < out_keys.size(); i++)
+		results[i] = crypto::derive_subaddress_public_key(out_keys[i], derivations[i], output_indices[i], spend_keys[i]);
 #endif
+}
 
-	if(!derivation_res)
+bool wallet2::block_scan_output(const wallet_scan_ctx& ctx, const crypto::public_key& out_pubkey, const crypto::key_derivation& derivation, size_t out_idx,
+								const crypto::public_key& subaddress_spendkey, std::unordered_set<crypto::key_image>& inc_kimg) const
+{
+	auto found = m_subaddresses.find(subaddress_spendkey);
+	if(found == m_subaddresses.end())
+		return false;
+
+	const cryptonote::account_keys &keys = ctx.account.get_keys();
+	bool spend_unknown = keys.m_spend_secret_key == crypto::null_skey || !keys.m_multisig_keys.empty();
+	if(!spend_unknown)
 	{
-		GULPS_WARN("Failed to generate key derivation from tx pubkey, skipping");
-		memcpy(&derivation, rct::identity().bytes, sizeof(derivation));
+		hw::core::device_default dummy_dev;
+		cryptonote::keypair eph;
+		crypto::key_image ki;
+		bool r = cryptonote::generate_key_image_helper_precomp(keys, out_pubkey, derivation, out_idx, found->second, eph, ki, dummy_dev);
+		THROW_WALLET_EXCEPTION_IF(!r, error::wallet_internal_error, "Failed to generate key image");
+		THROW_WALLET_EXCEPTION_IF(eph.pub != out_pubkey,
+							error::wallet_internal_error, "key_image generated ephemeral public key not matched with output_key");
+		THROW_WALLET_EXCEPTION_IF(!inc_kimg.insert(ki).second, error::wallet_internal_error, "Duplicate key image");
 	}
+	return true;
+}
 
-	std::vector<crypto::public_key> additional_tx_pub_keys = get_additional_tx_pub_keys_from_extra(tx);
-	std::vector<crypto::key_derivation> additional_derivations;
-	additional_derivations.resize(additional_tx_pub_keys.size());
+void wallet2::block_scan_span(const wallet_scan_ctx& ctx, const wallet_rpc_scan_data& res, wallet_rpc_scan_data::account_scan_result& acc) const
+{
+	struct tx_ref
+	{
+		size_t block_idx;
+		size_t tx_idx; // miner tx is 0
+		const cryptonote::transaction* tx;
+		size_t num_additional;
+		size_t derivation_idx; // the tx pubkey's derivation, the additional ones follow it
+		size_t spend_key_idx; // first output's spend key
+	};
 
-	// additional tx pubkeys and derivations for multi-destination transfers involving one or more subaddresses
-	for(size_t i = 0; i < additional_tx_pub_keys.size(); ++i)
+	const cryptonote::account_keys &keys = ctx.account.get_keys();
+	std::vector<tx_ref> txs;
+	std::vector<crypto::public_key> tx_pub_keys;
+	for(size_t i = 0; i < res.blocks_parsed.size(); i++)
 	{
-#ifdef HAVE_EC_64
-		derivation_res = crypto::generate_key_derivation_64(additional_tx_pub_keys[i], keys.m_view_secret_key, additional_derivations[i]);
-#else
-		derivation_res = crypto::generate_key_derivation(additional_tx_pub_keys[i], keys.m_view_secret_key, additional_derivations[i]);
-#endif
-		if(!derivation_res)
+		const wallet_rpc_scan_data::block_complete_entry_parsed& blke = res.blocks_parsed[i];
+		if(blke.skipped || acc.skipped[i])
+			continue;
+
+		for(size_t txi = ctx.scan_type == RefreshNoCoinbase ? 1 : 0; txi < blke.tx_keys.size(); txi++)
 		{
-			GULPS_WARN("Failed to generate key derivation from extra pubkey ", i, ", skipping");
-			memcpy(&additional_derivations[i], rct::identity().bytes, sizeof(additional_derivations[i]));
+			const tx_scan_keys& tx_keys = blke.tx_keys[txi];
+			GULPS_LOG_L2("Scanning tx ", txi == 0 ? blke.miner_tx_hash : blke.block.tx_hashes[txi-1]);
+			if(!tx_keys.valid)
+				continue;
+
+			const cryptonote::transaction* tx = txi == 0 ? &blke.block.miner_tx : &blke.txes[txi-1];
+			txs.push_back({i, txi, tx, tx_keys.additional_tx_pub_keys.size(), tx_pub_keys.size(), 0});
+			tx_pub_keys.push_back(tx_keys.tx_pub_key);
+			tx_pub_keys.insert(tx_pub_keys.end(), tx_keys.additional_tx_pub_keys.begin(), tx_keys.additional_tx_pub_keys.end());
 		}
 	}
 
-	bool spend_unknown = keys.m_spend_secret_key == crypto::null_skey || !keys.m_multisig_keys.empty();
-	bool ret = false;
-	for(size_t out_idx = 0; out_idx < tx.vout.size(); out_idx++)
+	std::vector<crypto::key_derivation> derivations;
+	std::vector<bool> derivations_ok;
+	generate_key_derivations(tx_pub_keys, keys.m_view_secret_key, derivations, derivations_ok);
+	for(size_t i = 0; i < derivations.size(); i++)
 	{
-		if(tx.vout[out_idx].target.type() != typeid(cryptonote::txout_to_key))
+		if(!derivations_ok[i])
 		{
-			GULPS_LOG_L0("Wrong type id in transaction out");
-			continue;
+			GULPS_WARN("Failed to generate key derivation from tx pubkey ", tx_pub_keys[i], ", skipping");
+			memcpy(&derivations[i], rct::identity().bytes, sizeof(derivations[i]));
 		}
+	}
 
-		// try the shared tx pubkey
-		crypto::public_key subaddress_spendkey;
-		const crypto::public_key& out_pubkey = boost::get<cryptonote::txout_to_key>(tx.vout[out_idx].target).key;
-#ifdef HAVE_EC_64
-		derivation_res = crypto::derive_subaddress_public_key_64(out_pubkey, derivation, out_idx, subaddress_spendkey);
-#else
-		derivation_res = crypto::derive_subaddress_public_key(out_pubkey, derivation, out_idx, subaddress_spendkey);
-#endif
-
-		if(!derivation_res)
+	// Every output is tried against the shared tx pubkey and, if it has one, its additional tx pubkey
+	std::vector<crypto::public_key> out_keys;
+	std::vector<crypto::key_derivation> out_derivations;
+	std::vector<size_t> out_indices;
+	for(tx_ref& t : txs)
+	{
+		t.spend_key_idx = out_keys.size();
+		for(size_t out_idx = 0; out_idx < t.tx->vout.size(); out_idx++)
 		{
-			GULPS_WARN("Failed to derive main addresses public key, skipping...");
-			continue;
-		}
+			if(t.tx->vout[out_idx].target.type() != typeid(cryptonote::txout_to_key))
+				continue;
 
-		auto found = m_subaddresses.find(subaddress_spendkey);
-		if(found != m_subaddresses.end())
-		{
-			if(!spend_unknown)
+			const crypto::public_key& out_pubkey = boost::get<cryptonote::txout_to_key>(t.tx->vout[out_idx].target).key;
+			out_keys.push_back(out_pubkey);
+			out_derivations.push_back(derivations[t.derivation_idx]);
+			out_indices.push_back(out_idx);
+			if(out_idx < t.num_additional)
 			{
-				cryptonote::keypair eph;
-				crypto::key_image ki;
-				bool r = cryptonote::generate_key_image_helper_precomp(keys, out_pubkey, derivation, out_idx, found->second, eph, ki, dummy_dev);
-				THROW_WALLET_EXCEPTION_IF(!r, error::wallet_internal_error, "Failed to generate key image");
-				THROW_WALLET_EXCEPTION_IF(eph.pub != out_pubkey,
-									error::wallet_internal_error, "key_image generated ephemeral public key not matched with output_key");
-				THROW_WALLET_EXCEPTION_IF(!inc_kimg.insert(ki).second, error::wallet_internal_error, "Duplicate key image");
+				out_keys.push_back(out_pubkey);
+				out_derivations.push_back(derivations[t.derivation_idx + 1 + out_idx]);
+				out_indices.push_back(out_idx);
 			}
-			ret = true;
-			continue;
 		}
+	}
 
-		// try additional tx pubkeys if available
-		if(!additional_derivations.empty())
+	std::vector<crypto::public_key> spend_keys;
+	std::vector<bool> spend_keys_ok;
+	derive_subaddress_public_keys(out_keys, out_derivations, out_indices, spend_keys, spend_keys_ok);
+
+	for(const tx_ref& t : txs)
+	{
+		size_t k = t.spend_key_idx;
+		bool ret = false;
+		for(size_t out_idx = 0; out_idx < t.tx->vout.size(); out_idx++)
 		{
-			if(out_idx >= additional_derivations.size())
+			if(t.tx->vout[out_idx].target.type() != typeid(cryptonote::txout_to_key))
 			{
-				GULPS_LOG_L0("Wrong number of additional derivations");
-				return false;
+				GULPS_LOG_L0("Wrong type id in transaction out");
+				continue;
 			}
 
-#ifdef HAVE_EC_64
-			derivation_res = crypto::derive_subaddress_public_key_64(out_pubkey, additional_derivations[out_idx], out_idx, subaddress_spendkey);
-#else
-			derivation_res = crypto::derive_subaddress_public_key(out_pubkey, additional_derivations[out_idx], out_idx, subaddress_spendkey);
-#endif
-
-			if(!derivation_res)
+			// try the shared tx pubkey
+			const crypto::public_key& out_pubkey = boost::get<cryptonote::txout_to_key>(t.tx->vout[out_idx].target).key;
+			size_t main_k = k++;
+			size_t additional_k = out_idx < t.num_additional ? k++ : 0;
+			if(!spend_keys_ok[main_k])
 			{
-				GULPS_WARN("Failed to derive subaddresses public key, skipping...");
+				GULPS_WARN("Failed to derive main addresses public key, skipping...");
 				continue;
 			}
 
-			found = m_subaddresses.find(subaddress_spendkey);
-			if(found != m_subaddresses.end())
+			if(block_scan_output(ctx, out_pubkey, derivations[t.derivation_idx], out_idx, spend_keys[main_k], acc.incoming_kimg))
 			{
-				if(!spend_unknown)
-				{
-					cryptonote::keypair eph;
-					crypto::key_image ki;
-					bool r = cryptonote::generate_key_image_helper_precomp(keys, out_pubkey, additional_derivations[out_idx], out_idx, found->second, eph, ki, dummy_dev);
-					THROW_WALLET_EXCEPTION_IF(!r, error::wallet_internal_error, "Failed to generate key image");
-					THROW_WALLET_EXCEPTION_IF(eph.pub != out_pubkey,
-										error::wallet_internal_error, "key_image generated ephemeral public key not matched with output_key");
-					THROW_WALLET_EXCEPTION_IF(!inc_kimg.insert(ki).second, error::wallet_internal_error, "Duplicate key image");
-				}
 				ret = true;
 				continue;
 			}
+
+			// try additional tx pubkeys if available
+			if(t.num_additional == 0)
+				continue;
+
+			if(out_idx >= t.num_additional)
+			{
+				GULPS_LOG_L0("Wrong number of additional derivations");
+				ret = false;
+				break;
+			}
+
+			if(!spend_keys_ok[additional_k])
+			{
+				GULPS_WARN("Failed to derive subaddresses public key, skipping...");
+				continue;
+			}
+
+			if(block_scan_output(ctx, out_pubkey, derivations[t.derivation_idx + 1 + out_idx], out_idx, spend_keys[additional_k], acc.incoming_kimg))
+				ret = true;
 		}
-	}
 
-	return ret;
+		if(ret)
+			acc.indices_found.emplace_back(t.block_idx, t.tx_idx);
+	}
 }
 
-void wallet2::block_scan_thd(const wallet_scan_ctx& ctx)
+void wallet2::block_scan_thd(const std::vector<wallet_scan_ctx>& ctxs, wallet_refresh_ctx& refresh_ctx)
 {
 	try
 	{
-		std::unique_lock<std::mutex> lck = ctx.refresh_ctx.m_scan_in_queue.get_lock();
-		while(ctx.refresh_ctx.m_scan_in_queue.wait_for_pop(lck))
+		std::unique_lock<std::mutex> lck = refresh_ctx.m_scan_in_queue.get_lock();
+		while(refresh_ctx.m_scan_in_queue.wait_for_pop(lck))
 		{
-			std::unique_ptr<wallet2::wallet_rpc_scan_data> pull_res = ctx.refresh_ctx.m_scan_in_queue.pop(lck);
+			std::unique_ptr<wallet2::wallet_rpc_scan_data> pull_res = refresh_ctx.m_scan_in_queue.pop(lck);
 
 			GULPSF_LOG_L1("Scanning blocks {} - {}", pull_res->blocks_start_height, pull_res->blocks_start_height+pull_res->blocks_bin.size()-1);
 
-			if(ctx.refresh_ctx.m_scan_error)
+			if(refresh_ctx.m_scan_error)
 			{
 				GULPS_LOG_L1("block_scan_thd exits due to m_scan_error.");
 				break;
@@ -331,6 +388,10 @@ void wallet2::block_scan_thd(const wallet_scan_ctx& ctx)
 			size_t blk_i=0;
 			size_t in_count = 0;
 			pull_res->blocks_parsed.resize(pull_res->blocks_bin.size());
+			pull_res->accounts.resize(ctxs.size());
+			for(wallet_rpc_scan_data::account_scan_result& acc : pull_res->accounts)
+				acc.skipped.resize(pull_res->blocks_bin.size());
+
 			for(const cryptonote::block_complete_entry_v& bl : pull_res->blocks_bin)
 			{
 				wallet_rpc_scan_data::block_complete_entry_parsed& blke = pull_res->blocks_parsed[blk_i];
@@ -346,16 +407,23 @@ void wallet2::block_scan_thd(const wallet_scan_ctx& ctx)
 				THROW_WALLET_EXCEPTION_IF(bl.txs.size() != blke.block.tx_hashes.size(), error::wallet_internal_error,
 										  "Wrong amount of transactions for block");
 
+				// Transactions are only parsed if at least one of the accounts needs the block
+				blke.skipped = true;
+				for(size_t ai = 0; ai < ctxs.size(); ai++)
+				{
+					const wallet_scan_ctx& ctx = ctxs[ai];
+					bool skip = !ctx.explicit_refresh && (blke.block.timestamp + 60 * 60 * 24 <= ctx.wallet_create_time || blke.block_height < ctx.refresh_height);
+					pull_res->accounts[ai].skipped[blk_i] = skip;
+					blke.skipped = blke.skipped && skip;
+				}
+
 				blk_i++;
-				if(!ctx.explicit_refresh && (blke.block.timestamp + 60 * 60 * 24 <= ctx.wallet_create_time || blke.block_height  < ctx.refresh_height))
+				if(blke.skipped)
 				{
 					if(blke.block_height % 100 == 0)
-						GULPS_LOG_L2("Skipped block by timestamp, height: ", blke.block_height, ", block time ",
-									 blke.block.timestamp, ", account time ", ctx.wallet_create_time);
-					blke.skipped = true;
+						GULPS_LOG_L2("Skipped block by timestamp, height: ", blke.block_height, ", block time ", blke.block.timestamp);
 					continue;
 				}
-				blke.skipped = false;
 
 				blke.miner_tx_hash = cryptonote::get_transaction_hash(blke.block.miner_tx);
 				size_t tx_i =0;
@@ -378,39 +446,303 @@ void wallet2::block_scan_thd(const wallet_scan_ctx& ctx)
 				if(blke.skipped)
 					continue;
 
-				if(ctx.scan_type != RefreshNoCoinbase)
-				{
-					if(block_scan_tx(ctx, blke.miner_tx_hash, blke.block.miner_tx, pull_res->key_images, pull_res->incoming_kimg))
-						pull_res->indices_found.emplace_back(i, 0);
-				}
-
+				// Shared per-tx work: spent key images and the tx public keys
+				blke.tx_keys.resize(blke.txes.size() + 1);
+				get_tx_scan_keys(blke.miner_tx_hash, blke.block.miner_tx, blke.tx_keys[0]);
 				for(size_t txi=0; txi < blke.txes.size(); txi++)
 				{
-					if(block_scan_tx(ctx, blke.block.tx_hashes[txi], blke.txes[txi], pull_res->key_images, pull_res->incoming_kimg))
-						pull_res->indices_found.emplace_back(i, txi+1);
+					for(const auto& tx_in : blke.txes[txi].vin)
+					{
+						if(tx_in.type() != typeid(cryptonote::txin_to_key))
+							continue;
+
+						const crypto::key_image& ki = boost::get<cryptonote::txin_to_key>(tx_in).k_image;
+						pull_res->key_images.add_element(&ki, sizeof(crypto::key_image));
+					}
+					get_tx_scan_keys(blke.block.tx_hashes[txi], blke.txes[txi], blke.tx_keys[txi+1]);
 				}
 			}
 
-			ctx.refresh_ctx.m_scan_out_queue.push(std::move(pull_res));
+			// Each account derives its keys for the whole span in one batch
+			for(size_t ai = 0; ai < ctxs.size(); ai++)
+				ctxs[ai].wallet.block_scan_span(ctxs[ai], *pull_res, pull_res->accounts[ai]);
+
+			refresh_ctx.m_scan_out_queue.push(std::move(pull_res));
 		}
 	}
 	catch(std::exception& e)
 	{
-		ctx.refresh_ctx.m_scan_error = true;
-		m_run = false;
+		refresh_ctx.m_scan_error = true;
+		refresh_ctx.m_run = false;
 		GULPSF_LOG_ERROR("Blocks scanning thread exception: {}", e.what());
 	}
 
-	if(ctx.refresh_ctx.m_running_scan_thd_cnt.fetch_sub(1)-1 == 0)
+	if(refresh_ctx.m_running_scan_thd_cnt.fetch_sub(1)-1 == 0)
 	{
 		GULPS_LOG_L1("Blocks scanning threads complete");
-		ctx.refresh_ctx.m_scan_out_queue.set_finish_flag();
+		refresh_ctx.m_scan_out_queue.set_finish_flag();
 	}
 	else
 	{
-		size_t left = ctx.refresh_ctx.m_running_scan_thd_cnt;
-		bool error = ctx.refresh_ctx.m_scan_error;
+		size_t left = refresh_ctx.m_running_scan_thd_cnt;
+		bool error = refresh_ctx.m_scan_error;
 		GULPSF_LOG_L1("block_scan_thd exits {} left, m_scan_error state", left, error);
 	}
 }
+
+bool wallet2::integrate_scanned_in_order(wallet_refresh_ctx& refresh_ctx, const std::function<void(wallet_rpc_scan_data&)>& integrate)
+{
+	size_t result_idx=0;
+	std::list<std::unique_ptr<wallet2::wallet_rpc_scan_data>> result_list;
+	std::unique_lock<std::mutex> lck = refresh_ctx.m_scan_out_queue.get_lock();
+	while(refresh_ctx.m_scan_out_queue.wait_for_pop(lck))
+	{
+		result_list.emplace_back(refresh_ctx.m_scan_out_queue.pop(lck));
+
+		if(!refresh_ctx.m_run)
+			break;
+
+		bool processed;
+		do
+		{
+			// Integrate scanned results in order they were fanned out
+			processed = false;
+			for(auto it = result_list.begin(); it != result_list.end();)
+			{
+				std::unique_ptr<wallet2::wallet_rpc_scan_data>& res = *it;
+				if(result_idx != res->dl_order)
+				{
+					it++;
+					continue;
+				}
+				result_idx++;
+				processed = true;
+				try
+				{
+					integrate(*res);
+				}
+				catch(std::exception &e)
+				{
+					GULPS_LOG_ERROR("Integrate scanned results exception:\n", e.what());
+					refresh_ctx.m_scan_error = true;
+					refresh_ctx.m_run = false;
+					return false;
+				}
+				it = result_list.erase(it);
+			}
+		}
+		while(processed);
+	}
+	return true;
+}
+
+bool wallet_shared_scanner::add_wallet(wallet2 &wallet, boost::mutex &lock)
+{
+	boost::unique_lock<boost::mutex> lk(m_wallets_lock);
+	for(const registered_wallet &reg : m_wallets)
+	{
+		if(reg.wallet == &wallet)
+			return true;
+		// Spans are downloaded through one of the wallets, they all have to ask the same daemon
+		if(reg.wallet->nettype() != wallet.nettype() || reg.wallet->get_daemon_address() != wallet.get_daemon_address())
+			return false;
+	}
+	m_wallets.push_back({&wallet, &lock});
+	return true;
+}
+
+void wallet_shared_scanner::remove_wallet(wallet2 &wallet)
+{
+	// Wait for a running refresh, it holds a pointer to the wallet
+	boost::unique_lock<boost::mutex> refresh_lock(m_refresh_lock);
+	boost::unique_lock<boost::mutex> lock(m_wallets_lock);
+	m_wallets.erase(std::remove_if(m_wallets.begin(), m_wallets.end(), [&wallet](const registered_wallet &reg) { return reg.wallet == &wallet; }), m_wallets.end());
+}
+
+size_t wallet_shared_scanner::wallet_count()
+{
+	boost::unique_lock<boost::mutex> lock(m_wallets_lock);
+	return m_wallets.size();
+}
+
+void wallet_shared_scanner::stop()
+{
+	boost::unique_lock<boost::mutex> lock(m_wallets_lock);
+	for(const registered_wallet &reg : m_wallets)
+		reg.wallet->stop();
+}
+
+bool wallet_shared_scanner::refresh_alone(const registered_wallet &reg)
+{
+	boost::unique_lock<boost::mutex> lock(*reg.lock);
+	uint64_t blocks_fetched;
+	bool received_money, ok;
+	return reg.wallet->refresh(blocks_fetched, received_money, ok);
+}
+
+void wallet_shared_scanner::merge_span(wallet2::wallet_rpc_scan_data &res, std::vector<scan_member> &members)
+{
+	for(size_t ai = 0; ai < members.size(); ai++)
+	{
+		scan_member &m = members[ai];
+		wallet2 &w = *m.reg.wallet;
+		if(m.failed || m.alone || !w.m_run.load(std::memory_order_relaxed))
+			continue;
+
+		boost::unique_lock<boost::mutex> lock(*m.reg.lock);
+		if(!w.m_blockchain.is_in_bounds(res.blocks_parsed.front().block_height))
+		{
+			m.alone = true;
+			continue;
+		}
+
+		try
+		{
+			w.integrate_scanned_result(res, res.accounts[ai]);
+		}
+		catch(const std::exception &e)
+		{
+			GULPSF_LOG_ERROR("Integrate scanned results of wallet {} failed: {}", ai, e.what());
+			m.failed = true;
+		}
+	}
+}
+
+bool wallet_shared_scanner::refresh()
+{
+	const uint64_t started = m_refreshes_started.load();
+	boost::unique_lock<boost::mutex> refresh_lock(m_refresh_lock);
+	// Everything registered when we were called is covered by a refresh that started since
+	if(m_refreshes_started.load() > started)
+		return m_last_refresh_ok;
+	m_refreshes_started++;
+
+	std::vector<registered_wallet> wallets;
+	{
+		boost::unique_lock<boost::mutex> lock(m_wallets_lock);
+		wallets = m_wallets;
+	}
+
+	m_last_refresh_ok = refresh_wallets(wallets);
+	return m_last_refresh_ok;
+}
+
+bool wallet_shared_scanner::refresh_wallets(const std::vector<registered_wallet> &wallets)
+{
+	if(wallets.empty())
+		return true;
+	if(wallets.size() == 1)
+		return refresh_alone(wallets.front());
+
+	bool ok = true;
+	std::vector<scan_member> members;
+
+	// Wallets restored from a height only pull hashes up to it, same as wallet2::refresh
+	for(const registered_wallet &reg : wallets)
+	{
+		boost::unique_lock<boost::mutex> lock(*reg.lock);
+		wallet2 &w = *reg.wallet;
+		w.m_run.store(true, std::memory_order_relaxed);
+		if(w.m_refresh_from_block_height > w.m_blockchain.size())
+		{
+			try
+			{
+				std::list<crypto::hash> short_chain_history;
+				uint64_t blocks_start_height;
+				w.get_short_chain_history(short_chain_history);
+				w.fast_refresh(w.m_explicit_refresh_from_block_height ? w.m_refresh_from_block_height : 0, blocks_start_height, short_chain_history);
+			}
+			catch(const std::exception &e)
+			{
+				GULPSF_LOG_ERROR("Fast refresh of wallet {} failed: {}", w.get_wallet_file(), e.what());
+				ok = false;
+				continue;
+			}
+		}
+
+		if(w.m_run.load(std::memory_order_relaxed))
+			members.push_back({reg, w.m_local_bc_height, false, false});
+	}
+
+	if(members.empty())
+		return ok;
+
+	// The wallet furthest behind drives the download, everyone else catches up on the way
+	size_t lead = 0;
+	for(size_t i = 1; i < members.size(); i++)
+	{
+		if(members[i].entry_height < members[lead].entry_height)
+			lead = i;
+	}
+
+	wallet2 &lw = *members[lead].reg.wallet;
+	wallet2::wallet_refresh_ctx refresh_ctx(lw.m_run);
+	wallet2::wallet_block_dl_ctx ctx(refresh_ctx);
+	size_t thd_max = std::min<size_t>(tools::get_max_concurrency(), 8);
+	ctx.scan_thd_cnt = thd_max;
+	ctx.start_height = 0;
+	std::vector<wallet2::wallet_scan_ctx> scan_ctxs;
+	scan_ctxs.reserve(members.size());
+	{
+		boost::unique_lock<boost::mutex> lock(*members[lead].reg.lock);
+		lw.get_short_chain_history(ctx.short_chain_history);
+	}
+	for(const scan_member &m : members)
+		scan_ctxs.emplace_back(*m.reg.wallet);
+
+	ctx.thd = std::thread(&wallet2::block_download_thd, &lw, std::ref(ctx));
+	refresh_ctx.m_running_scan_thd_cnt = thd_max;
+
+	GULPSF_LOG_L1("Running {} scanning threads for {} wallets", thd_max, members.size());
+
+	std::vector<std::thread> scan_thds;
+	scan_thds.reserve(thd_max);
+	for(size_t i=0; i < thd_max; i++)
+		scan_thds.emplace_back(&wallet2::block_scan_thd, std::cref(scan_ctxs), std::ref(refresh_ctx));
+
+	wallet2::integrate_scanned_in_order(refresh_ctx, [&members](wallet2::wallet_rpc_scan_data& res) { merge_span(res, members); });
+
+	GULPS_LOG_L1("Joining threads...");
+	ctx.thd.join();
+	for(auto& t : scan_thds)
+		t.join();
+
+	if(ctx.error || refresh_ctx.m_scan_error)
+	{
+		for(scan_member &m : members)
+			m.failed = true;
+	}
+
+	for(scan_member &m : members)
+	{
+		if(m.failed)
+		{
+			ok = false;
+			continue;
+		}
+
+		if(m.alone)
+		{
+			ok = refresh_alone(m.reg) && ok;
+			continue;
+		}
+
+		wallet2 &w = *m.reg.wallet;
+		boost::unique_lock<boost::mutex> lock(*m.reg.lock);
+		try
+		{
+			if(w.m_run.load(std::memory_order_relaxed))
+				w.update_pool_state(ctx.refreshed);
+		}
+		catch(...)
+		{
+			GULPS_LOG_L1("Failed to check pending transactions");
+		}
+
+		uint64_t blocks_fetched = w.m_local_bc_height > m.entry_height ? w.m_local_bc_height - m.entry_height : 0;
+		GULPSF_LOG_L1("Shared refresh done for wallet {}, blocks received: {}", w.get_wallet_file(), blocks_fetched);
+	}
+
+	return ok;
+}
 }
@@ -227,6 +227,8 @@ boost::optional<boost::program_options::variables_map> main(
 				if(printed)
 					return false;
 				return log_scr.match_msg(msg);
+				}, [](gulps::output out, gulps::level lvl) -> bool {
+				return (out == gulps::OUT_LOG_0 || out == gulps::OUT_USER_0) && log_scr.may_match(lvl);
 				});
 		gulps::inst().add_output(std::move(out));
 	}
@@ -237,6 +239,8 @@ boost::optional<boost::program_options::variables_map> main(
 				if(msg.out != gulps::OUT_LOG_0 && msg.out != gulps::OUT_USER_0)
 					return false;
 				return log_dsk.match_msg(msg);
+				}, [](gulps::output out, gulps::level lvl) -> bool {
+				return (out == gulps::OUT_LOG_0 || out == gulps::OUT_USER_0) && log_dsk.may_match(lvl);
 				});
 		gulps::inst().add_output(std::move(file_out));
 	}
@@ -3028,6 +3028,8 @@ int main(int argc, char **argv)
 	std::unique_ptr<gulps::gulps_output> out(new gulps::gulps_print_output(gulps::COLOR_WHITE, gulps::TIMESTAMP_ONLY));
 	out->add_filter([](const gulps::message& msg, bool printed, bool logged) -> bool {
 		return (msg.out == gulps::OUT_USER_0 || msg.out == gulps::OUT_LOG_0) && msg.lvl <= gulps::LEVEL_INFO; 
+	}, [](gulps::output out, gulps::level lvl) -> bool {
+		return (out == gulps::OUT_USER_0 || out == gulps::OUT_LOG_0) && lvl <= gulps::LEVEL_INFO;
 	});
 	gulps::inst().add_output(std::move(out));
 
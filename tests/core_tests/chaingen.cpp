@@ -347,15 +347,16 @@ bool init_output_indices(map_output_idx_t &outs, std::map<uint64_t, std::vector<
 
 				output_index oi(out.target, out.amount, boost::get<txin_gen>(*blk.miner_tx.vin.begin()).height, i, j, &blk, vtx[i]);
 
+				// every output lives in the amount 0 index, like BlockchainDB::add_transaction files them
 				if(2 == out.target.which())
 				{ // out_to_key
-					outs[out.amount].push_back(oi);
-					size_t tx_global_idx = outs[out.amount].size() - 1;
-					outs[out.amount][tx_global_idx].idx = tx_global_idx;
-					// Is out to me?
-					if(is_out_to_acc(from.get_keys(), boost::get<txout_to_key>(out.target), get_tx_pub_key_from_extra(tx), get_additional_tx_pub_keys_from_extra(tx), j))
+					outs[0].push_back(oi);
+					size_t tx_global_idx = outs[0].size() - 1;
+					outs[0][tx_global_idx].idx = tx_global_idx;
+					// Is out to me? Only miner outputs show their amount, the others would need decoding
+					if(out.amount != 0 && is_out_to_acc(from.get_keys(), boost::get<txout_to_key>(out.target), get_tx_pub_key_from_extra(tx), get_additional_tx_pub_keys_from_extra(tx), j))
 					{
-						outs_mine[out.amount].push_back(tx_global_idx);
+						outs_mine[0].push_back(tx_global_idx);
 					}
 				}
 			}
@@ -432,8 +433,10 @@ bool fill_output_entries(std::vector<output_index> &out_indices, size_t sender_o
 
 		if(append)
 		{
+			// miner outputs are stored as rct outputs with an identity mask
 			const txout_to_key &otk = boost::get<txout_to_key>(oi.out);
-			output_entries.push_back(tx_source_entry::output_entry(oi.idx, rct::ctkey({rct::pk2rct(otk.key), rct::identity()})));
+			const rct::key commitment = oi.tx_no == 0 ? rct::zeroCommit(oi.amount) : oi.p_tx->rct_signatures.outPk[oi.out_no].mask;
+			output_entries.push_back(tx_source_entry::output_entry(oi.idx, rct::ctkey({rct::pk2rct(otk.key), commitment})));
 		}
 	}
 
@@ -478,7 +481,8 @@ bool fill_tx_sources(std::vector<tx_source_entry> &sources, const std::vector<te
 				continue;
 
 			ts.real_output = realOutput;
-			ts.rct = false;
+			ts.rct = true;
+			ts.mask = rct::identity();
 
 			sources.push_back(ts);
 
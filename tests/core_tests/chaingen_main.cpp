@@ -159,6 +159,9 @@ int main(int argc, char *argv[])
 		GENERATE_AND_PLAY(gen_double_spend_in_alt_chain_in_different_blocks<false>);
 		GENERATE_AND_PLAY(gen_double_spend_in_alt_chain_in_different_blocks<true>);
 
+		// Transaction pool
+		GENERATE_AND_PLAY(gen_tx_pool_block_template);
+
 		GENERATE_AND_PLAY(gen_uint_overflow_1);
 		GENERATE_AND_PLAY(gen_uint_overflow_2);
 
@@ -40,6 +40,7 @@
 #include "multisig.h"
 #include "rct.h"
 #include "ring_signature_1.h"
+#include "tx_pool.h"
 #include "tx_validation.h"
 #include "v2_tests.h"
 /************************************************************************/
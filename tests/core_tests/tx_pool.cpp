@@ -0,0 +1,181 @@
+// Copyright (c) 2020, pasta Currency Project
+//
+// Portions of this file are available under BSD-3 license. Please see ORIGINAL-LICENSE for details
+// All rights reserved.
+//
+// Authors and copyright holders give permission for following:
+//
+// 1. Redistribution and use in source and binary forms WITHOUT modification.
+//
+// 2. Modification of the source form for your own personal use.
+//
+// As long as the following conditions are met:
+//
+// 3. You must not distribute modified copies of the work to third parties. This includes
+//    posting the work online, or hosting copies of the modified work for download.
+//
+// 4. Any derivative version of this work is also covered by this license, including point 8.
+//
+// 5. Neither the name of the copyright holders nor the names of the authors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+//
+// 6. You agree that this licence is governed by and shall be construed in accordance
+//    with the laws of England and Wales.
+//
+// 7. You agree to submit all disputes arising out of or in connection with this licence
+//    to the exclusive jurisdiction of the Courts of England and Wales.
+//
+// Authors and copyright holders agree that:
+//
+// 8. This licence expires and the work covered by it is released into the
+//    public domain on 1st of February 2021
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "tx_pool.h"
+#include "chaingen.h"
+
+using namespace epee;
+using namespace cryptonote;
+
+GULPS_CAT_MAJOR("test");
+
+namespace
+{
+bool get_template_txes(cryptonote::core &c, const std::vector<test_event_entry> &events, std::vector<crypto::hash> &tx_hashes)
+{
+	block b;
+	difficulty_type diffic;
+	uint64_t height, expected_reward;
+	const account_base &acc = boost::get<account_base>(events[1]);
+	if(!c.get_block_template(b, acc.get_keys().m_account_address, diffic, height, expected_reward, blobdata()))
+		return false;
+	tx_hashes = b.tx_hashes;
+	return true;
+}
+
+// the tx sent to the pool, and the one double spending it that only ever comes in a block
+void get_test_txes(const std::vector<test_event_entry> &events, crypto::hash &pool_tx, crypto::hash &block_tx)
+{
+	for(const test_event_entry &e : events)
+	{
+		if(typeid(transaction) == e.type() && pool_tx == crypto::null_hash)
+			pool_tx = get_transaction_hash(boost::get<transaction>(e));
+		else if(typeid(block) == e.type() && !boost::get<block>(e).tx_hashes.empty())
+			block_tx = boost::get<block>(e).tx_hashes.front();
+	}
+}
+}
+
+gen_tx_pool_block_template::gen_tx_pool_block_template()
+{
+	REGISTER_CALLBACK_METHOD(gen_tx_pool_block_template, check_template_has_pool_tx);
+	REGISTER_CALLBACK_METHOD(gen_tx_pool_block_template, check_template_after_double_spend);
+	REGISTER_CALLBACK_METHOD(gen_tx_pool_block_template, check_template_after_pop);
+}
+
+//-----------------------------------------------------------------------------------------------------
+bool gen_tx_pool_block_template::generate(std::vector<test_event_entry> &events) const
+{
+	uint64_t ts_start = 1338224400;
+	/*
+  (0 )-(1 )-(2 )              <- main chain until (3a) arrives
+          \ -(2a)-(3a)        <- alt chain, pops (2)
+
+  tx_0 spends a miner output and stays in the pool, tx_1 spends the same output in (2)
+  */
+
+	GENERATE_ACCOUNT(miner_account);
+	MAKE_GENESIS_BLOCK(events, blk_0, miner_account, ts_start);
+	MAKE_ACCOUNT(events, alice);
+	MAKE_ACCOUNT(events, bob);
+	// enough unlocked miner outputs of one amount for a ring of the minimum size
+	REWIND_BLOCKS_N(events, blk_0r, blk_0, miner_account, CRYPTONOTE_MINED_MONEY_UNLOCK_WINDOW + common_config::MIN_MIXIN_V1 + 1);
+
+	// both are built before either is an event, so they spend the same output
+	transaction tx_0, tx_1;
+	if(!construct_tx_to_key(events, tx_0, blk_0r, miner_account, alice, MK_COINS(5), TESTS_DEFAULT_FEE, common_config::MIN_MIXIN_V1))
+		return false;
+	if(!construct_tx_to_key(events, tx_1, blk_0r, miner_account, bob, MK_COINS(5), TESTS_DEFAULT_FEE, common_config::MIN_MIXIN_V1))
+		return false;
+
+	events.push_back(tx_0);
+	DO_CALLBACK(events, "check_template_has_pool_tx");
+
+	// a block leaves a ready tx ready
+	MAKE_NEXT_BLOCK(events, blk_1, blk_0r, miner_account);
+	DO_CALLBACK(events, "check_template_has_pool_tx");
+
+	// a block spending its key image takes it out of the template, not out of the pool;
+	// tx_1 arrives with its block, which lets it past the pool's key image check
+	SET_EVENT_VISITOR_SETT(events, event_visitor_settings::set_txs_keeped_by_block, true);
+	events.push_back(tx_1);
+	SET_EVENT_VISITOR_SETT(events, event_visitor_settings::set_txs_keeped_by_block, false);
+	MAKE_NEXT_BLOCK_TX1(events, blk_2, blk_1, miner_account, tx_1);
+	DO_CALLBACK(events, "check_template_after_double_spend");
+
+	// popping that block makes it ready again, next to tx_1 which goes back to the pool
+	MAKE_NEXT_BLOCK(events, blk_2a, blk_1, miner_account);
+	MAKE_NEXT_BLOCK(events, blk_3a, blk_2a, miner_account);
+	DO_CALLBACK(events, "check_template_after_pop");
+
+	return true;
+}
+
+//-----------------------------------------------------------------------------------------------------
+bool gen_tx_pool_block_template::check_template_has_pool_tx(cryptonote::core &c, size_t ev_index, const std::vector<test_event_entry> &events)
+{
+	DEFINE_TESTS_ERROR_CONTEXT("gen_tx_pool_block_template::check_template_has_pool_tx");
+
+	crypto::hash pool_tx = crypto::null_hash, block_tx = crypto::null_hash;
+	get_test_txes(events, pool_tx, block_tx);
+
+	std::vector<crypto::hash> tx_hashes;
+	CHECK_TEST_CONDITION(get_template_txes(c, events, tx_hashes));
+	CHECK_EQ(1, tx_hashes.size());
+	CHECK_TEST_CONDITION(tx_hashes.front() == pool_tx);
+
+	return true;
+}
+
+//-----------------------------------------------------------------------------------------------------
+bool gen_tx_pool_block_template::check_template_after_double_spend(cryptonote::core &c, size_t ev_index, const std::vector<test_event_entry> &events)
+{
+	DEFINE_TESTS_ERROR_CONTEXT("gen_tx_pool_block_template::check_template_after_double_spend");
+
+	CHECK_EQ(1, c.get_pool_transactions_count());
+
+	std::vector<crypto::hash> tx_hashes;
+	CHECK_TEST_CONDITION(get_template_txes(c, events, tx_hashes));
+	CHECK_EQ(0, tx_hashes.size());
+
+	return true;
+}
+
+//-----------------------------------------------------------------------------------------------------
+bool gen_tx_pool_block_template::check_template_after_pop(cryptonote::core &c, size_t ev_index, const std::vector<test_event_entry> &events)
+{
+	DEFINE_TESTS_ERROR_CONTEXT("gen_tx_pool_block_template::check_template_after_pop");
+
+	crypto::hash pool_tx = crypto::null_hash, block_tx = crypto::null_hash;
+	get_test_txes(events, pool_tx, block_tx);
+
+	CHECK_EQ(2, c.get_pool_transactions_count());
+
+	// both are valid on this chain, but only one of them fits in a block
+	std::vector<crypto::hash> tx_hashes;
+	CHECK_TEST_CONDITION(get_template_txes(c, events, tx_hashes));
+	CHECK_EQ(1, tx_hashes.size());
+	CHECK_TEST_CONDITION(tx_hashes.front() == pool_tx || tx_hashes.front() == block_tx);
+
+	return true;
+}
@@ -629,6 +629,86 @@ TEST_F(net_load_test_clt, permament_open_and_close_and_connections_closed_by_ser
 	ASSERT_EQ(RESERVED_CONN_CNT, m_tcp_server.get_config_object().get_connections_count());
 }
 
+namespace
+{
+struct notify_counting_handler : public test_levin_commands_handler
+{
+	virtual int notify(int command, const std::string &in_buff, test_connection_context &context)
+	{
+		m_notify_counter.inc();
+		return LEVIN_OK;
+	}
+
+	unit_test::call_counter m_notify_counter;
+};
+}
+
+TEST(net_load_test_throttle, rpc_requests_are_served_while_p2p_in_limit_is_active)
+{
+	const size_t bulk_message_size = 64 * 1024;
+	const size_t bulk_message_count = 64;
+	const size_t probe_count = 20;
+	const uint64_t down_limit_kbps = 16;
+	const int64_t max_probe_latency_ms = 200;
+
+	// A rate limited P2P server and an unlimited RPC server share a single io_service thread, so
+	// any waiting done to obey the P2P in limit inside that thread would stall the RPC requests too
+	notify_counting_handler p2p_handler;
+	test_levin_commands_handler rpc_handler;
+	test_tcp_server p2p_server(epee::net_utils::e_connection_type_P2P);
+	p2p_server.get_config_object().set_handler(&p2p_handler);
+	ASSERT_TRUE(p2p_server.init_server(throttle_p2p_port, "127.0.0.1"));
+	test_tcp_server rpc_server(p2p_server.get_io_service(), epee::net_utils::e_connection_type_RPC);
+	rpc_server.get_config_object().set_handler(&rpc_handler);
+	ASSERT_TRUE(rpc_server.init_server(throttle_rpc_port, "127.0.0.1"));
+	ASSERT_TRUE(p2p_server.run_server(1, false));
+
+	test_levin_commands_handler clt_handler;
+	test_tcp_server clt(epee::net_utils::e_connection_type_RPC);
+	clt.get_config_object().set_handler(&clt_handler);
+	clt.get_config_object().m_invoke_timeout = CONNECTION_TIMEOUT;
+	ASSERT_TRUE(clt.init_server(throttle_clt_port, "127.0.0.1"));
+	ASSERT_TRUE(clt.run_server(min_thread_count, false));
+
+	const uint64_t prev_down_limit = epee::net_utils::connection_basic::get_rate_down_limit();
+	epee::net_utils::connection_basic::set_rate_down_limit(down_limit_kbps);
+	epee::misc_utils::auto_scope_leave_caller restore_limit = epee::misc_utils::create_scope_leave_handler([&]() {
+		epee::net_utils::connection_basic::set_rate_down_limit(prev_down_limit);
+	});
+
+	test_connection_context bulk_ctx;
+	test_connection_context probe_ctx;
+	ASSERT_TRUE(clt.connect("127.0.0.1", throttle_p2p_port, CONNECTION_TIMEOUT, bulk_ctx));
+	ASSERT_TRUE(clt.connect("127.0.0.1", throttle_rpc_port, CONNECTION_TIMEOUT, probe_ctx));
+
+	// Flood the P2P server with far more than the limit lets through during the test
+	const std::string bulk_message(bulk_message_size, 'x');
+	for(size_t i = 0; i < bulk_message_count; ++i)
+		ASSERT_EQ(1, clt.get_config_object().notify(CMD_DATA_REQUEST::ID, bulk_message, bulk_ctx.m_connection_id));
+
+	int64_t max_latency_ms = 0;
+	for(size_t i = 0; i < probe_count; ++i)
+	{
+		std::string out;
+		auto start = std::chrono::steady_clock::now();
+		ASSERT_EQ(LEVIN_OK, clt.get_config_object().invoke(CMD_GET_STATISTICS::ID, std::string(), out, probe_ctx.m_connection_id));
+		auto latency = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count();
+		max_latency_ms = (std::max)(max_latency_ms, static_cast<int64_t>(latency));
+		epee::misc_utils::sleep_no_w(50);
+	}
+
+	// The limit must still be holding the bulk transfer back, or the probes proved nothing
+	ASSERT_LT(p2p_handler.m_notify_counter.get(), bulk_message_count);
+	ASSERT_GT(max_probe_latency_ms, max_latency_ms);
+
+	clt.get_config_object().close(bulk_ctx.m_connection_id);
+	clt.get_config_object().close(probe_ctx.m_connection_id);
+	clt.send_stop_signal();
+	p2p_server.send_stop_signal();
+	ASSERT_TRUE(clt.timed_wait_server_stop(DEFAULT_OPERATION_TIMEOUT));
+	ASSERT_TRUE(p2p_server.timed_wait_server_stop(DEFAULT_OPERATION_TIMEOUT));
+}
+
 int main(int argc, char **argv)
 {
 	tools::on_startup();
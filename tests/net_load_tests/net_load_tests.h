@@ -209,6 +209,9 @@ class open_close_test_helper
 const unsigned int min_thread_count = 2;
 const std::string clt_port("36230");
 const std::string srv_port("36231");
+const std::string throttle_p2p_port("36232");
+const std::string throttle_rpc_port("36233");
+const std::string throttle_clt_port("36234");
 
 enum command_ids
 {
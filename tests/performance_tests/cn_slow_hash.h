@@ -83,3 +83,86 @@ class test_cn_slow_hash
 	cn_pow_hash_v2 m_hash;
 	crypto::hash m_expected_hash;
 };
+
+// Same v2 hash, but with the scratchpad mapped on 4K pages or on huge pages (MAP_HUGETLB,
+// falling back to transparent huge pages) to measure the TLB miss cost of the random reads
+template <bool HUGE_PAGES>
+class test_cn_slow_hash_pages
+{
+  public:
+	static const size_t loop_count = 10;
+
+	test_cn_slow_hash_pages() : m_hash(HUGE_PAGES) {}
+
+	bool init()
+	{
+		if(!epee::string_tools::hex_to_pod("63617665617420656d70746f72", m_data))
+			return false;
+
+		if(!epee::string_tools::hex_to_pod("45f1fbd7ecdbbf9a94c1d55ce7e5aa9ca37de9f77568cdde243f77f6663cc278", m_expected_hash))
+			return false;
+
+		return true;
+	}
+
+	bool test()
+	{
+		crypto::hash hash;
+		m_hash.hash(&m_data, sizeof(m_data), &hash);
+		return hash == m_expected_hash;
+	}
+
+  private:
+	typename test_cn_slow_hash<false>::data_t m_data;
+	cn_pow_hash_v2 m_hash;
+	crypto::hash m_expected_hash;
+};
+
+// Interleaved hashing of WAYS nonces per call on independent scratchpads. Every call hashes
+// max_ways inputs in total, so the time per call (and the reported H/s) compares directly
+// across widths. The results are checked against the single input path.
+template <typename HASH, size_t WAYS>
+class test_cn_slow_hash_ways
+{
+  public:
+	static const size_t loop_count = 4;
+	static const size_t hashes_per_call = HASH::max_ways;
+
+	bool init()
+	{
+		for(size_t i = 0; i < HASH::max_ways; i++)
+		{
+			if(!epee::string_tools::hex_to_pod("63617665617420656d70746f72", m_data[i]))
+				return false;
+			m_data[i].data[0] += i;
+			m_hash[i].hash(&m_data[i], sizeof(m_data[i]), &m_expected_hash[i]);
+
+			m_ctx[i] = &m_hash[i];
+			m_in[i] = &m_data[i];
+			m_out[i] = &m_result[i];
+		}
+		return true;
+	}
+
+	bool test()
+	{
+		for(size_t i = 0; i < HASH::max_ways; i += WAYS)
+			HASH::hash_multi(m_ctx + i, m_in + i, sizeof(m_data[0]), m_out + i, WAYS);
+
+		for(size_t i = 0; i < HASH::max_ways; i++)
+		{
+			if(m_result[i] != m_expected_hash[i])
+				return false;
+		}
+		return true;
+	}
+
+  private:
+	typename test_cn_slow_hash<false>::data_t m_data[HASH::max_ways];
+	HASH m_hash[HASH::max_ways];
+	HASH* m_ctx[HASH::max_ways];
+	const void* m_in[HASH::max_ways];
+	void* m_out[HASH::max_ways];
+	crypto::hash m_result[HASH::max_ways];
+	crypto::hash m_expected_hash[HASH::max_ways];
+};
@@ -0,0 +1,134 @@
+// Copyright (c) 2020, pasta Currency Project
+//
+// Portions of this file are available under BSD-3 license. Please see ORIGINAL-LICENSE for details
+// All rights reserved.
+//
+// Authors and copyright holders give permission for following:
+//
+// 1. Redistribution and use in source and binary forms WITHOUT modification.
+//
+// 2. Modification of the source form for your own personal use.
+//
+// As long as the following conditions are met:
+//
+// 3. You must not distribute modified copies of the work to third parties. This includes
+//    posting the work online, or hosting copies of the modified work for download.
+//
+// 4. Any derivative version of this work is also covered by this license, including point 8.
+//
+// 5. Neither the name of the copyright holders nor the names of the authors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+//
+// 6. You agree that this licence is governed by and shall be construed in accordance
+//    with the laws of England and Wales.
+//
+// 7. You agree to submit all disputes arising out of or in connection with this licence
+//    to the exclusive jurisdiction of the Courts of England and Wales.
+//
+// Authors and copyright holders agree that:
+//
+// 8. This licence expires and the work covered by it is released into the
+//    public domain on 1st of February 2021
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "rpc/core_rpc_server_commands_defs.h"
+#include "storages/portable_storage.h"
+#include "storages/portable_storage_bin_stream.h"
+
+/*! Encodes or decodes a getblocks.bin sized response either through the
+ *  portable_storage section tree or through the streaming bin codec */
+template <bool ENCODE, bool STREAM>
+class test_epee_get_blocks_fast
+{
+  public:
+	static const size_t loop_count = 100;
+	static const size_t block_count = 100;
+	static const size_t txes_per_block = 20;
+
+	bool init()
+	{
+		for(size_t b = 0; b < block_count; ++b)
+		{
+			std::vector<cryptonote::blobdata> txs;
+			cryptonote::COMMAND_RPC_GET_BLOCKS_FAST::block_output_indices indices;
+			for(size_t t = 0; t < txes_per_block; ++t)
+			{
+				txs.push_back(cryptonote::blobdata(1500 + t * 100, char(t)));
+				indices.indices.emplace_back();
+				for(uint64_t o = 0; o < 2; ++o)
+					indices.indices.back().indices.push_back(b * 1000 + t * 2 + o);
+			}
+			m_res.blocks.emplace_back(cryptonote::blobdata(300, char(b)), std::move(txs));
+			m_res.output_indices.push_back(std::move(indices));
+		}
+		m_res.start_height = 1;
+		m_res.current_height = block_count + 1;
+		m_res.status = CORE_RPC_STATUS_OK;
+		m_res.untrusted = false;
+
+		epee::serialization::portable_storage ps;
+		m_res.store(ps);
+		return ps.store_to_binary(m_blob);
+	}
+
+	bool test()
+	{
+		return ENCODE ? encode() : decode();
+	}
+
+  private:
+	bool encode()
+	{
+		m_out.clear();
+		if(STREAM)
+		{
+			epee::serialization::portable_storage_bin_writer w(m_out);
+			m_res.store(w);
+			w.finish();
+		}
+		else
+		{
+			epee::serialization::portable_storage ps;
+			m_res.store(ps);
+			ps.store_to_binary(m_out);
+		}
+		return m_out.size() == m_blob.size();
+	}
+
+	bool decode()
+	{
+		cryptonote::COMMAND_RPC_GET_BLOCKS_FAST::response res;
+		if(STREAM)
+		{
+			epee::serialization::portable_storage_bin_reader r;
+			if(!r.load_from_binary(m_blob) || !res.load(r))
+				return false;
+		}
+		else
+		{
+			epee::serialization::portable_storage ps;
+			if(!ps.load_from_binary(m_blob) || !res.load(ps))
+				return false;
+		}
+		return res.blocks.size() == block_count && res.output_indices.size() == block_count;
+	}
+
+	cryptonote::COMMAND_RPC_GET_BLOCKS_FAST::response m_res;
+	std::string m_blob;
+	std::string m_out;
+};
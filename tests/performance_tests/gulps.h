@@ -0,0 +1,120 @@
+// Copyright (c) 2020, pasta Currency Project
+//
+// Portions of this file are available under BSD-3 license. Please see ORIGINAL-LICENSE for details
+// All rights reserved.
+//
+// Authors and copyright holders give permission for following:
+//
+// 1. Redistribution and use in source and binary forms WITHOUT modification.
+//
+// 2. Modification of the source form for your own personal use.
+//
+// As long as the following conditions are met:
+//
+// 3. You must not distribute modified copies of the work to third parties. This includes
+//    posting the work online, or hosting copies of the modified work for download.
+//
+// 4. Any derivative version of this work is also covered by this license, including point 8.
+//
+// 5. Neither the name of the copyright holders nor the names of the authors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+//
+// 6. You agree that this licence is governed by and shall be construed in accordance
+//    with the laws of England and Wales.
+//
+// 7. You agree to submit all disputes arising out of or in connection with this licence
+//    to the exclusive jurisdiction of the Courts of England and Wales.
+//
+// Authors and copyright holders agree that:
+//
+// 8. This licence expires and the work covered by it is released into the
+//    public domain on 1st of February 2021
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+#include "common/gulps.hpp"
+
+// Cost of a GULPS_LOG_L3 statement that no output is going to take, which is what
+// the Blockchain and BlockchainLMDB accessors pay on every call at the default level.
+// With gated = false the filter has no gate, so the message is formatted and fanned
+// out only to be thrown away by the filter, as it was before the level gates.
+template <bool gated, bool use_fmt>
+class test_gulps_disabled
+{
+  public:
+	static const size_t loop_count = 1000000;
+	static const size_t calls_per_test = 16;
+
+	bool init()
+	{
+		if(!log_level().parse_cat_string("*:WARN"))
+			return false;
+
+		std::unique_ptr<gulps::gulps_output> out(new gulps::gulps_mem_output());
+		if(gated)
+			out->add_filter(filter, gate);
+		else
+			out->add_filter(filter);
+		m_handle = gulps::inst().add_output(std::move(out));
+		m_height = 1234567;
+		m_hash = "0a5b4f2e9c7d";
+
+		// The gate has to close TRACE2 for the gated variant to measure anything useful
+		if(gated && gulps::inst().is_enabled(gulps::OUT_LOG_0, gulps::LEVEL_TRACE2))
+			return false;
+		return true;
+	}
+
+	~test_gulps_disabled()
+	{
+		gulps::inst().remove_output(m_handle);
+	}
+
+	bool test()
+	{
+		GULPS_CAT_MAJOR("perf_test");
+		for(size_t i = 0; i < calls_per_test; i++)
+		{
+			if(use_fmt)
+				GULPSF_LOG_L3("Fetching block {} with hash {}", m_height + i, m_hash);
+			else
+				GULPS_LOG_L3("Fetching block ", m_height + i, " with hash ", m_hash);
+		}
+		return true;
+	}
+
+  private:
+	static gulps_log_level& log_level()
+	{
+		static gulps_log_level level;
+		return level;
+	}
+
+	static bool filter(const gulps::message& msg, bool printed, bool logged)
+	{
+		return log_level().match_msg(msg);
+	}
+
+	static bool gate(gulps::output out, gulps::level lvl)
+	{
+		return log_level().may_match(lvl);
+	}
+
+	uint64_t m_handle;
+	uint64_t m_height;
+	std::string m_hash;
+};
@@ -45,6 +45,7 @@
 #include "crypto_ops.h"
 #include "derive_public_key.h"
 #include "derive_secret_key.h"
+#include "epee_serialization.h"
 #include "equality.h"
 #include "ge_frombytes_vartime.h"
 #include "ge_tobytes.h"
@@ -52,15 +53,19 @@
 #include "generate_key_image.h"
 #include "generate_key_image_helper.h"
 #include "generate_keypair.h"
+#include "gulps.h"
 #include "is_out_to_acc.h"
 #include "multiexp.h"
 #include "range_proof.h"
 #include "rct_mlsag.h"
 #include "rct_mlsag.h"
+#include "rct_point_cache.h"
 #include "sc_check.h"
 #include "sc_reduce32.h"
+#include "serialize_tx.h"
 #include "signature.h"
 #include "subaddress_expand.h"
+#include "threadpool.h"
 
 namespace po = boost::program_options;
 
@@ -133,6 +138,16 @@ int main(int argc, char **argv)
 	TEST_PERFORMANCE4(filter, p, test_check_tx_signature_aggregated_bulletproofs, 2, 2, 56, 16);
 	TEST_PERFORMANCE4(filter, p, test_check_tx_signature_aggregated_bulletproofs, 10, 2, 56, 16);
 
+	TEST_PERFORMANCE3(filter, p, test_serialize_tx, 11, 2, false);
+	TEST_PERFORMANCE3(filter, p, test_serialize_tx, 11, 2, true);
+	TEST_PERFORMANCE3(filter, p, test_serialize_tx, 11, 16, false);
+	TEST_PERFORMANCE3(filter, p, test_serialize_tx, 11, 16, true);
+
+	TEST_PERFORMANCE2(filter, p, test_epee_get_blocks_fast, true, false);
+	TEST_PERFORMANCE2(filter, p, test_epee_get_blocks_fast, true, true);
+	TEST_PERFORMANCE2(filter, p, test_epee_get_blocks_fast, false, false);
+	TEST_PERFORMANCE2(filter, p, test_epee_get_blocks_fast, false, true);
+
 	TEST_PERFORMANCE0(filter, p, test_is_out_to_acc);
 	TEST_PERFORMANCE0(filter, p, test_is_out_to_acc_precomp);
 	TEST_PERFORMANCE0(filter, p, test_generate_key_image_helper);
@@ -150,8 +165,28 @@ int main(int argc, char **argv)
 
 	TEST_PERFORMANCE2(filter, p, test_wallet2_expand_subaddresses, 50, 200);
 
+	TEST_PERFORMANCE2(filter, p, test_threadpool, legacy_threadpool, 16);
+	TEST_PERFORMANCE2(filter, p, test_threadpool, tools::threadpool, 16);
+	TEST_PERFORMANCE2(filter, p, test_threadpool, legacy_threadpool, 1024);
+	TEST_PERFORMANCE2(filter, p, test_threadpool, tools::threadpool, 1024);
+	TEST_PERFORMANCE2(filter, p, test_threadpool_nested, legacy_threadpool, 256);
+	TEST_PERFORMANCE2(filter, p, test_threadpool_nested, tools::threadpool, 256);
+
+	TEST_PERFORMANCE2(filter, p, test_gulps_disabled, false, false);
+	TEST_PERFORMANCE2(filter, p, test_gulps_disabled, true, false);
+	TEST_PERFORMANCE2(filter, p, test_gulps_disabled, false, true);
+	TEST_PERFORMANCE2(filter, p, test_gulps_disabled, true, true);
+
 	TEST_PERFORMANCE1(filter, p, test_cn_slow_hash, false);
 	TEST_PERFORMANCE1(filter, p, test_cn_slow_hash, true);
+	TEST_PERFORMANCE1(filter, p, test_cn_slow_hash_pages, false);
+	TEST_PERFORMANCE1(filter, p, test_cn_slow_hash_pages, true);
+	TEST_PERFORMANCE2(filter, p, test_cn_slow_hash_ways, cn_pow_hash_v2, 1);
+	TEST_PERFORMANCE2(filter, p, test_cn_slow_hash_ways, cn_pow_hash_v2, 2);
+	TEST_PERFORMANCE2(filter, p, test_cn_slow_hash_ways, cn_pow_hash_v2, 4);
+	TEST_PERFORMANCE2(filter, p, test_cn_slow_hash_ways, cn_pow_hash_v3, 1);
+	TEST_PERFORMANCE2(filter, p, test_cn_slow_hash_ways, cn_pow_hash_v3, 2);
+	TEST_PERFORMANCE2(filter, p, test_cn_slow_hash_ways, cn_pow_hash_v3, 4);
 	TEST_PERFORMANCE1(filter, p, test_cn_fast_hash, 32);
 	TEST_PERFORMANCE1(filter, p, test_cn_fast_hash, 16384);
 
@@ -164,6 +199,11 @@ int main(int argc, char **argv)
 	TEST_PERFORMANCE3(filter, p, test_ringct_mlsag, 1, 10, true);
 	TEST_PERFORMANCE3(filter, p, test_ringct_mlsag, 1, 100, true);
 
+	TEST_PERFORMANCE2(filter, p, test_ringct_point_cache, 11, false);
+	TEST_PERFORMANCE2(filter, p, test_ringct_point_cache, 11, true);
+	TEST_PERFORMANCE2(filter, p, test_ringct_point_cache, 25, false);
+	TEST_PERFORMANCE2(filter, p, test_ringct_point_cache, 25, true);
+
 	TEST_PERFORMANCE2(filter, p, test_equality, memcmp32, true);
 	TEST_PERFORMANCE2(filter, p, test_equality, memcmp32, false);
 	TEST_PERFORMANCE2(filter, p, test_equality, verify32, false);
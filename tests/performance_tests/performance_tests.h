@@ -191,6 +191,19 @@ class test_runner
 	std::vector<tools::PerformanceTimer> m_per_call_timers;
 };
 
+// Tests that hash several inputs per call declare hashes_per_call to get a H/s figure
+template <typename T>
+auto print_hash_rate(const test_runner<T> &runner, const Params &params, int) -> decltype(T::hashes_per_call, void())
+{
+	if(runner.elapsed_time() > 0)
+		std::cout << " (" << 1000.0 * T::hashes_per_call * T::loop_count * params.loop_multiplier / runner.elapsed_time() << " H/s)";
+}
+
+template <typename T>
+void print_hash_rate(const test_runner<T> &runner, const Params &params, long)
+{
+}
+
 template <typename T>
 void run_test(const std::string &filter, const Params &params, const char *test_name)
 {
@@ -239,6 +252,7 @@ void run_test(const std::string &filter, const Params &params, const char *test_
 			uint64_t stddev_ns = runner.standard_deviation_time_ns() / scale;
 			std::cout << " (min " << min_ns << " " << unit << ", median " << med_ns << " " << unit << ", std dev " << stddev_ns << " " << unit << ")";
 		}
+		print_hash_rate(runner, params, 0);
 		std::cout << std::endl;
 	}
 	else
@@ -0,0 +1,110 @@
+// Copyright (c) 2018, The Monero Project
+//
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this list of
+//    conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list
+//    of conditions and the following disclaimer in the documentation and/or other
+//    materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its contributors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+// Parts of this file are originally copyright (c) 2012-2013 The Cryptonote developers
+
+#pragma once
+
+#include "cryptonote_config.h"
+#include "ringct/point_cache.h"
+#include "ringct/rctSigs.h"
+#include <vector>
+
+// Verifies a batch of MLSAGs whose decoys are drawn from one output set,
+// skewed towards the newest outputs as wallets pick them. The point cache
+// is emptied before each batch, so only ring members shared within the
+// batch can be hits.
+template <size_t ring_size, bool cached>
+class test_ringct_point_cache
+{
+  public:
+	static const size_t loop_count = 10;
+	static const size_t outputs = 4096;
+	static const size_t signatures = 64;
+
+	bool init()
+	{
+		rct::point_cache::getInstance().set_capacity(cached ? CRYPTONOTE_RCT_POINT_CACHE_SIZE : 0);
+
+		std::vector<rct::ctkey> pool(outputs);
+		for(size_t n = 0; n < outputs; ++n)
+			std::tie(std::ignore, pool[n]) = rct::ctskpkGen(1);
+
+		for(size_t s = 0; s < signatures; ++s)
+		{
+			rct::ctkey in_sk, in_pk;
+			std::tie(in_sk, in_pk) = rct::ctskpkGen(1);
+			rct::key a = rct::skGen();
+			rct::key pseudo_out = rct::commit(1, a);
+			size_t index = rct::randpastaAmount(ring_size);
+
+			rct::ctkeyV ring(ring_size);
+			for(size_t i = 0; i < ring_size; ++i)
+			{
+				if(i == index)
+				{
+					ring[i] = in_pk;
+					continue;
+				}
+				double u = rct::randpastaAmount(1000000) / 1000000.0;
+				ring[i] = pool[outputs - 1 - (size_t)(outputs * u * u * u)];
+			}
+
+			sigs.push_back({rct::skGen(), ring, pseudo_out, rct::mgSig()});
+			sigs.back().mg = rct::proveRctMGSimple(sigs.back().message, ring, in_sk, a, pseudo_out, NULL, NULL, index, hw::get_device("default"));
+		}
+		return true;
+	}
+
+	~test_ringct_point_cache()
+	{
+		rct::point_cache::getInstance().set_capacity(CRYPTONOTE_RCT_POINT_CACHE_SIZE);
+	}
+
+	bool test()
+	{
+		rct::point_cache::getInstance().clear();
+		for(const signature &sig : sigs)
+		{
+			if(!rct::verRctMGSimple(sig.message, sig.mg, sig.ring, sig.pseudo_out))
+				return false;
+		}
+		return true;
+	}
+
+  private:
+	struct signature
+	{
+		rct::key message;
+		rct::ctkeyV ring;
+		rct::key pseudo_out;
+		rct::mgSig mg;
+	};
+
+	std::vector<signature> sigs;
+};
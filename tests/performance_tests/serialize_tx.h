@@ -0,0 +1,137 @@
+// Copyright (c) 2020, pasta Currency Project
+//
+// Portions of this file are available under BSD-3 license. Please see ORIGINAL-LICENSE for details
+// All rights reserved.
+//
+// Authors and copyright holders give permission for following:
+//
+// 1. Redistribution and use in source and binary forms WITHOUT modification.
+//
+// 2. Modification of the source form for your own personal use.
+//
+// As long as the following conditions are met:
+//
+// 3. You must not distribute modified copies of the work to third parties. This includes
+//    posting the work online, or hosting copies of the modified work for download.
+//
+// 4. Any derivative version of this work is also covered by this license, including point 8.
+//
+// 5. Neither the name of the copyright holders nor the names of the authors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+//
+// 6. You agree that this licence is governed by and shall be construed in accordance
+//    with the laws of England and Wales.
+//
+// 7. You agree to submit all disputes arising out of or in connection with this licence
+//    to the exclusive jurisdiction of the Courts of England and Wales.
+//
+// Authors and copyright holders agree that:
+//
+// 8. This licence expires and the work covered by it is released into the
+//    public domain on 1st of February 2021
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#pragma once
+
+#include <sstream>
+#include <vector>
+
+#include "cryptonote_basic/account.h"
+#include "cryptonote_basic/cryptonote_basic.h"
+#include "cryptonote_basic/cryptonote_format_utils.h"
+#include "cryptonote_core/cryptonote_tx_utils.h"
+#include "serialization/binary_archive.h"
+#include "serialization/binary_span_archive.h"
+
+#include "multi_tx_test_base.h"
+
+/*! Round trips a bulletproof tx through either the std::stream based
+ *  binary_archive or the span based binary_span_archive */
+template <size_t a_ring_size, size_t a_outputs, bool SPAN>
+class test_serialize_tx : private multi_tx_test_base<a_ring_size>
+{
+	static_assert(0 < a_ring_size, "ring_size must be greater than 0");
+
+  public:
+	static const size_t loop_count = 1000;
+	static const size_t ring_size = a_ring_size;
+	static const size_t outputs = a_outputs;
+	typedef multi_tx_test_base<a_ring_size> base_class;
+
+	bool init()
+	{
+		using namespace cryptonote;
+
+		if(!base_class::init())
+			return false;
+
+		m_alice.generate_new(0);
+
+		std::vector<tx_destination_entry> destinations;
+		destinations.push_back(tx_destination_entry(this->m_source_amount - outputs + 1, m_alice.get_keys().m_account_address, false));
+		for(size_t n = 1; n < outputs; ++n)
+			destinations.push_back(tx_destination_entry(1, m_alice.get_keys().m_account_address, false));
+
+		crypto::secret_key tx_key;
+		std::vector<crypto::secret_key> additional_tx_keys;
+		std::unordered_map<crypto::public_key, cryptonote::subaddress_index> subaddresses;
+		subaddresses[this->m_miners[this->real_source_idx].get_keys().m_account_address.m_spend_public_key] = {0, 0};
+		transaction tx;
+		if(!construct_tx_and_get_tx_key(this->m_miners[this->real_source_idx].get_keys(), subaddresses, this->m_sources, destinations, cryptonote::account_public_address{}, nullptr, tx, 0, tx_key, additional_tx_keys, true, nullptr))
+			return false;
+
+		m_blob = tx_to_blob(tx);
+		return true;
+	}
+
+	bool test()
+	{
+		cryptonote::transaction tx;
+		return SPAN ? round_trip_span(tx) : round_trip_stream(tx);
+	}
+
+  private:
+	bool round_trip_stream(cryptonote::transaction &tx)
+	{
+		std::stringstream iss;
+		iss << m_blob;
+		binary_archive<false> iar(iss);
+		if(!::serialization::serialize(iar, tx))
+			return false;
+
+		std::stringstream oss;
+		binary_archive<true> oar(oss);
+		if(!::serialization::serialize(oar, tx))
+			return false;
+		return oss.str().size() == m_blob.size();
+	}
+
+	bool round_trip_span(cryptonote::transaction &tx)
+	{
+		::serialization::span_istream iss(epee::to_byte_span(epee::to_span(m_blob)));
+		binary_span_archive<false> iar(iss);
+		if(!::serialization::serialize(iar, tx))
+			return false;
+
+		m_out.clear();
+		::serialization::blob_ostream oss(m_out);
+		binary_span_archive<true> oar(oss);
+		if(!::serialization::serialize(oar, tx))
+			return false;
+		return m_out.size() == m_blob.size();
+	}
+
+	cryptonote::account_base m_alice;
+	cryptonote::blobdata m_blob;
+	cryptonote::blobdata m_out;
+};
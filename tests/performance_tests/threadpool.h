@@ -0,0 +1,240 @@
+// Copyright (c) 2020, pasta Currency Project
+//
+// Portions of this file are available under BSD-3 license. Please see ORIGINAL-LICENSE for details
+// All rights reserved.
+//
+// Authors and copyright holders give permission for following:
+//
+// 1. Redistribution and use in source and binary forms WITHOUT modification.
+//
+// 2. Modification of the source form for your own personal use.
+//
+// As long as the following conditions are met:
+//
+// 3. You must not distribute modified copies of the work to third parties. This includes
+//    posting the work online, or hosting copies of the modified work for download.
+//
+// 4. Any derivative version of this work is also covered by this license, including point 8.
+//
+// 5. Neither the name of the copyright holders nor the names of the authors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+//
+// 6. You agree that this licence is governed by and shall be construed in accordance
+//    with the laws of England and Wales.
+//
+// 7. You agree to submit all disputes arising out of or in connection with this licence
+//    to the exclusive jurisdiction of the Courts of England and Wales.
+//
+// Authors and copyright holders agree that:
+//
+// 8. This licence expires and the work covered by it is released into the
+//    public domain on 1st of February 2021
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#pragma once
+
+#include <atomic>
+#include <deque>
+#include <functional>
+#include <vector>
+
+#include <boost/thread/condition_variable.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/thread.hpp>
+
+#include "common/threadpool.h"
+#include "common/util.h"
+
+// The single queue pool tools::threadpool was before it did work stealing,
+// kept here as the baseline for the throughput comparison
+class legacy_threadpool
+{
+  public:
+	static legacy_threadpool &getInstance()
+	{
+		static legacy_threadpool instance;
+		return instance;
+	}
+
+	class waiter
+	{
+		boost::mutex mt;
+		boost::condition_variable cv;
+		int num;
+
+	  public:
+		waiter() : num(0) {}
+
+		void inc()
+		{
+			const boost::unique_lock<boost::mutex> lock(mt);
+			num++;
+		}
+
+		void dec()
+		{
+			const boost::unique_lock<boost::mutex> lock(mt);
+			num--;
+			if(!num)
+				cv.notify_one();
+		}
+
+		void wait()
+		{
+			boost::unique_lock<boost::mutex> lock(mt);
+			while(num)
+				cv.wait(lock);
+		}
+	};
+
+	void submit(waiter *obj, std::function<void()> f)
+	{
+		entry e = {obj, f};
+		boost::unique_lock<boost::mutex> lock(mutex);
+		if((active == max && !queue.empty()) || depth() > 0)
+		{
+			lock.unlock();
+			++depth();
+			f();
+			--depth();
+		}
+		else
+		{
+			if(obj)
+				obj->inc();
+			queue.push_back(e);
+			has_work.notify_one();
+		}
+	}
+
+  private:
+	struct entry
+	{
+		waiter *wo;
+		std::function<void()> f;
+	};
+
+	static int &depth()
+	{
+		static thread_local int d = 0;
+		return d;
+	}
+
+	legacy_threadpool() : active(0), running(true)
+	{
+		max = tools::get_max_concurrency();
+		for(int i = 0; i < max; i++)
+			threads.push_back(boost::thread(boost::bind(&legacy_threadpool::run, this)));
+	}
+
+	~legacy_threadpool()
+	{
+		{
+			const boost::unique_lock<boost::mutex> lock(mutex);
+			running = false;
+			has_work.notify_all();
+		}
+		for(size_t i = 0; i < threads.size(); i++)
+			threads[i].join();
+	}
+
+	void run()
+	{
+		boost::unique_lock<boost::mutex> lock(mutex);
+		while(running)
+		{
+			while(queue.empty() && running)
+				has_work.wait(lock);
+			if(!running)
+				break;
+
+			active++;
+			entry e = queue.front();
+			queue.pop_front();
+			lock.unlock();
+			++depth();
+			e.f();
+			--depth();
+			if(e.wo)
+				e.wo->dec();
+			lock.lock();
+			active--;
+		}
+	}
+
+	std::deque<entry> queue;
+	boost::condition_variable has_work;
+	boost::mutex mutex;
+	std::vector<boost::thread> threads;
+	int active;
+	int max;
+	bool running;
+};
+
+// Submits a batch of tiny tasks and waits for all of them, as block
+// verification does with one task per ring or per output
+template <typename pool, size_t tasks>
+class test_threadpool
+{
+  public:
+	static const size_t loop_count = 1000;
+
+	bool init()
+	{
+		pool::getInstance();
+		return true;
+	}
+
+	bool test()
+	{
+		pool &tpool = pool::getInstance();
+		typename pool::waiter waiter;
+		std::atomic<size_t> sum(0);
+		for(size_t i = 0; i < tasks; i++)
+			tpool.submit(&waiter, [&sum, i] { sum += i; });
+		waiter.wait();
+		return sum == tasks * (tasks - 1) / 2;
+	}
+};
+
+// Same, with every task fanning out into nested subtasks
+template <typename pool, size_t tasks>
+class test_threadpool_nested
+{
+  public:
+	static const size_t loop_count = 100;
+
+	bool init()
+	{
+		pool::getInstance();
+		return true;
+	}
+
+	bool test()
+	{
+		pool &tpool = pool::getInstance();
+		typename pool::waiter waiter;
+		std::atomic<size_t> sum(0);
+		for(size_t i = 0; i < tasks; i++)
+		{
+			tpool.submit(&waiter, [&tpool, &sum] {
+				typename pool::waiter inner;
+				for(size_t j = 0; j < 16; j++)
+					tpool.submit(&inner, [&sum] { sum++; });
+				inner.wait();
+			});
+		}
+		waiter.wait();
+		return sum == tasks * 16;
+	}
+};
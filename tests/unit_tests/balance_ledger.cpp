@@ -0,0 +1,120 @@
+// Copyright (c) 2020, pasta Currency Project
+//
+// Portions of this file are available under BSD-3 license. Please see ORIGINAL-LICENSE for details
+// All rights reserved.
+//
+// Authors and copyright holders give permission for following:
+//
+// 1. Redistribution and use in source and binary forms WITHOUT modification.
+//
+// 2. Modification of the source form for your own personal use.
+//
+// As long as the following conditions are met:
+//
+// 3. You must not distribute modified copies of the work to third parties. This includes
+//    posting the work online, or hosting copies of the modified work for download.
+//
+// 4. Any derivative version of this work is also covered by this license, including point 8.
+//
+// 5. Neither the name of the copyright holders nor the names of the authors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+//
+// 6. You agree that this licence is governed by and shall be construed in accordance
+//    with the laws of England and Wales.
+//
+// 7. You agree to submit all disputes arising out of or in connection with this licence
+//    to the exclusive jurisdiction of the Courts of England and Wales.
+//
+// Authors and copyright holders agree that:
+//
+// 8. This licence expires and the work covered by it is released into the
+//    public domain on 1st of February 2021
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "gtest/gtest.h"
+
+#include "wallet/balance_ledger.h"
+
+namespace
+{
+cryptonote::subaddress_index idx(uint32_t major, uint32_t minor)
+{
+	return {major, minor};
+}
+}
+
+TEST(balance_ledger, sums_per_subaddress_and_account)
+{
+	tools::balance_ledger l;
+	l.set_height(100);
+	l.set(0, idx(0, 0), 10, 50, false);
+	l.set(1, idx(0, 3), 20, 50, false);
+	l.set(2, idx(1, 0), 40, 150, false);
+	l.set(3, idx(1, 0), 80, 50, true);
+
+	ASSERT_EQ(l.account(0).balance, 30);
+	ASSERT_EQ(l.account(0).unlocked, 30);
+	ASSERT_EQ(l.account(1).balance, 40);
+	ASSERT_EQ(l.account(1).unlocked, 0);
+	ASSERT_EQ(l.account(7).balance, 0);
+	ASSERT_EQ(l.all().balance, 70);
+	ASSERT_EQ(l.all().unlocked, 30);
+
+	const auto &minors = l.subaddresses(0);
+	ASSERT_EQ(minors.size(), 2);
+	ASSERT_EQ(minors.at(3).balance, 20);
+	ASSERT_EQ(l.subaddresses(1).at(0).unlocked_count, 0);
+}
+
+TEST(balance_ledger, spend_and_unspend)
+{
+	tools::balance_ledger l;
+	l.set_height(100);
+	l.set(0, idx(0, 1), 10, 50, false);
+	l.set(0, idx(0, 1), 10, 50, true);
+	ASSERT_EQ(l.account(0).balance, 0);
+	ASSERT_TRUE(l.subaddresses(0).empty());
+
+	l.set(0, idx(0, 1), 10, 50, false);
+	ASSERT_EQ(l.account(0).balance, 10);
+	ASSERT_EQ(l.account(0).unlocked, 10);
+
+	// a replaced output moves its amount and unlock height
+	l.set(0, idx(0, 2), 15, 120, false);
+	ASSERT_EQ(l.account(0).balance, 15);
+	ASSERT_EQ(l.account(0).unlocked, 0);
+	ASSERT_EQ(l.subaddresses(0).count(1), 0);
+}
+
+TEST(balance_ledger, unlocks_with_height_and_relocks_on_reorg)
+{
+	tools::balance_ledger l;
+	for(size_t i = 0; i < 10; ++i)
+		l.set(i, idx(0, 0), 1, 10 + i, false);
+
+	ASSERT_EQ(l.all().unlocked, 0);
+	l.set_height(14);
+	ASSERT_EQ(l.all().unlocked, 5);
+	l.set_height(30);
+	ASSERT_EQ(l.all().unlocked, 10);
+	l.set_height(12);
+	ASSERT_EQ(l.all().unlocked, 3);
+	ASSERT_EQ(l.all().balance, 10);
+
+	l.truncate(4);
+	ASSERT_EQ(l.size(), 4);
+	ASSERT_EQ(l.all().balance, 4);
+	ASSERT_EQ(l.all().unlocked, 3);
+	l.set_height(13);
+	ASSERT_EQ(l.all().unlocked, 4);
+}
@@ -79,7 +79,7 @@ class test_core
 	bool cleanup_handle_incoming_blocks(bool force_sync = false) { return true; }
 	uint64_t get_target_blockchain_height() const { return 1; }
 	size_t get_block_sync_size(uint64_t height) const { return BLOCKS_SYNCHRONIZING_DEFAULT_COUNT; }
-	virtual void on_transaction_relayed(const cryptonote::blobdata &tx) {}
+	virtual void on_transactions_relayed(const std::vector<crypto::hash> &tx_hashes) {}
 	cryptonote::network_type get_nettype() const { return cryptonote::MAINNET; }
 	bool get_pool_transaction(const crypto::hash &id, cryptonote::blobdata &tx_blob) const { return false; }
 	bool pool_has_tx(const crypto::hash &txid) const { return false; }
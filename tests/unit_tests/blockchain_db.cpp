@@ -448,4 +448,129 @@ TYPED_TEST(BlockchainDBTest, RetrieveBlockData)
 	ASSERT_HASH_EQ(get_block_hash(this->m_blocks[1]), hashes[1]);
 }
 
+TYPED_TEST(BlockchainDBTest, OutputDistribution)
+{
+	boost::filesystem::path tempPath = boost::filesystem::temp_directory_path() / boost::filesystem::unique_path();
+	std::string dirPath = tempPath.string();
+
+	this->set_prefix(dirPath);
+
+	// make sure open does not throw
+	ASSERT_NO_THROW(this->m_db->open(dirPath));
+	this->get_filenames();
+	this->init_hard_fork();
+
+	std::vector<uint64_t> counts;
+	for(size_t i = 0; i < 2; ++i)
+	{
+		ASSERT_NO_THROW(this->m_db->add_block(this->m_blocks[i], t_sizes[i], t_diffs[i], t_coins[i], this->m_txs[i]));
+		uint64_t count = this->m_blocks[i].miner_tx.vout.size();
+		for(const auto &tx : this->m_txs[i])
+			count += tx.vout.size();
+		counts.push_back(count);
+	}
+
+	std::vector<uint64_t> distribution;
+	uint64_t base = 0;
+	ASSERT_TRUE(this->m_db->get_output_distribution(0, 0, 0, distribution, base));
+	ASSERT_EQ(0, base);
+	ASSERT_EQ(counts, distribution);
+
+	ASSERT_TRUE(this->m_db->get_output_distribution(0, 1, 0, distribution, base));
+	ASSERT_EQ(counts[0], base);
+	ASSERT_EQ(1, distribution.size());
+	ASSERT_EQ(counts[1], distribution[0]);
+
+	ASSERT_FALSE(this->m_db->get_output_distribution(0, 2, 0, distribution, base));
+
+	// the distribution follows the chain when blocks are popped
+	block blk;
+	std::vector<transaction> txs;
+	ASSERT_NO_THROW(this->m_db->pop_block(blk, txs));
+	ASSERT_TRUE(this->m_db->get_output_distribution(0, 0, 0, distribution, base));
+	ASSERT_EQ(1, distribution.size());
+	ASSERT_EQ(counts[0], distribution[0]);
+}
+
+TYPED_TEST(BlockchainDBTest, PrunedTxBlobs)
+{
+	boost::filesystem::path tempPath = boost::filesystem::temp_directory_path() / boost::filesystem::unique_path();
+	std::string dirPath = tempPath.string();
+
+	this->set_prefix(dirPath);
+
+	// make sure open does not throw
+	ASSERT_NO_THROW(this->m_db->open(dirPath));
+	this->get_filenames();
+	this->init_hard_fork();
+
+	for(size_t i = 0; i < 2; ++i)
+		ASSERT_NO_THROW(this->m_db->add_block(this->m_blocks[i], t_sizes[i], t_diffs[i], t_coins[i], this->m_txs[i]));
+
+	for(size_t i = 0; i < 2; ++i)
+	{
+		for(auto &tx : this->m_txs[i])
+		{
+			const crypto::hash h = get_transaction_hash(tx);
+			blobdata full, pruned;
+			std::vector<uint64_t> indices;
+			ASSERT_TRUE(this->m_db->get_tx_blob(h, full));
+			ASSERT_EQ(t_serializable_object_to_blob(tx), full);
+			ASSERT_TRUE(this->m_db->get_pruned_tx_blob(h, pruned));
+			ASSERT_EQ(get_pruned_tx_blob(tx), pruned);
+			ASSERT_TRUE(this->m_db->get_pruned_tx_blob_indexed(h, pruned, indices));
+			ASSERT_EQ(get_pruned_tx_blob(tx), pruned);
+			ASSERT_EQ(tx.vout.size(), indices.size());
+		}
+	}
+
+	blobdata bd;
+	ASSERT_FALSE(this->m_db->get_pruned_tx_blob(crypto::null_hash, bd));
+}
+
+TYPED_TEST(BlockchainDBTest, CumulativeTotals)
+{
+	boost::filesystem::path tempPath = boost::filesystem::temp_directory_path() / boost::filesystem::unique_path();
+	std::string dirPath = tempPath.string();
+
+	this->set_prefix(dirPath);
+
+	// make sure open does not throw
+	ASSERT_NO_THROW(this->m_db->open(dirPath));
+	this->get_filenames();
+	this->init_hard_fork();
+
+	uint64_t emission = 0, fees = 0;
+	std::vector<uint64_t> emissions, total_fees;
+	for(size_t i = 0; i < 2; ++i)
+	{
+		ASSERT_NO_THROW(this->m_db->add_block(this->m_blocks[i], t_sizes[i], t_diffs[i], t_coins[i], this->m_txs[i]));
+		uint64_t block_fees = 0;
+		for(const auto &tx : this->m_txs[i])
+			block_fees += get_tx_fee(tx);
+		emission += get_outs_money_amount(this->m_blocks[i].miner_tx) - block_fees;
+		fees += block_fees;
+		emissions.push_back(emission);
+		total_fees.push_back(fees);
+	}
+
+	for(size_t i = 0; i < 2; ++i)
+	{
+		ASSERT_NO_THROW(this->m_db->get_block_cumulative_totals(i, emission, fees));
+		ASSERT_EQ(emissions[i], emission);
+		ASSERT_EQ(total_fees[i], fees);
+	}
+	ASSERT_THROW(this->m_db->get_block_cumulative_totals(2, emission, fees), BLOCK_DNE);
+
+	// a popped block takes its totals with it, and re-adding it restores them
+	block blk;
+	std::vector<transaction> txs;
+	ASSERT_NO_THROW(this->m_db->pop_block(blk, txs));
+	ASSERT_THROW(this->m_db->get_block_cumulative_totals(1, emission, fees), BLOCK_DNE);
+	ASSERT_NO_THROW(this->m_db->add_block(this->m_blocks[1], t_sizes[1], t_diffs[1], t_coins[1], this->m_txs[1]));
+	ASSERT_NO_THROW(this->m_db->get_block_cumulative_totals(1, emission, fees));
+	ASSERT_EQ(emissions[1], emission);
+	ASSERT_EQ(total_fees[1], fees);
+}
+
 } // anonymous namespace
@@ -0,0 +1,158 @@
+// Copyright (c) 2020, pasta Currency Project
+//
+// Portions of this file are available under BSD-3 license. Please see ORIGINAL-LICENSE for details
+// All rights reserved.
+//
+// Authors and copyright holders give permission for following:
+//
+// 1. Redistribution and use in source and binary forms WITHOUT modification.
+//
+// 2. Modification of the source form for your own personal use.
+//
+// As long as the following conditions are met:
+//
+// 3. You must not distribute modified copies of the work to third parties. This includes
+//    posting the work online, or hosting copies of the modified work for download.
+//
+// 4. Any derivative version of this work is also covered by this license, including point 8.
+//
+// 5. Neither the name of the copyright holders nor the names of the authors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+//
+// 6. You agree that this licence is governed by and shall be construed in accordance
+//    with the laws of England and Wales.
+//
+// 7. You agree to submit all disputes arising out of or in connection with this licence
+//    to the exclusive jurisdiction of the Courts of England and Wales.
+//
+// Authors and copyright holders agree that:
+//
+// 8. This licence expires and the work covered by it is released into the
+//    public domain on 1st of February 2021
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "gtest/gtest.h"
+
+#include "crypto/hash.h"
+#include "crypto/pow_hash/cn_slow_hash.hpp"
+#include "cryptonote_basic/cryptonote_format_utils.h"
+#include <memory>
+#include <vector>
+
+namespace
+{
+// Inputs of equal length that differ in a few bytes, like block blobs differing in nonce
+std::vector<std::string> make_inputs(size_t count, size_t len)
+{
+	std::vector<std::string> in(count, std::string(len, '\0'));
+	for(size_t i = 0; i < count; i++)
+		for(size_t j = 0; j < len; j++)
+			in[i][j] = static_cast<char>(j * 7 + i * 13 + 1);
+	return in;
+}
+
+// Digest of every lane of hash_multi must match hash() on a fresh context
+template <typename ctx_t>
+void check_hash_multi(std::vector<std::unique_ptr<ctx_t>> &ctx, size_t ways)
+{
+	const std::vector<std::string> in = make_inputs(ways, 76);
+	std::vector<crypto::hash> multi(ways), single(ways);
+	const void *in_ptr[ctx_t::max_ways];
+	void *out_ptr[ctx_t::max_ways];
+	ctx_t *ctx_ptr[ctx_t::max_ways];
+	for(size_t i = 0; i < ways; i++)
+	{
+		in_ptr[i] = in[i].data();
+		out_ptr[i] = multi[i].data;
+		ctx_ptr[i] = ctx[i].get();
+	}
+	ctx_t::hash_multi(ctx_ptr, in_ptr, in[0].size(), out_ptr, ways);
+
+	for(size_t i = 0; i < ways; i++)
+	{
+		ctx[0]->hash(in[i].data(), in[i].size(), single[i].data);
+		ASSERT_EQ(single[i], multi[i]) << "lane " << i << " of " << ways;
+	}
+}
+
+std::vector<std::unique_ptr<cn_pow_hash_v2>> make_contexts()
+{
+	std::vector<std::unique_ptr<cn_pow_hash_v2>> ctx;
+	for(size_t i = 0; i < cn_pow_hash_v2::max_ways; i++)
+		ctx.emplace_back(new cn_pow_hash_v2());
+	return ctx;
+}
+}
+
+TEST(cn_slow_hash_multi, cn_v1)
+{
+	std::vector<std::unique_ptr<cn_pow_hash_v2>> base = make_contexts();
+	std::vector<std::unique_ptr<cn_pow_hash_v1>> ctx;
+	for(auto &c : base)
+		ctx.emplace_back(new cn_pow_hash_v1(cn_pow_hash_v1::make_borrowed(*c)));
+	for(size_t ways : {1, 2, 4})
+		check_hash_multi(ctx, ways);
+}
+
+TEST(cn_slow_hash_multi, cn_heavy)
+{
+	std::vector<std::unique_ptr<cn_pow_hash_v2>> ctx = make_contexts();
+	for(size_t ways : {1, 2, 4})
+		check_hash_multi(ctx, ways);
+}
+
+TEST(cn_slow_hash_multi, cn_gpu)
+{
+	std::vector<std::unique_ptr<cn_pow_hash_v2>> base = make_contexts();
+	std::vector<std::unique_ptr<cn_pow_hash_v3>> ctx;
+	for(auto &c : base)
+		ctx.emplace_back(new cn_pow_hash_v3(cn_pow_hash_v3::make_borrowed_v3(*c)));
+	for(size_t ways : {1, 2, 4})
+		check_hash_multi(ctx, ways);
+}
+
+TEST(cn_slow_hash_multi, block_template_lanes)
+{
+	std::vector<std::unique_ptr<cn_pow_hash_v2>> ctx = make_contexts();
+	cn_pow_hash_v2 *ctx_ptr[cn_pow_hash_v2::max_ways];
+	for(size_t i = 0; i < ctx.size(); i++)
+		ctx_ptr[i] = ctx[i].get();
+
+	// mainnet major versions hashed with cn_v1, cn_heavy and cn_gpu
+	for(uint8_t major_version : {1, 3, 6})
+	{
+		cryptonote::block b = AUTO_VAL_INIT(b);
+		b.major_version = major_version;
+		b.minor_version = major_version;
+		b.timestamp = 1500000000;
+		const cryptonote::block_hashing_template base(cryptonote::MAINNET, b);
+
+		for(size_t ways : {1, 2, 4})
+		{
+			std::vector<cryptonote::block_hashing_template> tpl(ways, base);
+			for(size_t i = 0; i < ways; i++)
+				tpl[i].set_nonce(1000 + i);
+
+			std::vector<crypto::hash> multi(ways);
+			cryptonote::block_hashing_template::get_longhash_multi(tpl.data(), ctx_ptr, multi.data(), ways);
+
+			for(size_t i = 0; i < ways; i++)
+			{
+				b.nonce = 1000 + i;
+				crypto::hash single;
+				ASSERT_TRUE(cryptonote::get_block_longhash(cryptonote::MAINNET, b, *ctx[0], single));
+				ASSERT_EQ(single, multi[i]) << "version " << (int)major_version << " lane " << i << " of " << ways;
+			}
+		}
+	}
+}
@@ -108,6 +108,34 @@ TEST(Crypto, derive_subaddress_public_key_64)
 		ASSERT_EQ(memcmp(derived_key[i], result_key.data, 32), 0);
 	}
 }
+
+TEST(Crypto, derive_subaddress_public_keys_64)
+{
+	using namespace crypto;
+	std::vector<public_key> pks(9);
+	std::vector<key_derivation> dks(9);
+	std::vector<size_t> indices(9, 0);
+	for(int i = 0; i < 8; ++i)
+	{
+		memcpy(pks[i < 4 ? i : i + 1].data, out_key[i], 32u);
+		memcpy(dks[i < 4 ? i : i + 1].data, derivation[i], 32u);
+	}
+	// not a point
+	memset(pks[4].data, 0xff, 32u);
+	pks[4].data[31] = 0x7f;
+
+	std::vector<public_key> result_keys;
+	std::vector<bool> results;
+	derive_subaddress_public_keys_64(pks, dks, indices, result_keys, results);
+
+	ASSERT_EQ(result_keys.size(), 9u);
+	ASSERT_FALSE(results[4]);
+	for(int i = 0; i < 8; ++i)
+	{
+		ASSERT_TRUE(results[i < 4 ? i : i + 1]);
+		ASSERT_EQ(memcmp(derived_key[i], result_keys[i < 4 ? i : i + 1].data, 32), 0);
+	}
+}
 #endif
 
 namespace
@@ -178,4 +206,31 @@ TEST(Crypto, generate_key_derivation_64)
 		ASSERT_EQ(memcmp(res_derived_key[i], result_key.data, 32), 0);
 	}
 }
+
+TEST(Crypto, generate_key_derivations_64)
+{
+	using namespace crypto;
+	// keys 0-2 and 3-4 share their secret key
+	for(int first : {0, 3})
+	{
+		int last = first == 0 ? 3 : 5;
+		secret_key sk;
+		memcpy(sk.data, sec_key[first], 32u);
+
+		std::vector<public_key> pks(last - first);
+		for(int i = first; i < last; ++i)
+			memcpy(pks[i - first].data, pub_key[i], 32u);
+
+		std::vector<key_derivation> result_keys;
+		std::vector<bool> results;
+		generate_key_derivations_64(pks, sk, result_keys, results);
+
+		ASSERT_EQ(result_keys.size(), pks.size());
+		for(int i = first; i < last; ++i)
+		{
+			ASSERT_TRUE(results[i - first]);
+			ASSERT_EQ(memcmp(res_derived_key[i], result_keys[i - first].data, 32), 0);
+		}
+	}
+}
 #endif
@@ -0,0 +1,114 @@
+// Copyright (c) 2020, pasta Currency Project
+//
+// Portions of this file are available under BSD-3 license. Please see ORIGINAL-LICENSE for details
+// All rights reserved.
+//
+// Authors and copyright holders give permission for following:
+//
+// 1. Redistribution and use in source and binary forms WITHOUT modification.
+//
+// 2. Modification of the source form for your own personal use.
+//
+// As long as the following conditions are met:
+//
+// 3. You must not distribute modified copies of the work to third parties. This includes
+//    posting the work online, or hosting copies of the modified work for download.
+//
+// 4. Any derivative version of this work is also covered by this license, including point 8.
+//
+// 5. Neither the name of the copyright holders nor the names of the authors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+//
+// 6. You agree that this licence is governed by and shall be construed in accordance
+//    with the laws of England and Wales.
+//
+// 7. You agree to submit all disputes arising out of or in connection with this licence
+//    to the exclusive jurisdiction of the Courts of England and Wales.
+//
+// Authors and copyright holders agree that:
+//
+// 8. This licence expires and the work covered by it is released into the
+//    public domain on 1st of February 2021
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "gtest/gtest.h"
+
+#include "wallet/daemon_rpc_pool.h"
+#include <atomic>
+#include <memory>
+#include <thread>
+
+TEST(daemon_rpc_pool, rejects_bad_address)
+{
+	tools::daemon_rpc_pool pool;
+	ASSERT_FALSE(pool.set_server("", boost::none));
+	ASSERT_TRUE(pool.set_server("http://127.0.0.1:1", boost::none));
+}
+
+TEST(daemon_rpc_pool, reuses_idle_connection)
+{
+	tools::daemon_rpc_pool pool(2);
+	ASSERT_TRUE(pool.set_server("http://127.0.0.1:1", boost::none));
+
+	epee::net_utils::http::http_simple_client *first;
+	{
+		tools::daemon_rpc_pool::lease conn = pool.acquire();
+		first = &*conn;
+		ASSERT_EQ(conn->get_port(), "1");
+	}
+
+	tools::daemon_rpc_pool::lease conn = pool.acquire();
+	ASSERT_EQ(&*conn, first);
+}
+
+TEST(daemon_rpc_pool, leases_are_bounded)
+{
+	tools::daemon_rpc_pool pool(2);
+	ASSERT_TRUE(pool.set_server("http://127.0.0.1:1", boost::none));
+
+	std::unique_ptr<tools::daemon_rpc_pool::lease> a(new tools::daemon_rpc_pool::lease(pool.acquire()));
+	tools::daemon_rpc_pool::lease b = pool.acquire();
+	ASSERT_NE(&**a, &*b);
+	epee::net_utils::http::http_simple_client *released = &**a;
+
+	std::atomic<bool> got_third(false);
+	epee::net_utils::http::http_simple_client *third = nullptr;
+	std::thread waiter([&]() {
+		tools::daemon_rpc_pool::lease c = pool.acquire();
+		third = &*c;
+		got_third = true;
+	});
+
+	std::this_thread::sleep_for(std::chrono::milliseconds(100));
+	ASSERT_FALSE(got_third);
+
+	a.reset();
+	waiter.join();
+	ASSERT_TRUE(got_third);
+	ASSERT_EQ(third, released);
+}
+
+TEST(daemon_rpc_pool, leased_connection_follows_new_server)
+{
+	tools::daemon_rpc_pool pool(1);
+	ASSERT_TRUE(pool.set_server("http://127.0.0.1:1", boost::none));
+
+	{
+		tools::daemon_rpc_pool::lease conn = pool.acquire();
+		ASSERT_TRUE(pool.set_server("http://127.0.0.1:2", boost::none));
+		ASSERT_EQ(conn->get_port(), "1");
+	}
+
+	tools::daemon_rpc_pool::lease conn = pool.acquire();
+	ASSERT_EQ(conn->get_port(), "2");
+}
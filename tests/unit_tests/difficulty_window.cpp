@@ -0,0 +1,114 @@
+// Copyright (c) 2020, pasta Currency Project
+//
+// Portions of this file are available under BSD-3 license. Please see ORIGINAL-LICENSE for details
+// All rights reserved.
+//
+// Authors and copyright holders give permission for following:
+//
+// 1. Redistribution and use in source and binary forms WITHOUT modification.
+//
+// 2. Modification of the source form for your own personal use.
+//
+// As long as the following conditions are met:
+//
+// 3. You must not distribute modified copies of the work to third parties. This includes
+//    posting the work online, or hosting copies of the modified work for download.
+//
+// 4. Any derivative version of this work is also covered by this license, including point 8.
+//
+// 5. Neither the name of the copyright holders nor the names of the authors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+//
+// 6. You agree that this licence is governed by and shall be construed in accordance
+//    with the laws of England and Wales.
+//
+// 7. You agree to submit all disputes arising out of or in connection with this licence
+//    to the exclusive jurisdiction of the Courts of England and Wales.
+//
+// Authors and copyright holders agree that:
+//
+// 8. This licence expires and the work covered by it is released into the
+//    public domain on 1st of February 2021
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "gtest/gtest.h"
+
+#include "cryptonote_core/difficulty_window.h"
+
+namespace
+{
+void check_range(const cryptonote::difficulty_window &w, uint64_t begin, uint64_t end)
+{
+	std::vector<uint64_t> timestamps;
+	std::vector<cryptonote::difficulty_type> difficulties;
+	ASSERT_TRUE(w.covers(begin, end));
+	w.copy(begin, end, timestamps, difficulties);
+	ASSERT_EQ(timestamps.size(), end - begin);
+	for(uint64_t h = begin; h < end; ++h)
+	{
+		ASSERT_EQ(timestamps[h - begin], h * 10);
+		ASSERT_EQ(difficulties[h - begin], h * 100);
+	}
+}
+}
+
+TEST(difficulty_window, follows_pushes)
+{
+	cryptonote::difficulty_window w(8);
+	ASSERT_EQ(w.height(), 0);
+	w.reset(1);
+	for(uint64_t h = 1; h < 6; ++h)
+		w.push(h * 10, h * 100);
+	ASSERT_EQ(w.height(), 6);
+	ASSERT_EQ(w.size(), 5);
+	check_range(w, 1, 6);
+	ASSERT_FALSE(w.covers(0, 6));
+	ASSERT_FALSE(w.covers(1, 7));
+}
+
+TEST(difficulty_window, wraps_around)
+{
+	cryptonote::difficulty_window w(8);
+	w.reset(1);
+	for(uint64_t h = 1; h < 30; ++h)
+		w.push(h * 10, h * 100);
+	ASSERT_EQ(w.size(), 8);
+	ASSERT_EQ(w.back_timestamp(), 290);
+	ASSERT_EQ(w.back_cumulative_difficulty(), 2900);
+	check_range(w, 22, 30);
+	check_range(w, 24, 27);
+	ASSERT_FALSE(w.covers(21, 30));
+}
+
+TEST(difficulty_window, pops_and_forks)
+{
+	cryptonote::difficulty_window w(8);
+	w.reset(1);
+	for(uint64_t h = 1; h < 20; ++h)
+		w.push(h * 10, h * 100);
+
+	// a reorg pops some blocks and pushes the new ones
+	w.pop();
+	w.pop();
+	ASSERT_EQ(w.height(), 18);
+	check_range(w, 12, 18);
+	w.push(180, 1800);
+	check_range(w, 12, 19);
+
+	// an alt chain branching at 15 takes the main chain part below it
+	check_range(w, 12, 15);
+
+	w.clear();
+	ASSERT_EQ(w.height(), 0);
+	ASSERT_FALSE(w.covers(12, 15));
+}
@@ -146,6 +146,12 @@ class test_connection : public epee::net_utils::i_service_endpoint
 		return m_send_return;
 	}
 
+	virtual bool do_send_buffer(const epee::net_utils::shared_send_buffer &buf)
+	{
+		m_last_send_buffer = buf;
+		return do_send(buf->data(), buf->size());
+	}
+
 	virtual bool close() { /*std::cout << "test_connection::close()" << std::endl; */ return true; }
 	virtual bool send_done() { /*std::cout << "test_connection::send_done()" << std::endl; */ return true; }
 	virtual bool call_run_once_service_io()
@@ -177,6 +183,7 @@ class test_connection : public epee::net_utils::i_service_endpoint
 	size_t send_counter() const { return m_send_counter.get(); }
 
 	const std::string &last_send_data() const { return m_last_send_data; }
+	const epee::net_utils::shared_send_buffer &last_send_buffer() const { return m_last_send_buffer; }
 	void reset_last_send_data()
 	{
 		boost::unique_lock<boost::mutex> lock(m_mutex);
@@ -194,6 +201,7 @@ private:
 	boost::mutex m_mutex;
 
 	std::string m_last_send_data;
+	epee::net_utils::shared_send_buffer m_last_send_buffer;
 
 	bool m_send_return;
 
@@ -433,6 +441,43 @@ TEST_F(positive_test_connection_to_levin_protocol_handler_calls, handler_process
 	ASSERT_TRUE(conn->last_send_data().empty());
 }
 
+TEST_F(positive_test_connection_to_levin_protocol_handler_calls, notify_sends_header_and_body_as_one_packet)
+{
+	const int expected_command = 4673262;
+	std::string in_data(256, 'n');
+
+	test_connection_ptr conn = create_connection();
+
+	ASSERT_EQ(1, conn->m_protocol_handler.notify(expected_command, in_data));
+
+	ASSERT_EQ(1, conn->send_counter());
+	ASSERT_EQ(sizeof(epee::levin::bucket_head2) + in_data.size(), conn->last_send_data().size());
+
+	epee::levin::bucket_head2 head;
+	memcpy(&head, conn->last_send_data().data(), sizeof(head));
+	ASSERT_EQ(LEVIN_SIGNATURE, head.m_signature);
+	ASSERT_EQ(in_data.size(), head.m_cb);
+	ASSERT_FALSE(head.m_have_to_return_data);
+	ASSERT_EQ(expected_command, head.m_command);
+	ASSERT_EQ(LEVIN_PACKET_REQUEST, head.m_flags);
+	ASSERT_EQ(in_data, conn->last_send_data().substr(sizeof(head)));
+}
+
+TEST_F(positive_test_connection_to_levin_protocol_handler_calls, shared_packet_is_not_copied_per_connection)
+{
+	const epee::net_utils::shared_send_buffer packet = epee::levin::make_notify_buffer(4673263, std::string(1024, 's'));
+
+	test_connection_ptr conn1 = create_connection();
+	test_connection_ptr conn2 = create_connection();
+
+	ASSERT_EQ(1, conn1->m_protocol_handler.send(packet));
+	ASSERT_EQ(1, conn2->m_protocol_handler.send(packet));
+
+	ASSERT_EQ(packet.get(), conn1->last_send_buffer().get());
+	ASSERT_EQ(packet.get(), conn2->last_send_buffer().get());
+	ASSERT_EQ(*packet, conn1->last_send_data());
+}
+
 TEST_F(positive_test_connection_to_levin_protocol_handler_calls, handler_processes_qued_callback)
 {
 	test_connection_ptr conn = create_connection();
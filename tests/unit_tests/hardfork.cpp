@@ -64,7 +64,8 @@ class TestDB : public BlockchainDB
 	virtual blobdata get_block_blob_from_height(const uint64_t &height) const { return cryptonote::t_serializable_object_to_blob(get_block_from_height(height)); }
 	virtual blobdata get_block_blob(const crypto::hash &h) const { return blobdata(); }
 	virtual bool get_tx_blob(const crypto::hash &h, cryptonote::blobdata &tx) const { return false; }
-	virtual bool get_tx_blob_indexed(const crypto::hash& h, cryptonote::blobdata& bd, std::vector<uint64_t>& o_idx) const { return false; }
+	virtual bool get_pruned_tx_blob(const crypto::hash &h, cryptonote::blobdata &bd) const { return false; }
+	virtual bool get_pruned_tx_blob_indexed(const crypto::hash& h, cryptonote::blobdata& bd, std::vector<uint64_t>& o_idx) const { return false; }
 	virtual uint64_t get_block_height(const crypto::hash &h) const { return 0; }
 	virtual block_header get_block_header(const crypto::hash &h) const { return block_header(); }
 	virtual uint64_t get_block_timestamp(const uint64_t &height) const { return 0; }
@@ -73,6 +74,7 @@ class TestDB : public BlockchainDB
 	virtual difficulty_type get_block_cumulative_difficulty(const uint64_t &height) const { return 10; }
 	virtual difficulty_type get_block_difficulty(const uint64_t &height) const { return 0; }
 	virtual uint64_t get_block_already_generated_coins(const uint64_t &height) const { return 10000000000; }
+	virtual void get_block_cumulative_totals(const uint64_t &height, uint64_t &emission, uint64_t &fees) const { emission = fees = 0; }
 	virtual crypto::hash get_block_hash_from_height(const uint64_t &height) const { return crypto::hash(); }
 	virtual std::vector<block> get_blocks_range(const uint64_t &h1, const uint64_t &h2) const { return std::vector<block>(); }
 	virtual std::vector<crypto::hash> get_hashes_range(const uint64_t &h1, const uint64_t &h2) const { return std::vector<crypto::hash>(); }
@@ -126,7 +128,7 @@ class TestDB : public BlockchainDB
 	virtual cryptonote::blobdata get_txpool_tx_blob(const crypto::hash &txid) const { return ""; }
 	virtual bool for_all_txpool_txes(std::function<bool(const crypto::hash &, const txpool_tx_meta_t &, const cryptonote::blobdata *)>, bool include_blob = false, bool include_unrelayed_txes = false) const { return false; }
 
-	virtual void add_block(const block &blk, const size_t &block_size, const difficulty_type &cumulative_difficulty, const uint64_t &coins_generated, const crypto::hash &blk_hash)
+	virtual void add_block(const block &blk, const size_t &block_size, const difficulty_type &cumulative_difficulty, const uint64_t &coins_generated, const uint64_t &block_fees, const crypto::hash &blk_hash)
 	{
 		blocks.push_back(blk);
 	}
@@ -181,20 +183,20 @@ TEST(major, Only)
 	ASSERT_FALSE(hf.add(mkblock(0, 2), 0));
 	ASSERT_FALSE(hf.add(mkblock(2, 2), 0));
 	ASSERT_TRUE(hf.add(mkblock(1, 2), 0));
-	db.add_block(mkblock(1, 1), 0, 0, 0, crypto::hash());
+	db.add_block(mkblock(1, 1), 0, 0, 0, 0, crypto::hash());
 
 	// block height 1, only version 1 is accepted
 	ASSERT_FALSE(hf.add(mkblock(0, 2), 1));
 	ASSERT_FALSE(hf.add(mkblock(2, 2), 1));
 	ASSERT_TRUE(hf.add(mkblock(1, 2), 1));
-	db.add_block(mkblock(1, 1), 0, 0, 0, crypto::hash());
+	db.add_block(mkblock(1, 1), 0, 0, 0, 0, crypto::hash());
 
 	// block height 2, only version 2 is accepted
 	ASSERT_FALSE(hf.add(mkblock(0, 2), 2));
 	ASSERT_FALSE(hf.add(mkblock(1, 2), 2));
 	ASSERT_FALSE(hf.add(mkblock(3, 2), 2));
 	ASSERT_TRUE(hf.add(mkblock(2, 2), 2));
-	db.add_block(mkblock(2, 1), 0, 0, 0, crypto::hash());
+	db.add_block(mkblock(2, 1), 0, 0, 0, 0, crypto::hash());
 }
 
 TEST(empty_hardforks, Success)
@@ -209,7 +211,7 @@ TEST(empty_hardforks, Success)
 
 	for(uint64_t h = 0; h <= 10; ++h)
 	{
-		db.add_block(mkblock(hf, h, 1), 0, 0, 0, crypto::hash());
+		db.add_block(mkblock(hf, h, 1), 0, 0, 0, 0, crypto::hash());
 		ASSERT_TRUE(hf.add(db.get_block_from_height(h), h));
 	}
 	ASSERT_EQ(hf.get(0), 1);
@@ -268,7 +270,7 @@ TEST(steps_asap, Success)
 
 	for(uint64_t h = 0; h < 10; ++h)
 	{
-		db.add_block(mkblock(hf, h, 9), 0, 0, 0, crypto::hash());
+		db.add_block(mkblock(hf, h, 9), 0, 0, 0, 0, crypto::hash());
 		ASSERT_TRUE(hf.add(db.get_block_from_height(h), h));
 	}
 
@@ -296,7 +298,7 @@ TEST(steps_1, Success)
 
 	for(uint64_t h = 0; h < 10; ++h)
 	{
-		db.add_block(mkblock(hf, h, h + 1), 0, 0, 0, crypto::hash());
+		db.add_block(mkblock(hf, h, h + 1), 0, 0, 0, 0, crypto::hash());
 		ASSERT_TRUE(hf.add(db.get_block_from_height(h), h));
 	}
 
@@ -324,7 +326,7 @@ TEST(reorganize, Same)
 		static const uint8_t block_versions[] = {1, 1, 4, 4, 7, 7, 9, 9, 9, 9, 9, 9, 9, 9, 9, 9, 9, 9, 9, 9};
 		for(uint64_t h = 0; h < 20; ++h)
 		{
-			db.add_block(mkblock(hf, h, block_versions[h]), 0, 0, 0, crypto::hash());
+			db.add_block(mkblock(hf, h, block_versions[h]), 0, 0, 0, 0, crypto::hash());
 			ASSERT_TRUE(hf.add(db.get_block_from_height(h), h));
 		}
 
@@ -358,7 +360,7 @@ TEST(reorganize, Changed)
 	static const uint8_t expected_versions[] = {1, 1, 1, 1, 1, 1, 4, 4, 7, 7, 9, 9, 9, 9, 9, 9};
 	for(uint64_t h = 0; h < 16; ++h)
 	{
-		db.add_block(mkblock(hf, h, block_versions[h]), 0, 0, 0, crypto::hash());
+		db.add_block(mkblock(hf, h, block_versions[h]), 0, 0, 0, 0, crypto::hash());
 		ASSERT_TRUE(hf.add(db.get_block_from_height(h), h));
 	}
 
@@ -382,7 +384,7 @@ TEST(reorganize, Changed)
 	hf.reorganize_from_block_height(2);
 	for(uint64_t h = 3; h < 16; ++h)
 	{
-		db.add_block(mkblock(hf, h, block_versions_new[h]), 0, 0, 0, crypto::hash());
+		db.add_block(mkblock(hf, h, block_versions_new[h]), 0, 0, 0, 0, crypto::hash());
 		bool ret = hf.add(db.get_block_from_height(h), h);
 		ASSERT_EQ(ret, h < 15);
 	}
@@ -409,7 +411,7 @@ TEST(voting, threshold)
 		for(uint64_t h = 0; h <= 8; ++h)
 		{
 			uint8_t v = 1 + !!(h % 8);
-			db.add_block(mkblock(hf, h, v), 0, 0, 0, crypto::hash());
+			db.add_block(mkblock(hf, h, v), 0, 0, 0, 0, crypto::hash());
 			bool ret = hf.add(db.get_block_from_height(h), h);
 			if(h >= 8 && threshold == 87)
 			{
@@ -447,7 +449,7 @@ TEST(voting, different_thresholds)
 
 		for(uint64_t h = 0; h < sizeof(block_versions) / sizeof(block_versions[0]); ++h)
 		{
-			db.add_block(mkblock(hf, h, block_versions[h]), 0, 0, 0, crypto::hash());
+			db.add_block(mkblock(hf, h, block_versions[h]), 0, 0, 0, 0, crypto::hash());
 			bool ret = hf.add(db.get_block_from_height(h), h);
 			ASSERT_EQ(ret, true);
 		}
@@ -517,7 +519,7 @@ TEST(reorganize, changed)
 	do                                            \
 	{                                             \
 		cryptonote::block b = mkblock(hf, h, v);  \
-		db.add_block(b, 0, 0, 0, crypto::hash()); \
+		db.add_block(b, 0, 0, 0, 0, crypto::hash()); \
 		ASSERT_##a(hf.add(b, h));                 \
 	} while(0)
 #define ADD_TRUE(v, h) ADD(v, h, TRUE)
@@ -0,0 +1,155 @@
+// Copyright (c) 2020, pasta Currency Project
+//
+// Portions of this file are available under BSD-3 license. Please see ORIGINAL-LICENSE for details
+// All rights reserved.
+//
+// Authors and copyright holders give permission for following:
+//
+// 1. Redistribution and use in source and binary forms WITHOUT modification.
+//
+// 2. Modification of the source form for your own personal use.
+//
+// As long as the following conditions are met:
+//
+// 3. You must not distribute modified copies of the work to third parties. This includes
+//    posting the work online, or hosting copies of the modified work for download.
+//
+// 4. Any derivative version of this work is also covered by this license, including point 8.
+//
+// 5. Neither the name of the copyright holders nor the names of the authors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+//
+// 6. You agree that this licence is governed by and shall be construed in accordance
+//    with the laws of England and Wales.
+//
+// 7. You agree to submit all disputes arising out of or in connection with this licence
+//    to the exclusive jurisdiction of the Courts of England and Wales.
+//
+// Authors and copyright holders agree that:
+//
+// 8. This licence expires and the work covered by it is released into the
+//    public domain on 1st of February 2021
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "gtest/gtest.h"
+
+#include "cryptonote_core/key_image_index.h"
+#include "crypto/crypto.h"
+
+namespace
+{
+crypto::key_image make_ki(uint32_t n)
+{
+	crypto::key_image ki;
+	crypto::hash h;
+	crypto::cn_fast_hash(&n, sizeof(n), h);
+	memcpy(&ki, &h, sizeof(ki));
+	return ki;
+}
+}
+
+TEST(key_image_index, chain_and_pool)
+{
+	cryptonote::key_image_index idx;
+	const crypto::key_image a = make_ki(1), b = make_ki(2);
+
+	ASSERT_EQ(idx.get_status(a), cryptonote::key_image_index::UNSPENT);
+	idx.add_pool(a);
+	ASSERT_EQ(idx.get_status(a), cryptonote::key_image_index::SPENT_IN_POOL);
+	idx.add_chain(a);
+	ASSERT_EQ(idx.get_status(a), cryptonote::key_image_index::SPENT_IN_CHAIN);
+	idx.remove_chain(a);
+	ASSERT_EQ(idx.get_status(a), cryptonote::key_image_index::SPENT_IN_POOL);
+	idx.remove_pool(a);
+	ASSERT_EQ(idx.get_status(a), cryptonote::key_image_index::UNSPENT);
+	ASSERT_EQ(idx.get_status(b), cryptonote::key_image_index::UNSPENT);
+	ASSERT_EQ(idx.size(), 0);
+}
+
+TEST(key_image_index, pool_refcount)
+{
+	cryptonote::key_image_index idx;
+	const crypto::key_image a = make_ki(1);
+
+	// kept by block txes may spend the same image more than once
+	idx.add_pool(a);
+	idx.add_pool(a);
+	idx.remove_pool(a);
+	ASSERT_EQ(idx.get_status(a), cryptonote::key_image_index::SPENT_IN_POOL);
+	idx.remove_pool(a);
+	ASSERT_EQ(idx.get_status(a), cryptonote::key_image_index::UNSPENT);
+}
+
+TEST(key_image_index, batch_matches_single)
+{
+	cryptonote::key_image_index idx;
+	std::vector<crypto::key_image> kis;
+	for(uint32_t n = 0; n < 20000; ++n)
+	{
+		kis.push_back(make_ki(n));
+		if(n % 3 == 0)
+			idx.add_chain(kis.back());
+		else if(n % 3 == 1)
+			idx.add_pool(kis.back());
+	}
+	// remove a part again so lookups have to probe past deleted slots
+	for(uint32_t n = 0; n < 20000; n += 6)
+		idx.remove_chain(kis[n]);
+
+	std::vector<cryptonote::key_image_index::spent_status> status;
+	idx.get_status(kis, status);
+	ASSERT_EQ(status.size(), kis.size());
+	for(uint32_t n = 0; n < kis.size(); ++n)
+	{
+		const cryptonote::key_image_index::spent_status expected = n % 6 == 0 ? cryptonote::key_image_index::UNSPENT : n % 3 == 0 ? cryptonote::key_image_index::SPENT_IN_CHAIN : n % 3 == 1 ? cryptonote::key_image_index::SPENT_IN_POOL : cryptonote::key_image_index::UNSPENT;
+		ASSERT_EQ(status[n], expected);
+		ASSERT_EQ(idx.get_status(kis[n]), expected);
+	}
+}
+
+TEST(key_image_index, pool_status_ignores_chain)
+{
+	cryptonote::key_image_index idx;
+	const crypto::key_image a = make_ki(1), b = make_ki(2), c = make_ki(3), d = make_ki(4);
+	idx.add_pool(a);
+	idx.add_chain(b);
+	// a pool double spend of an image already mined is still in the pool
+	idx.add_chain(c);
+	idx.add_pool(c);
+
+	std::vector<bool> in_pool;
+	idx.get_pool_status({a, b, c, d}, in_pool);
+	ASSERT_EQ(in_pool, std::vector<bool>({true, false, true, false}));
+	idx.get_pool_status({c}, in_pool);
+	ASSERT_EQ(in_pool, std::vector<bool>({true}));
+	ASSERT_EQ(idx.get_status(c), cryptonote::key_image_index::SPENT_IN_CHAIN);
+}
+
+TEST(key_image_index, clear_sides)
+{
+	cryptonote::key_image_index idx;
+	const crypto::key_image a = make_ki(1), b = make_ki(2), c = make_ki(3);
+	idx.add_chain(a);
+	idx.add_pool(b);
+	idx.add_chain(c);
+	idx.add_pool(c);
+
+	idx.clear_pool();
+	ASSERT_EQ(idx.get_status(a), cryptonote::key_image_index::SPENT_IN_CHAIN);
+	ASSERT_EQ(idx.get_status(b), cryptonote::key_image_index::UNSPENT);
+	ASSERT_EQ(idx.size(), 2);
+
+	idx.clear_chain();
+	ASSERT_EQ(idx.get_status(c), cryptonote::key_image_index::UNSPENT);
+	ASSERT_EQ(idx.size(), 0);
+}
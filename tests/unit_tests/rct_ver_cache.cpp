@@ -0,0 +1,143 @@
+// Copyright (c) 2020, pasta Currency Project
+//
+// Portions of this file are available under BSD-3 license. Please see ORIGINAL-LICENSE for details
+// All rights reserved.
+//
+// Authors and copyright holders give permission for following:
+//
+// 1. Redistribution and use in source and binary forms WITHOUT modification.
+//
+// 2. Modification of the source form for your own personal use.
+//
+// As long as the following conditions are met:
+//
+// 3. You must not distribute modified copies of the work to third parties. This includes
+//    posting the work online, or hosting copies of the modified work for download.
+//
+// 4. Any derivative version of this work is also covered by this license, including point 8.
+//
+// 5. Neither the name of the copyright holders nor the names of the authors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+//
+// 6. You agree that this licence is governed by and shall be construed in accordance
+//    with the laws of England and Wales.
+//
+// 7. You agree to submit all disputes arising out of or in connection with this licence
+//    to the exclusive jurisdiction of the Courts of England and Wales.
+//
+// Authors and copyright holders agree that:
+//
+// 8. This licence expires and the work covered by it is released into the
+//    public domain on 1st of February 2021
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "gtest/gtest.h"
+
+#include "cryptonote_core/rct_ver_cache.h"
+#include "ringct/rctOps.h"
+
+namespace
+{
+rct::rctSig make_rv(size_t inputs, size_t ring_size)
+{
+	rct::rctSig rv;
+	rv.type = rct::RCTTypeSimple;
+	rv.mixRing.resize(inputs);
+	for(rct::ctkeyV &row : rv.mixRing)
+	{
+		row.resize(ring_size);
+		for(rct::ctkey &k : row)
+		{
+			k.dest = rct::skGen();
+			k.mask = rct::skGen();
+		}
+	}
+	return rv;
+}
+
+crypto::hash make_hash(uint8_t n)
+{
+	crypto::hash h = crypto::null_hash;
+	h.data[0] = n;
+	return h;
+}
+}
+
+TEST(rct_ver_cache, hit_skips_check)
+{
+	cryptonote::rct_ver_cache cache(16);
+	const rct::rctSig rv = make_rv(2, 11);
+	size_t calls = 0;
+	auto verify = [&calls] { ++calls; return true; };
+
+	ASSERT_TRUE(cache.check(make_hash(1), rv, verify));
+	ASSERT_EQ(calls, 1);
+	ASSERT_TRUE(cache.check(make_hash(1), rv, verify));
+	ASSERT_EQ(calls, 1);
+
+	// another tx with the same rings is not a hit
+	ASSERT_TRUE(cache.check(make_hash(2), rv, verify));
+	ASSERT_EQ(calls, 2);
+}
+
+TEST(rct_ver_cache, changed_ring_member_reverifies)
+{
+	cryptonote::rct_ver_cache cache(16);
+	rct::rctSig rv = make_rv(2, 11);
+	size_t calls = 0;
+	auto verify = [&calls] { ++calls; return true; };
+
+	ASSERT_TRUE(cache.check(make_hash(1), rv, verify));
+
+	// a reorg resolved one ring member to another output
+	rv.mixRing[1][5].dest = rct::skGen();
+	ASSERT_TRUE(cache.check(make_hash(1), rv, verify));
+	ASSERT_EQ(calls, 2);
+
+	rv.mixRing[0][0].mask = rct::skGen();
+	ASSERT_TRUE(cache.check(make_hash(1), rv, verify));
+	ASSERT_EQ(calls, 3);
+
+	// the newest digest replaced the old one
+	ASSERT_TRUE(cache.check(make_hash(1), rv, verify));
+	ASSERT_EQ(calls, 3);
+	ASSERT_EQ(cache.size(), 1);
+}
+
+TEST(rct_ver_cache, failure_not_cached)
+{
+	cryptonote::rct_ver_cache cache(16);
+	const rct::rctSig rv = make_rv(1, 11);
+	size_t calls = 0;
+
+	ASSERT_FALSE(cache.check(make_hash(1), rv, [&calls] { ++calls; return false; }));
+	ASSERT_EQ(cache.size(), 0);
+	ASSERT_FALSE(cache.check(make_hash(1), rv, [&calls] { ++calls; return false; }));
+	ASSERT_EQ(calls, 2);
+	ASSERT_FALSE(cache.contains(make_hash(1), cryptonote::rct_ver_cache::ring_digest(rv)));
+}
+
+TEST(rct_ver_cache, evicts_oldest)
+{
+	cryptonote::rct_ver_cache cache(4);
+	const rct::rctSig rv = make_rv(1, 11);
+	const crypto::hash digest = cryptonote::rct_ver_cache::ring_digest(rv);
+	for(uint8_t n = 0; n < 6; ++n)
+		cache.insert(make_hash(n), digest);
+
+	ASSERT_EQ(cache.size(), 4);
+	ASSERT_FALSE(cache.contains(make_hash(0), digest));
+	ASSERT_FALSE(cache.contains(make_hash(1), digest));
+	for(uint8_t n = 2; n < 6; ++n)
+		ASSERT_TRUE(cache.contains(make_hash(n), digest));
+}
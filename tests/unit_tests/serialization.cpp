@@ -42,6 +42,7 @@
 #include "device/device.hpp"
 #include "ringct/rctSigs.h"
 #include "serialization/binary_archive.h"
+#include "serialization/binary_span_archive.h"
 #include "serialization/binary_utils.h"
 #include "serialization/debug_archive.h"
 #include "serialization/json_archive.h"
@@ -216,6 +217,49 @@ TEST(Serialization, Overflow)
 	ASSERT_EQ(0, bigvector.size());
 }
 
+TEST(Serialization, BinarySpanArchive)
+{
+	uint64_t x = 0xff00000000, x1 = 0, v = 0xff00000000, v1 = 0;
+
+	string blob;
+	::serialization::blob_ostream ostr(blob);
+	binary_span_archive<true> oar(ostr);
+	oar.serialize_int(x);
+	oar.serialize_varint(v);
+	ASSERT_TRUE(ostr.good());
+	ASSERT_EQ(string("\0\0\0\0\xff\0\0\0\x80\x80\x80\x80\xF0\x1F", 14), blob);
+
+	::serialization::span_istream istr(epee::to_byte_span(epee::to_span(blob)));
+	binary_span_archive<false> iar(istr);
+	iar.serialize_int(x1);
+	iar.serialize_varint(v1);
+	ASSERT_TRUE(istr.good());
+	ASSERT_EQ(0, iar.remaining_bytes());
+	ASSERT_EQ(x, x1);
+	ASSERT_EQ(v, v1);
+
+	iar.serialize_int(x1);
+	ASSERT_FALSE(istr.good());
+
+	rct::keyV keyv0 = rct::skvGen(30), keyv1;
+	string blob_span, blob_stream;
+	ASSERT_TRUE(serialization::append_binary(keyv0, blob_span));
+	ASSERT_TRUE(serialization::dump_binary(keyv0, blob_stream));
+	ASSERT_EQ(blob_stream, blob_span);
+	ASSERT_TRUE(serialization::parse_binary(epee::to_byte_span(epee::to_span(blob_span)), keyv1));
+	ASSERT_TRUE(keyv0 == keyv1);
+
+	blob_span.pop_back();
+	ASSERT_FALSE(serialization::parse_binary(epee::to_byte_span(epee::to_span(blob_span)), keyv1));
+
+	Blob b = {0xff00000000};
+	vector<Blob> bigvector;
+	blob.clear();
+	ASSERT_TRUE(serialization::append_binary(b, blob));
+	ASSERT_FALSE(serialization::parse_binary(epee::to_byte_span(epee::to_span(blob)), bigvector));
+	ASSERT_EQ(0, bigvector.size());
+}
+
 TEST(Serialization, serializes_vector_uint64_as_varint)
 {
 	std::vector<uint64_t> v;
@@ -32,6 +32,7 @@
 
 #include "cryptonote_protocol/cryptonote_protocol_defs.h"
 #include "include_base_utils.h"
+#include "storages/portable_storage.h"
 #include "storages/portable_storage_template_helper.h"
 
 TEST(protocol_pack, protocol_pack_command)
@@ -53,3 +54,52 @@ TEST(protocol_pack, protocol_pack_command)
 		ASSERT_TRUE(r.total_height == 3);
 	}
 }
+
+TEST(protocol_pack, streaming_codec_matches_portable_storage)
+{
+	cryptonote::NOTIFY_RESPONSE_GET_OBJECTS::request r;
+	r.current_blockchain_height = 1000;
+	r.txs.push_back(std::string(300, 't'));
+	for(size_t i = 0; i < 70; ++i)
+	{
+		std::list<cryptonote::blobdata> txs(i % 4, std::string(i * 10, char(i)));
+		r.blocks.emplace_back(std::string(80 + i, 'b'), txs);
+	}
+	r.missed_ids.resize(3, boost::value_initialized<crypto::hash>());
+
+	std::string dom_buff, stream_buff;
+	epee::serialization::portable_storage ps;
+	r.store(ps);
+	ASSERT_TRUE(ps.store_to_binary(dom_buff));
+	ASSERT_TRUE(epee::serialization::store_t_to_binary(r, stream_buff));
+	ASSERT_EQ(dom_buff.size(), stream_buff.size());
+
+	// each side reads what the other one wrote
+	epee::serialization::portable_storage ps2;
+	cryptonote::NOTIFY_RESPONSE_GET_OBJECTS::request r2, r3;
+	ASSERT_TRUE(ps2.load_from_binary(stream_buff));
+	ASSERT_TRUE(r2.load(ps2));
+	ASSERT_TRUE(epee::serialization::load_t_from_binary(r3, dom_buff));
+	for(const auto &rr : {r2, r3})
+	{
+		ASSERT_EQ(rr.current_blockchain_height, 1000);
+		ASSERT_EQ(rr.txs, r.txs);
+		ASSERT_EQ(rr.missed_ids, r.missed_ids);
+		ASSERT_EQ(rr.blocks.size(), r.blocks.size());
+		auto it = r.blocks.begin();
+		for(const auto &b : rr.blocks)
+		{
+			ASSERT_EQ(b.block, it->block);
+			ASSERT_EQ(b.txs, it->txs);
+			++it;
+		}
+	}
+
+	// truncated input never yields a complete object
+	for(size_t n = 0; n < dom_buff.size(); n += 13)
+	{
+		cryptonote::NOTIFY_RESPONSE_GET_OBJECTS::request r4;
+		if(epee::serialization::load_t_from_binary(r4, dom_buff.substr(0, n)))
+			ASSERT_NE(r4.blocks.size(), r.blocks.size());
+	}
+}
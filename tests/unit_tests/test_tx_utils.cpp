@@ -203,3 +203,25 @@ TEST(validate_parse_amount_case, validate_parse_amount)
 	r = cryptonote::parse_amount(res, "1 00.00 00");
 	ASSERT_FALSE(r);
 }
+
+TEST(block_hashing_template, nonce_patch_matches_hashing_blob)
+{
+	cryptonote::block b;
+	b.major_version = 9;
+	b.minor_version = 9;
+	b.timestamp = 1590000000;
+	b.prev_id = crypto::cn_fast_hash("prev", 4);
+	b.nonce = 0;
+	b.miner_tx.version = 2;
+	b.tx_hashes.push_back(crypto::cn_fast_hash("tx", 2));
+
+	cryptonote::block_hashing_template hashing_template(cryptonote::MAINNET, b);
+	ASSERT_EQ(hashing_template.blob(), cryptonote::get_block_hashing_blob(b));
+
+	for(uint32_t nonce : {1u, 0x80u, 0xdeadbeefu, 0xffffffffu})
+	{
+		b.nonce = nonce;
+		hashing_template.set_nonce(nonce);
+		ASSERT_EQ(hashing_template.blob(), cryptonote::get_block_hashing_blob(b));
+	}
+}
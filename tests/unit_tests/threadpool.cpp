@@ -0,0 +1,99 @@
+// Copyright (c) 2020, pasta Currency Project
+//
+// Portions of this file are available under BSD-3 license. Please see ORIGINAL-LICENSE for details
+// All rights reserved.
+//
+// Authors and copyright holders give permission for following:
+//
+// 1. Redistribution and use in source and binary forms WITHOUT modification.
+//
+// 2. Modification of the source form for your own personal use.
+//
+// As long as the following conditions are met:
+//
+// 3. You must not distribute modified copies of the work to third parties. This includes
+//    posting the work online, or hosting copies of the modified work for download.
+//
+// 4. Any derivative version of this work is also covered by this license, including point 8.
+//
+// 5. Neither the name of the copyright holders nor the names of the authors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+//
+// 6. You agree that this licence is governed by and shall be construed in accordance
+//    with the laws of England and Wales.
+//
+// 7. You agree to submit all disputes arising out of or in connection with this licence
+//    to the exclusive jurisdiction of the Courts of England and Wales.
+//
+// Authors and copyright holders agree that:
+//
+// 8. This licence expires and the work covered by it is released into the
+//    public domain on 1st of February 2021
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "gtest/gtest.h"
+
+#include "common/threadpool.h"
+
+TEST(threadpool, waiter_runs_only_its_own_tasks)
+{
+	tools::threadpool &tpool = tools::threadpool::getInstance();
+	const boost::thread::id self = boost::this_thread::get_id();
+	std::atomic<bool> release(false);
+	std::atomic<bool> foreign_run_here(false);
+	std::atomic<int> done(0);
+	tools::threadpool::waiter others, mine;
+
+	// unrelated tasks keep the workers busy and the queues full while we wait
+	const int foreign = 4 * tpool.get_max_concurrency();
+	for(int i = 0; i < foreign; i++)
+	{
+		tpool.submit(&others, [&] {
+			if(boost::this_thread::get_id() == self && !release)
+			{
+				foreign_run_here = true;
+				return;
+			}
+			while(!release)
+				boost::this_thread::yield();
+		});
+	}
+
+	for(int i = 0; i < 16; i++)
+		tpool.submit(&mine, [&] { done++; });
+	mine.wait();
+
+	ASSERT_EQ(done, 16);
+	ASSERT_FALSE(foreign_run_here);
+
+	release = true;
+	others.wait();
+}
+
+TEST(threadpool, nested_waits)
+{
+	tools::threadpool &tpool = tools::threadpool::getInstance();
+	std::atomic<int> sum(0);
+	tools::threadpool::waiter outer;
+	for(int i = 0; i < 32; i++)
+	{
+		tpool.submit(&outer, [&] {
+			tools::threadpool::waiter inner;
+			for(int j = 0; j < 32; j++)
+				tpool.submit(&inner, [&] { sum++; });
+			inner.wait();
+		});
+	}
+	outer.wait();
+	ASSERT_EQ(sum, 32 * 32);
+}
@@ -0,0 +1,447 @@
+// Copyright (c) 2020, pasta Currency Project
+//
+// Portions of this file are available under BSD-3 license. Please see ORIGINAL-LICENSE for details
+// All rights reserved.
+//
+// Authors and copyright holders give permission for following:
+//
+// 1. Redistribution and use in source and binary forms WITHOUT modification.
+//
+// 2. Modification of the source form for your own personal use.
+//
+// As long as the following conditions are met:
+//
+// 3. You must not distribute modified copies of the work to third parties. This includes
+//    posting the work online, or hosting copies of the modified work for download.
+//
+// 4. Any derivative version of this work is also covered by this license, including point 8.
+//
+// 5. Neither the name of the copyright holders nor the names of the authors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+//
+// 6. You agree that this licence is governed by and shall be construed in accordance
+//    with the laws of England and Wales.
+//
+// 7. You agree to submit all disputes arising out of or in connection with this licence
+//    to the exclusive jurisdiction of the Courts of England and Wales.
+//
+// Authors and copyright holders agree that:
+//
+// 8. This licence expires and the work covered by it is released into the
+//    public domain on 1st of February 2021
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "gtest/gtest.h"
+
+#include "crypto/crypto.h"
+#include "cryptonote_basic/difficulty.h"
+#include "cryptonote_protocol/cryptonote_protocol_handler.h"
+#include "cryptonote_protocol/cryptonote_protocol_handler.inl"
+#include "cryptonote_protocol/tx_relay.h"
+#include "p2p/net_node_common.h"
+#include <cstring>
+#include <unordered_set>
+
+namespace
+{
+crypto::hash make_txid(int n)
+{
+	crypto::hash h = crypto::null_hash;
+	memcpy(&h, &n, sizeof(n));
+	return h;
+}
+
+// txes are their own hash in here, so blobs and txids map back and forth
+cryptonote::blobdata tx_blob(const crypto::hash &txid)
+{
+	return cryptonote::blobdata((const char *)&txid, sizeof(txid));
+}
+
+class relay_core
+{
+  public:
+	void on_synchronized() {}
+	void safesyncmode(const bool) {}
+	uint64_t get_current_blockchain_height() const { return 1; }
+	void set_target_blockchain_height(uint64_t) {}
+	bool init(const boost::program_options::variables_map &vm) { return true; }
+	bool deinit() { return true; }
+	bool get_short_chain_history(std::list<crypto::hash> &ids) const { return true; }
+	bool get_stat_info(cryptonote::core_stat_info &st_inf) const { return true; }
+	bool have_block(const crypto::hash &id) const { return true; }
+	void get_blockchain_top(uint64_t &height, crypto::hash &top_id) const
+	{
+		height = 0;
+		top_id = crypto::null_hash;
+	}
+	bool handle_incoming_tx(const cryptonote::blobdata &tx_blob, cryptonote::tx_verification_context &tvc, bool keeped_by_block, bool relayed, bool do_not_relay)
+	{
+		memcpy(&tvc.m_tx_hash, tx_blob.data(), sizeof(tvc.m_tx_hash));
+		tvc.m_should_be_relayed = pool.insert(tvc.m_tx_hash).second;
+		return true;
+	}
+	bool handle_incoming_txs(const std::list<cryptonote::blobdata> &tx_blob, std::vector<cryptonote::tx_verification_context> &tvc, bool keeped_by_block, bool relayed, bool do_not_relay) { return true; }
+	bool handle_incoming_block(const cryptonote::blobdata &block_blob, cryptonote::block_verification_context &bvc, bool update_miner_blocktemplate = true) { return true; }
+	void pause_mine() {}
+	void resume_mine() {}
+	bool on_idle() { return true; }
+	bool find_blockchain_supplement(const std::list<crypto::hash> &qblock_ids, cryptonote::NOTIFY_RESPONSE_CHAIN_ENTRY::request &resp) { return true; }
+	bool handle_get_objects(cryptonote::NOTIFY_REQUEST_GET_OBJECTS::request &arg, cryptonote::NOTIFY_RESPONSE_GET_OBJECTS::request &rsp, cryptonote::cryptonote_connection_context &context) { return true; }
+	bool get_test_drop_download() const { return true; }
+	bool get_test_drop_download_height() const { return true; }
+	bool prepare_handle_incoming_blocks(const std::list<cryptonote::block_complete_entry> &blocks) { return true; }
+	bool cleanup_handle_incoming_blocks(bool force_sync = false) { return true; }
+	uint64_t get_target_blockchain_height() const { return 1; }
+	size_t get_block_sync_size(uint64_t height) const { return BLOCKS_SYNCHRONIZING_DEFAULT_COUNT; }
+	void on_transactions_relayed(const std::vector<crypto::hash> &tx_hashes) {}
+	cryptonote::network_type get_nettype() const { return cryptonote::MAINNET; }
+	bool get_pool_transaction(const crypto::hash &id, cryptonote::blobdata &blob) const
+	{
+		if(!pool_has_tx(id))
+			return false;
+		blob = tx_blob(id);
+		return true;
+	}
+	bool pool_has_tx(const crypto::hash &txid) const { return pool.count(txid) != 0; }
+	bool get_blocks(uint64_t start_offset, size_t count, std::list<std::pair<cryptonote::blobdata, cryptonote::block>> &blocks, std::list<cryptonote::blobdata> &txs) const { return false; }
+	bool get_transactions(const std::vector<crypto::hash> &txs_ids, std::list<cryptonote::transaction> &txs, std::list<crypto::hash> &missed_txs) const { return false; }
+	bool get_block_by_hash(const crypto::hash &h, cryptonote::block &blk, bool *orphan = NULL) const { return false; }
+	uint8_t get_ideal_hard_fork_version() const { return 0; }
+	uint8_t get_ideal_hard_fork_version(uint64_t height) const { return 0; }
+	uint8_t get_hard_fork_version(uint64_t height) const { return 0; }
+	cryptonote::difficulty_type get_block_cumulative_difficulty(uint64_t height) const { return 0; }
+	bool fluffy_blocks_enabled() const { return false; }
+	uint64_t prevalidate_block_hashes(uint64_t height, const std::list<crypto::hash> &hashes) { return 0; }
+	void stop() {}
+
+	std::unordered_set<crypto::hash> pool;
+};
+
+// records what the handler sends instead of putting it on the wire
+class relay_endpoint : public nodetool::p2p_endpoint_stub<cryptonote::cryptonote_connection_context>
+{
+  public:
+	struct sent
+	{
+		int command;
+		std::string blob;
+		boost::uuids::uuid connection_id;
+	};
+
+	cryptonote::cryptonote_connection_context &add_peer(uint32_t support_flags)
+	{
+		peers.emplace_back();
+		static_cast<epee::net_utils::connection_context_base &>(peers.back().context) = epee::net_utils::connection_context_base(crypto::rand<boost::uuids::uuid>(), epee::net_utils::ipv4_network_address{0, 0}, false);
+		peers.back().context.m_state = cryptonote::cryptonote_connection_context::state_normal;
+		peers.back().peer_id = peers.size();
+		peers.back().support_flags = support_flags;
+		return peers.back().context;
+	}
+
+	virtual bool relay_notify_to_list(int command, const std::string &data_buff, const std::list<boost::uuids::uuid> &connections)
+	{
+		for(const boost::uuids::uuid &connection_id : connections)
+			messages.push_back({command, data_buff, connection_id});
+		return true;
+	}
+	virtual bool invoke_notify_to_peer(int command, const std::string &req_buff, const epee::net_utils::connection_context_base &context)
+	{
+		messages.push_back({command, req_buff, context.m_connection_id});
+		return true;
+	}
+	virtual void for_each_connection(std::function<bool(cryptonote::cryptonote_connection_context &, nodetool::peerid_type, uint32_t)> f)
+	{
+		for(peer &p : peers)
+		{
+			if(!f(p.context, p.peer_id, p.support_flags))
+				break;
+		}
+	}
+
+	// the txids of the messages with this command sent to this connection
+	std::vector<crypto::hash> txids_sent(int command, const boost::uuids::uuid &connection_id) const
+	{
+		std::vector<crypto::hash> txids;
+		for(const sent &msg : messages)
+		{
+			if(msg.command != command || msg.connection_id != connection_id)
+				continue;
+			if(command == cryptonote::NOTIFY_NEW_TRANSACTIONS::ID)
+			{
+				cryptonote::NOTIFY_NEW_TRANSACTIONS::request req;
+				EXPECT_TRUE(epee::serialization::load_t_from_binary(req, msg.blob));
+				for(const cryptonote::blobdata &blob : req.txs)
+				{
+					txids.emplace_back();
+					memcpy(&txids.back(), blob.data(), sizeof(crypto::hash));
+				}
+			}
+			else
+			{
+				cryptonote::NOTIFY_TX_INVENTORY::request req;
+				EXPECT_TRUE(epee::serialization::load_t_from_binary(req, msg.blob));
+				txids.insert(txids.end(), req.tx_hashes.begin(), req.tx_hashes.end());
+			}
+		}
+		return txids;
+	}
+
+	struct peer
+	{
+		cryptonote::cryptonote_connection_context context;
+		nodetool::peerid_type peer_id;
+		uint32_t support_flags;
+	};
+	std::list<peer> peers;
+	std::vector<sent> messages;
+};
+
+typedef cryptonote::t_cryptonote_protocol_handler<relay_core> relay_handler;
+
+template <class t_parameter>
+void receive(relay_handler &handler, typename t_parameter::request &req, cryptonote::cryptonote_connection_context &context)
+{
+	std::string blob, out;
+	bool handled = false;
+	epee::serialization::store_t_to_binary(req, blob);
+	handler.handle_invoke_map(true, t_parameter::ID, blob, out, context, handled);
+	ASSERT_TRUE(handled);
+}
+
+void relay(relay_handler &handler, const std::vector<crypto::hash> &txids, cryptonote::cryptonote_connection_context &exclude_context)
+{
+	cryptonote::NOTIFY_NEW_TRANSACTIONS::request req;
+	for(const crypto::hash &txid : txids)
+		req.txs.push_back(tx_blob(txid));
+	static_cast<cryptonote::i_cryptonote_protocol &>(handler).relay_transactions(req, txids, exclude_context);
+}
+}
+
+TEST(tx_request_tracker, first_announce_requests)
+{
+	cryptonote::tx_request_tracker tracker;
+	const boost::uuids::uuid a = crypto::rand<boost::uuids::uuid>(), b = crypto::rand<boost::uuids::uuid>();
+	const crypto::hash txid = make_txid(1);
+
+	ASSERT_TRUE(tracker.announced(txid, a, 100));
+	ASSERT_TRUE(tracker.requested(txid));
+	ASSERT_FALSE(tracker.announced(txid, a, 101));
+	ASSERT_FALSE(tracker.announced(txid, b, 101));
+	ASSERT_TRUE(tracker.announced(make_txid(2), b, 101));
+	ASSERT_EQ(tracker.size(), 2);
+
+	tracker.received(txid);
+	ASSERT_FALSE(tracker.requested(txid));
+	ASSERT_TRUE(tracker.announced(txid, b, 102));
+}
+
+TEST(tx_request_tracker, timeout_asks_next_announcer)
+{
+	cryptonote::tx_request_tracker tracker;
+	const boost::uuids::uuid a = crypto::rand<boost::uuids::uuid>(), b = crypto::rand<boost::uuids::uuid>(), c = crypto::rand<boost::uuids::uuid>();
+	const crypto::hash txid = make_txid(1);
+	std::map<boost::uuids::uuid, std::vector<crypto::hash>> requests;
+
+	ASSERT_TRUE(tracker.announced(txid, a, 100));
+	ASSERT_FALSE(tracker.announced(txid, b, 101));
+	ASSERT_FALSE(tracker.announced(txid, c, 102));
+	ASSERT_FALSE(tracker.announced(txid, b, 103));
+
+	tracker.expire(100 + P2P_TX_REQUEST_TIMEOUT, requests);
+	ASSERT_TRUE(requests.empty());
+
+	tracker.expire(101 + P2P_TX_REQUEST_TIMEOUT, requests);
+	ASSERT_EQ(requests.size(), 1);
+	ASSERT_EQ(requests[b], std::vector<crypto::hash>{txid});
+
+	requests.clear();
+	tracker.expire(102 + 2 * P2P_TX_REQUEST_TIMEOUT, requests);
+	ASSERT_EQ(requests.size(), 1);
+	ASSERT_EQ(requests[c], std::vector<crypto::hash>{txid});
+
+	// nobody left to ask
+	requests.clear();
+	tracker.expire(103 + 3 * P2P_TX_REQUEST_TIMEOUT, requests);
+	ASSERT_TRUE(requests.empty());
+	ASSERT_FALSE(tracker.requested(txid));
+}
+
+TEST(tx_request_tracker, late_announce_asks_directly)
+{
+	cryptonote::tx_request_tracker tracker;
+	const boost::uuids::uuid a = crypto::rand<boost::uuids::uuid>(), b = crypto::rand<boost::uuids::uuid>();
+	const crypto::hash txid = make_txid(1);
+	std::map<boost::uuids::uuid, std::vector<crypto::hash>> requests;
+
+	ASSERT_TRUE(tracker.announced(txid, a, 100));
+	ASSERT_TRUE(tracker.announced(txid, b, 101 + P2P_TX_REQUEST_TIMEOUT));
+	tracker.expire(101 + P2P_TX_REQUEST_TIMEOUT, requests);
+	ASSERT_TRUE(requests.empty());
+}
+
+TEST(tx_request_tracker, closed_connection)
+{
+	cryptonote::tx_request_tracker tracker;
+	const boost::uuids::uuid a = crypto::rand<boost::uuids::uuid>(), b = crypto::rand<boost::uuids::uuid>(), c = crypto::rand<boost::uuids::uuid>();
+	std::map<boost::uuids::uuid, std::vector<crypto::hash>> requests;
+
+	ASSERT_TRUE(tracker.announced(make_txid(1), a, 100));
+	ASSERT_FALSE(tracker.announced(make_txid(1), b, 100));
+	ASSERT_FALSE(tracker.announced(make_txid(1), c, 100));
+	ASSERT_TRUE(tracker.announced(make_txid(2), c, 100));
+	ASSERT_FALSE(tracker.announced(make_txid(2), b, 100));
+
+	// the asked peer is gone, the next announcer is asked without waiting for the timeout
+	tracker.flush_connection(a);
+	tracker.flush_connection(b);
+	tracker.expire(100, requests);
+	ASSERT_EQ(requests.size(), 1);
+	ASSERT_EQ(requests[c], std::vector<crypto::hash>{make_txid(1)});
+
+	// and an announcer that closed is not asked
+	requests.clear();
+	tracker.expire(101 + P2P_TX_REQUEST_TIMEOUT, requests);
+	ASSERT_TRUE(requests.empty());
+	ASSERT_EQ(tracker.size(), 0);
+}
+
+TEST(tx_request_tracker, announcers_capped)
+{
+	cryptonote::tx_request_tracker tracker;
+	const crypto::hash txid = make_txid(1);
+	std::map<boost::uuids::uuid, std::vector<crypto::hash>> requests;
+
+	ASSERT_TRUE(tracker.announced(txid, crypto::rand<boost::uuids::uuid>(), 0));
+	for(size_t i = 0; i < P2P_TX_REQUEST_MAX_ANNOUNCERS + 4; ++i)
+		ASSERT_FALSE(tracker.announced(txid, crypto::rand<boost::uuids::uuid>(), 0));
+
+	size_t asked = 0;
+	for(time_t now = P2P_TX_REQUEST_TIMEOUT + 1; tracker.requested(txid); now += P2P_TX_REQUEST_TIMEOUT + 1)
+	{
+		requests.clear();
+		tracker.expire(now, requests);
+		asked += requests.size();
+	}
+	ASSERT_EQ(asked, P2P_TX_REQUEST_MAX_ANNOUNCERS);
+}
+
+TEST(tx_relay, negotiated_by_support_flags)
+{
+	relay_core core;
+	relay_endpoint p2p;
+	relay_handler handler(core, &p2p, true);
+	cryptonote::cryptonote_connection_context &source = p2p.add_peer(P2P_SUPPORT_FLAG_TX_INVENTORY);
+	cryptonote::cryptonote_connection_context &full = p2p.add_peer(P2P_SUPPORT_FLAG_FLUFFY_BLOCKS);
+	cryptonote::cryptonote_connection_context &inventory = p2p.add_peer(P2P_SUPPORT_FLAGS);
+	const std::vector<crypto::hash> txids = {make_txid(1), make_txid(2)};
+
+	relay(handler, txids, source);
+
+	// old peers get the txes straight away, peers taking inventories wait for the idle tick
+	ASSERT_EQ(p2p.txids_sent(cryptonote::NOTIFY_NEW_TRANSACTIONS::ID, full.m_connection_id), txids);
+	ASSERT_TRUE(p2p.txids_sent(cryptonote::NOTIFY_NEW_TRANSACTIONS::ID, inventory.m_connection_id).empty());
+	ASSERT_TRUE(p2p.txids_sent(cryptonote::NOTIFY_TX_INVENTORY::ID, inventory.m_connection_id).empty());
+
+	handler.on_idle();
+	ASSERT_EQ(p2p.txids_sent(cryptonote::NOTIFY_TX_INVENTORY::ID, inventory.m_connection_id), txids);
+	ASSERT_TRUE(p2p.txids_sent(cryptonote::NOTIFY_TX_INVENTORY::ID, full.m_connection_id).empty());
+	ASSERT_TRUE(p2p.txids_sent(cryptonote::NOTIFY_TX_INVENTORY::ID, source.m_connection_id).empty());
+
+	// each txid is announced once
+	relay(handler, txids, source);
+	p2p.messages.clear();
+	handler.on_idle();
+	ASSERT_TRUE(p2p.txids_sent(cryptonote::NOTIFY_TX_INVENTORY::ID, inventory.m_connection_id).empty());
+}
+
+TEST(tx_relay, inventory_requests_missing)
+{
+	relay_core core;
+	relay_endpoint p2p;
+	relay_handler handler(core, &p2p, true);
+	cryptonote::cryptonote_connection_context &a = p2p.add_peer(P2P_SUPPORT_FLAGS);
+	cryptonote::cryptonote_connection_context &b = p2p.add_peer(P2P_SUPPORT_FLAGS);
+	core.pool.insert(make_txid(1));
+
+	cryptonote::NOTIFY_TX_INVENTORY::request inv;
+	inv.tx_hashes = {make_txid(1), make_txid(2), make_txid(3)};
+	receive<cryptonote::NOTIFY_TX_INVENTORY>(handler, inv, a);
+	ASSERT_EQ(p2p.txids_sent(cryptonote::NOTIFY_REQUEST_TX::ID, a.m_connection_id), std::vector<crypto::hash>({make_txid(2), make_txid(3)}));
+
+	// already asked from a
+	receive<cryptonote::NOTIFY_TX_INVENTORY>(handler, inv, b);
+	ASSERT_TRUE(p2p.txids_sent(cryptonote::NOTIFY_REQUEST_TX::ID, b.m_connection_id).empty());
+
+	// the answer goes in the pool and is not announced back to where it came from
+	cryptonote::NOTIFY_NEW_TRANSACTIONS::request txs;
+	txs.txs = {tx_blob(make_txid(2)), tx_blob(make_txid(3))};
+	receive<cryptonote::NOTIFY_NEW_TRANSACTIONS>(handler, txs, a);
+	ASSERT_TRUE(core.pool_has_tx(make_txid(2)));
+	ASSERT_TRUE(core.pool_has_tx(make_txid(3)));
+
+	// b announced them as well, so it is not told about them either
+	p2p.messages.clear();
+	handler.on_idle();
+	ASSERT_TRUE(p2p.messages.empty());
+}
+
+TEST(tx_relay, request_answers_known_only)
+{
+	relay_core core;
+	relay_endpoint p2p;
+	relay_handler handler(core, &p2p, true);
+	cryptonote::cryptonote_connection_context &source = p2p.add_peer(0);
+	cryptonote::cryptonote_connection_context &peer = p2p.add_peer(P2P_SUPPORT_FLAGS);
+	core.pool.insert(make_txid(1));
+	core.pool.insert(make_txid(2));
+
+	relay(handler, {make_txid(1)}, source);
+	p2p.messages.clear();
+
+	// txid 2 is in the pool but was never announced to the peer
+	cryptonote::NOTIFY_REQUEST_TX::request req;
+	req.tx_hashes = {make_txid(1), make_txid(2), make_txid(3)};
+	receive<cryptonote::NOTIFY_REQUEST_TX>(handler, req, peer);
+	ASSERT_EQ(p2p.txids_sent(cryptonote::NOTIFY_NEW_TRANSACTIONS::ID, peer.m_connection_id), std::vector<crypto::hash>{make_txid(1)});
+}
+
+TEST(tx_relay, rerequest_from_next_announcer)
+{
+	relay_core core;
+	relay_endpoint p2p;
+	relay_handler handler(core, &p2p, true);
+	cryptonote::cryptonote_connection_context &a = p2p.add_peer(P2P_SUPPORT_FLAGS);
+	cryptonote::cryptonote_connection_context &b = p2p.add_peer(P2P_SUPPORT_FLAGS);
+	cryptonote::cryptonote_connection_context &c = p2p.add_peer(P2P_SUPPORT_FLAGS);
+
+	cryptonote::NOTIFY_TX_INVENTORY::request inv;
+	inv.tx_hashes = {make_txid(1), make_txid(2)};
+	receive<cryptonote::NOTIFY_TX_INVENTORY>(handler, inv, a);
+	receive<cryptonote::NOTIFY_TX_INVENTORY>(handler, inv, b);
+	receive<cryptonote::NOTIFY_TX_INVENTORY>(handler, inv, c);
+	ASSERT_EQ(p2p.txids_sent(cryptonote::NOTIFY_REQUEST_TX::ID, a.m_connection_id), inv.tx_hashes);
+
+	// txid 2 turns up from elsewhere before a goes away without answering
+	core.pool.insert(make_txid(2));
+	handler.on_connection_close(a);
+	p2p.messages.clear();
+	handler.on_idle();
+	ASSERT_EQ(p2p.txids_sent(cryptonote::NOTIFY_REQUEST_TX::ID, b.m_connection_id), std::vector<crypto::hash>{make_txid(1)});
+	ASSERT_TRUE(p2p.txids_sent(cryptonote::NOTIFY_REQUEST_TX::ID, c.m_connection_id).empty());
+
+	// b goes too, c is next
+	handler.on_connection_close(b);
+	p2p.messages.clear();
+	handler.on_idle();
+	ASSERT_EQ(p2p.txids_sent(cryptonote::NOTIFY_REQUEST_TX::ID, c.m_connection_id), std::vector<crypto::hash>{make_txid(1)});
+}
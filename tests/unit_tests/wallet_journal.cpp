@@ -0,0 +1,285 @@
+// Copyright (c) 2020, pasta Currency Project
+//
+// Portions of this file are available under BSD-3 license. Please see ORIGINAL-LICENSE for details
+// All rights reserved.
+//
+// Authors and copyright holders give permission for following:
+//
+// 1. Redistribution and use in source and binary forms WITHOUT modification.
+//
+// 2. Modification of the source form for your own personal use.
+//
+// As long as the following conditions are met:
+//
+// 3. You must not distribute modified copies of the work to third parties. This includes
+//    posting the work online, or hosting copies of the modified work for download.
+//
+// 4. Any derivative version of this work is also covered by this license, including point 8.
+//
+// 5. Neither the name of the copyright holders nor the names of the authors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+//
+// 6. You agree that this licence is governed by and shall be construed in accordance
+//    with the laws of England and Wales.
+//
+// 7. You agree to submit all disputes arising out of or in connection with this licence
+//    to the exclusive jurisdiction of the Courts of England and Wales.
+//
+// Authors and copyright holders agree that:
+//
+// 8. This licence expires and the work covered by it is released into the
+//    public domain on 1st of February 2021
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "gtest/gtest.h"
+#include <boost/filesystem.hpp>
+
+#include "wallet/wallet2.h"
+#include "file_io_utils.h"
+#include "serialization/binary_utils.h"
+
+class WalletJournal : public ::testing::Test
+{
+  protected:
+	virtual void SetUp()
+	{
+		dir = boost::filesystem::temp_directory_path() / boost::filesystem::unique_path();
+		ASSERT_TRUE(boost::filesystem::create_directory(dir));
+		wallet_file = (dir / "wallet").string();
+		w.generate_legacy(wallet_file, password, recovery_key);
+		ASSERT_FALSE(has_journal());
+	}
+
+	virtual void TearDown()
+	{
+		boost::system::error_code ec;
+		boost::filesystem::remove_all(dir, ec);
+	}
+
+	static void add_block(tools::wallet2 &wallet, int n)
+	{
+		crypto::hash hash = crypto::null_hash;
+		memcpy(&hash, &n, sizeof(n));
+		wallet.m_blockchain.push_back(hash);
+	}
+
+	static uint64_t blockchain_size(const tools::wallet2 &wallet) { return wallet.m_blockchain.size(); }
+
+	// an output of ours, its key image known
+	static void add_transfer(tools::wallet2 &wallet, char n, uint64_t amount)
+	{
+		tools::wallet2::transfer_details td = boost::value_initialized<tools::wallet2::transfer_details>();
+		td.m_tx.vout.push_back({amount, cryptonote::txout_to_key(key_of<crypto::public_key>(n))});
+		td.m_txid = key_of<crypto::hash>(n);
+		td.m_key_image = key_of<crypto::key_image>(n);
+		td.m_key_image_known = true;
+		td.m_amount = amount;
+		wallet.m_key_images[td.m_key_image] = wallet.m_transfers.size();
+		wallet.m_pub_keys[td.get_public_key()] = wallet.m_transfers.size();
+		wallet.m_transfers.push_back(td);
+	}
+
+	// a pool tx spending transfer n with amount, as process_new_transaction sees it
+	static void spend_in_pool(tools::wallet2 &wallet, char n, uint64_t amount)
+	{
+		cryptonote::transaction tx;
+		cryptonote::txin_to_key in;
+		in.amount = amount;
+		in.k_image = key_of<crypto::key_image>(n);
+		tx.vin.push_back(in);
+		wallet.process_new_transaction(key_of<crypto::hash>('p'), tx, {}, 0, 0, false, true, false);
+	}
+
+	template <typename T>
+	static T key_of(char n)
+	{
+		static_assert(sizeof(T) == sizeof(crypto::hash), "32 byte keys only");
+		const crypto::hash h = crypto::cn_fast_hash(&n, 1);
+		T k;
+		memcpy(&k, &h, sizeof(k));
+		return k;
+	}
+
+	static void set_spent(tools::wallet2 &wallet, size_t idx, bool spent)
+	{
+		if(spent)
+			wallet.set_spent(idx, 10);
+		else
+			wallet.set_unspent(idx);
+	}
+
+	static const tools::wallet2::transfer_details &transfer(const tools::wallet2 &wallet, size_t idx) { return wallet.m_transfers[idx]; }
+	static size_t transfers(const tools::wallet2 &wallet) { return wallet.m_transfers.size(); }
+	static size_t subaddresses(const tools::wallet2 &wallet) { return wallet.m_subaddresses.size(); }
+
+	static size_t journal_header_size()
+	{
+		tools::wallet2::cache_journal_header hdr = boost::value_initialized<tools::wallet2::cache_journal_header>();
+		std::stringstream ss;
+		binary_archive<true> ar(ss);
+		EXPECT_TRUE(::serialization::serialize(ar, hdr));
+		return ss.str().size();
+	}
+
+	bool has_journal() const { return boost::filesystem::exists(wallet_file + ".journal"); }
+
+	std::string journal() const
+	{
+		std::string buf;
+		EXPECT_TRUE(epee::file_io_utils::load_file_to_string(wallet_file + ".journal", buf));
+		return buf;
+	}
+
+	void set_journal(const std::string &buf) const
+	{
+		ASSERT_TRUE(epee::file_io_utils::save_string_to_file(wallet_file + ".journal", buf));
+	}
+
+	// two records on top of the snapshot, each one block and one tx note
+	void store_two_records()
+	{
+		add_block(w, 1);
+		w.set_tx_note(txid1, "first");
+		w.store();
+		record1 = journal();
+
+		add_block(w, 2);
+		w.set_tx_note(txid2, "second");
+		w.store();
+		ASSERT_GT(journal().size(), record1.size());
+	}
+
+	boost::filesystem::path dir;
+	std::string wallet_file;
+	tools::wallet2 w;
+	const std::string password = "testpass";
+	crypto::secret_key recovery_key = crypto::secret_key();
+	const crypto::hash txid1 = crypto::cn_fast_hash("1", 1);
+	const crypto::hash txid2 = crypto::cn_fast_hash("2", 1);
+	std::string record1; // journal header and first record
+};
+
+TEST_F(WalletJournal, replays_records)
+{
+	const uint64_t base_height = blockchain_size(w);
+	add_block(w, 1);
+	w.set_tx_note(txid1, "note");
+	w.set_attribute("key", "value");
+	w.store();
+	ASSERT_TRUE(has_journal());
+
+	add_block(w, 2);
+	w.add_subaddress_account("second");
+	w.set_subaddress_label({0, 0}, "renamed");
+	ASSERT_TRUE(w.add_address_book_row(w.get_subaddress({1, 0}), crypto::uniform_payment_id(), "friend", true));
+	w.store();
+
+	// only the changes are journaled, not the subaddress table and the rest of the cache
+	ASSERT_LT(boost::filesystem::file_size(wallet_file + ".journal"), boost::filesystem::file_size(wallet_file) / 4);
+
+	tools::wallet2 w2;
+	w2.load(wallet_file, password);
+	ASSERT_EQ(blockchain_size(w2), base_height + 2);
+	ASSERT_EQ(w2.get_tx_note(txid1), "note");
+	ASSERT_EQ(w2.get_attribute("key"), "value");
+	ASSERT_EQ(w2.get_num_subaddress_accounts(), 2);
+	ASSERT_EQ(w2.get_subaddress_label({0, 0}), "renamed");
+	ASSERT_EQ(w2.get_subaddress_label({1, 0}), "second");
+	ASSERT_EQ(subaddresses(w2), subaddresses(w));
+	ASSERT_EQ(w2.get_address_book().size(), 1);
+	ASSERT_EQ(w2.get_address_book()[0].m_description, "friend");
+
+	// and stores on top of the loaded journal append to it
+	w2.set_tx_note(txid2, "more");
+	w2.store();
+	tools::wallet2 w3;
+	w3.load(wallet_file, password);
+	ASSERT_EQ(w3.get_tx_note(txid1), "note");
+	ASSERT_EQ(w3.get_tx_note(txid2), "more");
+}
+
+TEST_F(WalletJournal, torn_journal)
+{
+	const uint64_t base_height = blockchain_size(w);
+	store_two_records();
+	const std::string buf = journal();
+	set_journal(buf.substr(0, buf.size() - 5));
+
+	tools::wallet2 w2;
+	w2.load(wallet_file, password);
+	ASSERT_EQ(blockchain_size(w2), base_height + 1);
+	ASSERT_EQ(w2.get_tx_note(txid1), "first");
+	ASSERT_EQ(w2.get_tx_note(txid2), "");
+
+	// the next store writes a snapshot instead of appending after the torn record
+	w2.store();
+	ASSERT_FALSE(has_journal());
+	tools::wallet2 w3;
+	w3.load(wallet_file, password);
+	ASSERT_EQ(blockchain_size(w3), base_height + 1);
+	ASSERT_EQ(w3.get_tx_note(txid1), "first");
+}
+
+TEST_F(WalletJournal, mismatched_journal)
+{
+	const uint64_t base_height = blockchain_size(w);
+	store_two_records();
+
+	// the first record twice, its second copy starts below the hashchain it already grew
+	const std::string buf = journal();
+	set_journal(record1 + record1.substr(journal_header_size()) + buf.substr(record1.size()));
+
+	tools::wallet2 w2;
+	ASSERT_NO_THROW(w2.load(wallet_file, password));
+	ASSERT_EQ(blockchain_size(w2), base_height + 1);
+	ASSERT_EQ(w2.get_tx_note(txid1), "first");
+	ASSERT_EQ(w2.get_tx_note(txid2), "");
+
+	w2.store();
+	ASSERT_FALSE(has_journal());
+	tools::wallet2 w3;
+	w3.load(wallet_file, password);
+	ASSERT_EQ(blockchain_size(w3), base_height + 1);
+}
+
+TEST_F(WalletJournal, replays_transfer_changes)
+{
+	add_transfer(w, 'a', 100);
+	add_transfer(w, 'b', 200);
+	w.store();
+	ASSERT_TRUE(has_journal());
+
+	// a new transfer, a spent flag and an amount corrected by a spending tx, each on top of the last record
+	add_transfer(w, 'c', 300);
+	set_spent(w, 0, true);
+	spend_in_pool(w, 'b', 150);
+	ASSERT_EQ(transfer(w, 1).amount(), 150);
+	ASSERT_FALSE(transfer(w, 1).m_spent);
+	w.store();
+
+	tools::wallet2 w2;
+	w2.load(wallet_file, password);
+	ASSERT_EQ(transfers(w2), 3);
+	ASSERT_TRUE(transfer(w2, 0).m_spent);
+	ASSERT_EQ(transfer(w2, 0).m_spent_height, 10);
+	ASSERT_EQ(transfer(w2, 1).amount(), 150);
+	ASSERT_EQ(transfer(w2, 2).amount(), 300);
+
+	// and flipping back to unspent
+	set_spent(w2, 0, false);
+	w2.store();
+	tools::wallet2 w3;
+	w3.load(wallet_file, password);
+	ASSERT_FALSE(transfer(w3, 0).m_spent);
+	ASSERT_EQ(transfer(w3, 1).amount(), 150);
+}
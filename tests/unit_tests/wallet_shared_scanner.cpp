@@ -0,0 +1,193 @@
+// Copyright (c) 2020, pasta Currency Project
+//
+// Portions of this file are available under BSD-3 license. Please see ORIGINAL-LICENSE for details
+// All rights reserved.
+//
+// Authors and copyright holders give permission for following:
+//
+// 1. Redistribution and use in source and binary forms WITHOUT modification.
+//
+// 2. Modification of the source form for your own personal use.
+//
+// As long as the following conditions are met:
+//
+// 3. You must not distribute modified copies of the work to third parties. This includes
+//    posting the work online, or hosting copies of the modified work for download.
+//
+// 4. Any derivative version of this work is also covered by this license, including point 8.
+//
+// 5. Neither the name of the copyright holders nor the names of the authors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+//
+// 6. You agree that this licence is governed by and shall be construed in accordance
+//    with the laws of England and Wales.
+//
+// 7. You agree to submit all disputes arising out of or in connection with this licence
+//    to the exclusive jurisdiction of the Courts of England and Wales.
+//
+// Authors and copyright holders agree that:
+//
+// 8. This licence expires and the work covered by it is released into the
+//    public domain on 1st of February 2021
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "gtest/gtest.h"
+#include <thread>
+
+#include "wallet/wallet2.h"
+
+class WalletSharedScanner : public ::testing::Test
+{
+  protected:
+	using scan_data = tools::wallet2::wallet_rpc_scan_data;
+	using member = tools::wallet_shared_scanner::scan_member;
+
+	virtual void SetUp()
+	{
+		a.generate_legacy("", "", crypto::secret_key());
+		b.generate_legacy("", "", crypto::secret_key());
+		// both wallets on the test chain, spans start at a block the lead wallet has, like the daemon's do
+		a.m_blockchain[0] = block_hash(0);
+		b.m_blockchain[0] = block_hash(0);
+	}
+
+	static crypto::hash block_hash(uint64_t height)
+	{
+		return crypto::cn_fast_hash(&height, sizeof(height));
+	}
+
+	static void add_blocks(tools::wallet2 &wallet, uint64_t count)
+	{
+		for(uint64_t i = 0; i < count; i++)
+		{
+			wallet.m_blockchain.push_back(block_hash(wallet.m_blockchain.size()));
+			++wallet.m_local_bc_height;
+		}
+	}
+
+	static uint64_t height(const tools::wallet2 &wallet) { return wallet.m_blockchain.size(); }
+
+	// blocks [from, to) without transactions, nothing found for any of the accounts
+	static scan_data make_span(uint64_t from, uint64_t to, size_t accounts)
+	{
+		scan_data res{};
+		res.key_images.init(1);
+		for(uint64_t h = from; h < to; h++)
+		{
+			scan_data::block_complete_entry_parsed blke{};
+			blke.block_height = h;
+			blke.block_hash = block_hash(h);
+			res.blocks_parsed.push_back(blke);
+		}
+		res.o_indices.resize(res.blocks_parsed.size());
+		res.accounts.resize(accounts);
+		for(auto &acc : res.accounts)
+			acc.skipped.resize(res.blocks_parsed.size(), false);
+		return res;
+	}
+
+	std::vector<member> members()
+	{
+		return {{{&a, &a_lock}, height(a), false, false}, {{&b, &b_lock}, height(b), false, false}};
+	}
+
+	static void merge(scan_data &res, std::vector<member> &m)
+	{
+		tools::wallet_shared_scanner::merge_span(res, m);
+	}
+
+	tools::wallet2 a, b;
+	boost::mutex a_lock, b_lock;
+};
+
+TEST_F(WalletSharedScanner, merges_span_into_each_wallet)
+{
+	ASSERT_EQ(height(a), 1);
+	ASSERT_EQ(height(b), 1);
+	add_blocks(a, 2);
+
+	std::vector<member> m = members();
+	scan_data res = make_span(0, 5, m.size());
+	merge(res, m);
+
+	// a already had blocks 1 and 2, both end up at the top of the span
+	ASSERT_EQ(height(a), 5);
+	ASSERT_EQ(height(b), 5);
+	ASSERT_EQ(a.get_blockchain_current_height(), 5);
+	ASSERT_EQ(b.get_blockchain_current_height(), 5);
+	ASSERT_TRUE(res.accounts[0].skipped[2] && !res.accounts[0].skipped[3]);
+	ASSERT_TRUE(res.accounts[1].skipped[0] && !res.accounts[1].skipped[1]);
+	for(const member &mb : m)
+		ASSERT_FALSE(mb.failed || mb.alone);
+}
+
+TEST_F(WalletSharedScanner, wallet_behind_the_span_refreshes_alone)
+{
+	add_blocks(a, 4);
+
+	std::vector<member> m = members();
+	scan_data res = make_span(4, 7, m.size());
+	merge(res, m);
+
+	ASSERT_EQ(height(a), 7);
+	ASSERT_FALSE(m[0].alone);
+	// b's hashchain ends below the span, it is left alone for its own refresh
+	ASSERT_EQ(height(b), 1);
+	ASSERT_TRUE(m[1].alone);
+	ASSERT_FALSE(m[1].failed);
+}
+
+TEST_F(WalletSharedScanner, merge_holds_each_wallet_lock)
+{
+	std::vector<member> m = members();
+	scan_data res = make_span(0, 3, m.size());
+
+	boost::unique_lock<boost::mutex> b_held(b_lock);
+	std::thread merger([&]() { merge(res, m); });
+
+	// a is merged while b's owner still holds b
+	for(;;)
+	{
+		boost::unique_lock<boost::mutex> lock(a_lock);
+		if(height(a) == 3)
+			break;
+		lock.unlock();
+		std::this_thread::yield();
+	}
+	ASSERT_EQ(height(b), 1);
+
+	b_held.unlock();
+	merger.join();
+	ASSERT_EQ(height(b), 3);
+}
+
+TEST_F(WalletSharedScanner, registers_wallets_on_one_daemon)
+{
+	tools::wallet_shared_scanner scanner;
+	ASSERT_TRUE(scanner.add_wallet(a, a_lock));
+	ASSERT_TRUE(scanner.add_wallet(a, a_lock));
+	ASSERT_TRUE(scanner.add_wallet(b, b_lock));
+	ASSERT_EQ(scanner.wallet_count(), 2);
+
+	tools::wallet2 c;
+	boost::mutex c_lock;
+	c.generate_legacy("", "", crypto::secret_key());
+	ASSERT_TRUE(c.init("203.0.113.1:19734"));
+	ASSERT_FALSE(scanner.add_wallet(c, c_lock));
+	ASSERT_EQ(scanner.wallet_count(), 2);
+
+	scanner.remove_wallet(a);
+	ASSERT_EQ(scanner.wallet_count(), 1);
+	scanner.remove_wallet(b);
+	ASSERT_EQ(scanner.wallet_count(), 0);
+}